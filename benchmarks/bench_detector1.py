@@ -0,0 +1,45 @@
+"""
+Benchmarks of the hot paths of calwebb_detector1: jump detection and ramp
+fitting, from subarrays to full frames and for a range of group counts and
+core counts.
+"""
+from jwst.jump import jump
+from jwst.ramp_fitting import ramp_fit
+
+from .data import SHAPES, _Benchmark, accepts, ramp_models, require
+
+
+class _RampBenchmark(_Benchmark):
+    params = [['SUB64P', 'SUB400P', 'FULL'], [10, 50, 200],
+              [None, 'half', 'all']]
+    param_names = ['shape', 'ngroups', 'max_cores']
+
+    def setup(self, shape, ngroups, max_cores):
+        self.model, self.gain, self.readnoise = ramp_models(ngroups, shape)
+
+    def work(self, shape, ngroups, max_cores):
+        nrows, ncols = SHAPES[shape]
+        return ngroups * nrows * ncols / 1e6
+
+
+class JumpDetection(_RampBenchmark):
+    """Two-point difference jump detection, `find_crs` through `detect_jumps`."""
+
+    def run(self, shape, ngroups, max_cores):
+        jump.detect_jumps(self.model, self.gain, self.readnoise, 4.0,
+                          max_cores, 200., 10., True)
+
+
+class OLSRampFit(_RampBenchmark):
+    """Ordinary least squares ramp fit, `ols_ramp_fit`."""
+
+    def setup(self, shape, ngroups, max_cores):
+        if max_cores is not None:
+            require(accepts(ramp_fit.ramp_fit, 'max_cores'),
+                    'The max_cores argument of ramp_fit')
+        super().setup(shape, ngroups, max_cores)
+
+    def run(self, shape, ngroups, max_cores):
+        kwargs = {} if max_cores is None else {'max_cores': max_cores}
+        ramp_fit.ramp_fit(self.model, ramp_fit.BUFSIZE, False, self.readnoise,
+                          self.gain, 'OLS', 'optimal', **kwargs)
@@ -0,0 +1,32 @@
+"""
+Benchmarks of the hot paths of calwebb_image3: drizzling dithered
+exposures onto the output mosaic.
+"""
+from jwst.resample import resample
+
+from .data import SHAPES, _Benchmark, imaging_models, require
+
+
+class ResampleImages(_Benchmark):
+    """Drizzle of all the exposures to one mosaic, `ResampleData.do_drizzle`."""
+    params = [['SUB400P', 'FULL'], [4, 16, 100], [None, 'all']]
+    param_names = ['shape', 'nexposures', 'max_cores']
+
+    def setup(self, shape, nexposures, max_cores):
+        # ResampleData takes any keyword, but only uses maximum_cores since
+        # it computes the pixel maps in parallel
+        if max_cores is not None:
+            require(hasattr(resample.ResampleData, 'iter_pixmaps'),
+                    'The maximum_cores parameter of ResampleData')
+        models = imaging_models(nexposures, shape)
+        self.resamp = resample.ResampleData(
+            models, pixfrac=1.0, kernel='square', fillval='INDEF',
+            weight_type='exptime', good_bits=6, single=False,
+            blendheaders=False, maximum_cores=max_cores)
+
+    def run(self, shape, nexposures, max_cores):
+        self.resamp.do_drizzle()
+
+    def work(self, shape, nexposures, max_cores):
+        nrows, ncols = SHAPES[shape]
+        return nexposures * nrows * ncols / 1e6
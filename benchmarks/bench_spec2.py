@@ -0,0 +1,51 @@
+"""
+Benchmarks of the hot paths of calwebb_spec2: the fast-varying component
+of the NIRSpec flat field and the mapping of the IFU point cloud to the
+cube spaxels.
+"""
+import numpy as np
+
+from jwst.cube_build import cube_cloud
+from jwst.flatfield import flat_field
+
+from .data import SHAPES, _Benchmark, point_cloud, require, slit_flat_inputs
+
+
+class CombineFastSlow(_Benchmark):
+    """Fast-varying flat component of a slit, `combine_fast_slow`."""
+    params = [['SLITLET', 'FULL'], [1, 2]]
+    param_names = ['shape', 'dispaxis']
+
+    def setup(self, shape, dispaxis):
+        self.inputs = slit_flat_inputs(shape, dispaxis=dispaxis)
+
+    def run(self, shape, dispaxis):
+        flat_field.combine_fast_slow(*self.inputs, dispaxis)
+
+    def work(self, shape, dispaxis):
+        nrows, ncols = SHAPES[shape]
+        return nrows * ncols / 1e6
+
+
+class MatchDet2CubeMSM(_Benchmark):
+    """Point cloud to IFU cube mapping, `match_det2cube_msm`."""
+    params = [[10000, 100000], ['msm', 'emsm']]
+    param_names = ['npoints', 'weighting']
+
+    def setup(self, npoints, weighting):
+        require(hasattr(cube_cloud, 'SpaxelIndex'), 'cube_cloud.SpaxelIndex')
+        self.cube, self.cloud = point_cloud(npoints)
+        self.spaxel_index = cube_cloud.SpaxelIndex(
+            self.cube['naxis1'], self.cube['naxis2'], self.cube['xcenters'],
+            self.cube['ycenters'], self.cube['zcoord'])
+
+    def run(self, npoints, weighting):
+        nspaxels = self.cube['naxis1'] * self.cube['naxis2'] * self.cube['naxis3']
+        spaxels = {name: np.zeros(nspaxels) for name in
+                   ('spaxel_flux', 'spaxel_weight', 'spaxel_iflux', 'spaxel_var')}
+        cube_cloud.match_det2cube_msm(weighting_type=weighting,
+                                      spaxel_index=self.spaxel_index,
+                                      **self.cube, **spaxels, **self.cloud)
+
+    def work(self, npoints, weighting):
+        return npoints / 1e6
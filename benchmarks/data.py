@@ -0,0 +1,328 @@
+"""
+Synthetic datasets for the benchmarks.
+
+The datasets are generated from a fixed seed, so that every commit is
+benchmarked on the same data. Their shapes follow the JWST detectors, from
+subarrays to full frames, and the sizes too large for the machine running
+the benchmarks are skipped (see `check_size`).
+"""
+import inspect
+import os
+import time
+
+import numpy as np
+from astropy import coordinates as coord
+from astropy import units as u
+from astropy.modeling.models import (Shift, Scale, Pix2Sky_TAN,
+                                     RotateNative2Celestial)
+from gwcs import WCS
+from gwcs import coordinate_frames as cf
+
+from jwst import datamodels
+
+# (nrows, ncols) of the detector areas used by the benchmarks
+SHAPES = {
+    'SLITLET': (40, 2048),
+    'SUB64P': (64, 64),
+    'SUB400P': (400, 400),
+    'FULL': (2048, 2048),
+}
+
+# Largest number of elements of the main array of a dataset. Larger datasets
+# are skipped, unless allowed by setting JWST_BENCHMARK_MAX_ELEMENTS.
+MAX_ELEMENTS = int(os.environ.get('JWST_BENCHMARK_MAX_ELEMENTS', 2**26))
+
+SEED = 42
+
+
+class _Benchmark:
+    """
+    Time, peak memory and throughput of `run`.
+
+    The name is private so that asv does not collect this base class itself.
+    Subclasses set the asv ``params`` and ``param_names``, create their inputs
+    in ``setup`` and define `run` and `work`, the size of the work done by
+    `run`, in the unit of `track_throughput`.
+    """
+    number = 1
+    repeat = (1, 3, 60.0)
+    timeout = 1200
+
+    def run(self, *params):
+        raise NotImplementedError
+
+    def work(self, *params):
+        raise NotImplementedError
+
+    def time_run(self, *params):
+        self.run(*params)
+
+    def peakmem_run(self, *params):
+        self.run(*params)
+
+    def track_throughput(self, *params):
+        start = time.perf_counter()
+        self.run(*params)
+        return self.work(*params) / (time.perf_counter() - start)
+
+    track_throughput.unit = 'Mpix/s'
+
+
+def check_size(nelements):
+    """
+    Skip the benchmark if a dataset of `nelements` is larger than
+    `MAX_ELEMENTS`.
+
+    asv skips a benchmark whose ``setup`` raises NotImplementedError.
+    """
+    if nelements > MAX_ELEMENTS:
+        raise NotImplementedError(
+            'Dataset of {} elements larger than JWST_BENCHMARK_MAX_ELEMENTS'
+            .format(nelements))
+
+
+def require(available, feature):
+    """
+    Skip the benchmark if `feature` is not `available` in the commit being
+    benchmarked, e.g. an older commit compared by ``asv continuous``.
+    """
+    if not available:
+        raise NotImplementedError(
+            '{} is not available in this commit'.format(feature))
+
+
+def accepts(func, name):
+    """
+    True if `func` has a parameter `name`.
+    """
+    return name in inspect.signature(func).parameters
+
+
+def ramp_models(ngroups, shape, nints=1, rate=5., readnoise=10., gain=1.,
+                cr_fraction=1e-3):
+    """
+    RampModel of linear ramps with read noise and jumps, with its gain and
+    read noise models.
+
+    Parameters
+    ----------
+    ngroups : int
+        Number of groups of each integration.
+    shape : str
+        Key of `SHAPES`.
+    nints : int
+        Number of integrations.
+    rate : float
+        Count rate, in DN per group.
+    readnoise, gain : float
+        Read noise in DN and gain of every pixel.
+    cr_fraction : float
+        Fraction of the pixels of each group hit by a cosmic ray.
+
+    Returns
+    -------
+    model, gain_model, readnoise_model : `~jwst.datamodels.RampModel`,
+        `~jwst.datamodels.GainModel`, `~jwst.datamodels.ReadnoiseModel`
+    """
+    nrows, ncols = SHAPES[shape]
+    check_size(nints * ngroups * nrows * ncols)
+    rng = np.random.RandomState(SEED)
+
+    dims = (nints, ngroups, nrows, ncols)
+    data = rate * np.arange(ngroups, dtype=np.float32)[:, np.newaxis, np.newaxis]
+    data = np.broadcast_to(data, dims).copy()
+    data += rng.normal(scale=readnoise, size=dims).astype(np.float32)
+
+    # Each jump adds a step to the rest of its ramp
+    jumps = rng.random_sample(dims) < cr_fraction
+    data += np.cumsum(jumps * np.float32(500.), axis=1, dtype=np.float32)
+
+    model = datamodels.RampModel(
+        data=data,
+        err=np.ones(dims, dtype=np.float32),
+        pixeldq=np.zeros((nrows, ncols), dtype=np.uint32),
+        groupdq=np.zeros(dims, dtype=np.uint8))
+    model.meta.instrument.name = 'MIRI'
+    model.meta.instrument.detector = 'MIRIMAGE'
+    model.meta.instrument.filter = 'F480M'
+    model.meta.observation.date = '2015-10-13'
+    model.meta.exposure.type = 'MIR_IMAGE'
+    model.meta.exposure.frame_time = 1.
+    model.meta.exposure.group_time = 1.
+    model.meta.exposure.ngroups = ngroups
+    model.meta.exposure.nframes = 1
+    model.meta.exposure.groupgap = 0
+
+    gain_model = datamodels.GainModel(
+        data=np.full((nrows, ncols), gain, dtype=np.float32))
+    readnoise_model = datamodels.ReadnoiseModel(
+        data=np.full((nrows, ncols), readnoise, dtype=np.float32))
+    for m in (model, gain_model, readnoise_model):
+        m.meta.instrument.name = 'MIRI'
+        m.meta.subarray.xstart = 1
+        m.meta.subarray.ystart = 1
+        m.meta.subarray.xsize = ncols
+        m.meta.subarray.ysize = nrows
+    model.meta.subarray.name = 'FULL'
+
+    return model, gain_model, readnoise_model
+
+
+def imaging_wcs(shape, ra, dec, pscale=0.031):
+    """
+    Celestial gWCS of an image of `shape` (nrows, ncols) centered on `ra`,
+    `dec` (in degrees), with a pixel scale of `pscale` arcsec.
+    """
+    nrows, ncols = shape
+    cdelt = pscale / 3600.
+    transform = ((Shift(-(ncols - 1) / 2) & Shift(-(nrows - 1) / 2)) |
+                 (Scale(cdelt) & Scale(cdelt)) | Pix2Sky_TAN() |
+                 RotateNative2Celestial(ra, dec, 180.))
+    detector = cf.Frame2D(name='detector', axes_order=(0, 1),
+                          unit=(u.pix, u.pix))
+    world = cf.CelestialFrame(reference_frame=coord.ICRS(), name='world')
+    return WCS([(detector, transform), (world, None)])
+
+
+def imaging_models(nexposures, shape, ra=5.3, dec=-72.1, pscale=0.031,
+                   dither=20.):
+    """
+    Container of dithered, calibrated images, ready to be resampled.
+
+    Parameters
+    ----------
+    nexposures : int
+        Number of exposures.
+    shape : str
+        Key of `SHAPES`.
+    ra, dec : float
+        Center of the dither pattern, in degrees.
+    pscale : float
+        Pixel scale, in arcsec.
+    dither : float
+        Largest offset of an exposure from the center, in pixels.
+
+    Returns
+    -------
+    models : `~jwst.datamodels.ModelContainer`
+        `~jwst.datamodels.ImageModel` of each exposure.
+    """
+    shape = SHAPES[shape]
+    check_size(nexposures * shape[0] * shape[1])
+    rng = np.random.RandomState(SEED)
+    cdelt = pscale / 3600.
+
+    models = datamodels.ModelContainer()
+    for i in range(nexposures):
+        offset = rng.uniform(-dither, dither, size=2) * cdelt
+        model = datamodels.ImageModel(shape)
+        model.data[...] = rng.normal(loc=1., scale=0.1, size=shape)
+        model.err[...] = 0.1
+        model.meta.wcs = imaging_wcs(shape, ra + offset[0], dec + offset[1],
+                                     pscale=pscale)
+        model.meta.wcsinfo.wcsaxes = 2
+        model.meta.wcsinfo.ctype1 = 'RA---TAN'
+        model.meta.wcsinfo.ctype2 = 'DEC--TAN'
+        model.meta.wcsinfo.cdelt1 = cdelt
+        model.meta.wcsinfo.cdelt2 = cdelt
+        model.meta.wcsinfo.pc1_1 = 1.
+        model.meta.wcsinfo.pc1_2 = 0.
+        model.meta.wcsinfo.pc2_1 = 0.
+        model.meta.wcsinfo.pc2_2 = 1.
+        model.meta.coordinates.reference_frame = 'ICRS'
+        model.meta.instrument.name = 'NIRCAM'
+        model.meta.exposure.exposure_time = 100.
+        model.meta.exposure.start_time = 58000. + i
+        model.meta.exposure.end_time = 58000. + i + 0.01
+        model.meta.observation.program_number = '00001'
+        model.meta.observation.observation_number = '001'
+        model.meta.observation.visit_number = '001'
+        model.meta.observation.visit_group = '01'
+        model.meta.observation.sequence_id = '1'
+        model.meta.observation.activity_id = '01'
+        model.meta.observation.exposure_number = str(i + 1)
+        model.meta.filename = 'bench_{:04d}_cal.fits'.format(i)
+        models.append(model)
+    models.meta.resample.output = 'bench_i2d.fits'
+    return models
+
+
+def slit_flat_inputs(shape, dispaxis=1, ntab=2000):
+    """
+    Wavelengths of a slit and the fast-varying component of its flat.
+
+    Parameters
+    ----------
+    shape : str
+        Key of `SHAPES`.
+    dispaxis : int
+        1 is horizontal, 2 is vertical.
+    ntab : int
+        Length of the table of the fast-varying component.
+
+    Returns
+    -------
+    wl, flat_2d, flat_dq, tab_wl, tab_flat : ndarray
+        The arguments of `~jwst.flatfield.flat_field.combine_fast_slow`. The
+        wavelengths of the pixels outside of the slit are NaN.
+    """
+    nrows, ncols = SHAPES[shape]
+    check_size(nrows * ncols)
+    rng = np.random.RandomState(SEED)
+
+    ndisp = ncols if dispaxis == 1 else nrows
+    wave = np.linspace(0.6, 5.3, ndisp)
+    wl = np.broadcast_to(wave, (nrows, ncols)) if dispaxis == 1 else \
+        np.broadcast_to(wave[:, np.newaxis], (nrows, ncols))
+    wl = wl + rng.normal(scale=1e-4, size=(nrows, ncols))
+    wl[rng.random_sample((nrows, ncols)) < 0.01] = np.nan
+
+    flat_2d = rng.normal(loc=1., scale=0.01, size=(nrows, ncols)).astype(np.float32)
+    flat_dq = np.zeros((nrows, ncols), dtype=np.uint32)
+    tab_wl = np.linspace(0.5, 5.5, ntab)
+    tab_flat = 1. + 0.05 * np.sin(tab_wl * 7.)
+    return wl, flat_2d, flat_dq, tab_wl, tab_flat
+
+
+def point_cloud(npoints, naxis1=40, naxis2=40, naxis3=1000,
+                cdelt=0.13, cdelt3=0.001, wave0=5.0):
+    """
+    IFU cube grid and a point cloud of detector pixels that overlaps it.
+
+    Returns
+    -------
+    cube, cloud : dict
+        The cube axes ``naxis1, naxis2, naxis3, cdelt1, cdelt2, zcdelt3,
+        xcenters, ycenters, zcoord`` and the point cloud ``flux, err, coord1,
+        coord2, wave, rois_pixel, roiw_pixel, weight_pixel, softrad_pixel,
+        scalerad_pixel``, as needed by
+        `~jwst.cube_build.cube_cloud.match_det2cube_msm`.
+    """
+    check_size(npoints)
+    rng = np.random.RandomState(SEED)
+
+    xcoord = cdelt * (np.arange(naxis1) - (naxis1 - 1) / 2)
+    ycoord = cdelt * (np.arange(naxis2) - (naxis2 - 1) / 2)
+    ygrid, xgrid = np.meshgrid(ycoord, xcoord, indexing='ij')
+    cube = {
+        'naxis1': naxis1, 'naxis2': naxis2, 'naxis3': naxis3,
+        'cdelt1': cdelt, 'cdelt2': cdelt,
+        'zcdelt3': np.full(naxis3, cdelt3),
+        'xcenters': xgrid.flatten(), 'ycenters': ygrid.flatten(),
+        'zcoord': wave0 + cdelt3 * np.arange(naxis3),
+    }
+
+    half_width = cdelt * naxis1 / 2
+    cloud = {
+        'flux': rng.normal(loc=10., scale=1., size=npoints),
+        'err': np.full(npoints, 1.),
+        'coord1': rng.uniform(-half_width, half_width, npoints),
+        'coord2': rng.uniform(-half_width, half_width, npoints),
+        'wave': rng.uniform(cube['zcoord'][0], cube['zcoord'][-1], npoints),
+        'rois_pixel': np.full(npoints, 1.5 * cdelt),
+        'roiw_pixel': np.full(npoints, 1.5 * cdelt3),
+        'weight_pixel': np.full(npoints, 2.),
+        'softrad_pixel': np.full(npoints, 0.01),
+        'scalerad_pixel': np.full(npoints, 0.1),
+    }
+    return cube, cloud
@@ -95,6 +95,61 @@ def interf(kx, ky):
     return interference
 
 
+def fringing_pattern(ctrs, lam, phi, pitch, size, offx, offy):
+    """
+    Short Summary
+    -------------
+    Calculate the interference for all holes over a grid of image plane
+    pixels; this is np.fromfunction(interf, size).transpose() for the same
+    parameters.
+
+    The phasor of a hole is the product of a term depending only on the
+    column and a term depending only on the row, so the sum over the holes is
+    the product of a (rows x holes) and a (holes x columns) matrix, and the
+    exponentials are only evaluated along the axes.
+
+    Parameters
+    ----------
+    ctrs: 2D float array
+        centers of holes
+
+    lam: float
+        wavelength
+
+    phi: float 1D array
+        distance of fringe from hole center in units of waves, for each hole
+
+    pitch: float
+        sampling pitch in radians in image plane
+
+    size: integer, integer
+        number of columns and rows of the grid
+
+    offx, offy: float, float
+        offsets of the center of the grid in pixels
+
+    Returns
+    -------
+    fringing: 2D complex array
+        interference for all holes, indexed by row and column
+    """
+    ctrs = np.asarray(ctrs, dtype=np.float64)
+    phi = np.broadcast_to(np.asarray(phi, dtype=np.float64), (len(ctrs),))
+
+    kx = np.arange(size[0]) - offx
+    ky = np.arange(size[1]) - offy
+
+    # (holes x columns), including the piston of each hole
+    colterms = np.exp(-2 * np.pi * 1j * (pitch * np.outer(ctrs[:, 0], kx)
+                                         + phi[:, np.newaxis]) / lam)
+    # (rows x holes)
+    rowterms = np.exp(-2 * np.pi * 1j * pitch * np.outer(ky, ctrs[:, 1]) / lam)
+
+    fringing = np.dot(rowterms, colterms)
+
+    return fringing
+
+
 def ASF(pixel, fov, oversample, ctrs, d, lam, phi, centering=(0.5, 0.5)):
     """
     Short Summary
@@ -159,17 +214,10 @@ def ASF(pixel, fov, oversample, ctrs, d, lam, phi, centering=(0.5, 0.5)):
                                          int((oversample * fov))))
     primarybeam = primarybeam.transpose()
 
-    # interference terms' parameters
-    interf.lam = lam
-    interf.offx = oversample * fov / 2.0 - off_x # in pixels
-    interf.offy = oversample * fov / 2.0 - off_y
-    interf.pitch = pixel / float(oversample)
-    interf.ctrs = ctrs
-    interf.phi = phi
-
-    fringing = np.fromfunction(interf, (int((oversample * fov)),
-                                        int((oversample * fov))))
-    fringing = fringing.transpose()
+    fringing = fringing_pattern(ctrs, lam, phi, pixel / float(oversample),
+                                (int((oversample * fov)), int((oversample * fov))),
+                                oversample * fov / 2.0 - off_x,
+                                oversample * fov / 2.0 - off_y)
 
     asf = primarybeam * fringing
 
@@ -236,17 +284,10 @@ def ASFfringe(pixel, fov, oversample, ctrs, d, lam, phi, centering=(0.5, 0.5)):
     Jinc.pitch = pixel / float(oversample)
     Jinc.d = d
 
-    # interference terms' parameters
-    interf.lam = lam
-    interf.offx = oversample * fov / 2.0 - off_x # in pixels
-    interf.offy = oversample * fov / 2.0 - off_y
-    interf.pitch = pixel / float(oversample)
-    interf.ctrs = ctrs
-    interf.phi = phi
-
-    fringing = np.fromfunction(interf, (int((oversample * fov)),
-                                        int((oversample * fov))))
-    fringing = fringing.transpose()
+    fringing = fringing_pattern(ctrs, lam, phi, pixel / float(oversample),
+                                (int((oversample * fov)), int((oversample * fov))),
+                                oversample * fov / 2.0 - off_x,
+                                oversample * fov / 2.0 - off_y)
 
     return fringing
 
@@ -310,20 +351,12 @@ def ASFhex(pixel, fov, oversample, ctrs, d, lam, phi, centering='PIXELCENTERED')
 
     pitch = pixel / float(oversample)
 
-    # interference terms' parameters
-    interf.lam = lam
-    interf.offx = (oversample * fov) / 2.0 - off_x # in pixels
-    interf.offy = (oversample * fov) / 2.0 - off_y
-    interf.pitch = pixel / float(oversample)
-    interf.ctrs = ctrs
-    interf.phi = phi
-
     primarybeam = hexee.hex_eeAG(s=(oversample * fov, oversample * fov),
                                  c=(offx, offy), d=d, lam=lam, pitch=pitch)
 
-    fringing = np.fromfunction(interf, (int((oversample * fov)),
-                                        int((oversample * fov))))
-    fringing = fringing.transpose()
+    fringing = fringing_pattern(ctrs, lam, phi, pitch,
+                                (int((oversample * fov)), int((oversample * fov))),
+                                offx, offy)
 
     asf = primarybeam * fringing
 
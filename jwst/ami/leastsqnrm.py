@@ -283,6 +283,55 @@ def ffs(kx, ky):
     return sin_array
 
 
+def fringe_terms(ri, rj, lam, pitch, size, offx, offy):
+    """
+    Short Summary
+    -------------
+    Calculate the cosine and sine terms of the analytic model for the
+    baseline between two holes; these are the transposed
+    np.fromfunction(ffc, size) and np.fromfunction(ffs, size) for the same
+    parameters.
+
+    The phase is the sum of a term depending only on the column and a term
+    depending only on the row, so the terms are outer products of the
+    cosines and sines evaluated along the axes.
+
+    Parameters
+    ----------
+    ri, rj: float 1D arrays
+        centers of the two holes
+
+    lam: float
+        wavelength
+
+    pitch: float
+        sampling pitch in radians in image plane
+
+    size: integer, integer
+        number of columns and rows of the grid
+
+    offx, offy: float, float
+        offsets of the center of the grid in pixels
+
+    Returns
+    -------
+    cos_array, sin_array: 2D float arrays
+        cosine and sine terms of analytic model
+    """
+    colphase = 2 * np.pi * pitch * (np.arange(size[0]) - offx) * \
+               (ri[0] - rj[0]) / lam
+    rowphase = 2 * np.pi * pitch * (np.arange(size[1]) - offy) * \
+               (ri[1] - rj[1]) / lam
+
+    cos_col, sin_col = np.cos(colphase), np.sin(colphase)
+    cos_row, sin_row = np.cos(rowphase), np.sin(rowphase)
+
+    cos_array = 2 * (np.outer(cos_row, cos_col) - np.outer(sin_row, sin_col))
+    sin_array = -2 * (np.outer(sin_row, cos_col) + np.outer(cos_row, sin_col))
+
+    return cos_array, sin_array
+
+
 def model_array(ctrs, lam, oversample, pitch, fov, d,
                 centering='PIXELCENTERED', shape='circ'):
     """
@@ -394,8 +443,8 @@ def model_array(ctrs, lam, oversample, pitch, fov, d,
         ffs.ri = ctrs[int(r[0])]
         ffs.rj = ctrs[int(r[1])]
 
-        ffmodel.append( np.transpose(np.fromfunction(ffc, ffc.size)) )
-        ffmodel.append( np.transpose(np.fromfunction(ffs, ffs.size)) )
+        ffmodel.extend(fringe_terms(ffc.ri, ffc.rj, ffc.lam, ffc.pitch,
+                                    ffc.size, ffc.offx, ffc.offy))
 
     if shape == 'circ': # if unspecified (default), or specified as 'circ'
         return np.fromfunction(primarybeam, ffc.size), ffmodel
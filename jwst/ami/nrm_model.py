@@ -19,6 +19,8 @@
 # - updated (hard refactored) Oct-Nov 2014 Anand S.
 
 import logging
+from collections import OrderedDict
+
 import numpy as np
 
 from . import leastsqnrm as leastsqnrm
@@ -31,6 +33,77 @@ log = logging.getLogger(__name__)
 log.setLevel(logging.DEBUG)
 
 
+class ModelCache:
+    """
+    Short Summary
+    -------------
+    Bounded cache of the simulated PSFs and fringe models, shared by the
+    NrmModel objects of a process.
+
+    The models only depend on the mask geometry, the bandpass, the
+    oversampling, the pixel scale and the rotation, so the PSFs simulated to
+    find the scale and rotation of an image are the same for all the
+    integrations and targets observed with a filter. The least recently used
+    entries are dropped once their arrays take more than max_bytes, and an
+    entry larger than max_bytes is not kept at all. The cached arrays are
+    read-only.
+
+    Parameters
+    ----------
+    max_bytes: integer
+        maximum size in bytes of the arrays kept
+    """
+
+    def __init__(self, max_bytes=64 * 1024**2):
+        self._entries = OrderedDict()
+        self.max_bytes = max_bytes
+        self.nbytes = 0
+        self.hits = 0
+        self.misses = 0
+
+    def __len__(self):
+        return len(self._entries)
+
+    def get(self, key, compute):
+        """
+        Return the entry for key, calling compute() to create it if it is
+        not in the cache.
+        """
+        try:
+            value = self._entries.pop(key)
+            self.hits += 1
+        except KeyError:
+            value = compute()
+            for a in value:
+                a.flags.writeable = False
+            self.misses += 1
+            size = sum(a.nbytes for a in value)
+            if size > self.max_bytes:
+                return value
+            self.nbytes += size
+        self._entries[key] = value
+        while self.nbytes > self.max_bytes:
+            _, dropped = self._entries.popitem(last=False)
+            self.nbytes -= sum(a.nbytes for a in dropped)
+        return value
+
+    def clear(self):
+        """ Remove all the entries."""
+        self._entries.clear()
+        self.nbytes = 0
+        self.hits = 0
+        self.misses = 0
+
+
+model_cache = ModelCache()
+
+
+def _array_key(a):
+    """ Hashable key of the values of an array or scalar."""
+    a = np.asarray(a, dtype=np.float64)
+    return a.shape, a.tobytes()
+
+
 class NrmModel:
 
     def __init__(self, mask=None, holeshape="circ", pixscale=hexee.mas2rad(65),
@@ -217,13 +290,42 @@ class NrmModel:
         else:
             self.pixel_sim = pixel
 
+        if not hasattr(self.bandpass, '__iter__'):
+            self.lam = bandpass
+
+        key = ('psf', _array_key(self.bandpass), self.fov_sim, self.over,
+               self.pixel_sim, _array_key(self.rotctrs), self.d,
+               _array_key(self.phi), str(centering), self.holeshape)
+        self.psf_over, self.psf = model_cache.get(
+            key, lambda: self._simulate_psf(centering))
+
+        return self.psf
+
+
+    def _simulate_psf(self, centering):
+        """
+        Short Summary
+        -------------
+        Calculate the oversampled and binned PSFs for the parameters set by
+        simulate().
+
+        Parameters
+        ----------
+        centering: string or float, float
+            type of centering
+
+        Returns
+        -------
+        psf_over, psf: 2D float arrays
+            oversampled and binned simulated psf
+        """
         # The polychromatic case:
         if hasattr(self.bandpass, '__iter__'):
             log.debug("------Simulating Polychromatic------")
-            self.psf_over = np.zeros((self.over*self.fov_sim,
-                                      self.over*self.fov_sim))
+            psf_over = np.zeros((self.over*self.fov_sim,
+                                 self.over*self.fov_sim))
             for w,l in self.bandpass: # w: weight, l: lambda (wavelength)
-                self.psf_over += w*analyticnrm2.PSF(self.pixel_sim,
+                psf_over += w*analyticnrm2.PSF(self.pixel_sim,
                             self.fov_sim, self.over, self.rotctrs, self.d, l,
                             self.phi, centering = centering, shape=self.holeshape)
 
@@ -231,17 +333,15 @@ class NrmModel:
 
         # The monochromatic case if bandpass input is a single wavelength
         else:
-            self.lam = bandpass
-
             log.debug("Calculating Oversampled PSF")
-            self.psf_over = analyticnrm2.PSF(self.pixel_sim, self.fov_sim,
+            psf_over = analyticnrm2.PSF(self.pixel_sim, self.fov_sim,
                             self.over, self.rotctrs, self.d, self.lam,
                             self.phi, centering=centering,
                             shape=self.holeshape)
 
-        self.psf = utils.rebin(self.psf_over, (self.over, self.over))
+        psf = utils.rebin(psf_over, (self.over, self.over))
 
-        return self.psf
+        return psf_over, psf
 
 
     def make_model(self, fov=None, bandpass=None, over=False,
@@ -316,36 +416,66 @@ class NrmModel:
 
         if not hasattr(bandpass, '__iter__'):
             self.lam = bandpass
-            self.model = np.ones((self.fov, self.fov, self.N*(self.N-1)+2))
-            self.model_beam, self.fringes = leastsqnrm.model_array(
+        else:
+            self.bandpass = bandpass
+
+        key = ('model', _array_key(bandpass), self.fov, self.over,
+               self.modelpix, _array_key(self.modelctrs), self.d,
+               str(centering), self.holeshape)
+        self.model, self.model_beam, self.fringes, self.model_over = \
+            model_cache.get(key, lambda: self._fringe_model(bandpass, centering))
+
+        return self.model
+
+
+    def _fringe_model(self, bandpass, centering):
+        """
+        Short Summary
+        -------------
+        Calculate the fringe model for the parameters set by make_model().
+
+        Parameters
+        ----------
+        bandpass: float or 2D float array
+            wavelength, or array of the form: [(weight1, wavl1), ...]
+
+        centering: string
+            type of centering
+
+        Returns
+        -------
+        model, model_beam, fringes, model_over: float arrays
+            binned fringe model, oversampled envelope, oversampled fringe
+            terms and oversampled model of the last wavelength
+        """
+        if not hasattr(bandpass, '__iter__'):
+            model_beam, fringes = leastsqnrm.model_array(
                      self.modelctrs, self.lam, self.over, self.modelpix,
                      self.fov, self.d, shape=self.holeshape, centering=centering)
 
             log.debug("centering: {0}".format(centering))
             log.debug("what primary beam has the model created?"+
-                                " {0}".format(self.model_beam))
+                                " {0}".format(model_beam))
 
             # this routine multiplies the envelope by each fringe "image"
-            self.model_over = leastsqnrm.multiplyenv(self.model_beam, self.fringes)
+            model_over = leastsqnrm.multiplyenv(model_beam, fringes)
 
-            self.model = np.zeros((self.fov,self.fov, self.model_over.shape[2]))
+            model = np.zeros((self.fov,self.fov, model_over.shape[2]))
 
             # loop over slices "sl" in the model
-            for sl in range(self.model_over.shape[2]):
-                self.model[:,:,sl] = utils.rebin( self.model_over[:,:,sl],
+            for sl in range(model_over.shape[2]):
+                model[:,:,sl] = utils.rebin( model_over[:,:,sl],
                                             (self.over, self.over))
-            return self.model
+            return model, model_beam, np.asarray(fringes), model_over
 
         else:
-            self.bandpass = bandpass
-
             # The model shape is (fov) x (fov) x (# solution coefficients)
             # the coefficient refers to the terms in the analytic equation
             # There are N(N-1) independent pistons, double-counted by cosine
             # and sine, one constant term and a DC offset.
-            self.model = np.ones((self.fov, self.fov, self.N*(self.N-1)+2))
-            self.model_beam = np.zeros((self.over*self.fov, self.over*self.fov))
-            self.fringes = np.zeros((
+            model = np.ones((self.fov, self.fov, self.N*(self.N-1)+2))
+            model_beam = np.zeros((self.over*self.fov, self.over*self.fov))
+            fringes = np.zeros((
                 self.N*(self.N-1)+1, self.over*self.fov, self.over*self.fov))
 
             for w,l in self.bandpass: # w: weight, l: lambda (wavelength)
@@ -357,23 +487,23 @@ class NrmModel:
                 log.debug("centering: {0}".format(centering))
                 log.debug("what primary beam has the model created? {0}".format(pb))
 
-                self.model_beam += pb
-                self.fringes += ff
+                model_beam += pb
+                fringes += ff
 
                 # this routine multiplies the envelope by each fringe "image"
-                self.model_over = leastsqnrm.multiplyenv(pb, ff)
+                model_over = leastsqnrm.multiplyenv(pb, ff)
 
                 model_binned = np.zeros((
-                    self.fov,self.fov, self.model_over.shape[2]))
+                    self.fov,self.fov, model_over.shape[2]))
 
                 # loop over slices "sl" in the model
-                for sl in range(self.model_over.shape[2]):
+                for sl in range(model_over.shape[2]):
                     model_binned[:,:,sl] = utils.rebin(
-                        self.model_over[:,:,sl], (self.over, self.over))
+                        model_over[:,:,sl], (self.over, self.over))
 
-                self.model += w*model_binned
+                model += w*model_binned
 
-            return self.model
+            return model, model_beam, fringes, model_over
 
 
     def fit_image(self, image, reference=None, pixguess=None, rotguess=0,
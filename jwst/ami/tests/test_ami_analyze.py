@@ -12,8 +12,9 @@ from jwst.ami.leastsqnrm import hexpb, ffc, ffs, return_CAs
 from jwst.ami.leastsqnrm import closurephase, redundant_cps
 from jwst.ami.leastsqnrm import populate_symmamparray
 from jwst.ami.leastsqnrm import populate_antisymmphasearray
-from jwst.ami.leastsqnrm import tan2visibilities, model_array
-from jwst.ami.analyticnrm2 import interf, PSF, phasor, ASFhex
+from jwst.ami.leastsqnrm import tan2visibilities, model_array, fringe_terms
+from jwst.ami.analyticnrm2 import interf, PSF, phasor, ASFhex, fringing_pattern
+from jwst.ami.nrm_model import ModelCache, NrmModel, model_cache
 
 from numpy.testing import assert_allclose
 
@@ -411,6 +412,33 @@ def test_leastsqnrm_ffs():
         delattr( ffs, kk )
 
 
+def test_leastsqnrm_fringe_terms():
+    ''' Test of fringe_terms in leastsqnrm module.
+        Compare the separable cosine and sine terms to ffc and ffs.
+    '''
+    for func in (ffc, ffs):
+        for kk in list( (func.__dict__).keys()):
+            delattr( func, kk )
+        func.lam = 2.3965000082171173e-06
+        func.offx = 28.0
+        func.offy = 27.5
+        func.pitch = 9.099800633275124e-08
+        func.ri = np.array([-0.01540951, -2.63995503])
+        func.rj = np.array([-2.28627105,  0.01334504])
+
+    cos_arr, sin_arr = fringe_terms(ffc.ri, ffc.rj, ffc.lam, ffc.pitch,
+                                    (57, 56), ffc.offx, ffc.offy)
+
+    assert_allclose( cos_arr, np.fromfunction(ffc, (57, 56)).transpose(),
+                     atol=1E-10 )
+    assert_allclose( sin_arr, np.fromfunction(ffs, (57, 56)).transpose(),
+                     atol=1E-10 )
+
+    for func in (ffc, ffs):
+        for kk in list( (func.__dict__).keys()):
+            delattr( func, kk )
+
+
 def test_leastsqnrm_return_CAs():
     ''' Test of return_CAs in leastsqnrm module.
         Calculate the closure amplitudes.
@@ -722,6 +750,101 @@ def test_analyticnrm2_phasor():
     assert_allclose( result, true_result, atol=1E-7 )
 
 
+def test_analyticnrm2_fringing_pattern():
+    ''' Test of fringing_pattern() in the analyticnrm2 module:
+        compare the separable evaluation to interf() on a grid.
+    '''
+    for kk in list( (interf.__dict__).keys()):
+        delattr( interf, kk )
+
+    pixel, fov, oversample, ctrs, d, lam, phi, centering = setup_SF()
+    phi = np.linspace(-0.2, 0.3, len(ctrs)) * lam
+
+    interf.lam = lam
+    interf.offx = 9.5
+    interf.offy = 10.5
+    interf.ctrs = ctrs
+    interf.phi = phi
+    interf.pitch = pixel / float(oversample)
+
+    fringing = fringing_pattern(ctrs, lam, phi, interf.pitch, (21, 23),
+                                interf.offx, interf.offy)
+
+    assert fringing.shape == (23, 21)
+    assert_allclose( fringing, np.fromfunction(interf, (21, 23)).transpose(),
+                     atol=1E-10 )
+
+    for kk in list( (interf.__dict__).keys()):
+        delattr( interf, kk )
+
+
+def test_nrm_model_cache():
+    ''' Test that NrmModel reuses the cached simulated PSFs and models. '''
+    model_cache.clear()
+    bandpass = np.array([[0.4, 4.2e-06], [0.6, 4.4e-06]])
+
+    jwnrm = NrmModel(mask='jwst', holeshape='hex',
+                     pixscale=leastsqnrm.mas2rad(65.))
+    jwnrm.over = 3
+    psf = jwnrm.simulate(bandpass=bandpass, fov=5, pixel=jwnrm.pixel)
+    model = jwnrm.make_model(5, bandpass=bandpass, over=3,
+                             pixscale=jwnrm.pixel)
+    assert model_cache.misses == 2
+
+    other = NrmModel(mask='jwst', holeshape='hex',
+                     pixscale=leastsqnrm.mas2rad(65.))
+    other.over = 3
+    assert other.simulate(bandpass=bandpass, fov=5, pixel=other.pixel) is psf
+    assert other.make_model(5, bandpass=bandpass, over=3,
+                            pixscale=other.pixel) is model
+    assert model_cache.hits == 2
+
+    # A different rotation is a different model
+    other.simulate(bandpass=bandpass, fov=5, pixel=other.pixel, rotate=0.01)
+    assert model_cache.misses == 3
+
+    expected = np.zeros((15, 15))
+    for w, l in bandpass:
+        expected += w * PSF(jwnrm.pixel, 5, 3, jwnrm.ctrs, jwnrm.d, l,
+                            np.zeros(7), centering=(0.5, 0.5), shape='hex')
+    assert_allclose( jwnrm.psf_over, expected )
+    assert not psf.flags.writeable
+
+    model_cache.clear()
+
+
+def test_model_cache_max_bytes():
+    ''' Test that ModelCache drops the least recently used entries to stay
+        within max_bytes, and doesn't keep entries larger than that. '''
+    cache = ModelCache(max_bytes=3 * 800)
+
+    def compute(n):
+        return lambda: (np.zeros(n), np.ones(n))
+
+    for key in 'abc':
+        cache.get(key, compute(50))             # 800 bytes each
+    assert len(cache) == 3 and cache.nbytes == 2400
+
+    cache.get('a', compute(50))                 # 'b' is now the oldest
+    cache.get('d', compute(50))
+    assert cache.nbytes == 2400
+    assert set(cache._entries) == {'a', 'c', 'd'}
+
+    big = cache.get('e', compute(200))          # 3200 bytes
+    assert not big[0].flags.writeable
+    assert 'e' not in cache._entries
+    assert set(cache._entries) == {'a', 'c', 'd'}
+    assert cache.nbytes == 2400
+
+    cache.get('f', compute(100))                # 1600 bytes
+    assert set(cache._entries) == {'d', 'f'}
+    assert cache.nbytes == 2400
+    assert (cache.hits, cache.misses) == (1, 6)
+
+    cache.clear()
+    assert len(cache) == 0 and cache.nbytes == 0
+
+
 #---------------------------------------------------------------
 # webb_psf module test:
 #
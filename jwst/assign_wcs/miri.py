@@ -208,7 +208,7 @@ def lrs_distortion(input_model, reference_files):
     # the S3 URI handling to one place.  The S3-related code here can
     # be removed once that has been changed.
     if s3_utils.is_s3_uri(reference_files['specwcs']):
-        ref = fits.open(s3_utils.get_object(reference_files['specwcs']))
+        ref = fits.open(s3_utils.open_object(reference_files['specwcs']))
     else:
         ref = fits.open(reference_files['specwcs'])
     with ref:
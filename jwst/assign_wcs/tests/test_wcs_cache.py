@@ -0,0 +1,148 @@
+"""
+Test the cache of evaluated WCS coordinates
+"""
+import numpy as np
+import pytest
+
+from ... import datamodels
+from .. import wcs_cache
+
+
+class FakeWCS:
+    pass
+
+
+def make_coords(offset=0.):
+    y, x = np.mgrid[:3, :4]
+    return x, y, x + offset, y + offset, x * 0.1
+
+
+def test_compute_once():
+    cache = wcs_cache.WCSCoordinateCache()
+    ncalls = []
+
+    def compute():
+        ncalls.append(1)
+        return make_coords()
+
+    first = cache.get(('slit', 1), compute)
+    second = cache.get(('slit', 1), compute)
+    assert len(ncalls) == 1
+    assert all(a is b for a, b in zip(first, second))
+    assert cache.hits == 1 and cache.misses == 1
+
+    # cached arrays can not be changed by callers
+    with pytest.raises(ValueError):
+        first[2][0, 0] = 0.
+
+
+def test_new_wcs_empties_cache():
+    cache = wcs_cache.WCSCoordinateCache()
+    wcs1 = FakeWCS()
+    cache.bind(wcs1)
+    cache.get(('slit', 1), make_coords)
+
+    cache.bind(wcs1)
+    assert len(cache) == 1
+    wcs2 = FakeWCS()
+    cache.bind(wcs2)
+    assert len(cache) == 0
+
+
+def test_model_copy_keeps_cache():
+    model = datamodels.ImageModel((3, 4))
+    assert wcs_cache.get_cache(model) is None
+
+    cache = wcs_cache.enable(model)
+    cache.get(('slit', 'S200A1'), make_coords)
+
+    # a model opened from the model shares its cache
+    assert wcs_cache.get_cache(datamodels.ImageModel(model)) is cache
+
+    # a copy has a cache of its own, sharing the entries
+    copy = model.copy()
+    copy_cache = wcs_cache.get_cache(copy)
+    assert copy_cache is not cache
+    assert len(copy_cache) == 1
+    copy_cache.get(('slit', 'S200A2'), make_coords)
+    assert len(cache) == 2
+
+    wcs_cache.disable(model)
+    assert wcs_cache.get_cache(model) is None
+
+
+def test_save_and_load(tmpdir):
+    model = datamodels.ImageModel((3, 4))
+    cache = wcs_cache.enable(model)
+    expected = cache.get(('slit', 3), make_coords)
+    cache.get(('slit', 'S200A1'), lambda: make_coords(1.))
+
+    sidecar = str(tmpdir.join('wcscache.npz'))
+    wcs_cache.save(model, sidecar)
+
+    other = datamodels.ImageModel((3, 4))
+    loaded = wcs_cache.enable(other, sidecar=sidecar)
+    assert len(loaded) == 2
+    result = loaded.get(('slit', 3), pytest.fail)
+    for a, b in zip(result, expected):
+        np.testing.assert_array_equal(a, b)
+
+    # a missing sidecar gives an empty cache
+    third = datamodels.ImageModel((3, 4))
+    assert len(wcs_cache.enable(third, sidecar=str(tmpdir.join('none.npz')))) == 0
+
+
+@pytest.mark.parametrize('change', ['ref_file', 'wcsinfo', 'shape', 'version'])
+def test_sidecar_from_other_wcs_is_ignored(tmpdir, monkeypatch, change):
+    def make_model(shape=(3, 4)):
+        model = datamodels.ImageModel(shape)
+        model.meta.ref_file.camera.name = 'crds://jwst_nirspec_camera_0004.asdf'
+        model.meta.wcsinfo.roll_ref = 10.
+        return model
+
+    model = make_model()
+    wcs_cache.enable(model).get(('slit', 3), make_coords)
+    sidecar = str(tmpdir.join('wcscache.npz'))
+    wcs_cache.save(model, sidecar)
+
+    assert len(wcs_cache.enable(make_model(), sidecar=sidecar)) == 1
+
+    if change == 'shape':
+        other = make_model((3, 5))
+    else:
+        other = make_model()
+    if change == 'ref_file':
+        other.meta.ref_file.camera.name = 'crds://jwst_nirspec_camera_0005.asdf'
+    elif change == 'wcsinfo':
+        other.meta.wcsinfo.roll_ref = 11.
+    elif change == 'version':
+        import jwst
+        monkeypatch.setattr(jwst, '__version__', 'other')
+    cache = wcs_cache.enable(other, sidecar=sidecar)
+    assert len(cache) == 0
+    assert cache.fingerprint == wcs_cache.fingerprint(other)
+
+
+def test_save_after_later_steps(tmpdir):
+    """ A cache saved at the end of a run is loaded by the next run, even
+    if later steps changed the metadata of the models """
+    def assign_wcs_output():
+        model = datamodels.ImageModel((3, 4))
+        model.meta.ref_file.camera.name = 'crds://jwst_nirspec_camera_0004.asdf'
+        return model
+
+    sidecar = str(tmpdir.join('wcscache.npz'))
+    model = assign_wcs_output()
+    wcs_cache.enable(model, sidecar=sidecar)
+
+    # a later step works on a copy, adds its reference file and uses the cache
+    result = model.copy()
+    result.meta.ref_file.flat.name = 'crds://jwst_nirspec_flat_0001.fits'
+    expected = wcs_cache.get_cache(result).get(('slit', 3), make_coords)
+    wcs_cache.save(model, sidecar)
+
+    cache = wcs_cache.enable(assign_wcs_output(), sidecar=sidecar)
+    coords = cache.get(('slit', 3), pytest.fail)
+    assert cache.hits == 1
+    for a, b in zip(coords, expected):
+        np.testing.assert_array_equal(a, b)
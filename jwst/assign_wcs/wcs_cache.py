@@ -0,0 +1,251 @@
+"""
+Opt-in cache of the world coordinates evaluated from the WCS of a model.
+
+Several steps evaluate the same WCS over the same grid of detector pixels,
+for example the 30 NIRSpec IFU slices are evaluated by pathloss and twice by
+cube_build. Once ``enable`` has been called on a model, the coordinates are
+computed the first time they are needed and reused afterwards, including by
+copies of the model made by later steps, which share the entries of the
+cache. The cache can also be saved to and loaded from a sidecar file.
+
+The coordinates are only valid for the WCS they were computed from. The
+cache is emptied if a different WCS object is assigned to the model, and each
+entry is keyed by the bounding box of its slit. A sidecar file records the
+fingerprint of the model the cache was enabled on (see `fingerprint`) and is
+ignored if it does not match the model it is loaded for. The fingerprint is
+taken when the cache is enabled, right after assign_wcs, because the later
+steps add reference files to the metadata and can change the data shape.
+
+Only the callers evaluating the NIRSpec IFU slices (pathloss and cube_build)
+use the cache.
+"""
+import json
+import logging
+import weakref
+
+import numpy as np
+from gwcs import wcstools
+
+from . import nirspec
+
+log = logging.getLogger(__name__)
+log.setLevel(logging.DEBUG)
+
+
+__all__ = ["WCSCoordinateCache", "enable", "disable", "save", "get_cache",
+           "fingerprint", "slit_coordinates"]
+
+
+class WCSCoordinateCache:
+    """
+    Coordinates evaluated from one WCS, keyed by slit and bounding box.
+
+    Each entry is a tuple of read-only arrays ``(x, y, ra, dec, lam)``.
+
+    Parameters
+    ----------
+    entries : dict, optional
+        Initial entries.
+    fingerprint : str, optional
+        Fingerprint of the model the entries were computed for, as returned
+        by `fingerprint`.
+    """
+
+    def __init__(self, entries=None, fingerprint=None):
+        self._entries = {} if entries is None else entries
+        self.fingerprint = fingerprint
+        self._wcs_ref = None
+        self.hits = 0
+        self.misses = 0
+
+    def __len__(self):
+        return len(self._entries)
+
+    def copy(self):
+        """
+        Return a cache sharing the entries of this one, bound to the WCS of
+        the model it is next used with.
+
+        The entries computed through the copy are added to this cache too,
+        so that they are saved with the model the cache was enabled on.
+        """
+        return WCSCoordinateCache(self._entries, self.fingerprint)
+
+    def bind(self, wcsobj):
+        """
+        Bind the cache to ``wcsobj``, dropping the entries if they were
+        computed from a different WCS.
+        """
+        bound = None if self._wcs_ref is None else self._wcs_ref()
+        if bound is not wcsobj:
+            if bound is not None and self._entries:
+                log.debug("WCS has changed, emptying the coordinate cache")
+                self._entries = {}
+            self._wcs_ref = weakref.ref(wcsobj)
+
+    def get(self, key, compute):
+        """
+        Return the entry for ``key``, calling ``compute()`` to create it if
+        it is not in the cache.
+        """
+        try:
+            coords = self._entries[key]
+            self.hits += 1
+        except KeyError:
+            coords = tuple(np.asarray(a) for a in compute())
+            for a in coords:
+                a.flags.writeable = False
+            self._entries[key] = coords
+            self.misses += 1
+        return coords
+
+    def save(self, filename):
+        """ Write the entries and fingerprint to the numpy ``.npz`` file ``filename``."""
+        arrays = {'keys': np.array([repr(key) for key in self._entries]),
+                  'fingerprint': np.array(self.fingerprint or '')}
+        for i, coords in enumerate(self._entries.values()):
+            for name, a in zip(('x', 'y', 'ra', 'dec', 'lam'), coords):
+                arrays['{0}_{1}'.format(name, i)] = a
+        np.savez(filename, **arrays)
+
+    @classmethod
+    def load(cls, filename):
+        """ Read a cache written by ``save``."""
+        from ast import literal_eval
+
+        entries = {}
+        with np.load(filename) as arrays:
+            for i, key in enumerate(arrays['keys']):
+                coords = tuple(arrays['{0}_{1}'.format(name, i)]
+                               for name in ('x', 'y', 'ra', 'dec', 'lam'))
+                for a in coords:
+                    a.flags.writeable = False
+                entries[literal_eval(str(key))] = coords
+            if 'fingerprint' in arrays:
+                fingerprint = str(arrays['fingerprint']) or None
+            else:
+                fingerprint = None
+        return cls(entries, fingerprint)
+
+
+def enable(model, sidecar=None):
+    """
+    Attach a coordinate cache to ``model``.
+
+    Parameters
+    ----------
+    model : `~jwst.datamodels.DataModel`
+        A model with a WCS assigned.
+    sidecar : str, optional
+        File to load the cache from, if it exists and was saved from a model
+        with the same fingerprint.
+
+    Returns
+    -------
+    cache : `WCSCoordinateCache`
+    """
+    cache = get_cache(model)
+    if cache is None:
+        model_fingerprint = fingerprint(model)
+        if sidecar is not None:
+            try:
+                cache = WCSCoordinateCache.load(sidecar)
+            except FileNotFoundError:
+                pass
+            else:
+                if cache.fingerprint != model_fingerprint:
+                    log.info("Ignoring the WCS cache in %s, saved from a different "
+                             "WCS, reference files or pipeline version", sidecar)
+                    cache = None
+                else:
+                    log.info("Loaded %d cached WCS evaluations from %s", len(cache), sidecar)
+        if cache is None:
+            cache = WCSCoordinateCache(fingerprint=model_fingerprint)
+        model._wcs_cache = cache
+    return cache
+
+
+def disable(model):
+    """ Remove the coordinate cache of ``model``, if any."""
+    if get_cache(model) is not None:
+        model._wcs_cache = None
+
+
+def save(model, sidecar):
+    """
+    Write the coordinate cache of ``model``, if any, to ``sidecar``.
+
+    ``model`` is the model the cache was enabled on. The cache keeps the
+    fingerprint taken by `enable`, which is what the next run compares with
+    the output of assign_wcs.
+    """
+    cache = get_cache(model)
+    if cache is not None:
+        log.info("Saving %d cached WCS evaluations to %s (%d reused)",
+                 len(cache), sidecar, cache.hits)
+        cache.save(sidecar)
+
+
+def get_cache(model):
+    """ Return the coordinate cache of ``model``, or None if it has none."""
+    return getattr(model, '_wcs_cache', None)
+
+
+def fingerprint(model):
+    """
+    Identify what the WCS of ``model`` was computed from.
+
+    The fingerprint is made of the jwst version, the data shape and the
+    ``ref_file``, ``instrument`` and ``wcsinfo`` metadata of the model: the
+    reference files, the optical configuration and the pointing.
+
+    Returns
+    -------
+    fingerprint : str
+        A JSON string.
+    """
+    from .. import __version__
+
+    meta = model.meta
+    parts = {
+        'jwst_version': __version__,
+        'shape': list(model.shape or ()),
+        'ref_file': meta.ref_file.instance,
+        'instrument': meta.instrument.instance,
+        'wcsinfo': meta.wcsinfo.instance,
+    }
+    return json.dumps(parts, sort_keys=True, default=str)
+
+
+def slit_coordinates(input_model, slit_name):
+    """
+    Evaluate the WCS of a NIRSpec slit or IFU slice over its bounding box.
+
+    Parameters
+    ----------
+    input_model : `~jwst.datamodels.DataModel`
+        NIRSpec model with a WCS for all the slits or slices.
+    slit_name : int or str
+        Slit.name of an open slit, or the IFU slice number.
+
+    Returns
+    -------
+    x, y, ra, dec, lam : ndarray
+        The detector grid of the bounding box and its world coordinates.
+        The arrays are read-only if they come from the cache.
+    """
+    slit_wcs = nirspec.nrs_wcs_set_input(input_model, slit_name)
+
+    def compute():
+        x, y = wcstools.grid_from_bounding_box(slit_wcs.bounding_box)
+        ra, dec, lam = slit_wcs(x, y)
+        return x, y, ra, dec, lam
+
+    cache = get_cache(input_model)
+    if cache is None:
+        return compute()
+
+    cache.bind(input_model.meta.wcs)
+    bounding_box = tuple(tuple(float(v) for v in axis)
+                         for axis in slit_wcs.bounding_box)
+    return cache.get(('slit', slit_name, bounding_box), compute)
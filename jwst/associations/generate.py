@@ -3,6 +3,7 @@ import logging
 from .association import (
     make_timestamp
 )
+from .lib.asn_index import AssociationIndex
 from .lib.process_list import (
     ProcessList,
     ProcessQueueSorted
@@ -15,7 +16,7 @@ logger.addHandler(logging.NullHandler())
 __all__ = ['generate']
 
 
-def generate(pool, rules, version_id=None):
+def generate(pool, rules, version_id=None, use_index=True):
     """Generate associations in the pool according to the rules.
 
     Parameters
@@ -32,6 +33,11 @@ def generate(pool, rules, version_id=None):
         If True, use a timestamp
         If a string, the string.
 
+    use_index : bool
+        Look up the existing associations an item may belong to in
+        an `AssociationIndex`, instead of checking the item against
+        all of them. The resulting associations are the same.
+
     Returns
     -------
     associations : [Association[,...]]
@@ -43,6 +49,7 @@ def generate(pool, rules, version_id=None):
     documentation for a full description.
     """
     associations = []
+    index = AssociationIndex() if use_index else None
     if type(version_id) is bool:
         version_id = make_timestamp()
     process_queue = ProcessQueueSorted([
@@ -67,11 +74,14 @@ def generate(pool, rules, version_id=None):
                 version_id,
                 associations,
                 rules,
-                process_list
+                process_list,
+                index=index
             )
             # logger.debug(f'Associations updated: {existing_asns}')
             # logger.debug(f'New associations: {new_asns}')
             associations.extend(new_asns)
+            if index is not None:
+                index.extend(new_asns)
 
             # If working on a process list EXISTING
             # remove any new `to_process` that is
@@ -99,7 +109,8 @@ def generate_from_item(
         version_id,
         associations,
         rules,
-        process_list):
+        process_list,
+        index=None):
     """Either match or generate a new assocation
 
     Parameters
@@ -123,6 +134,11 @@ def generate_from_item(
     process_list : ProcessList
         The `ProcessList` from which the current item belongs to.
 
+    index : AssociationIndex or None
+        Index of `associations`. If given, only the associations it
+        finds for the item are checked, and the ones the item is
+        added to are re-indexed.
+
     Returns
     -------
     (associations, process_list): 3-tuple where
@@ -149,6 +165,8 @@ def generate_from_item(
             ProcessList.EXISTING,
             ProcessList.NONSCIENCE,
     ):
+        if index is not None:
+            associations = index.candidates(item)
         associations = [
             asn
             for asn in associations
@@ -160,6 +178,8 @@ def generate_from_item(
         existing_asns, reprocess_list = match_item(
             item, associations
         )
+        if index is not None:
+            index.update(existing_asns)
 
     # Now see if this item will create new associatons.
     # By default, a item will not be allowed to create
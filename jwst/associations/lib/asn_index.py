@@ -0,0 +1,178 @@
+"""Index of associations by the values their constraints require"""
+from collections import defaultdict
+import re
+
+from .constraint import (
+    AttrConstraint,
+    Constraint,
+    _is_ascii
+)
+from .utilities import getattr_from_list
+
+__all__ = ['AssociationIndex']
+
+# Key of an item that cannot match an association.
+_NO_MATCH = object()
+
+
+class AssociationIndex:
+    """Index of associations by the values their constraints require
+
+    Once an association has matched an item, most of its constraints are
+    fixed to the values of that item, such as the program, instrument and
+    optical path. Only items with the same values can be added to the
+    association. The associations are grouped by the sources of these
+    fixed constraints and hashed by their values, so the associations an
+    item can belong to are looked up instead of checked one by one.
+
+    The lookup only excludes associations that would not match the item, so
+    the associations found by `AssociationIndex.candidates` are those that
+    must be checked, in the order they were added.
+
+    Parameters
+    ----------
+    associations : [Association[,...]]
+        Initial associations to index.
+    """
+
+    def __init__(self, associations=None):
+        self._associations = []
+        self._positions = {}
+
+        # For each association, its group and the key in the group.
+        self._entries = {}
+
+        # Associations by the key of their fixed values, in groups
+        # sharing the same sources.
+        self._groups = defaultdict(lambda: defaultdict(set))
+
+        if associations is not None:
+            self.extend(associations)
+
+    def __len__(self):
+        return len(self._associations)
+
+    def extend(self, associations):
+        """Add associations to the index"""
+        for asn in associations:
+            if id(asn) in self._positions:
+                continue
+            self._positions[id(asn)] = len(self._associations)
+            self._associations.append(asn)
+            self._index(asn)
+
+    def update(self, associations):
+        """Re-index associations whose constraints may have changed
+
+        Constraints are only ever fixed, so an association that is not
+        updated is still looked up when it should be, but possibly more often
+        than needed.
+        """
+        for asn in associations:
+            if id(asn) in self._positions:
+                self._unindex(asn)
+                self._index(asn)
+
+    def candidates(self, item):
+        """Associations the item may belong to, in the order added
+
+        Parameters
+        ----------
+        item : dict
+            The item to match.
+
+        Returns
+        -------
+        associations : [Association[,...]]
+        """
+        positions = []
+        for group, by_key in self._groups.items():
+            key = _item_key(item, group)
+            if key is _NO_MATCH:
+                continue
+            if key is None:
+                for members in by_key.values():
+                    positions.extend(members)
+            else:
+                positions.extend(by_key.get(key, ()))
+        return [self._associations[position] for position in sorted(positions)]
+
+    def _index(self, asn):
+        group, key = _asn_key(asn)
+        self._groups[group][key].add(self._positions[id(asn)])
+        self._entries[id(asn)] = (group, key)
+
+    def _unindex(self, asn):
+        group, key = self._entries.pop(id(asn))
+        by_key = self._groups[group]
+        by_key[key].discard(self._positions[id(asn)])
+        if not by_key[key]:
+            del by_key[key]
+            if not by_key:
+                del self._groups[group]
+
+
+def _asn_key(asn):
+    """Group and key of the fixed constraints of an association
+
+    Returns
+    -------
+    group, key : tuple, tuple
+        The group is the sorted `(source, invalid_values)` pairs of the
+        fixed constraints, the key the corresponding fixed values.
+    """
+    constraints = getattr(asn, 'constraints', None)
+    if not isinstance(constraints, Constraint):
+        return (), ()
+    try:
+        constraints['force_match']
+    except KeyError:
+        pass
+    else:
+        # The result of `add` does not depend on the constraints alone.
+        return (), ()
+
+    fixed = {}
+    for constraint in constraints.required_constraints():
+        if not isinstance(constraint, AttrConstraint):
+            continue
+        fixed_value = constraint.fixed_value()
+        if fixed_value is None:
+            continue
+        source, value = fixed_value
+
+        # If a source is fixed more than once, an item has to match
+        # all of the values, so indexing on the first one is enough.
+        fixed.setdefault((source, tuple(constraint.invalid_values)), value)
+
+    group = tuple(sorted(fixed, key=repr))
+    return group, tuple(fixed[source] for source in group)
+
+
+def _item_key(item, group):
+    """Key of an item in a group
+
+    Returns
+    -------
+    key : tuple, None or `_NO_MATCH`
+        The escaped, lower-cased values of the item, None if the item
+        may match any association of the group or `_NO_MATCH` if it
+        cannot match any.
+    """
+    key = []
+    for source, invalid_values in group:
+        try:
+            _, value = getattr_from_list(
+                item, [source], invalid_values=invalid_values
+            )
+        except KeyError:
+            return _NO_MATCH
+        if key is None:
+            continue
+        if not isinstance(value, str) or not _is_ascii(value) or '\n' in value:
+            # Case folding and the end-of-line anchor do not reduce
+            # to comparing lower-cased values.
+            key = None
+        else:
+            key.append(re.escape(value).lower())
+    return key if key is None else tuple(key)
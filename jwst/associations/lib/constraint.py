@@ -368,7 +368,7 @@ class AttrConstraint(SimpleConstraintABC):
         if invalid_values is None:
             self.invalid_values = []
         if onlyif is None:
-            self.onlyif = lambda item: True
+            self.onlyif = _always_true
 
         # Haven't actually matched anything yet.
         self.found_values = set()
@@ -475,6 +475,30 @@ class AttrConstraint(SimpleConstraintABC):
         self.matched = True
         return self.matched, reprocess
 
+    def fixed_value(self):
+        """The value an item must have to satisfy the constraint, if fixed
+
+        Once a `force_unique` constraint has matched, only items whose
+        source has the same value, ignoring case, can satisfy it.
+
+        Returns
+        -------
+        fixed : (str, str) or None
+            The source and the escaped, lower-cased value that an item must
+            have, or None if the constraint can be satisfied otherwise, for
+            example by items missing the source.
+        """
+        if type(self).check_and_set is not AttrConstraint.check_and_set:
+            return None
+        if self.onlyif is not _always_true or self.evaluate or \
+           not self.required or self.force_undefined or self.force_unique:
+            return None
+        if not isinstance(self.value, str) or self.value not in self.found_values:
+            return None
+        if len(self.sources) != 1 or not _is_ascii(self.value):
+            return None
+        return self.sources[0], self.value.lower()
+
 
 class Constraint:
     """Constraint that is made up of SimpleConstraint
@@ -692,6 +716,25 @@ class Constraint:
         match, to_reprocess = Constraint.any(item, constraints)
         return not match, to_reprocess
 
+    def required_constraints(self):
+        """Simple constraints that any matching item must satisfy
+
+        An item failing any of these fails the whole constraint, without
+        reprocessing.
+
+        Returns
+        -------
+        constraints : generator of `SimpleConstraintABC`
+        """
+        if type(self).check_and_set is not Constraint.check_and_set or \
+           self.reduce is not Constraint.all or self.reprocess_on_fail:
+            return
+        for constraint in self.constraints:
+            if isinstance(constraint, Constraint):
+                yield from constraint.required_constraints()
+            else:
+                yield constraint
+
     # Make iterable
     def __iter__(self):
         for constraint in chain(*map(iter, self.constraints)):
@@ -744,6 +787,16 @@ class Constraint:
 # ---------
 # Utilities
 # ---------
+def _always_true(item):
+    """Default `AttrConstraint.onlyif`"""
+    return True
+
+
+def _is_ascii(value):
+    """True if all characters of the string are ASCII"""
+    return all(ord(char) < 128 for char in value)
+
+
 def meets_conditions(value, conditions):
     """Check whether value meets any of the provided conditions
 
@@ -1,6 +1,12 @@
 """Test basic generate operations"""
+import pytest
 
-from .helpers import t_path
+from .helpers import (
+    combine_pools,
+    registry_level2_only,
+    registry_level3_only,
+    t_path
+)
 
 from .. import (
     AssociationPool,
@@ -24,6 +30,24 @@ def test_simple():
     assert len(asns[0]['members']) == 2
 
 
+@pytest.mark.parametrize(
+    'registry, pool_file',
+    [
+        (registry_level2_only, 'data/pool_010_spec_nirspec_lv2bkg.csv'),
+        (registry_level3_only, 'data/pool_002_image_miri.csv'),
+        (registry_level3_only, 'data/pool_006_spec_nirspec.csv'),
+        (registry_level3_only, 'data/pool_017_spec_nirspec_lv2imprint.csv'),
+    ]
+)
+def test_index_same_associations(registry, pool_file):
+    """Test that indexing the associations does not change them"""
+    pool = combine_pools(t_path(pool_file))
+    asns = generate(pool, registry(), use_index=True)
+    asns_scanned = generate(pool, registry(), use_index=False)
+    assert len(asns) > 0
+    assert [asn.dump() for asn in asns] == [asn.dump() for asn in asns_scanned]
+
+
 def test_unserialize():
     """Test basic unserializing"""
     asn_file = t_path(
@@ -42,6 +42,7 @@ def monkey_patch_s3_client(monkeypatch, request):
     else:
         path = None
     monkeypatch.setattr(s3_utils, "_CLIENT", lib_helpers.MockS3Client(path))
+    monkeypatch.setattr(s3_utils, "_BLOCK_CACHE", s3_utils.BlockCache())
 
 
 @pytest.fixture
@@ -55,6 +55,7 @@ class CubeBuildStep (Step):
          skip_dqflagging = boolean(default=false) # skip setting the DQ plane of the IFU
          search_output_file = boolean(default=false)
          output_use_model = boolean(default=true) # Use filenames in the output models
+         maximum_cores = option('quarter', 'half', 'all', default=None) # max number of processes mapping files to a cube
        """
 
     reference_file_types = ['cubepar', 'resol']
@@ -104,6 +105,10 @@ class CubeBuildStep (Step):
             self.log.info('Setting maximum wavelength of spectral cube to: %f',
                           self.wavemax)
 
+        if self.maximum_cores is not None:
+            self.log.info('Maximum cores to use for mapping files to cubes: %s',
+                          self.maximum_cores)
+
         if self.rois != 0.0:
             self.log.info('Input Spatial ROI size %f', self.rois)
         if self.roiw != 0.0:
@@ -260,7 +265,8 @@ class CubeBuildStep (Step):
             'ydebug': self.ydebug,
             'zdebug': self.zdebug,
             'debug_pixel': self.debug_pixel,
-            'spaxel_debug': self.spaxel_debug}
+            'spaxel_debug': self.spaxel_debug,
+            'maximum_cores': self.maximum_cores}
 # ________________________________________________________________________________
 # create an instance of class CubeData
 
@@ -1,8 +1,7 @@
 """ Routines related to WCS procedures of cube_build
 """
 import numpy as np
-from ..assign_wcs import nirspec
-from gwcs import wcstools
+from ..assign_wcs import wcs_cache
 import logging
 log = logging.getLogger(__name__)
 log.setLevel(logging.DEBUG)
@@ -104,10 +103,8 @@ def find_footprint_NIRSPEC(input, coord_system):
     log.info('Looping over slices to determine cube size .. this takes a while')
 
     for i in range(nslices):
-        slice_wcs = nirspec.nrs_wcs_set_input(input, i)
-        x, y = wcstools.grid_from_bounding_box(slice_wcs.bounding_box, step=(1, 1), center=True)
         if coord_system == 'world':
-            coord1, coord2, lam = slice_wcs(x, y)
+            x, y, coord1, coord2, lam = wcs_cache.slit_coordinates(input, i)
         else:  # coord_system == 'alpha-beta':
             raise InvalidCoordSystem(" The Alpha-Beta Coordinate system is not valid (at this time) for NIRSPEC data")
 #                detector2slicer = input.meta.wcs.get_transform('detector','slicer')
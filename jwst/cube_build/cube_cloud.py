@@ -7,6 +7,87 @@ log = logging.getLogger(__name__)
 log.setLevel(logging.DEBUG)
 
 
+class SpaxelIndex():
+    """ Index of the spaxel centers of an IFU cube
+
+    The spaxel centers lie on a regular grid: the xy plane is naxis2 rows of
+    naxis1 spaxels, flattened row by row, and zcoord holds the wavelength of
+    each plane. For a point cloud member only the spaxels within a box of
+    the roi size around it are tested, so the cost of matching scales with
+    the number of overlaps rather than with the size of the cube.
+
+    Parameters
+    ----------
+    naxis1 : int
+       size of the ifucube in 1st axis
+    naxis2 : int
+       size of the ifucube in 2nd axis
+    xcenters : numpy.ndarray
+       spaxel center locations 1st dimensions.
+    ycenters : numpy.ndarray
+       spaxel center locations 2nd dimensions.
+    zcoord : numpy.ndarray
+        spaxel center locations in 3rd dimensions
+    """
+
+    def __init__(self, naxis1, naxis2, xcenters, ycenters, zcoord):
+        self.naxis1 = naxis1
+        self.naxis2 = naxis2
+        self.xcenters = xcenters
+        self.ycenters = ycenters
+        self.zcoord = np.asarray(zcoord)
+        # centers along each spatial axis, increasing by construction
+        self.xaxis = xcenters[0:naxis1]
+        self.yaxis = ycenters[0:naxis1 * naxis2:naxis1]
+        # the wavelength table is not required to be sorted
+        self.zorder = np.argsort(self.zcoord, kind='stable')
+        self.zsorted = self.zcoord[self.zorder]
+
+    @staticmethod
+    def _candidates(axis, low, high):
+        """ Range of axis indices that may fall between low and high
+
+        The range is padded by one element on each side so that the exact
+        distance test done by the caller decides the edge cases.
+        """
+        istart = max(np.searchsorted(axis, low, side='left') - 1, 0)
+        iend = min(np.searchsorted(axis, high, side='right') + 1, axis.size)
+        return istart, iend
+
+    def spatial_match(self, x, y, rois):
+        """ Find the spaxels in the xy plane within rois of (x, y)
+
+        Returns
+        -------
+        tuple holding the sorted indices into xcenters, ycenters (the same
+        form as numpy.where)
+        """
+        ix1, ix2 = self._candidates(self.xaxis, x - rois, x + rois)
+        iy1, iy2 = self._candidates(self.yaxis, y - rois, y + rois)
+        if ix1 >= ix2 or iy1 >= iy2:
+            return (np.zeros(0, dtype=np.intp),)
+
+        index = (np.arange(iy1, iy2)[:, np.newaxis] * self.naxis1 +
+                 np.arange(ix1, ix2)[np.newaxis, :]).ravel()
+        xdistance = (self.xcenters[index] - x)
+        ydistance = (self.ycenters[index] - y)
+        radius = np.sqrt(xdistance * xdistance + ydistance * ydistance)
+        return (index[radius <= rois],)
+
+    def spectral_match(self, wave, roiw):
+        """ Find the wavelength planes within roiw of wave
+
+        Returns
+        -------
+        tuple holding the sorted indices into zcoord (the same form as
+        numpy.where)
+        """
+        iz1, iz2 = self._candidates(self.zsorted, wave - roiw, wave + roiw)
+        index = np.sort(self.zorder[iz1:iz2])
+        return (index[abs(self.zcoord[index] - wave) <= roiw],)
+# _______________________________________________________________________
+
+
 def match_det2cube_msm(naxis1, naxis2, naxis3,
                        cdelt1, cdelt2,
                        zcdelt3,
@@ -20,7 +101,8 @@ def match_det2cube_msm(naxis1, naxis2, naxis3,
                        coord1, coord2, wave,
                        weighting_type,
                        rois_pixel, roiw_pixel, weight_pixel,
-                       softrad_pixel, scalerad_pixel):
+                       softrad_pixel, scalerad_pixel,
+                       spaxel_index=None):
 
     """ Map the detector pixels to the cube spaxels using the MSM parameters
 
@@ -79,6 +161,9 @@ def match_det2cube_msm(naxis1, naxis2, naxis3,
        detector pixel
     wave : numpy.ndarray
        contains the spectral coordinate  for the mapped detector pixel
+    spaxel_index : SpaxelIndex, optional
+       index of the spaxel centers. If None one is built from xcenters,
+       ycenters and zcoord.
 
     Returns
     -------
@@ -87,6 +172,8 @@ def match_det2cube_msm(naxis1, naxis2, naxis3,
     """
 
     nplane = naxis1 * naxis2
+    if spaxel_index is None:
+        spaxel_index = SpaxelIndex(naxis1, naxis2, xcenters, ycenters, zcoord)
 
     # now loop over the pixel values for this region and find the spaxels that fall
     # within the region of interest.
@@ -105,11 +192,8 @@ def match_det2cube_msm(naxis1, naxis2, naxis3,
         # find the spaxels that fall withing ROI of point cloud defined  by
         # coord1,coord2,wave
         lower_limit = softrad_pixel[ipt]
-        xdistance = (xcenters - coord1[ipt])
-        ydistance = (ycenters - coord2[ipt])
-        radius = np.sqrt(xdistance * xdistance + ydistance * ydistance)
-        indexr = np.where(radius <= rois_pixel[ipt])
-        indexz = np.where(abs(zcoord - wave[ipt]) <= roiw_pixel[ipt])
+        indexr = spaxel_index.spatial_match(coord1[ipt], coord2[ipt], rois_pixel[ipt])
+        indexz = spaxel_index.spectral_match(wave[ipt], roiw_pixel[ipt])
         # on the wavelength boundaries the point cloud may not be in the IFUCube
         # the edge cases are skipped and not included in final IFUcube to avoid noisy results
         # Left commented code for checking later for NIRSPEC the spectral size
@@ -179,7 +263,8 @@ def match_det2cube_miripsf(alpha_resol, beta_resol, wave_resol,
                            rois_pixel, roiw_pixel,
                            weight_pixel,
                            softrad_pixel,
-                           scalerad_pixel):
+                           scalerad_pixel,
+                           spaxel_index=None):
     """ Map the detector pixels to the cube spaxels using miri PSF weighting
 
     Map coordinates coord1,coord2, and wave of the point cloud to which
@@ -250,6 +335,9 @@ def match_det2cube_miripsf(alpha_resol, beta_resol, wave_resol,
        msm weighting parameter
     softrad_pxiel :float
        weighting paramter
+    spaxel_index : SpaxelIndex, optional
+       index of the spaxel centers. If None one is built from xcenters,
+       ycenters and zcoord.
 
     Returns
     -------
@@ -259,6 +347,8 @@ def match_det2cube_miripsf(alpha_resol, beta_resol, wave_resol,
     """
 
     nplane = naxis1 * naxis2
+    if spaxel_index is None:
+        spaxel_index = SpaxelIndex(naxis1, naxis2, xcenters, ycenters, zcoord)
     # now loop over the pixel values for this region and find the spaxels
     # that fall within the region of interest.
     nn = coord1.size
@@ -272,12 +362,8 @@ def match_det2cube_miripsf(alpha_resol, beta_resol, wave_resol,
         # find the spaxels that fall withing ROI of point cloud defined by
         # coord1,coord2,wave
 
-        xdistance = (xcenters - coord1[ipt])
-        ydistance = (ycenters - coord2[ipt])
-        radius = np.sqrt(xdistance * xdistance + ydistance * ydistance)
-
-        indexr = np.where(radius <= rois_pixel[ipt])
-        indexz = np.where(abs(zcoord - wave[ipt]) <= roiw_pixel[ipt])
+        indexr = spaxel_index.spatial_match(coord1[ipt], coord2[ipt], rois_pixel[ipt])
+        indexz = spaxel_index.spectral_match(wave[ipt], roiw_pixel[ipt])
 
         # _______________________________________________________________
         # loop over the points in the ROI
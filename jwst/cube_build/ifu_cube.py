@@ -11,9 +11,10 @@ from ..assign_wcs import pointing
 from jwst.transforms.models import _toindex
 from astropy.stats import circmean
 from astropy import units as u
-from gwcs import wcstools
-from ..assign_wcs import nirspec
+from ..assign_wcs import wcs_cache
 from ..datamodels import dqflags
+from ..lib.multiprocessing_utils import (fork_pool, fork_processes,
+                                         num_processes)
 from . import cube_build_wcs_util
 from . import cube_overlap
 from . import cube_cloud
@@ -74,6 +75,7 @@ class IFUCubeData():
         self.zdebug = pars_cube.get('zdebug')
         self.skip_dqflagging = pars_cube.get('skip_dqflagging')
         self.spaxel_debug = pars_cube.get('spaxel_debug')
+        self.maximum_cores = pars_cube.get('maximum_cores')
 
         self.num_bands = 0
         self.output_name = ''
@@ -499,6 +501,13 @@ class IFUCubeData():
         self.spaxel_var = np.zeros(total_num)
         self.spaxel_dq = np.zeros((self.naxis3, self.naxis2 * self.naxis1), dtype=np.uint32)
 
+        # index of the spaxel centers, shared by all the files mapped to the cube
+        spaxel_index = None
+        if self.interpolation == 'pointcloud':
+            spaxel_index = cube_cloud.SpaxelIndex(self.naxis1, self.naxis2,
+                                                  self.xcenters, self.ycenters,
+                                                  self.zcoord)
+
         spaxel_ra = None
         spaxel_dec = None
         spaxel_wave = None
@@ -537,98 +546,23 @@ class IFUCubeData():
         for i in range(number_bands):
             this_par1 = self.list_par1[i]
             this_par2 = self.list_par2[i]
-            nfiles = len(self.master_table.FileMap[self.instrument][this_par1][this_par2])
-# ________________________________________________________________________________
-# loop over the files that cover the spectral range the cube is for
-            for k in range(nfiles):
-                ifile = self.master_table.FileMap[self.instrument][this_par1][this_par2][k]
-                self.this_cube_filenames.append(ifile)
-                log.debug("Working on Band defined by: %s %s ", this_par1, this_par2)
-# --------------------------------------------------------------------------------
-                if self.interpolation == 'pointcloud':
-                    t0 = time.time()
-                    pixelresult = self.map_detector_to_outputframe(this_par1,
-                                                                   subtract_background,
-                                                                   ifile)
-
-                    coord1, coord2, wave, flux, err, slice_no, rois_pixel, roiw_pixel, weight_pixel,\
-                        softrad_pixel, scalerad_pixel, alpha_det, beta_det = pixelresult
-                    t1 = time.time()
-                    log.info("Time to transform pixels to output frame = %.1f s" % (t1 - t0,))
-
-                    # If setting the DQ plane of the IFU
-                    if self.skip_dqflagging:
-                        log.info("Skipping setting DQ flagging")
-                    else:
-                        t0 = time.time()
-                        roiw_ave = np.mean(roiw_pixel)
-                        self.map_fov_to_dqplane(this_par1, coord1, coord2, wave, roiw_ave, slice_no)
-                        t1 = time.time()
-                        log.info("Time to set initial dq values = %.1f s" % (t1 - t0,))
-                    if self.weighting == 'msm' or self.weighting == 'emsm':
-                        t0 = time.time()
-                        cube_cloud.match_det2cube_msm(self.naxis1, self.naxis2, self.naxis3,
-                                                      self.cdelt1, self.cdelt2,
-                                                      self.cdelt3_normal,
-                                                      self.xcenters, self.ycenters, self.zcoord,
-                                                      self.spaxel_flux,
-                                                      self.spaxel_weight,
-                                                      self.spaxel_iflux,
-                                                      self.spaxel_var,
-                                                      flux,
-                                                      err,
-                                                      coord1, coord2, wave,
-                                                      self.weighting,
-                                                      rois_pixel, roiw_pixel,
-                                                      weight_pixel,
-                                                      softrad_pixel,
-                                                      scalerad_pixel)
-
-                        t1 = time.time()
-                        log.info("Time to match file to ifucube = %.1f s" % (t1 - t0,))
+            ifiles = self.master_table.FileMap[self.instrument][this_par1][this_par2]
+            nfiles = len(ifiles)
+            log.debug("Working on Band defined by: %s %s ", this_par1, this_par2)
 # ________________________________________________________________________________
-                    elif self.weighting == 'miripsf':
-                        with datamodels.IFUImageModel(ifile) as input_model:
-                            wave_resol = self.instrument_info.Get_RP_ave_Wave(this_par1,
-                                                                              this_par2)
-
-                            alpha_resol = self.instrument_info.Get_psf_alpha_parameters()
-                            beta_resol = self.instrument_info.Get_psf_beta_parameters()
-
-                            worldtov23 = input_model.meta.wcs.get_transform("world", "v2v3")
-                            v2ab_transform = input_model.meta.wcs.get_transform('v2v3',
-                                                                                'alpha_beta')
-
-                            spaxel_v2, spaxel_v3, zl = worldtov23(spaxel_ra,
-                                                                  spaxel_dec,
-                                                                  spaxel_wave)
-
-                            spaxel_alpha, spaxel_beta, spaxel_wave = v2ab_transform(spaxel_v2,
-                                                                                    spaxel_v3,
-                                                                                    zl)
-                            cube_cloud.match_det2cube_miripsf(alpha_resol,
-                                                              beta_resol,
-                                                              wave_resol,
-                                                              self.naxis1, self.naxis2, self.naxis3,
-                                                              self.xcenters, self.ycenters, self.zcoord,
-                                                              self.spaxel_flux,
-                                                              self.spaxel_weight,
-                                                              self.spaxel_iflux,
-                                                              self.spaxel_var,
-                                                              spaxel_alpha, spaxel_beta, spaxel_wave,
-                                                              flux,
-                                                              err,
-                                                              coord1, coord2, wave,
-                                                              alpha_det, beta_det,
-                                                              self.weighting,
-                                                              rois_pixel, roiw_pixel,
-                                                              weight_pixel,
-                                                              softrad_pixel,
-                                                              scalerad_pixel)
+# map the files that cover the spectral range the cube is for
+            if self.interpolation == 'pointcloud':
+                self.this_cube_filenames.extend(ifiles)
+                self.map_files_to_cube(this_par1, this_par2, ifiles,
+                                       subtract_background, spaxel_index,
+                                       spaxel_ra, spaxel_dec, spaxel_wave)
 # --------------------------------------------------------------------------------
 # 2D area method - only works for single files and coord_system = 'alpha-beta'
 # --------------------------------------------------------------------------------
-                elif self.interpolation == 'area':
+            elif self.interpolation == 'area':
+                for k in range(nfiles):
+                    ifile = ifiles[k]
+                    self.this_cube_filenames.append(ifile)
                     with datamodels.IFUImageModel(ifile) as input_model:
                         det2ab_transform = input_model.meta.wcs.get_transform('detector',
                                                                               'alpha_beta')
@@ -675,6 +609,206 @@ class IFUCubeData():
 # shove Flux and iflux in the  final IFU cube
         self.update_ifucube(ifucube_model)
         return ifucube_model
+# ********************************************************************************
+
+    def map_files_to_cube(self, this_par1, this_par2, ifiles,
+                          subtract_background, spaxel_index,
+                          spaxel_ra, spaxel_dec, spaxel_wave):
+        """ Map the point cloud of a set of files to the cube spaxels
+
+        The files are divided among the worker processes set by maximum_cores.
+        Each process maps its files to the output frame and matches them to
+        the spaxels in its own spaxel_flux, spaxel_weight, spaxel_iflux and
+        spaxel_var arrays, which are added to the cube arrays at the end. The
+        initial DQ plane is then set from each file in turn.
+
+        Processes are used rather than threads because matching the point
+        cloud to the spaxels is a Python loop over the detector pixels, which
+        holds the GIL. The pool is started with the 'fork' method, so the
+        workers inherit the cube and the input models and nothing is pickled
+        but the results; where 'fork' is not available, the files are mapped
+        in this process.
+
+        Parameters
+        ----------
+        this_par1 : str
+           for MIRI this is the channel # for NIRSPEC this is the grating name
+        this_par2 : str
+           for MIRI this is the sub-channel for NIRSPEC this is the filter name
+        ifiles : list
+           files covering this_par1, this_par2
+        subtract_background : boolean
+           if TRUE then subtract the background found in the mrs_imatch step
+        spaxel_index : cube_cloud.SpaxelIndex
+           index of the spaxel centers
+        spaxel_ra, spaxel_dec, spaxel_wave : numpy.ndarray
+           spaxel centers in ra, dec, wavelength, only used (and not None) for
+           miripsf weighting
+        """
+        nproc = fork_processes(min(num_processes(self.maximum_cores),
+                                   len(ifiles)))
+        if nproc <= 1:
+            spaxel_sums = (self.spaxel_flux, self.spaxel_weight,
+                           self.spaxel_iflux, self.spaxel_var)
+            for ifile in ifiles:
+                fov = self.map_file_to_cube(this_par1, this_par2, ifile,
+                                            subtract_background, spaxel_index,
+                                            spaxel_ra, spaxel_dec, spaxel_wave,
+                                            *spaxel_sums)
+                self.set_dqplane_from_fov(this_par1, fov)
+            return
+
+        # The background is subtracted from the input models in place, so
+        # it is done here for the change to be seen after the workers exit.
+        if subtract_background:
+            for ifile in ifiles:
+                with datamodels.IFUImageModel(ifile) as input_model:
+                    self.subtract_file_background(this_par1, input_model)
+
+        # give the files to the processes in turn; file k goes to process k % nproc
+        file_lists = [list(range(i, len(ifiles), nproc)) for i in range(nproc)]
+        state = (self, this_par1, this_par2, ifiles, spaxel_index,
+                 spaxel_ra, spaxel_dec, spaxel_wave)
+        log.info("Mapping %d files to the cube with %d processes", len(ifiles), nproc)
+        pool = fork_pool(nproc, _set_pool_state, (state,))
+        try:
+            results = pool.map(_pool_map_file_list, file_lists)
+        finally:
+            pool.terminate()
+            pool.close()
+
+        fovs = [None] * len(ifiles)
+        for i, (spaxel_sums, process_fovs) in enumerate(results):
+            self.spaxel_flux += spaxel_sums[0]
+            self.spaxel_weight += spaxel_sums[1]
+            self.spaxel_iflux += spaxel_sums[2]
+            self.spaxel_var += spaxel_sums[3]
+            fovs[i::nproc] = process_fovs
+
+        # the DQ plane is set from the files in their original order
+        for fov in fovs:
+            self.set_dqplane_from_fov(this_par1, fov)
+# ********************************************************************************
+
+    def map_file_to_cube(self, this_par1, this_par2, ifile,
+                         subtract_background, spaxel_index,
+                         spaxel_ra, spaxel_dec, spaxel_wave,
+                         spaxel_flux, spaxel_weight, spaxel_iflux, spaxel_var):
+        """ Map the detector pixels of a file to the cube spaxels
+
+        Parameters
+        ----------
+        this_par1, this_par2, ifile, subtract_background, spaxel_index,
+        spaxel_ra, spaxel_dec, spaxel_wave : see map_files_to_cube
+        spaxel_flux, spaxel_weight, spaxel_iflux, spaxel_var : numpy.ndarray
+           arrays the weighted fluxes, weights, counts and variances of the
+           file are added to
+
+        Returns
+        -------
+        fov : tuple
+           coord1, coord2, wave, roiw_pixel and slice_no of the point cloud,
+           used to set the initial DQ plane. None if skip_dqflagging is set.
+        """
+        t0 = time.time()
+        pixelresult = self.map_detector_to_outputframe(this_par1,
+                                                       subtract_background,
+                                                       ifile)
+
+        coord1, coord2, wave, flux, err, slice_no, rois_pixel, roiw_pixel, weight_pixel,\
+            softrad_pixel, scalerad_pixel, alpha_det, beta_det = pixelresult
+        t1 = time.time()
+        log.info("Time to transform pixels to output frame = %.1f s" % (t1 - t0,))
+
+        if self.weighting == 'msm' or self.weighting == 'emsm':
+            t0 = time.time()
+            cube_cloud.match_det2cube_msm(self.naxis1, self.naxis2, self.naxis3,
+                                          self.cdelt1, self.cdelt2,
+                                          self.cdelt3_normal,
+                                          self.xcenters, self.ycenters, self.zcoord,
+                                          spaxel_flux,
+                                          spaxel_weight,
+                                          spaxel_iflux,
+                                          spaxel_var,
+                                          flux,
+                                          err,
+                                          coord1, coord2, wave,
+                                          self.weighting,
+                                          rois_pixel, roiw_pixel,
+                                          weight_pixel,
+                                          softrad_pixel,
+                                          scalerad_pixel,
+                                          spaxel_index=spaxel_index)
+
+            t1 = time.time()
+            log.info("Time to match file to ifucube = %.1f s" % (t1 - t0,))
+# ________________________________________________________________________________
+        elif self.weighting == 'miripsf':
+            with datamodels.IFUImageModel(ifile) as input_model:
+                wave_resol = self.instrument_info.Get_RP_ave_Wave(this_par1,
+                                                                  this_par2)
+
+                alpha_resol = self.instrument_info.Get_psf_alpha_parameters()
+                beta_resol = self.instrument_info.Get_psf_beta_parameters()
+
+                worldtov23 = input_model.meta.wcs.get_transform("world", "v2v3")
+                v2ab_transform = input_model.meta.wcs.get_transform('v2v3',
+                                                                    'alpha_beta')
+
+                spaxel_v2, spaxel_v3, zl = worldtov23(spaxel_ra,
+                                                      spaxel_dec,
+                                                      spaxel_wave)
+
+                spaxel_alpha, spaxel_beta, spaxel_ab_wave = v2ab_transform(spaxel_v2,
+                                                                           spaxel_v3,
+                                                                           zl)
+                cube_cloud.match_det2cube_miripsf(alpha_resol,
+                                                  beta_resol,
+                                                  wave_resol,
+                                                  self.naxis1, self.naxis2, self.naxis3,
+                                                  self.xcenters, self.ycenters, self.zcoord,
+                                                  spaxel_flux,
+                                                  spaxel_weight,
+                                                  spaxel_iflux,
+                                                  spaxel_var,
+                                                  spaxel_alpha, spaxel_beta, spaxel_ab_wave,
+                                                  flux,
+                                                  err,
+                                                  coord1, coord2, wave,
+                                                  alpha_det, beta_det,
+                                                  self.weighting,
+                                                  rois_pixel, roiw_pixel,
+                                                  weight_pixel,
+                                                  softrad_pixel,
+                                                  scalerad_pixel,
+                                                  spaxel_index=spaxel_index)
+
+        if self.skip_dqflagging:
+            return None
+        return coord1, coord2, wave, roiw_pixel, slice_no
+# ********************************************************************************
+
+    def set_dqplane_from_fov(self, this_par1, fov):
+        """ Set the initial DQ plane from the point cloud of a file
+
+        Parameters
+        ----------
+        this_par1 : str
+           for MIRI this is the channel # for NIRSPEC this is the grating name
+        fov : tuple
+           returned by map_file_to_cube
+        """
+        if self.skip_dqflagging:
+            log.info("Skipping setting DQ flagging")
+            return
+        t0 = time.time()
+        coord1, coord2, wave, roiw_pixel, slice_no = fov
+        roiw_ave = np.mean(roiw_pixel)
+        self.map_fov_to_dqplane(this_par1, coord1, coord2, wave, roiw_ave, slice_no)
+        t1 = time.time()
+        log.info("Time to set initial dq values = %.1f s" % (t1 - t0,))
+# ********************************************************************************
+
 # ********************************************************************************
 
     def build_ifucube_single(self):
@@ -695,6 +829,9 @@ class IFUCubeData():
         log.info("Number of Single IFU cubes to create = %i" % n)
         this_par1 = self.list_par1[0]  # only one channel is used in this approach
 #        this_par2 = None  # not important for this type of mapping
+        spaxel_index = cube_cloud.SpaxelIndex(self.naxis1, self.naxis2,
+                                              self.xcenters, self.ycenters,
+                                              self.zcoord)
 
         for j in range(n):
             log.info("Working on next Single IFU Cube = %i" % (j + 1))
@@ -735,7 +872,8 @@ class IFUCubeData():
                                           rois_pixel, roiw_pixel,
                                           weight_pixel,
                                           softrad_pixel,
-                                          scalerad_pixel)
+                                          scalerad_pixel,
+                                          spaxel_index=spaxel_index)
 # _______________________________________________________________________
 # shove Flux and iflux in the  final ifucube
             self.find_spaxel_flux()
@@ -1073,10 +1211,34 @@ class IFUCubeData():
         self.print_cube_geometry()
 # **************************************************************************
 
+    def subtract_file_background(self, this_par1, input_model):
+        """ Subtract the background found in the mrs_imatch step, in place
+
+        Parameters
+        ----------
+        this_par1 : str
+           for MIRI this is the channel #; only the background of this
+           channel is subtracted
+        input_model : datamodel
+           input data model
+        """
+        from ..mrs_imatch.mrs_imatch_step import apply_background_2d
+
+        # check if background sky matching as been done
+        # mrs_imatch step. THis is only for MRS data at this time
+        # but go head and check it before splitting by instrument
+        # the polynomial should be empty for NIRSPEC
+        num_ch_bgk = len(input_model.meta.background.polynomial_info)
+        for ich_num in range(num_ch_bgk):
+            poly = input_model.meta.background.polynomial_info[ich_num]
+            poly_ch = poly.channel
+            if(poly_ch == this_par1):
+                apply_background_2d(input_model, poly_ch, subtract=True)
+# **************************************************************************
+
     def map_detector_to_outputframe(self, this_par1,
                                     subtract_background,
                                     ifile):
-        from ..mrs_imatch.mrs_imatch_step import apply_background_2d
 # **************************************************************************
         """Loop over a file and map the detector pixels to the output cube
 
@@ -1135,18 +1297,8 @@ class IFUCubeData():
         slice_no = None  # Slice number
 # Open the input data model
         with datamodels.IFUImageModel(ifile) as input_model:
-            # check if background sky matching as been done
-            # mrs_imatch step. THis is only for MRS data at this time
-            # but go head and check it before splitting by instrument
-            # the polynomial should be empty for NIRSPEC
-
-            num_ch_bgk = len(input_model.meta.background.polynomial_info)
-            if(num_ch_bgk > 0 and subtract_background):
-                for ich_num in range(num_ch_bgk):
-                    poly = input_model.meta.background.polynomial_info[ich_num]
-                    poly_ch = poly.channel
-                    if(poly_ch == this_par1):
-                        apply_background_2d(input_model, poly_ch, subtract=True)
+            if subtract_background:
+                self.subtract_file_background(this_par1, input_model)
 # --------------------------------------------------------------------------------
             if self.instrument == 'MIRI':
 
@@ -1215,9 +1367,7 @@ class IFUCubeData():
                 nslices = 30
                 log.info("Mapping each NIRSpec slice to sky; this takes a while for NIRSpec data")
                 for ii in range(nslices):
-                    slice_wcs = nirspec.nrs_wcs_set_input(input_model, ii)
-                    x, y = wcstools.grid_from_bounding_box(slice_wcs.bounding_box)
-                    ra, dec, lam = slice_wcs(x, y)
+                    x, y, ra, dec, lam = wcs_cache.slit_coordinates(input_model, ii)
 
                     # the slices are curved on detector so a rectangular region
                     # returns NaNs
@@ -2033,6 +2183,33 @@ class IFUCubeData():
                               output=output_file)
 
 
+# The state shared by the worker processes of map_files_to_cube, assigned by
+# the initializer of the forked pool so that the cube and the models are
+# inherited rather than sent with every task.
+_pool_state = None
+
+
+def _set_pool_state(state):
+    global _pool_state
+    _pool_state = state
+
+
+def _pool_map_file_list(indices):
+    """ Map the files at indices to the spaxel arrays of a worker """
+    (cube, this_par1, this_par2, ifiles, spaxel_index,
+     spaxel_ra, spaxel_dec, spaxel_wave) = _pool_state
+    total_num = cube.naxis1 * cube.naxis2 * cube.naxis3
+    spaxel_sums = tuple(np.zeros(total_num) for _ in range(4))
+    fovs = []
+    for i in indices:
+        # the background was subtracted by map_files_to_cube
+        fovs.append(cube.map_file_to_cube(this_par1, this_par2, ifiles[i],
+                                          False, spaxel_index,
+                                          spaxel_ra, spaxel_dec, spaxel_wave,
+                                          *spaxel_sums))
+    return spaxel_sums, fovs
+
+
 class IncorrectInput(Exception):
     """ Raises an exception if input parameter, Interpolation, is set to area
     when more than one file is used to build the cube.
@@ -0,0 +1,182 @@
+"""
+Unit test for the spaxel index used to match the point cloud to the cube
+"""
+
+import numpy as np
+
+from jwst.cube_build import cube_cloud
+
+
+def brute_force_match(xcenters, ycenters, zcoord, x, y, wave, rois, roiw):
+    xdistance = (xcenters - x)
+    ydistance = (ycenters - y)
+    radius = np.sqrt(xdistance * xdistance + ydistance * ydistance)
+    indexr = np.where(radius <= rois)
+    indexz = np.where(abs(zcoord - wave) <= roiw)
+    return indexr, indexz
+
+
+def test_spaxel_index_matches_brute_force():
+    naxis1, naxis2, naxis3 = 17, 11, 30
+    cdelt1, cdelt2, cdelt3 = 0.13, 0.13, 0.002
+    xcoord = -1.0 + cdelt1 * np.arange(naxis1)
+    ycoord = -0.7 + cdelt2 * np.arange(naxis2)
+    ygrid, xgrid = np.meshgrid(ycoord, xcoord, indexing='ij')
+    xcenters = xgrid.flatten()
+    ycenters = ygrid.flatten()
+    zcoord = 5.0 + cdelt3 * np.arange(naxis3)
+
+    spaxel_index = cube_cloud.SpaxelIndex(naxis1, naxis2, xcenters, ycenters, zcoord)
+
+    rng = np.random.RandomState(42)
+    npts = 200
+    # include points outside of the cube
+    coord1 = rng.uniform(-1.5, 1.9, npts)
+    coord2 = rng.uniform(-1.2, 1.2, npts)
+    wave = rng.uniform(4.95, 5.07, npts)
+    rois = rng.uniform(0.05, 0.5, npts)
+    roiw = rng.uniform(0.001, 0.01, npts)
+    for ipt in range(npts):
+        indexr, indexz = brute_force_match(xcenters, ycenters, zcoord,
+                                           coord1[ipt], coord2[ipt], wave[ipt],
+                                           rois[ipt], roiw[ipt])
+        np.testing.assert_array_equal(
+            spaxel_index.spatial_match(coord1[ipt], coord2[ipt], rois[ipt])[0], indexr[0])
+        np.testing.assert_array_equal(
+            spaxel_index.spectral_match(wave[ipt], roiw[ipt])[0], indexz[0])
+
+    # a grid point lying exactly on the edge of the roi is matched
+    indexr = spaxel_index.spatial_match(xcenters[0], ycenters[0], cdelt1)[0]
+    assert set(indexr) == {0, 1, naxis1}
+
+
+def test_spaxel_index_unsorted_wavelength_table():
+    zcoord = np.array([5.0, 5.3, 5.1, 5.2])
+    xcenters = np.array([0.0])
+    ycenters = np.array([0.0])
+    spaxel_index = cube_cloud.SpaxelIndex(1, 1, xcenters, ycenters, zcoord)
+
+    np.testing.assert_array_equal(spaxel_index.spectral_match(5.15, 0.06)[0], [2, 3])
+
+
+def make_cube(maximum_cores, skip_dqflagging):
+    from jwst.cube_build import ifu_cube
+
+    cube = ifu_cube.IFUCubeData(None, None, None, None, None, 'MIRI',
+                                ['1'], ['short'], None, None,
+                                maximum_cores=maximum_cores,
+                                skip_dqflagging=skip_dqflagging,
+                                weighting='msm')
+    cube.naxis1, cube.naxis2, cube.naxis3 = 9, 7, 20
+    cube.cdelt1, cube.cdelt2 = 0.13, 0.13
+    cube.cdelt3_normal = np.full(cube.naxis3, 0.002)
+    xcoord = cube.cdelt1 * (np.arange(cube.naxis1) - (cube.naxis1 - 1) / 2)
+    ycoord = cube.cdelt2 * (np.arange(cube.naxis2) - (cube.naxis2 - 1) / 2)
+    ygrid, xgrid = np.meshgrid(ycoord, xcoord, indexing='ij')
+    cube.xcenters = xgrid.flatten()
+    cube.ycenters = ygrid.flatten()
+    cube.zcoord = 5.0 + 0.002 * np.arange(cube.naxis3)
+    total_num = cube.naxis1 * cube.naxis2 * cube.naxis3
+    cube.spaxel_flux = np.zeros(total_num)
+    cube.spaxel_weight = np.zeros(total_num)
+    cube.spaxel_iflux = np.zeros(total_num)
+    cube.spaxel_var = np.zeros(total_num)
+    cube.fov_order = []
+    cube.background_files = []
+    return cube
+
+
+def fake_point_cloud(self, this_par1, subtract_background, ifile):
+    """ Point cloud of a file, with the file (an int) as seed """
+    rng = np.random.RandomState(ifile)
+    npts = 300
+    half_width = 0.13 * 5
+    ones = np.ones(npts)
+    return (rng.uniform(-half_width, half_width, npts),     # coord1
+            rng.uniform(-half_width, half_width, npts),     # coord2
+            rng.uniform(4.99, 5.05, npts),                  # wave
+            rng.normal(10., 1., npts),                      # flux
+            rng.uniform(0.5, 1.5, npts),                    # err
+            np.zeros(npts, dtype=int),                      # slice_no
+            0.2 * ones, 0.003 * ones, 2. * ones,            # rois, roiw, weight
+            0.01 * ones, 0.1 * ones,                        # softrad, scalerad
+            None, None)                                     # alpha, beta
+
+
+def test_map_files_to_cube_processes(monkeypatch):
+    """ The point clouds matched by a pool of processes add up to
+    the ones matched one file at a time """
+    from jwst.cube_build import ifu_cube
+
+    def record_background(self, this_par1, input_model):
+        self.background_files.append(input_model)
+
+    monkeypatch.setattr(ifu_cube.IFUCubeData, 'map_detector_to_outputframe',
+                        fake_point_cloud)
+    monkeypatch.setattr(ifu_cube.IFUCubeData, 'subtract_file_background',
+                        record_background)
+    monkeypatch.setattr(ifu_cube.datamodels, 'IFUImageModel', DummyModel)
+    monkeypatch.setattr(ifu_cube, 'num_processes',
+                        lambda max_cores: 1 if max_cores is None else 3)
+
+    ifiles = list(range(7))
+    serial = make_cube(None, True)
+    spaxel_index = cube_cloud.SpaxelIndex(serial.naxis1, serial.naxis2,
+                                          serial.xcenters, serial.ycenters,
+                                          serial.zcoord)
+    serial.map_files_to_cube('1', 'short', ifiles, True, spaxel_index,
+                             None, None, None)
+    parallel = make_cube('all', True)
+    parallel.map_files_to_cube('1', 'short', ifiles, True, spaxel_index,
+                               None, None, None)
+
+    assert serial.spaxel_iflux.sum() > 0
+    np.testing.assert_allclose(parallel.spaxel_flux, serial.spaxel_flux, rtol=1e-12)
+    np.testing.assert_allclose(parallel.spaxel_weight, serial.spaxel_weight, rtol=1e-12)
+    np.testing.assert_array_equal(parallel.spaxel_iflux, serial.spaxel_iflux)
+    np.testing.assert_allclose(parallel.spaxel_var, serial.spaxel_var, rtol=1e-12)
+
+    # the background is subtracted once from each file, by the parent for
+    # the pool (the fake point cloud does not subtract it when serial)
+    assert parallel.background_files == ifiles
+    assert serial.background_files == []
+
+
+class DummyModel:
+    """ Stands for IFUImageModel(ifile), giving back ifile """
+
+    def __init__(self, ifile):
+        self.ifile = ifile
+
+    def __enter__(self):
+        return self.ifile
+
+    def __exit__(self, *args):
+        return False
+
+
+def test_map_files_to_cube_dq_order(monkeypatch):
+    """ The DQ plane is set from the files in their original order """
+    from jwst.cube_build import ifu_cube
+
+    def fake_set_dqplane_from_fov(self, this_par1, fov):
+        self.fov_order.append(fov[3][0])
+
+    def fake_roiw_point_cloud(self, this_par1, subtract_background, ifile):
+        cloud = list(fake_point_cloud(self, this_par1, subtract_background, ifile))
+        cloud[7] = np.full(cloud[0].size, 0.001 * (ifile + 1))
+        return tuple(cloud)
+
+    monkeypatch.setattr(ifu_cube.IFUCubeData, 'map_detector_to_outputframe',
+                        fake_roiw_point_cloud)
+    monkeypatch.setattr(ifu_cube.IFUCubeData, 'set_dqplane_from_fov',
+                        fake_set_dqplane_from_fov)
+    monkeypatch.setattr(ifu_cube, 'num_processes',
+                        lambda max_cores: 1 if max_cores is None else 3)
+
+    ifiles = list(range(7))
+    expected = [0.001 * (ifile + 1) for ifile in ifiles]
+    for maximum_cores in (None, 'all'):
+        cube = make_cube(maximum_cores, False)
+        cube.map_files_to_cube('1', 'short', ifiles, False, None, None, None, None)
+        np.testing.assert_allclose(cube.fov_order, expected)
@@ -50,6 +50,15 @@ class ModelContainer(model_base.DataModel):
 
        - asn_n_members: Open only the first N qualifying members.
 
+       - lazy: If True, members given as file paths are not opened until
+         they are first accessed, and are then opened memory-mapped.
+
+       - max_open: With ``lazy``, the maximum number of members kept open.
+         The least recently used member is closed when another one is
+         opened, and reopened from its file when it is accessed again, so
+         changes made to a member that are not saved are lost once it has
+         been closed.  If None, members stay open once opened.
+
     Examples
     --------
     >>> container = ModelContainer('example_asn.json')
@@ -68,19 +77,34 @@ class ModelContainer(model_base.DataModel):
     >>> c = ModelContainer()
     >>> m = datamodels.open('myfile.fits')
     >>> c.append(m)
+
+    Large associations can be read lazily so that only a few members are
+    open at any time:
+
+    >>> container = ModelContainer('example_asn.json', lazy=True, max_open=8)
+    >>> for dm in container:
+    ...     print(dm.data.mean())
     """
 
     # This schema merely extends the 'meta' part of the datamodel, and
     # does not describe the data contents of the container.
     schema_url = "http://stsci.edu/schemas/jwst_datamodel/container.schema"
 
-    def __init__(self, init=None, asn_exptypes=None, asn_n_members=None, **kwargs):
+    def __init__(self, init=None, asn_exptypes=None, asn_n_members=None,
+                 lazy=False, max_open=None, **kwargs):
 
         super().__init__(init=None, asn_exptypes=None, **kwargs)
 
         self._models = []
         self.asn_exptypes = asn_exptypes
         self.asn_n_members = asn_n_members
+        self._lazy = lazy
+        self._max_open = None if max_open is None else max(1, max_open)
+        # Lazy members that are open, least recently used first
+        self._open_members = OrderedDict()
+        # Containers made from another container share its members, which
+        # are closed by the container that opened them
+        self._owns_members = True
 
         if init is None:
             # Don't populate the container with models
@@ -88,7 +112,9 @@ class ModelContainer(model_base.DataModel):
         elif isinstance(init, fits.HDUList):
             self._models.append([datamodel_open(init)])
         elif isinstance(init, list):
-            if all(isinstance(x, (str, fits.HDUList)) for x in init):
+            if self._lazy and all(isinstance(x, str) for x in init):
+                init = [self._lazy_member(m) for m in init]
+            elif all(isinstance(x, (str, fits.HDUList)) for x in init):
                 # Try opening the list of files as datamodels
                 try:
                     init = [datamodel_open(m) for m in init]
@@ -106,6 +132,10 @@ class ModelContainer(model_base.DataModel):
             self._ctx = self
             self.__class__ = init.__class__
             self._models = init._models
+            self._lazy = init._lazy
+            self._max_open = init._max_open
+            self._open_members = init._open_members
+            self._owns_members = False
         elif is_association(init):
             self.from_asn(init)
         elif isinstance(init, str):
@@ -119,17 +149,24 @@ class ModelContainer(model_base.DataModel):
         return len(self._models)
 
     def __getitem__(self, index):
-        return self._models[index]
+        if isinstance(index, slice):
+            return [self._resolve(m) for m in self._models[index]]
+        return self._resolve(self._models[index])
 
     def __setitem__(self, index, model):
         self._models[index] = model
 
     def __delitem__(self, index):
+        if isinstance(index, slice):
+            for m in self._models[index]:
+                self._forget(m)
+        else:
+            self._forget(self._models[index])
         del self._models[index]
 
     def __iter__(self):
         for model in self._models:
-            yield model
+            yield self._resolve(model)
 
     def insert(self, index, model):
         self._models.insert(index, model)
@@ -141,7 +178,46 @@ class ModelContainer(model_base.DataModel):
         self._models.extend(model)
 
     def pop(self, index=-1):
-        self._models.pop(index)
+        self._forget(self._models.pop(index))
+
+    def _lazy_member(self, path):
+        if not op.exists(path):
+            raise FileNotFoundError('Cannot open {}'.format(path))
+        return _LazyMember(path)
+
+    def _resolve(self, member):
+        """
+        Return the model of a member, opening it if it is a lazy member,
+        and close the least recently used members beyond ``max_open``.
+        """
+        if not isinstance(member, _LazyMember):
+            return member
+        model = member.open()
+        if self._max_open is not None:
+            self._open_members[id(member)] = member
+            self._open_members.move_to_end(id(member))
+            while len(self._open_members) > self._max_open:
+                _, least_recent = self._open_members.popitem(last=False)
+                least_recent.release()
+        return model
+
+    def _forget(self, member):
+        if isinstance(member, _LazyMember):
+            self._open_members.pop(id(member), None)
+            member.release()
+
+    def close(self):
+        """
+        Close the members opened lazily by the container.
+
+        Models added to the container already opened are not closed.
+        """
+        if self._owns_members:
+            for member in self._models:
+                if isinstance(member, _LazyMember):
+                    member.release()
+            self._open_members.clear()
+        super().close()
 
     def copy(self, memo=None):
         """
@@ -156,9 +232,13 @@ class ModelContainer(model_base.DataModel):
         result._iscopy = self._iscopy
         result._schema = result._schema
         result._ctx = result
+        result._lazy = self._lazy
+        result._max_open = self._max_open
         for m in self._models:
             if isinstance(m, model_base.DataModel):
                 result.append(m.copy())
+            elif isinstance(m, _LazyMember):
+                result.append(m.copy())
             else:
                 result.append(m)
         return result
@@ -219,7 +299,10 @@ class ModelContainer(model_base.DataModel):
         else:
             sublist = infiles
         try:
-            self._models = [datamodel_open(infile) for infile in sublist]
+            if self._lazy:
+                self._models = [self._lazy_member(infile) for infile in sublist]
+            else:
+                self._models = [datamodel_open(infile) for infile in sublist]
         except IOError:
             raise IOError('Cannot open {}'.format(infiles))
 
@@ -323,14 +406,19 @@ class ModelContainer(model_base.DataModel):
             'exposure_number'
             ]
 
-        for i, model in enumerate(self._models):
-            params = []
-            for param in unique_exposure_parameters:
-                params.append(getattr(model.meta.observation, param))
+        for i, member in enumerate(self._models):
+            params = None
+            if isinstance(member, _LazyMember) and member.model is None:
+                # Read the grouping metadata without opening the model
+                params = member.read_observation(unique_exposure_parameters)
+            if params is None:
+                model = self._resolve(member)
+                params = []
+                for param in unique_exposure_parameters:
+                    params.append(getattr(model.meta.observation, param))
             try:
                 group_id = ('jw' + '_'.join([''.join(params[:3]),
                                              ''.join(params[3:6]), params[6]]))
-                model.meta.group_id = group_id
             except TypeError:
                 params_dict = dict(zip(unique_exposure_parameters, params))
                 bad_params = {'meta.observation.'+k:v for k, v in params_dict.items() if not v}
@@ -338,21 +426,36 @@ class ModelContainer(model_base.DataModel):
                     'Cannot determine grouping of exposures: '
                     '{}'.format(bad_params)
                     )
-                model.meta.group_id = 'exposure{0:04d}'.format(i + 1)
+                group_id = 'exposure{0:04d}'.format(i + 1)
+            if isinstance(member, _LazyMember):
+                # Keep the group_id if the member is closed and reopened
+                member.group_id = group_id
+                if member.model is not None:
+                    member.model.meta.group_id = group_id
+            else:
+                member.meta.group_id = group_id
 
     @property
     def models_grouped(self):
         """
         Returns a list of a list of datamodels grouped by exposure.
+
+        For a lazy container, the members of each group are opened when the
+        group is indexed or iterated over.
         """
         self._assign_group_ids()
         group_dict = OrderedDict()
-        for model in self._models:
-            group_id = model.meta.group_id
+        for member in self._models:
+            if isinstance(member, _LazyMember):
+                group_id = member.group_id
+            else:
+                group_id = member.meta.group_id
             if group_id in group_dict:
-                group_dict[group_id].append(model)
+                group_dict[group_id].append(member)
             else:
-                group_dict[group_id] = [model]
+                group_dict[group_id] = [member]
+        if self._lazy:
+            return [_LazyGroup(self, members) for members in group_dict.values()]
         return group_dict.values()
 
     @property
@@ -360,12 +463,96 @@ class ModelContainer(model_base.DataModel):
         """
         Return list of names for the DataModel groups by exposure.
         """
+        self._assign_group_ids()
         result = []
-        for group in self.models_grouped:
-            result.append(group[0].meta.group_id)
+        for member in self._models:
+            if isinstance(member, _LazyMember):
+                group_id = member.group_id
+            else:
+                group_id = member.meta.group_id
+            if group_id not in result:
+                result.append(group_id)
         return result
 
 
+# FITS keywords of the meta.observation attributes used to group exposures
+_OBSERVATION_KEYWORDS = {
+    'program_number': 'PROGRAM',
+    'observation_number': 'OBSERVTN',
+    'visit_number': 'VISIT',
+    'visit_group': 'VISITGRP',
+    'sequence_id': 'SEQ_ID',
+    'activity_id': 'ACT_ID',
+    'exposure_number': 'EXPOSURE',
+}
+
+
+class _LazyMember:
+    """
+    A member of a lazy `ModelContainer`, opened from its file on demand.
+    """
+
+    def __init__(self, path, group_id=None):
+        self.path = path
+        self.group_id = group_id
+        self.model = None
+
+    def open(self):
+        if self.model is None:
+            self.model = datamodel_open(self.path, memmap=True)
+            if self.group_id is not None:
+                self.model.meta.group_id = self.group_id
+        return self.model
+
+    def read_observation(self, params):
+        """
+        Values of the ``meta.observation`` attributes `params`, read from the
+        primary header of a FITS file without opening the model.
+
+        Returns None if the file is not a FITS file.
+        """
+        if not self.path.lower().endswith(('.fits', '.fits.gz')):
+            return None
+        header = fits.getheader(self.path)
+        values = []
+        for param in params:
+            value = header.get(_OBSERVATION_KEYWORDS[param])
+            values.append(None if value is None else str(value))
+        return values
+
+    def release(self):
+        if self.model is not None:
+            self.model.close()
+            self.model = None
+
+    def copy(self):
+        if self.model is None:
+            return _LazyMember(self.path, group_id=self.group_id)
+        return self.model.copy()
+
+
+class _LazyGroup:
+    """
+    The members of one exposure of a lazy `ModelContainer`.
+    """
+
+    def __init__(self, container, members):
+        self._container = container
+        self._members = members
+
+    def __len__(self):
+        return len(self._members)
+
+    def __getitem__(self, index):
+        if isinstance(index, slice):
+            return [self._container._resolve(m) for m in self._members[index]]
+        return self._container._resolve(self._members[index])
+
+    def __iter__(self):
+        for member in self._members:
+            yield self._container._resolve(member)
+
+
 def make_file_with_index(file_path, idx):
     """Append an index to a filename
 
@@ -46,13 +46,21 @@ _builtin_regex = re.compile(
     '|'.join('(^{0}$)'.format(x) for x in _builtin_regexes))
 
 
+# Results of _is_builtin_fits_keyword, as the same keywords are in every file
+_builtin_keywords = {}
+
+
 def _is_builtin_fits_keyword(key):
     """
     Returns `True` if the given `key` is a built-in FITS keyword, i.e.
     a keyword that is managed by ``astropy.io.fits`` and we wouldn't
     want to propagate through the `_extra_fits` mechanism.
     """
-    return _builtin_regex.match(key) is not None
+    try:
+        return _builtin_keywords[key]
+    except KeyError:
+        builtin = _builtin_keywords[key] = _builtin_regex.match(key) is not None
+        return builtin
 
 
 _keyword_indices = [
@@ -394,20 +402,156 @@ def to_fits(tree, schema):
 ##############################################################################
 # READER
 
+# Keywords that may appear on several cards of a header.  Their values are
+# looked up in the header itself rather than in the keyword index.
+_commentary_keywords = ('', 'COMMENT', 'HISTORY')
 
-def _fits_keyword_loader(hdulist, fits_keyword, schema, hdu_index, known_keywords):
-    hdu_name = _get_hdu_name(schema)
+# The FITS keywords and arrays of the schemas of the model classes, as
+# compiled by _compile_schema, keyed by schema URL.
+_compiled_schemas = {}
+
+# Entry kinds of a compiled schema
+_KEYWORD, _ARRAY, _ITEMS = range(3)
+
+
+def _schema_has_fits_hdu(schema):
+    has_fits_hdu = [False]
+
+    for node in treeutil.iter_tree(schema):
+        if isinstance(node, dict) and 'fits_hdu' in node:
+            has_fits_hdu[0] = True
+
+    return has_fits_hdu[0]
+
+
+def _compile_schema(schema):
+    """
+    Walk the schema once, listing where its FITS keywords and arrays go in
+    the tree.
+
+    Returns
+    -------
+    entries : list of tuples
+        One ``(kind, path, hdu_name, fits_keyword, tag, subschema)`` entry
+        per keyword (``_KEYWORD``) or array (``_ARRAY``) of the schema, in
+        the order the schema is walked.  Arrays of HDUs are ``_ITEMS``
+        entries, in which ``subschema`` is the compiled schema of the items,
+        with paths relative to the path of the array.
+    """
+    entries = []
+
+    def callback(schema, path, combiner, ctx, recurse):
+        path = tuple(path)
+        if 'fits_keyword' in schema:
+            entries.append((_KEYWORD, path, _get_hdu_name(schema),
+                            schema['fits_keyword'], schema.get('tag'), schema))
+
+        elif 'fits_hdu' in schema and (
+                'max_ndim' in schema or 'ndim' in schema or 'datatype' in schema):
+            hdu_name = _get_hdu_name(schema)
+            _assert_non_primary_hdu(hdu_name)
+            entries.append((_ARRAY, path, hdu_name, None, None, schema))
+
+        if schema.get('type') == 'array':
+            if _schema_has_fits_hdu(schema):
+                entries.append((_ITEMS, path, None, None, None,
+                                _compile_schema(schema['items'])))
+                return True
+
+    mschema.walk_schema(schema, callback)
+    return entries
+
+
+def _get_compiled_schema(schema, schema_key=None):
+    """
+    Return the compiled schema, reusing the one compiled for ``schema_key``.
+
+    ``schema_key`` identifies the schema of a model class; schemas built or
+    extended at run time have no key and are compiled each time.
+    """
+    if schema_key is None:
+        return _compile_schema(schema)
+
+    compiled = _compiled_schemas.get(schema_key)
+    if compiled is None:
+        compiled = _compiled_schemas[schema_key] = _compile_schema(schema)
+    return compiled
+
+
+class _HeaderIndex:
+    """
+    The HDUs of an HDUList and the keyword values of their headers, each
+    header being read only once.
+    """
+
+    def __init__(self, hdulist):
+        self._hdulist = hdulist
+        self._hdus = {}
+        self._headers = {}
+
+    def get_hdu(self, hdu_name, index=None):
+        """ Same as `get_hdu`, but looks up each HDU only once."""
+        pair = _get_hdu_pair(hdu_name, index=index)
+        try:
+            hdu = self._hdus[pair]
+        except KeyError:
+            try:
+                hdu = get_hdu(self._hdulist, hdu_name, index)
+            except AttributeError:
+                hdu = None
+            self._hdus[pair] = hdu
+        if hdu is None:
+            raise AttributeError(
+                "Property missing because FITS file has no "
+                "'{0!r}' HDU".format(pair))
+        return hdu
+
+    def cards(self, hdu):
+        """ Return the ``(keyword, value, comment)`` cards of the header."""
+        return self._index(hdu)[1]
+
+    def value(self, hdu, fits_keyword):
+        """
+        Return the value of the keyword in the header of ``hdu``.
+
+        Raises
+        ------
+        KeyError
+            If the header has no such keyword.
+        """
+        if fits_keyword in _commentary_keywords:
+            return hdu.header[fits_keyword]
+        return self._index(hdu)[0][fits_keyword.upper()]
+
+    def _index(self, hdu):
+        try:
+            return self._headers[hdu]
+        except KeyError:
+            pass
+
+        values = {}
+        cards = []
+        for key, val, comment in hdu.header.cards:
+            cards.append((key, val, comment))
+            key = key.upper()
+            if key not in values:
+                values[key] = val
+        self._headers[hdu] = values, cards
+        return values, cards
+
+
+def _fits_keyword_loader(headers, fits_keyword, tag, hdu_name, hdu_index,
+                         known_keywords):
     try:
-        hdu = get_hdu(hdulist, hdu_name, hdu_index)
+        hdu = headers.get_hdu(hdu_name, hdu_index)
     except AttributeError:
         return None
 
     try:
-        val = hdu.header[fits_keyword]
+        val = headers.value(hdu, fits_keyword)
     except KeyError:
         return None
 
-    tag = schema.get('tag')
     if tag is not None:
         val = tagged.tag_object(tag, val)
 
@@ -416,11 +560,9 @@ def _fits_keyword_loader(hdulist, fits_keyword, schema, hdu_index, known_keyword
     return val
 
 
-def _fits_array_loader(hdulist, schema, hdu_index, known_datas):
-    hdu_name = _get_hdu_name(schema)
-    _assert_non_primary_hdu(hdu_name)
+def _fits_array_loader(headers, schema, hdu_name, hdu_index, known_datas):
     try:
-        hdu = get_hdu(hdulist, hdu_name, hdu_index)
+        hdu = headers.get_hdu(hdu_name, hdu_index)
     except AttributeError:
         return None
 
@@ -428,78 +570,57 @@ def _fits_array_loader(hdulist, schema, hdu_index, known_datas):
     return from_fits_hdu(hdu, schema)
 
 
-def _schema_has_fits_hdu(schema):
-    has_fits_hdu = [False]
-
-    for node in treeutil.iter_tree(schema):
-        if isinstance(node, dict) and 'fits_hdu' in node:
-            has_fits_hdu[0] = True
-
-    return has_fits_hdu[0]
-
-
-def _load_from_schema(hdulist, schema, tree, context):
+def _load_from_schema(hdulist, schema, tree, context, schema_key=None,
+                      headers=None):
     known_keywords = {}
     known_datas = set()
+    if headers is None:
+        headers = _HeaderIndex(hdulist)
 
-    def callback(schema, path, combiner, ctx, recurse):
-        result = None
-        if 'fits_keyword' in schema:
-            fits_keyword = schema['fits_keyword']
-            result = _fits_keyword_loader(
-                hdulist, fits_keyword, schema,
-                ctx.get('hdu_index'), known_keywords)
+    def load(entries, prefix, hdu_index):
+        for kind, path, hdu_name, fits_keyword, tag, subschema in entries:
+            path = prefix + list(path)
+            if kind == _ITEMS:
+                for i in range(len(hdulist)):
+                    load(subschema, path + [i], i)
+                continue
 
-            if result is None:
-                validate.value_change(path, result, schema,
-                                      context._pass_invalid_values,
-                                      context._strict_validation)
+            if kind == _KEYWORD:
+                result = _fits_keyword_loader(
+                    headers, fits_keyword, tag, hdu_name, hdu_index,
+                    known_keywords)
             else:
-                if validate.value_change(path, result, schema,
-                                         context._pass_invalid_values,
-                                         context._strict_validation):
-                    properties.put_value(path, result, tree)
-
-        elif 'fits_hdu' in schema and (
-                'max_ndim' in schema or 'ndim' in schema or 'datatype' in schema):
-            result = _fits_array_loader(
-                hdulist, schema, ctx.get('hdu_index'), known_datas)
+                result = _fits_array_loader(
+                    headers, subschema, hdu_name, hdu_index, known_datas)
 
             if result is None:
-                validate.value_change(path, result, schema,
+                validate.value_change(path, result, subschema,
                                       context._pass_invalid_values,
                                       context._strict_validation)
             else:
-                if validate.value_change(path, result, schema,
+                if validate.value_change(path, result, subschema,
                                          context._pass_invalid_values,
                                          context._strict_validation):
                     properties.put_value(path, result, tree)
 
-        if schema.get('type') == 'array':
-            has_fits_hdu = _schema_has_fits_hdu(schema)
-            if has_fits_hdu:
-                for i in range(len(hdulist)):
-                    recurse(schema['items'],
-                            path + [i],
-                            combiner,
-                            {'hdu_index': i})
-                return True
-
-    mschema.walk_schema(schema, callback)
+    load(_get_compiled_schema(schema, schema_key), [], None)
     return known_keywords, known_datas
 
 
-def _load_extra_fits(hdulist, known_keywords, known_datas, tree):
+def _load_extra_fits(hdulist, known_keywords, known_datas, tree, headers=None):
     # Remove any extra_fits from tree
     if 'extra_fits' in tree:
         del tree['extra_fits']
 
+    if headers is None:
+        headers = _HeaderIndex(hdulist)
+
     # Add header keywords and data not in schema to extra_fits
     for hdu in hdulist:
         known = known_keywords.get(hdu, set())
 
         cards = []
-        for key, val, comment in hdu.header.cards:
+        for key, val, comment in headers.cards(hdu):
             if not (_is_builtin_fits_keyword(key) or
                     key in known):
                 cards.append([key, val, comment])
@@ -531,15 +652,26 @@ def _load_history(hdulist, tree):
         history['entries'].append(HistoryEntry({'description': entry}))
 
 
-def from_fits(hdulist, schema, context, **kwargs):
+def from_fits(hdulist, schema, context, schema_key=None, **kwargs):
+    """
+    Load the tree of a model from a FITS file.
+
+    The FITS keywords and arrays of the schema are found by walking the
+    schema.  If ``schema_key`` is given, the result of the walk is cached
+    under that key and reused for the next files opened with the same key,
+    so it must identify the schema, e.g. its URL.  Each header is read once.
+    """
     try:
         ff = from_fits_asdf(hdulist, **kwargs)
     except Exception as exc:
         raise exc.__class__("ERROR loading embedded ASDF: " + str(exc)) from exc
 
-    known_keywords, known_datas = _load_from_schema(hdulist, schema,
-                                                    ff.tree, context)
-    _load_extra_fits(hdulist, known_keywords, known_datas, ff.tree)
+    headers = _HeaderIndex(hdulist)
+    known_keywords, known_datas = _load_from_schema(
+        hdulist, schema, ff.tree, context, schema_key=schema_key,
+        headers=headers)
+    _load_extra_fits(hdulist, known_keywords, known_datas, ff.tree,
+                     headers=headers)
     _load_history(hdulist, ff.tree)
 
     return ff
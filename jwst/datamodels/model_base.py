@@ -99,8 +99,11 @@ class DataModel(properties.ObjectNode, ndmodel.NDModel):
 
         kwargs.update({'ignore_missing_extensions': ignore_missing_extensions})
 
-        # Load the schema files
+        # Load the schema files.  The schema of the class is identified by
+        # its URL, so the FITS loader can reuse what it compiled from it.
+        self._schema_key = None
         if schema is None:
+            self._schema_key = self.schema_url
             # Create an AsdfFile so we can use its resolver for loading schemas
             asdf_file = AsdfFile()
             schema = asdf_schema.load_schema(self.schema_url,
@@ -153,6 +156,7 @@ class DataModel(properties.ObjectNode, ndmodel.NDModel):
 
         elif isinstance(init, fits.HDUList):
             asdffile = fits_support.from_fits(init, self._schema, self._ctx,
+                                              schema_key=self._schema_key,
                                               **kwargs)
 
         elif isinstance(init, (str, bytes)):
@@ -162,13 +166,14 @@ class DataModel(properties.ObjectNode, ndmodel.NDModel):
 
             if file_type == "fits":
                 if s3_utils.is_s3_uri(init):
-                    hdulist = fits.open(s3_utils.get_object(init))
+                    hdulist = fits.open(s3_utils.open_object(init))
                 else:
                     hdulist = fits.open(init, memmap=memmap)
 
                 asdffile = fits_support.from_fits(hdulist,
                                               self._schema,
                                               self._ctx,
+                                              schema_key=self._schema_key,
                                               **kwargs)
                 self._files_to_close.append(hdulist)
 
@@ -191,6 +196,8 @@ class DataModel(properties.ObjectNode, ndmodel.NDModel):
 
         # Initalize class dependent hidden fields
         self._no_asdf_extension = False
+        # Coordinates evaluated from the WCS, see assign_wcs.wcs_cache
+        self._wcs_cache = None
 
         # Instantiate the primary array of the image
         if is_array:
@@ -324,6 +331,12 @@ class DataModel(properties.ObjectNode, ndmodel.NDModel):
         target._ctx = target
         target._no_asdf_extension = source._no_asdf_extension
 
+        # Copies have the same WCS, so they can reuse its evaluated coordinates
+        wcs_cache = getattr(source, '_wcs_cache', None)
+        if wcs_cache is not None and deepcopy:
+            wcs_cache = wcs_cache.copy()
+        target._wcs_cache = wcs_cache
+
     def copy(self, memo=None):
         """
         Returns a deep copy of this model.
@@ -661,6 +674,7 @@ class DataModel(properties.ObjectNode, ndmodel.NDModel):
         """
         schema = {'allOf': [self._schema, new_schema]}
         self._schema = mschema.merge_property_trees(schema)
+        self._schema_key = None
         self.validate()
         return self
 
@@ -1083,6 +1097,7 @@ class DataModel(properties.ObjectNode, ndmodel.NDModel):
         hdulist = fits.HDUList([hdu])
 
         ff = fits_support.from_fits(hdulist, self._schema, self._ctx,
+                                    schema_key=self._schema_key,
                                     ignore_missing_extensions=self._ignore_missing_extensions)
 
         self._instance = properties.merge_tree(self._instance, ff.tree)
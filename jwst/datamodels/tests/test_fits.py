@@ -184,6 +184,25 @@ def test_extra_fits():
         assert _header_to_dict(dm.extra_fits.PRIMARY.header)['SCIYSTRT'] == 705
 
 
+def test_compiled_schema_reuse():
+    from .. import fits_support
+
+    for i, filename in enumerate((TMP_FITS, TMP_FITS2)):
+        with ImageModel(data=np.full((2, 2), float(i))) as dm:
+            dm.meta.subarray.xstart = i + 1
+            dm.save(filename)
+
+    fits_support._compiled_schemas.pop(ImageModel.schema_url, None)
+    with ImageModel(TMP_FITS) as dm:
+        assert dm.meta.subarray.xstart == 1
+    compiled = fits_support._compiled_schemas[ImageModel.schema_url]
+
+    with ImageModel(TMP_FITS2) as dm:
+        assert dm.meta.subarray.xstart == 2
+        assert_array_equal(dm.data, 1.)
+    assert fits_support._compiled_schemas[ImageModel.schema_url] is compiled
+
+
 def test_hdu_order():
     from astropy.io import fits
 
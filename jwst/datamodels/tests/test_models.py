@@ -718,3 +718,75 @@ def test_ifuimage():
 def test_datamodel_raises_filenotfound():
     with pytest.raises(FileNotFoundError):
         DataModel(init='file_does_not_exist.fits')
+
+
+def test_modelcontainer_lazy():
+    asn_file_path, asn_file_name = op.split(ASN_FILE)
+    with pushdir(asn_file_path):
+        with ModelContainer(asn_file_name, lazy=True, max_open=1) as c:
+            # Members are not opened until they are accessed
+            assert all(m.model is None for m in c._models)
+
+            assert c[0].meta.telescope == 'JWST'
+            assert c._models[0].model is not None
+            assert c._models[1].model is None
+
+            # Opening the second member closes the first one
+            assert c[1].meta.telescope == 'JWST'
+            assert c._models[0].model is None
+            assert c._models[1].model is not None
+
+            for model in c:
+                assert model.meta.telescope == 'JWST'
+            assert sum(m.model is not None for m in c._models) == 1
+
+            # Group ids are kept when the members are reopened
+            names = c.group_names
+            for group in c.models_grouped:
+                for model in group:
+                    assert model.meta.group_id in names
+
+        assert all(m.model is None for m in c._models)
+
+
+def test_modelcontainer_lazy_group_ids(tmpdir):
+    paths = []
+    for i, exposure_number in enumerate(['1', '1', '2']):
+        with ImageModel((4, 4)) as im:
+            im.meta.observation.program_number = '00001'
+            im.meta.observation.observation_number = '001'
+            im.meta.observation.visit_number = '001'
+            im.meta.observation.visit_group = '01'
+            im.meta.observation.sequence_id = '1'
+            im.meta.observation.activity_id = '01'
+            im.meta.observation.exposure_number = exposure_number
+            path = str(tmpdir.join('image{}.fits'.format(i)))
+            im.save(path)
+            paths.append(path)
+
+    with ModelContainer(paths) as c:
+        expected = c.group_names
+    assert len(expected) == 2
+
+    with ModelContainer(paths, lazy=True, max_open=1) as c:
+        # The grouping is read from the headers, without opening the members
+        assert c.group_names == expected
+        assert [len(group) for group in c.models_grouped] == [2, 1]
+        assert all(m.model is None for m in c._models)
+
+        # An open member is grouped by its metadata in memory
+        c[2].meta.observation.exposure_number = '1'
+        assert len(c.group_names) == 1
+        assert c[2].meta.group_id == expected[0]
+
+
+def test_modelcontainer_lazy_copy():
+    asn_file_path, asn_file_name = op.split(ASN_FILE)
+    with pushdir(asn_file_path):
+        with ModelContainer(asn_file_name, lazy=True) as c:
+            c[0].meta.observation.exposure_number = '2'
+            c2 = c.copy()
+            assert c2[0].meta.observation.exposure_number == '2'
+            assert c2[1].meta.telescope == 'JWST'
+            assert c2._models[1] is not c._models[1]
+            c2.close()
@@ -85,7 +85,7 @@ def open(init=None, memmap=False, **kwargs):
 
         if file_type == "fits":
             if s3_utils.is_s3_uri(init):
-                hdulist = fits.open(s3_utils.get_object(init))
+                hdulist = fits.open(s3_utils.open_object(init))
             else:
                 hdulist = fits.open(init, memmap=memmap)
             file_to_close = hdulist
@@ -11,6 +11,7 @@ from ..datamodels import dqflags
 from ..assign_wcs import niriss         # for specifying spectral order number
 from ..assign_wcs.util import wcs_bbox_from_shape
 from ..lib import pipe_utils
+from ..lib.multiprocessing_utils import fork_pool, fork_processes
 from ..lib.wcs_utils import get_wavelengths
 from . import extract1d
 from . import ifu
@@ -2515,7 +2516,7 @@ class ImageExtractModel(ExtractBase):
 
 def run_extract1d(input_model, refname, smoothing_length, bkg_order,
                   log_increment, subtract_background, apply_nod_offset,
-                  was_source_model=False):
+                  was_source_model=False, nproc=1):
     """Extract 1-D spectra.
 
     This just reads the reference file (if any) and calls do_extract1d.
@@ -2557,6 +2558,10 @@ def run_extract1d(input_model, refname, smoothing_length, bkg_order,
         obtained by iterating over a SourceModelContainer.  The default
         is False.
 
+    nproc : int
+        The number of processes to use for extracting the slits, or the
+        integrations of multi-integration data.  The default is 1.
+
     Returns
     -------
     output_model : data model
@@ -2576,7 +2581,7 @@ def run_extract1d(input_model, refname, smoothing_length, bkg_order,
     output_model = do_extract1d(input_model, ref_dict,
                                 smoothing_length, bkg_order,
                                 log_increment, subtract_background,
-                                apply_nod_offset, was_source_model)
+                                apply_nod_offset, was_source_model, nproc)
 
     return output_model
 
@@ -2619,7 +2624,7 @@ def ref_dict_sanity_check(ref_dict):
 def do_extract1d(input_model, ref_dict, smoothing_length=None,
                  bkg_order=None, log_increment=50,
                  subtract_background=None, apply_nod_offset=None,
-                 was_source_model=False):
+                 was_source_model=False, nproc=1):
     """Extract 1-D spectra.
 
     In the pipeline, this function would be called by run_extract1d.
@@ -2670,6 +2675,10 @@ def do_extract1d(input_model, ref_dict, smoothing_length=None,
         obtained by iterating over a SourceModelContainer.  The default
         is False.
 
+    nproc : int
+        The number of processes to use for extracting the slits, or the
+        integrations of multi-integration data.  The default is 1.
+
     Returns
     -------
     output_model : data model
@@ -2730,10 +2739,12 @@ def do_extract1d(input_model, ref_dict, smoothing_length=None,
         else:                           # MultiProductModel
             slits = input_model.products
 
-        # Loop over the slits in the input model
+        # Loop over the slits in the input model, to select the slits to
+        # extract and get their extraction parameters.  The slits are then
+        # extracted independently of each other, possibly concurrently.
+        jobs = []
         for slit in slits:
             log.info('Working on slit %s', slit.name)
-            prev_offset = OFFSET_NOT_ASSIGNED_YET
             if np.size(slit.data) <= 0:
                 log.info('No data for slit %s, skipping ...', slit.name)
                 continue
@@ -2775,15 +2786,18 @@ def do_extract1d(input_model, ref_dict, smoothing_length=None,
                                 "the flux will not be correct.")
             else:
                 pixel_solid_angle = 1.                  # not needed
+            jobs.append((slit, sp_order, source_type, extract_params,
+                         pixel_solid_angle))
 
-            try:
-                (ra, dec, wavelength, temp_flux, background,
-                 npixels, dq, prev_offset) = extract_one_slit(
-                                        input_model, slit, -1,
-                                        prev_offset, True, extract_params)
-            except InvalidSpectralOrderNumberError as e:
-                log.info(str(e) + ", skipping ...")
+        extracted = extract_slits(input_model,
+                                  [(job[0], job[3]) for job in jobs], nproc)
+        for (job, result) in zip(jobs, extracted):
+            if result is None:
                 continue
+            (slit, sp_order, source_type, extract_params,
+             pixel_solid_angle) = job
+            (ra, dec, wavelength, temp_flux, background,
+             npixels, dq, prev_offset) = result
 
             # Convert the sum to an average, for surface brightness.
             npixels_temp = np.where(npixels > 0., npixels, 1.)
@@ -3028,7 +3042,6 @@ def do_extract1d(input_model, ref_dict, smoothing_length=None,
                     continue
 
                 # Loop over each integration in the input model
-                verbose = True          # for just the first integration
                 shape = input_model.data.shape
                 if len(shape) == 3 and shape[0] == 1 or len(shape) == 2:
                     log.info("Beginning loop, just 1 integration ...")
@@ -3036,16 +3049,20 @@ def do_extract1d(input_model, ref_dict, smoothing_length=None,
                 else:
                     log.info("Beginning loop over {} integrations ...".format(shape[0]))
                     integrations = range(shape[0])
-                for integ in integrations:
-                    # Extract spectrum
-                    try:
-                        (ra, dec, wavelength, temp_flux, background,
-                         npixels, dq, prev_offset) = extract_one_slit(
-                                        input_model, slit, integ,
-                                        prev_offset, verbose, extract_params)
-                    except InvalidSpectralOrderNumberError as e:
-                        log.info(str(e) + ", skipping ...")
-                        break
+                try:
+                    (extracted, prev_offset) = extract_integrations(
+                                        input_model, integrations,
+                                        prev_offset, extract_params, nproc)
+                except InvalidSpectralOrderNumberError as e:
+                    log.info(str(e) + ", skipping ...")
+                    # As for a break out of the loop over integrations:
+                    # there is no spectrum for this order, but the other
+                    # orders are still extracted.
+                    extracted = []
+                    progress_msg_printed = True
+                for (integ, result) in zip(integrations, extracted):
+                    (ra, dec, wavelength, temp_flux, background,
+                     npixels, dq) = result
 
                     # Convert the sum to an average, for surface brightness.
                     npixels_temp = np.where(npixels > 0., npixels, 1.)
@@ -3108,7 +3125,6 @@ def do_extract1d(input_model, ref_dict, smoothing_length=None,
                             progress_msg_printed = True
                     else:
                             progress_msg_printed = False
-                    verbose = False
 
                 if not progress_msg_printed:
                     if input_model.data.shape[0] == 1:
@@ -3513,6 +3529,53 @@ def extract_one_slit(input_model, slit, integ,
 
     data = replace_bad_values(data, input_dq, wl_array)
 
+    (extract_model, offset) = setup_extraction(input_model, slit, data.shape,
+                                               prev_offset, verbose,
+                                               extract_params)
+    (ra, dec, wavelength, temp_flux, background, npixels, dq) = \
+                extract_model.extract(data, wl_array, verbose)
+
+    return (ra, dec, wavelength, temp_flux, background, npixels, dq, offset)
+
+
+def setup_extraction(input_model, slit, shape, prev_offset, verbose,
+                     extract_params):
+    """Create the extraction model for one slit, or spectral order.
+
+    The extraction limits and the nod/dither offset are determined from
+    the WCS; they don't depend on the data values, so the extraction model
+    can be used for every integration of multi-integration data.
+
+    Parameters
+    ----------
+    input_model : data model
+        The input science model.
+
+    slit : one slit from a MultiSlitModel (or similar), or None
+        See `extract_one_slit`.
+
+    shape : tuple
+        The shape of the data array from which spectra will be extracted.
+
+    prev_offset : float or str
+        The previously computed nod/dither offset, or a value (a string)
+        indicating that the offset hasn't been computed yet.
+
+    verbose : boolean
+        If True, log more info (extraction parameters, for example).
+
+    extract_params : dict
+        Parameters read from the reference file.
+
+    Returns
+    -------
+    extract_model : ExtractModel or ImageExtractModel
+        The extraction model, with the extraction limits assigned.
+
+    offset : float
+        The nod/dither offset in the cross-dispersion direction.
+    """
+
     if extract_params['ref_file_type'] == FILE_TYPE_IMAGE:
         # The reference file is an image.
         extract_model = ImageExtractModel(input_model, slit, verbose, **extract_params)
@@ -3521,7 +3584,7 @@ def extract_one_slit(input_model, slit, integ,
         # If there is a reference file (there doesn't have to be), it's in
         # JSON format.
         extract_model = ExtractModel(input_model, slit, verbose, **extract_params)
-        ap = get_aperture(data.shape, extract_model.wcs,
+        ap = get_aperture(shape, extract_model.wcs,
                           verbose, extract_params)
         extract_model.update_extraction_limits(ap)
 
@@ -3543,16 +3606,177 @@ def extract_one_slit(input_model, slit, integ,
 
     # Add the nod/dither offset to the polynomial coefficients, or shift
     # the reference image (depending on the type of reference file).
-    extract_model.add_nod_correction(verbose, data.shape)
+    extract_model.add_nod_correction(verbose, shape)
 
     if verbose:
         extract_model.log_extraction_parameters()
 
     extract_model.assign_polynomial_limits(verbose)
-    (ra, dec, wavelength, temp_flux, background, npixels, dq) = \
-                extract_model.extract(data, wl_array, verbose)
 
-    return (ra, dec, wavelength, temp_flux, background, npixels, dq, offset)
+    return (extract_model, offset)
+
+
+def extract_slits(input_model, jobs, nproc=1):
+    """Extract the spectra of several slits.
+
+    Parameters
+    ----------
+    input_model : data model
+        The input science model.
+
+    jobs : list of tuple
+        A (slit, extract_params) tuple for each slit to extract.
+        See `extract_one_slit`.
+
+    nproc : int
+        The number of processes to use.
+
+    Returns
+    -------
+    list
+        For each job, the tuple returned by `extract_one_slit`, or None
+        if the slit was skipped.
+    """
+
+    state = (input_model, jobs)
+    nproc = fork_processes(min(nproc, len(jobs)))
+    if nproc > 1:
+        log.info("Extracting %d slits with %d processes", len(jobs), nproc)
+        pool = fork_pool(nproc, _set_pool_state, (state,))
+        try:
+            results = pool.map(_pool_extract_slit, range(len(jobs)))
+        finally:
+            pool.terminate()
+            pool.close()
+    else:
+        results = [_extract_slit(state, i) for i in range(len(jobs))]
+
+    for (i, result) in enumerate(results):
+        if isinstance(result, InvalidSpectralOrderNumberError):
+            log.info(str(result) + ", skipping ...")
+            results[i] = None
+
+    return results
+
+
+def extract_integrations(input_model, integrations, prev_offset,
+                         extract_params, nproc=1):
+    """Extract a spectrum from each integration of multi-integration data.
+
+    The wavelengths, the extraction limits and the nod/dither offset are
+    the same for every integration, so they are computed once.
+
+    Parameters
+    ----------
+    input_model : data model
+        The input science model, a CubeModel or SlitModel.
+
+    integrations : list of int
+        The integration numbers, or [-1] if the data are not to be indexed
+        by integration.
+
+    prev_offset : float or str
+        The previously computed nod/dither offset, or a value (a string)
+        indicating that the offset hasn't been computed yet.
+
+    extract_params : dict
+        Parameters read from the reference file.
+
+    nproc : int
+        The number of processes to use.
+
+    Returns
+    -------
+    results : list of tuple
+        For each integration, (ra, dec, wavelength, temp_flux, background,
+        npixels, dq); see `extract_one_slit`.
+
+    offset : float
+        The nod/dither offset in the cross-dispersion direction.
+
+    Raises
+    ------
+    InvalidSpectralOrderNumberError
+        If the spectral order number is invalid or off the detector.
+    """
+
+    log_initial_parameters(extract_params)
+
+    exp_type = input_model.meta.exposure.type
+    wl_array = get_wavelengths(input_model, exp_type,
+                               extract_params['spectral_order'])
+    (data, _) = _integration_data(input_model, integrations[0])
+    (extract_model, offset) = setup_extraction(input_model, None, data.shape,
+                                               prev_offset, True,
+                                               extract_params)
+
+    state = (input_model, extract_model, wl_array, integrations[0])
+    nproc = fork_processes(min(nproc, len(integrations)))
+    if nproc > 1:
+        log.info("Extracting %d integrations with %d processes",
+                 len(integrations), nproc)
+        pool = fork_pool(nproc, _set_pool_state, (state,))
+        try:
+            results = pool.map(_pool_extract_integration, integrations)
+        finally:
+            pool.terminate()
+            pool.close()
+    else:
+        results = [_extract_integration(state, integ)
+                   for integ in integrations]
+
+    return (results, offset)
+
+
+def _integration_data(input_model, integ):
+    """Return the data and DQ arrays for integration `integ`."""
+
+    input_dq = None
+    if integ > -1:
+        data = input_model.data[integ]
+        if hasattr(input_model, 'dq'):
+            input_dq = input_model.dq[integ]
+    else:
+        data = input_model.data
+        if hasattr(input_model, 'dq'):
+            input_dq = input_model.dq
+    return (data, input_dq)
+
+
+def _extract_slit(state, i):
+    (input_model, jobs) = state
+    (slit, extract_params) = jobs[i]
+    try:
+        return extract_one_slit(input_model, slit, -1,
+                                OFFSET_NOT_ASSIGNED_YET, True, extract_params)
+    except InvalidSpectralOrderNumberError as e:
+        return e
+
+
+def _extract_integration(state, integ):
+    (input_model, extract_model, wl_array, first_integ) = state
+    (data, input_dq) = _integration_data(input_model, integ)
+    data = replace_bad_values(data, input_dq, wl_array)
+    return extract_model.extract(data, wl_array, integ == first_integ)
+
+
+# The state shared by the worker processes, assigned by the initializer
+# of the forked pool so that the models are inherited rather than sent
+# with every task.
+_pool_state = None
+
+
+def _set_pool_state(state):
+    global _pool_state
+    _pool_state = state
+
+
+def _pool_extract_slit(i):
+    return _extract_slit(_pool_state, i)
+
+
+def _pool_extract_integration(integ):
+    return _extract_integration(_pool_state, integ)
 
 
 def replace_bad_values(data, input_dq, wl_array):
@@ -1,5 +1,6 @@
 from ..stpipe import Step
 from .. import datamodels
+from ..lib.multiprocessing_utils import num_processes
 from . import extract
 
 
@@ -54,6 +55,11 @@ class Extract1dStep(Step):
         It also doesn't make sense to apply a nod/dither offset for an
         extended target, so this flag can internally be overridden (set to
         False) for extended targets.
+
+    maximum_cores : str or None
+        The fraction of the cores ('quarter', 'half' or 'all') to use for
+        extracting the slits, or the integrations of multi-integration
+        data, concurrently.  If None (the default), one process is used.
     """
 
     spec = """
@@ -71,6 +77,8 @@ class Extract1dStep(Step):
     # Currently this offset is not applied for NIRSpec fixed-slit or
     # MOS (MSA) data), or for WFSS data.
     apply_nod_offset = boolean(default=None)
+    # Number of processes for extracting slits or integrations.
+    maximum_cores = option('quarter', 'half', 'all', default=None)
     """
 
     reference_file_types = ['extract1d']
@@ -148,7 +156,8 @@ class Extract1dStep(Step):
                                                  self.log_increment,
                                                  self.subtract_background,
                                                  self.apply_nod_offset,
-                                                 was_source_model=was_source_model)
+                                                 was_source_model=was_source_model,
+                                                 nproc=num_processes(self.maximum_cores))
                     # Set the step flag to complete in each MultiSpecModel
                     temp.meta.cal_step.extract_1d = 'COMPLETE'
                     result.append(temp)
@@ -169,7 +178,8 @@ class Extract1dStep(Step):
                                                self.log_increment,
                                                self.subtract_background,
                                                self.apply_nod_offset,
-                                               was_source_model=was_source_model)
+                                               was_source_model=was_source_model,
+                                               nproc=num_processes(self.maximum_cores))
                 # Set the step flag to complete
                 result.meta.cal_step.extract_1d = 'COMPLETE'
             else:
@@ -190,7 +200,8 @@ class Extract1dStep(Step):
                                            self.log_increment,
                                            self.subtract_background,
                                            self.apply_nod_offset,
-                                           was_source_model=False)
+                                           was_source_model=False,
+                                           nproc=num_processes(self.maximum_cores))
             # Set the step flag to complete
             result.meta.cal_step.extract_1d = 'COMPLETE'
 
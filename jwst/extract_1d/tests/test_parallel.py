@@ -0,0 +1,110 @@
+"""
+Test that extracting slits and integrations in a pool of processes gives
+the same spectra as extracting them serially.
+"""
+import numpy as np
+import pytest
+
+from jwst import datamodels
+from jwst.extract_1d import extract
+
+shape = (20, 50)
+ref_dict = {"ref_file_type": extract.FILE_TYPE_JSON,
+            "apertures": [{"id": "ANY",
+                           "xstart": 0,
+                           "xstop": 49,
+                           "src_coeff": [[8.5], [11.5]],
+                           "bkg_coeff": [[1.5], [4.5], [15.5], [18.5]],
+                           "bkg_order": 1
+                          }
+                         ]
+           }
+
+
+def fill_spectrum(rng, model, data_shape):
+    """Assign a spectrum over a sloped background, with some bad pixels
+    and a wavelength array."""
+    yy, xx = np.mgrid[:shape[0], :shape[1]]
+    source = 50. * np.exp(-0.5 * ((yy - 10.) / 1.2)**2) * (1. + xx / 50.)
+    data = (source + 2. + 0.1 * yy
+            + rng.normal(scale=0.5, size=data_shape)).astype(np.float32)
+    dq = np.zeros(data_shape, dtype=np.uint32)
+    dq[rng.random_sample(data_shape) < 0.01] = \
+        datamodels.dqflags.pixel['DO_NOT_USE']
+    model.data = data
+    model.dq = dq
+    model.wavelength = np.broadcast_to(np.linspace(1., 5., shape[1]),
+                                       shape).copy()
+
+
+def extract_params(model, slit):
+    params = extract.get_extract_parameters(ref_dict, slit, "ANY", 1,
+                                            model.meta, None, None, False)
+    params['dispaxis'] = extract.HORIZONTAL
+    return params
+
+
+def multislit_model(nslits=5):
+    rng = np.random.RandomState(11)
+    model = datamodels.MultiSlitModel()
+    model.meta.exposure.type = 'NRS_FIXEDSLIT'
+    model.meta.target.source_type = 'POINT'
+    for i in range(nslits):
+        slit = datamodels.SlitModel()
+        fill_spectrum(rng, slit, shape)
+        slit.name = 'S{}'.format(i)
+        model.slits.append(slit)
+    return model
+
+
+def multiint_model(nints=6):
+    rng = np.random.RandomState(12)
+    model = datamodels.CubeModel()
+    model.meta.exposure.type = 'NRS_BRIGHTOBJ'
+    model.meta.target.source_type = 'POINT'
+    fill_spectrum(rng, model, (nints,) + shape)
+    return model
+
+
+def assert_same_spectra(results, expected):
+    assert len(results) == len(expected)
+    for (result, truth) in zip(results, expected):
+        assert len(result) == len(truth)
+        for (value, true_value) in zip(result, truth):
+            np.testing.assert_array_equal(value, true_value)
+
+
+@pytest.mark.parametrize('nproc', [2, 3])
+def test_extract_slits_parallel(nproc):
+    """Spectra of a multi-slit model, serially and in a pool."""
+    model = multislit_model()
+    jobs = [(slit, extract_params(model, slit)) for slit in model.slits]
+
+    expected = extract.extract_slits(model, jobs, nproc=1)
+    results = extract.extract_slits(model, jobs, nproc=nproc)
+
+    assert all(result is not None for result in results)
+    assert_same_spectra(results, expected)
+
+
+@pytest.mark.parametrize('nproc', [2, 4])
+def test_extract_integrations_parallel(nproc):
+    """Spectra of each integration of a CubeModel, serially and in a pool,
+    and the same as extracting the integrations one at a time."""
+    model = multiint_model()
+    params = extract_params(model, None)
+    integrations = range(model.data.shape[0])
+
+    (expected, offset) = extract.extract_integrations(
+        model, integrations, extract.OFFSET_NOT_ASSIGNED_YET, params, 1)
+    (results, offset_pool) = extract.extract_integrations(
+        model, integrations, extract.OFFSET_NOT_ASSIGNED_YET, params, nproc)
+
+    assert offset_pool == offset
+    assert_same_spectra(results, expected)
+
+    one_at_a_time = [extract.extract_one_slit(model, None, integ, offset,
+                                              False, params)[:-1]
+                     for integ in integrations]
+    assert_same_spectra(results, one_at_a_time)
+
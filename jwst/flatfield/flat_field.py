@@ -1368,27 +1368,24 @@ def combine_fast_slow(wl, flat_2d, flat_dq, tab_wl, tab_flat, dispaxis):
         dwl[-1, :] = dwl[-2, :]
 
     # Values averaged within tab_flat.
-    values = np.zeros_like(wl_c)
-    (ny, nx) = wl_c.shape
+    values = np.ones_like(wl_c)
     # Abscissas and weights for 3-point Gaussian integration, but taking
     # the width of the interval to be 1, so the result will be the average
     # over the interval.
     d = math.sqrt(0.6) / 2.
     dx = np.array([-d, 0., d])
     wgt = np.array([5., 8., 5.]) / 18.
-    for j in range(ny):
-        for i in range(nx):
-            if wl[j, i] <= 0.:          # note:  wl, not wl_c
-                values[j, i] = 1.
-            else:
-                # average the tabular data over the range of wavelengths
-                temp = g_average(wl_c[j, i], dwl[j, i],
-                                 tab_wl, tab_flat, dx, wgt)
-                if temp is None:
-                    values[j, i] = 1.
-                    combined_dq[j, i] |= dqflags.pixel['NO_FLAT_FIELD']
-                else:
-                    values[j, i] = temp
+
+    # Pixels with no wavelength are left at 1.
+    in_slit = np.logical_not(wl <= 0.)      # note:  wl, not wl_c
+    # Average the tabular data over the range of wavelengths of each pixel
+    temp, in_range = g_average_array(wl_c[in_slit], dwl[in_slit],
+                                     tab_wl, tab_flat, dx, wgt)
+    temp[np.logical_not(in_range)] = 1.
+    values[in_slit] = temp
+    out_of_range = np.zeros(wl.shape, dtype=bool)
+    out_of_range[in_slit] = np.logical_not(in_range)
+    combined_dq[out_of_range] |= dqflags.pixel['NO_FLAT_FIELD']
 
     return (flat_2d * values, combined_dq)
 
@@ -1500,6 +1497,95 @@ def g_average(wl0, dwl0, tab_wl, tab_flat, dx, wgt):
     return sum
 
 
+def g_average_array(wl0, dwl0, tab_wl, tab_flat, dx, wgt):
+    """Gaussian integration for an array of pixels.
+
+    This gives the same values as `g_average` for each element of `wl0`
+    and `dwl0`.
+
+    Parameters
+    ----------
+    wl0 : ndarray
+        Wavelength at the center of each pixel.
+
+    dwl0 : ndarray
+        Width (in wavelength units) of each pixel.
+
+    tab_wl : ndarray, 1-D
+        Array of wavelengths corresponding to `tab_flat` flat-field values.
+
+    tab_flat : ndarray, 1-D
+        Array of flat-field values.
+
+    dx : ndarray, 1-D
+        Array of offsets within a pixel, e.g. -0.3873, 0.0, +0.3873
+
+    wgt : ndarray, 1-D
+        Array of weights, e.g. 5/18, 8/18, 5/18
+
+    Returns
+    -------
+    tuple of two ndarrays, each with the shape of `wl0`
+        The average value of `tab_flat` over each pixel, and a boolean
+        array that is False where any of the wavelengths used for computing
+        the average is outside the range of wavelengths in `tab_wl`.  The
+        average is not meaningful where the second array is False.
+    """
+
+    # Compute the wavelengths in double precision, as g_average does
+    wl0 = np.asarray(wl0, dtype=np.float64)
+    dwl0 = np.asarray(dwl0, dtype=np.float64)
+    sum = np.zeros(wl0.shape, dtype=np.float64)
+    in_range = np.ones(wl0.shape, dtype=bool)
+    for k in range(len(dx)):
+        value, valid = wl_interpolate_array(wl0 + dwl0 * dx[k],
+                                            tab_wl, tab_flat)
+        in_range &= valid
+        sum += (value * wgt[k])
+
+    return (sum, in_range)
+
+
+def wl_interpolate_array(wavelengths, tab_wl, tab_flat):
+    """Interpolate the flat field at an array of wavelengths.
+
+    This gives the same values as `wl_interpolate` for each element of
+    `wavelengths`.
+
+    Parameters
+    ----------
+    wavelengths : ndarray
+        The wavelengths (microns) at which to find the flat-field values.
+
+    tab_wl : ndarray, 1-D
+        Array of wavelengths corresponding to `tab_flat` flat-field values.
+        These are assumed to be strictly increasing.
+
+    tab_flat : ndarray, 1-D
+        Array of flat-field values.
+
+    Returns
+    -------
+    tuple of two ndarrays, each with the shape of `wavelengths`
+        The flat-field values (from `tab_flat`), and a boolean array that
+        is False where the wavelength is not positive, is NaN, or is
+        outside the range of `tab_wl`.  The flat-field value is not
+        meaningful where the second array is False.
+    """
+
+    valid = np.logical_and(wavelengths > 0., wavelengths >= tab_wl[0])
+    valid &= (wavelengths <= tab_wl[-1])
+    # Look up out-of-range wavelengths at the start of the table, so that
+    # the indices are valid; their values are not used.
+    wavelengths = np.where(valid, wavelengths, tab_wl[0])
+
+    n0 = np.searchsorted(tab_wl, wavelengths) - 1
+    p = (wavelengths - tab_wl[n0]) / (tab_wl[n0 + 1] - tab_wl[n0])
+    q = 1. - p
+
+    return (q * tab_flat[n0] + p * tab_flat[n0 + 1], valid)
+
+
 def wl_interpolate(wavelength, tab_wl, tab_flat):
     """Interpolate the flat field at the specified wavelength.
 
@@ -0,0 +1,64 @@
+"""
+Test for flat_field.combine_fast_slow
+"""
+import math
+
+import numpy as np
+
+from jwst.datamodels import dqflags
+from jwst.flatfield.flat_field import (combine_fast_slow, clean_wl,
+                                       g_average)
+
+
+def combine_fast_slow_per_pixel(wl, flat_2d, flat_dq, tab_wl, tab_flat):
+    """Evaluate the fast variation one pixel at a time, with g_average."""
+    wl_c = clean_wl(wl, 1)
+    dwl = np.zeros_like(wl_c)
+    dwl[:, 0:-1] = wl_c[:, 1:] - wl_c[:, 0:-1]
+    dwl[:, -1] = dwl[:, -2]
+    combined_dq = flat_dq.copy()
+
+    d = math.sqrt(0.6) / 2.
+    dx = np.array([-d, 0., d])
+    wgt = np.array([5., 8., 5.]) / 18.
+    values = np.zeros_like(wl_c)
+    for j in range(wl.shape[0]):
+        for i in range(wl.shape[1]):
+            if wl[j, i] <= 0.:
+                values[j, i] = 1.
+                continue
+            temp = g_average(wl_c[j, i], dwl[j, i], tab_wl, tab_flat, dx, wgt)
+            if temp is None:
+                values[j, i] = 1.
+                combined_dq[j, i] |= dqflags.pixel['NO_FLAT_FIELD']
+            else:
+                values[j, i] = temp
+
+    return flat_2d * values, combined_dq
+
+
+def test_combine_fast_slow():
+    """The flat for a whole slit matches the per-pixel calculation."""
+    ny, nx = 7, 50
+    tab_wl = np.linspace(1.0, 2.0, 200)
+    tab_flat = 1. + 0.1 * np.sin(20. * tab_wl)
+
+    # The wavelengths extend beyond both ends of the table, and some
+    # pixels have no wavelength.
+    wl = (np.linspace(0.95, 2.05, nx)[np.newaxis, :] +
+          0.001 * np.arange(ny)[:, np.newaxis]).astype(np.float32)
+    wl[2, 10:13] = 0.
+    wl[4, 30] = -1.
+    flat_2d = np.full((ny, nx), 0.9, dtype=np.float32)
+    flat_dq = np.zeros((ny, nx), dtype=np.uint32)
+    flat_dq[0, 0] = dqflags.pixel['DO_NOT_USE']
+
+    flat, dq = combine_fast_slow(wl, flat_2d, flat_dq, tab_wl, tab_flat, 1)
+    expected_flat, expected_dq = combine_fast_slow_per_pixel(
+        wl, flat_2d, flat_dq, tab_wl, tab_flat)
+
+    np.testing.assert_allclose(flat, expected_flat, rtol=1.e-7)
+    np.testing.assert_array_equal(dq, expected_dq)
+    assert np.all(flat[2, 10:13] == flat_2d[2, 10:13])
+    assert dq[0, -1] & dqflags.pixel['NO_FLAT_FIELD']
+    assert flat_dq[0, -1] == 0
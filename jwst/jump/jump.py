@@ -4,6 +4,7 @@ import logging
 import numpy as np
 from ..datamodels import dqflags
 from ..lib import reffile_utils
+from ..lib.multiprocessing_utils import num_processes
 from . import twopoint_difference as twopt
 import multiprocessing
 
@@ -13,7 +14,7 @@ log.setLevel(logging.DEBUG)
 def detect_jumps (input_model, gain_model, readnoise_model,
                   rejection_threshold, max_cores,
                   max_jump_to_flag_neighbors, min_jump_to_flag_neighbors,
-                  flag_4_neighbors):
+                  flag_4_neighbors, max_block_memory=None):
     """
     This is the high-level controlling routine for the jump detection process.
     It loads and sets the various input data and parameters needed by each of
@@ -30,20 +31,11 @@ def detect_jumps (input_model, gain_model, readnoise_model,
     appropriate instrument- and detector-dependent values for each pixel of an
     image.  Also, a 2-dimensional read noise array with appropriate values for
     each pixel is passed to the detection methods.
+
+    If max_block_memory (in MB) is given, each integration is processed in
+    blocks of rows whose work arrays fit within that budget.
     """
-    if max_cores is None:
-        numslices = 1
-    else:
-        num_cores = multiprocessing.cpu_count()
-        log.info("Found %d possible cores to use for jump detection " % num_cores)
-        if max_cores == 'quarter':
-            numslices = num_cores // 4 or 1
-        elif max_cores == 'half':
-            numslices = num_cores // 2 or 1
-        elif max_cores == 'all':
-            numslices = num_cores
-        else:
-            numslices = 1
+    numslices = num_processes(max_cores)
 
     # Load the data arrays that we need from the input model
     output_model = input_model.copy()
@@ -92,59 +84,62 @@ def detect_jumps (input_model, gain_model, readnoise_model,
     num_groups = data.shape[1]
     num_ints = data.shape[0]
     frames_per_group = input_model.meta.exposure.nframes
-    row_above_gdq = np.zeros((num_ints, num_groups, ncols), dtype=np.uint8)
-    previous_row_above_gdq = np.zeros((num_ints, num_groups, ncols), dtype=np.uint8)
-    row_below_gdq = np.zeros((num_ints, num_groups, ncols), dtype=np.uint8)
-
-    yincrement = int(nrows / numslices)
-    slices = []
-    # Slice up data, gdq, readnoise_2d into slices
-    # Each element of slices is a tuple of
-    # (data, gdq, readnoise_2d, rejection_threshold, nframes)
-    for i in range(numslices - 1):
-        slices.insert(i, (data[:, :, i * yincrement:(i + 1) * yincrement, :],
-                          gdq[:, :, i * yincrement:(i + 1) * yincrement, :],
-                          readnoise_2d[i * yincrement:(i + 1) * yincrement, :],
-                          rejection_threshold, frames_per_group, flag_4_neighbors,
-                          max_jump_to_flag_neighbors, min_jump_to_flag_neighbors))
-    # last slice get the rest
-    slices.insert(numslices - 1, (data[:, :, (numslices - 1) * yincrement:nrows, :],
-                                 gdq[:, :, (numslices - 1) * yincrement:nrows, :],
-                                 readnoise_2d[(numslices - 1) * yincrement:nrows, :],
-                                 rejection_threshold, frames_per_group, flag_4_neighbors,
-                                 max_jump_to_flag_neighbors, min_jump_to_flag_neighbors))
-    if numslices == 1:
+    max_block_rows = twopt.rows_per_block(max_block_memory, num_groups, ncols)
+    if max_block_rows is not None:
+        log.info('Processing blocks of at most %d rows' % max_block_rows)
+
+    # Divide the data into tiles of integrations and rows, one tile per
+    # process. Integrations are independent of each other, so they are split
+    # up first; the rows of each integration are split up only when there
+    # are fewer integrations than processes, as the neighbors of jumps on
+    # the edges of row slices have to be flagged when the results are merged.
+    num_int_chunks = min(numslices, num_ints)
+    num_row_slices = max(1, min(numslices // num_int_chunks, nrows))
+    int_bounds = chunk_bounds(num_ints, num_int_chunks)
+    row_bounds = chunk_bounds(nrows, num_row_slices)
+
+    if num_int_chunks * num_row_slices == 1:
         gdq, row_below_dq, row_above_dq = twopt.find_crs(data, gdq, readnoise_2d, rejection_threshold,
                                                                         frames_per_group, flag_4_neighbors,
                                                                         max_jump_to_flag_neighbors,
-                                                                        min_jump_to_flag_neighbors)
-        elapsed = time.time() - start
+                                                                        min_jump_to_flag_neighbors,
+                                                                        max_block_rows)
     else:
-        log.info("Creating %d processes for jump detection " % numslices)
-        pool = multiprocessing.Pool(processes=numslices)
+        tiles = []
+        slices = []
+        # Slice up data, gdq, readnoise_2d into tiles
+        # Each element of slices is a tuple of the arguments of find_crs
+        for (ilo, ihi) in int_bounds:
+            for (rlo, rhi) in row_bounds:
+                tiles.append((ilo, ihi, rlo, rhi))
+                slices.append((data[ilo:ihi, :, rlo:rhi, :],
+                               gdq[ilo:ihi, :, rlo:rhi, :],
+                               readnoise_2d[rlo:rhi, :],
+                               rejection_threshold, frames_per_group, flag_4_neighbors,
+                               max_jump_to_flag_neighbors, min_jump_to_flag_neighbors,
+                               max_block_rows))
+
+        log.info("Creating %d processes for jump detection of %d integration chunks"
+                 " and %d row slices" % (numslices, num_int_chunks, num_row_slices))
+        pool = multiprocessing.Pool(processes=min(numslices, len(tiles)))
         real_result = pool.starmap(twopt.find_crs, slices)
-        k = 0
-        # Reconstruct gdq, the row_above_gdq, and the row_below_gdq from the slice result
-        for resultslice in real_result:
-
-            if len(real_result) == k + 1:  # last result
-                gdq[:, :, k * yincrement:nrows, :] = resultslice[0]
-            else:
-                gdq[:, :, k * yincrement:(k + 1) * yincrement, :] = resultslice[0]
-            row_below_gdq[:, :, :] = resultslice[1]
-            row_above_gdq[:, :, :] = resultslice[2]
-            if k != 0: #for all but the first slice, flag any CR neighbors in the top row of the previous slice and
-                #flag any neighbors in the bottom row of this slice saved from the top of the previous slice
-                gdq[:, :, k * yincrement - 1, :] = np.bitwise_or(gdq[:, :, k * yincrement - 1, :],
-                                                                     row_below_gdq[:, :, :])
-                gdq[:, :, k * yincrement, :] = np.bitwise_or(gdq[:, :, k * yincrement, :],
-                                                                     previous_row_above_gdq[:, :, :])
-            #save the neighbors to be flagged that will be in the next slice
-            previous_row_above_gdq = row_above_gdq.copy()
-            k += 1
         pool.terminate()
         pool.close()
-        elapsed = time.time() - start
+
+        # Reconstruct gdq from the tile results
+        for (ilo, ihi, rlo, rhi), resulttile in zip(tiles, real_result):
+            gdq[ilo:ihi, :, rlo:rhi, :] = resulttile[0]
+
+        # Flag the CR neighbors that are in the rows adjacent to each tile:
+        # the row below the first row and the row above the last row
+        for (ilo, ihi, rlo, rhi), resulttile in zip(tiles, real_result):
+            row_below_gdq, row_above_gdq = resulttile[1], resulttile[2]
+            if rlo != 0:
+                gdq[ilo:ihi, :, rlo - 1, :] = np.bitwise_or(gdq[ilo:ihi, :, rlo - 1, :],
+                                                            row_below_gdq)
+            if rhi != nrows:
+                gdq[ilo:ihi, :, rhi, :] = np.bitwise_or(gdq[ilo:ihi, :, rhi, :],
+                                                        row_above_gdq)
 
     elapsed = time.time() - start
     log.info('Total elapsed time = %g sec' % elapsed)
@@ -154,3 +149,23 @@ def detect_jumps (input_model, gain_model, readnoise_model,
     output_model.pixeldq = pdq
 
     return output_model
+
+
+def chunk_bounds(length, num_chunks):
+    """
+    Divide range(length) into num_chunks contiguous chunks; the last chunk
+    gets the rest.
+
+    Returns
+    -------
+    bounds : list of (int, int) tuples
+        the (low, high) bounds of each chunk
+    """
+    increment = length // num_chunks
+    bounds = []
+    for i in range(num_chunks):
+        if i == num_chunks - 1:
+            bounds.append((i * increment, length))
+        else:
+            bounds.append((i * increment, (i + 1) * increment))
+    return bounds
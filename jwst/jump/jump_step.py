@@ -20,6 +20,7 @@ class JumpStep(Step):
         flag_4_neighbors = boolean(default=True) # flag the four perpendicular neighbors of each CR
         max_jump_to_flag_neighbors = float(default=200) # maximum jump sigma that will trigger neighbor flagging
         min_jump_to_flag_neighbors = float(default=10) # minimum jump sigma that will trigger neighbor flagging
+        max_block_memory = float(default=None, min=0) # max MB for the work arrays of a block of rows (default: whole integration)
     """
 
     reference_file_types = ['gain', 'readnoise']
@@ -47,6 +48,9 @@ class JumpStep(Step):
             self.log.info('CR rejection threshold = %g sigma', rej_thresh)
             if self.maximum_cores is not None:
                 self.log.info('Maximum cores to use = %s', max_cores)
+            if self.max_block_memory is not None:
+                self.log.info('Maximum memory per block of rows = %g MB',
+                              self.max_block_memory)
 
             # Get the gain and readnoise reference files
             gain_filename = self.get_reference_file(input_model, 'gain')
@@ -64,7 +68,7 @@ class JumpStep(Step):
             result = detect_jumps(input_model, gain_model, readnoise_model,
                                 rej_thresh, max_cores,
                                 max_jump_to_flag_neighbors, min_jump_to_flag_neighbors,
-                                flag_4_neighbors)
+                                flag_4_neighbors, self.max_block_memory)
 
             gain_model.close()
             readnoise_model.close()
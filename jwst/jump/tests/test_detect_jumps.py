@@ -528,6 +528,34 @@ def test_proc(setup_inputs):
     assert( out_model_a.groupdq == out_model_c.groupdq ).all()
 
 
+def test_tiles_of_integrations_and_rows(setup_inputs, monkeypatch):
+    """
+    A multiprocessing test that divides the data into tiles of both
+    integrations and rows, with CRs on the boundary between two row slices.
+    The pixels flagged must be identical to those flagged without
+    multiprocessing.
+    """
+    monkeypatch.setattr(multiprocessing, 'cpu_count', lambda: 8)
+    results = []
+    for max_cores in [None, 'all']:
+        model1, gdq, rnModel, pixdq, err, gain = \
+            setup_inputs(ngroups=10, nrows=20, ncols=6, nints=4, gain=5,
+                         readnoise=np.float64(7), deltatime=3.0)
+        model1.data[:, :, :, :] = np.arange(10)[np.newaxis, :, np.newaxis,
+                                                np.newaxis] * 5.
+        # 4 integration chunks of 2 row slices, which meet between rows 9 and 10
+        model1.data[0, 5:, 9, 3] += 100.
+        model1.data[1, 7:, 10, 2] += 100.
+        model1.data[3, 4:, 15, 4] += 100.
+        out_model = detect_jumps(model1, gain, rnModel, 4.0, max_cores, 200, 4,
+                                 True)
+        results.append(out_model.groupdq)
+
+    np.testing.assert_array_equal(results[0], results[1])
+    assert (4 == results[1][0, 5, 10, 3])
+    assert (4 == results[1][1, 7, 9, 2])
+
+
 def test_adjacent_CRs( setup_inputs ):
     """
     Three CRs in a 10 group exposure; the CRs have overlapping neighboring
@@ -645,6 +645,26 @@ def test_first_last_group(setup_cube):
     assert outgdq[0, 3, 100, 100] == dqflags.group['JUMP_DET']
 
 
+def test_blocks_of_rows_match_whole_integration(setup_cube):
+    # CRs on either side of a block boundary must have their neighbors in the
+    # adjacent block flagged, giving the same result as without blocks.
+    ngroups = 10
+    results = []
+    for max_block_rows in [None, 50]:
+        data, gdq, nframes, read_noise, rej_threshold = setup_cube(ngroups)
+        data[0, :, :, :] = np.arange(ngroups)[:, np.newaxis, np.newaxis] * 10.
+        data[0, 5:, 49, 30] += 500.
+        data[0, 3:, 50, 60] += 800.
+        data[0, 7:, 100, 100] += 400.
+        results.append(find_crs(data, gdq, read_noise, rej_threshold, nframes,
+                                True, 200, 10, max_block_rows))
+
+    for whole, blocked in zip(*results):
+        np.testing.assert_array_equal(whole, blocked)
+    assert results[1][0][0, 5, 50, 30] == dqflags.group['JUMP_DET']
+    assert results[1][0][0, 3, 49, 60] == dqflags.group['JUMP_DET']
+
+
 @pytest.fixture(scope='function')
 def setup_cube():
 
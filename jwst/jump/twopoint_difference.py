@@ -18,28 +18,119 @@ log.setLevel(logging.DEBUG)
 
 HUGE_NUM = np.finfo(np.float32).max
 
+# Approximate number of bytes of work arrays needed per first difference of
+# a pixel (first diffs, their absolute values, sort indices, ratios, ...),
+# used to convert a memory budget into a number of rows per block
+BYTES_PER_DIFF = 40
+
 
 def find_crs(data, group_dq, read_noise, rej_threshold, nframes, flag_4_neighbors,
-             max_jump_to_flag_neighbors, min_jump_to_flag_neighbors):
+             max_jump_to_flag_neighbors, min_jump_to_flag_neighbors,
+             max_block_rows=None):
     """
     Find CRs/Jumps in each integration within the input data array.
     The input data array is assumed to be in units of electrons, i.e. already
     multiplied by the gain. We also assume that the read noise is in units of
     electrons.
+
+    The integrations are processed one at a time, and each integration is
+    processed in blocks of at most max_block_rows rows, so that the work
+    arrays are limited to the size of a block. Jumps are found in every
+    block before any neighbors are flagged, so the neighbors of jumps on the
+    edges of a block are flagged in the adjacent block exactly as if the
+    integration had been processed at once.
     """
     gdq = group_dq.copy()
     # Get data characteristics
     (nints, ngroups, nrows, ncols) = data.shape
 
+    if max_block_rows is None or max_block_rows > nrows:
+        max_block_rows = nrows
+
     # Create arrays for output
-    median_slopes = np.zeros((nints, nrows, ncols), dtype=np.float32)
-    all_ratios =  np.zeros((nints, nrows, ncols, ngroups-1), dtype=np.float32)
     row_above_gdq = np.zeros((nints, ngroups, ncols), dtype=np.uint8)
     row_below_gdq = np.zeros((nints, ngroups, ncols), dtype=np.uint8)
 
     # Square the read noise values, for use later
     read_noise_2 = read_noise**2
 
+    # Loop over multiple integrations
+    for integration in range(nints):
+
+        log.info(' working on integration %d' % (integration+1))
+
+        # Jumps whose neighbors are to be flagged, for all blocks of rows
+        neighbor_groups = []
+        neighbor_rows = []
+        neighbor_cols = []
+
+        # Loop over blocks of rows
+        for rlo in range(0, nrows, max_block_rows):
+            rhi = min(rlo + max_block_rows, nrows)
+
+            data_block = data[integration, :, rlo:rhi, :]
+            gdq_block = gdq[integration, :, rlo:rhi, :]
+
+            ratio = find_crs_in_block(data_block, gdq_block,
+                                      read_noise_2[rlo:rhi, :],
+                                      rej_threshold, nframes)
+
+            if flag_4_neighbors:
+                # Jumps must be within a certain range to have neighbors
+                # flagged. The ratios are compared in single precision, as
+                # they were when they were saved for the whole exposure.
+                cr_group, cr_row, cr_col = np.where(
+                    np.bitwise_and(gdq_block, dqflags.group['JUMP_DET']))
+                cr_ratio = ratio[cr_row, cr_col, cr_group - 1].astype(np.float32)
+                in_range = (cr_ratio < max_jump_to_flag_neighbors) & \
+                    (cr_ratio > min_jump_to_flag_neighbors)
+                neighbor_groups.append(cr_group[in_range])
+                neighbor_rows.append(cr_row[in_range] + rlo)
+                neighbor_cols.append(cr_col[in_range])
+
+            del ratio
+
+        if flag_4_neighbors: # We need to flag the neighbors of jumps
+            flag_neighbors(gdq, row_below_gdq, row_above_gdq, integration,
+                           np.concatenate(neighbor_groups),
+                           np.concatenate(neighbor_rows),
+                           np.concatenate(neighbor_cols))
+    # Next integration (integration loop)
+
+    return gdq, row_below_gdq, row_above_gdq
+
+
+def find_crs_in_block(data, gdq, read_noise_2, rej_threshold, nframes):
+    """
+    Find CRs/Jumps in a block of rows of a single integration. The JUMP_DET
+    flag is set in the input group DQ array, and saturated and DO_NOT_USE
+    groups are reset to NaN in the input data array.
+
+    Parameters
+    ----------
+    data : float, 3D array
+        science data of the block, [group, y, x], in electrons
+
+    gdq : int, 3D array
+        group DQ of the block, [group, y, x]; updated in place
+
+    read_noise_2 : float, 2D array
+        read noise squared of the block, in electrons
+
+    rej_threshold : float
+        CR sigma rejection threshold
+
+    nframes : int
+        number of frames averaged per group
+
+    Returns
+    -------
+    ratio : float, 3D array
+        deviation of each first difference from the median, in units of
+        sigma, [y, x, difference]
+    """
+    (ngroups, nrows, ncols) = data.shape
+
     # Reset saturated values in input data array to NaN, so they don't get
     # used in any of the subsequent calculations
     saturated_pixels = np.where(np.bitwise_and(gdq, dqflags.group['SATURATED']))
@@ -51,167 +142,186 @@ def find_crs(data, group_dq, read_noise, rej_threshold, nframes, flag_4_neighbor
     wh_donotuse = np.where(np.bitwise_and(gdq, dqflags.group['DO_NOT_USE']))
     data[wh_donotuse] = np.NaN
 
-    # Loop over multiple integrations
-    for integration in range(nints):
+    # Roll the ngroups axis of data arrays to the end, to make
+    # memory access to the values for a given pixel faster
+    # new array has dimensions of [nrows, ncols, ngroups]
+    rolled_data = np.rollaxis(data, 0, 3)
+
+    # Compute first differences of adjacent groups up the ramp
+    first_diffs = np.diff(rolled_data, axis=2)
+    nan_pixels = np.where(np.isnan(first_diffs))
+    first_diffs[nan_pixels] = 100000.
+
+    positive_first_diffs = np.abs(first_diffs)
+
+    # Make all the first diffs for saturated groups be equal to
+    # 100,000 to put them above the good values in the sorted index
+    #sat_groups is a 3D array that is true when the group is saturated
+    sat_groups = (positive_first_diffs == 100000.)
+    #number_sat_groups is a 2D array with the count of saturated groups for each pixel
+    number_sat_groups = (sat_groups * 1).sum(axis=2)
+    del sat_groups
+    ndiffs = ngroups - 1
+    #Here we sort the 3D array along the last axis which is the group axis.
+    #np.argsort returns a 3D array with the last axis containing the indexes that would yield the groups in
+    #order.
+    sort_index = np.argsort(positive_first_diffs)
+    del positive_first_diffs
+    #median_diffs is a 2D array with the clipped median of each pixel
+    median_diffs = get_clipped_median(ndiffs, number_sat_groups, first_diffs, sort_index)
+
+    # Compute uncertainties as the quadrature sum of the poisson noise
+    # in the first difference signal and read noise. Because the first
+    # differences can be biased by CRs/jumps, we use the median signal
+    # for computing the poisson noise. Here we lower the read noise
+    # by the square root of number of frames in the group.
+    # Sigma is a 2D array.
+    poisson_noise = np.sqrt(np.abs(median_diffs))
+    sigma = np.sqrt(poisson_noise * poisson_noise + read_noise_2 / nframes)
+
+    # Reset sigma to exclude pixels with both readnoise and signal=0
+    sigma_0_pixels = np.where(sigma == 0.)
+    if len(sigma_0_pixels[0] > 0):
+        log.debug('Twopt found %d pixels with sigma=0' % (len(sigma_0_pixels[0])))
+        log.debug('which will be reset so that no jump will be detected')
+        sigma[sigma_0_pixels] = HUGE_NUM
+
+    # Compute distance of each sample from the median in units of sigma;
+    # note that the use of "abs" means we'll detect both positive and
+    # negative outliers.
+    #ratio is a 3D array with the units of sigma deviation of the difference from the median.
+    ratio = np.abs(first_diffs - median_diffs[:, :, np.newaxis]) / sigma[:, :, np.newaxis]
+
+    # get the rows and columns of pixels of all pixels
+    # This seems like an obtuse way to set row and column.
+    row, col = np.where(number_sat_groups >= 0)
+    # Get the group index for each pixel of the largest non-saturated group, assuming the indicies are sorted.
+    # 2 is subtracted from ngroups because we are using differences and there is one less difference than the
+    # number of groups.
+    # This is a 2-D array.
+    max_value_index = ngroups - 2 - number_sat_groups
+
+    # Extract from the sorted group index the index of the largest non-saturated group.
+    max_index1d = sort_index[row, col, max_value_index[row, col]]
+    # Reshape the list of max indicies to be a 2-day array
+    max_index1 = np.reshape(max_index1d, (nrows, ncols))
+
+    #Is this redundant? Are r and c different than row and column?
+    r, c = np.indices(max_index1.shape)
+    # Get the row and column indices of pixels whose largest non-saturated ratio is above the threshold
+    row1, col1 = np.where(ratio[r, c, max_index1] > rej_threshold)
+    log.info('From highest outlier Two point found %d pixels with at least one CR' % (len(row1)))
+    number_pixels_with_cr = len(row1)
+    # Loop over all pixels that we found the first CR in
+    for j in range(number_pixels_with_cr):
+        # Extract the first diffs for the this pixel with at least one CR yielding a 1D array
+        pixel_masked_diffs = first_diffs[row1[j], col1[j]]
+        # Get the scalar readnoise^2 and number of saturated groups for this pixel.
+        pixel_rn2 = read_noise_2[row1[j], col1[j]]
+        pixel_sat_groups = number_sat_groups[row1[j], col1[j]]
+
+        # Create a CR mask and set 1st CR to be found
+        # cr_mask=0 designates a CR
+        pixel_cr_mask = np.ones(pixel_masked_diffs.shape, dtype=bool)
+        number_CRs_found = 1
+        pixel_sorted_index = sort_index[row1[j], col1[j], :]
+        pixel_cr_mask[pixel_sorted_index[ndiffs - pixel_sat_groups - 1]] = 0  #setting largest diff to be a CR
+        new_CR_found = True
+
+        # Loop and see if there is more than one CR, setting the mask as you go
+        while new_CR_found and ((ndiffs - number_CRs_found - pixel_sat_groups) > 1):
+            new_CR_found = False
+            # For this pixel get a new median difference excluding the number of CRs found and
+            # the number of saturated groups
+            pixel_med_diff = get_clipped_median(ndiffs, number_CRs_found + pixel_sat_groups,
+                                                   pixel_masked_diffs, pixel_sorted_index)
+            #recalculate the noise and ratio for this pixel now that we have rejected a CR
+            pixel_poisson_noise = np.sqrt(np.abs(pixel_med_diff))
+            pixel_sigma = np.sqrt(pixel_poisson_noise * pixel_poisson_noise + pixel_rn2 / nframes)
+            pixel_ratio = np.abs(pixel_masked_diffs - pixel_med_diff) / pixel_sigma
+
+            # Check if largest remaining difference is above threshold
+            if pixel_ratio[pixel_sorted_index[ndiffs - number_CRs_found - pixel_sat_groups - 1]] > rej_threshold:
+                new_CR_found = True
+                pixel_cr_mask[pixel_sorted_index[ndiffs - number_CRs_found - pixel_sat_groups - 1]] = 0
+                number_CRs_found += 1
+
+        # Found all CRs for this pixel. Set CR flags in input DQ array for this pixel
+        gdq[1:, row1[j], col1[j]] = \
+            np.bitwise_or(gdq[1:, row1[j], col1[j]],
+                          dqflags.group['JUMP_DET'] * np.invert(pixel_cr_mask))
+
+    # Next pixel with an outlier (j loop)
+
+    return ratio
+
+
+def flag_neighbors(gdq, row_below_gdq, row_above_gdq, integration,
+                   cr_group, cr_row, cr_col):
+    """
+    Flag the four perpendicular neighbors of the given jumps in a single
+    integration as JUMP_DET.
+
+    Neighbors that are above or below the range of rows of gdq are saved in
+    row_above_gdq and row_below_gdq. If find_crs is running in a single
+    process, these rows are not used. If it is running in multiprocessing
+    mode, then the rows above and below need to be returned to find_jumps to
+    use when it reconstructs the full group dq array from the slices.
+    """
+    nrows, ncols = gdq.shape[-2:]
+    number_pixels_with_cr = len(cr_group)
+    #loop over all jumps
+    for j in range(number_pixels_with_cr):
+        if cr_row[j] != 0:
+            gdq[integration, cr_group[j], cr_row[j] - 1, cr_col[j]] = np.bitwise_or(
+                gdq[integration, cr_group[j], cr_row[j] - 1, cr_col[j]],
+                dqflags.group['JUMP_DET'])
+        else:
+            row_below_gdq[integration, cr_group[j], cr_col[j]] =  dqflags.group['JUMP_DET']
+        if cr_row[j] != nrows - 1:
+            gdq[integration, cr_group[j], cr_row[j] + 1, cr_col[j]] = np.bitwise_or(
+                gdq[integration, cr_group[j], cr_row[j] + 1, cr_col[j]],
+                dqflags.group['JUMP_DET'])
+        else:
+            row_above_gdq[integration, cr_group[j], cr_col[j]] = dqflags.group['JUMP_DET']
+        # Here we are just checking that we don't flag neighbors of jumps that are off the detector.
+        if cr_col[j] != 0:
+            gdq[integration, cr_group[j], cr_row[j], cr_col[j] - 1] = np.bitwise_or(
+                gdq[integration, cr_group[j], cr_row[j], cr_col[j] - 1],
+                dqflags.group['JUMP_DET'])
+        if cr_col[j] != ncols - 1:
+            gdq[integration, cr_group[j], cr_row[j], cr_col[j] + 1] = np.bitwise_or(
+                gdq[integration, cr_group[j], cr_row[j], cr_col[j] + 1],
+                dqflags.group['JUMP_DET'])
+
+
+def rows_per_block(max_block_memory, ngroups, ncols):
+    """
+    Compute the number of rows per block for which the find_crs work arrays
+    fit within the given memory budget.
 
-        log.info(' working on integration %d' % (integration+1))
+    Parameters
+    ----------
+    max_block_memory : float or None
+        memory budget in MB for the work arrays of a block; None means no
+        limit
 
-        # Roll the ngroups axis of data arrays to the end, to make
-        # memory access to the values for a given pixel faster
-        # new array has dimensions of [nrows, ncols, ngroups]
-        rolled_data = np.rollaxis(data[integration], 0, 3)
-
-        # Compute first differences of adjacent groups up the ramp
-        first_diffs = np.diff(rolled_data, axis=2)
-        nan_pixels = np.where(np.isnan(first_diffs))
-        first_diffs[nan_pixels] = 100000.
-
-        positive_first_diffs = np.abs(first_diffs)
-
-        # Make all the first diffs for saturated groups be equal to
-        # 100,000 to put them above the good values in the sorted index
-        matching_array = np.ones(shape=(positive_first_diffs.shape[0],
-                                        positive_first_diffs.shape[1],
-                                        positive_first_diffs.shape[2])) * 100000
-        #sat_groups is a 3D array that is true when the group is saturated
-        sat_groups = (positive_first_diffs == matching_array)
-        #number_sat_groups is a 2D array with the count of saturated groups for each pixel
-        number_sat_groups = (sat_groups * 1).sum(axis=2)
-        ndiffs = ngroups - 1
-        #Here we sort the 3D array along the last axis which is the group axis.
-        #np.argsort returns a 3D array with the last axis containing the indexes that would yield the groups in
-        #order.
-        sort_index = np.argsort(positive_first_diffs)
-        #median_diffs is a 2D array with the clipped median of each pixel
-        median_diffs = get_clipped_median(ndiffs, number_sat_groups, first_diffs, sort_index)
-
-        # Save initial estimate of the median slope for all pixels
-        median_slopes[integration] = median_diffs
-
-        # Compute uncertainties as the quadrature sum of the poisson noise
-        # in the first difference signal and read noise. Because the first
-        # differences can be biased by CRs/jumps, we use the median signal
-        # for computing the poisson noise. Here we lower the read noise
-        # by the square root of number of frames in the group.
-        # Sigma is a 2D array.
-        poisson_noise = np.sqrt(np.abs(median_diffs))
-        sigma = np.sqrt(poisson_noise * poisson_noise + read_noise_2 / nframes)
-
-        # Reset sigma to exclude pixels with both readnoise and signal=0
-        sigma_0_pixels = np.where(sigma == 0.)
-        if len(sigma_0_pixels[0] > 0):
-            log.debug('Twopt found %d pixels with sigma=0' % (len(sigma_0_pixels[0])))
-            log.debug('which will be reset so that no jump will be detected')
-            sigma[sigma_0_pixels] = HUGE_NUM
-
-        # Compute distance of each sample from the median in units of sigma;
-        # note that the use of "abs" means we'll detect both positive and
-        # negative outliers.
-        #ratio is a 2D array with the units of sigma deviation of the difference from the median.
-        ratio = np.abs(first_diffs - median_diffs[:, :, np.newaxis]) / sigma[:, :, np.newaxis]
-        all_ratios[integration] = ratio
-
-        # get the rows and columns of pixels of all pixels
-        # This seems like an obtuse way to set row and column.
-        row, col = np.where(number_sat_groups >= 0)
-        # Get the group index for each pixel of the largest non-saturated group, assuming the indicies are sorted.
-        # 2 is subtracted from ngroups because we are using differences and there is one less difference than the
-        # number of groups.
-        # This is a 2-D array.
-        max_value_index = ngroups - 2 - number_sat_groups
-
-        # Extract from the sorted group index the index of the largest non-saturated group.
-        max_index1d = sort_index[row, col, max_value_index[row, col]]
-        # Reshape the list of max indicies to be a 2-day array
-        max_index1 = np.reshape(max_index1d, (nrows, ncols))
-
-        #Is this redundant? Are r and c different than row and column?
-        r, c = np.indices(max_index1.shape)
-        # Get the row and column indices of pixels whose largest non-saturated ratio is above the threshold
-        row1, col1 = np.where(ratio[r, c, max_index1] > rej_threshold)
-        log.info('From highest outlier Two point found %d pixels with at least one CR' % (len(row1)))
-        number_pixels_with_cr = len(row1)
-        # Loop over all pixels that we found the first CR in
-        for j in range(number_pixels_with_cr):
-            # Extract the first diffs for the this pixel with at least one CR yielding a 1D array
-            pixel_masked_diffs = first_diffs[row1[j], col1[j]]
-            # Get the scalar readnoise^2 and number of saturated groups for this pixel.
-            pixel_rn2 = read_noise_2[row1[j], col1[j]]
-            pixel_sat_groups = number_sat_groups[row1[j], col1[j]]
-
-            # Create a CR mask and set 1st CR to be found
-            # cr_mask=0 designates a CR
-            pixel_cr_mask = np.ones(pixel_masked_diffs.shape, dtype=bool)
-            number_CRs_found = 1
-            pixel_sorted_index = sort_index[row1[j], col1[j], :]
-            pixel_cr_mask[pixel_sorted_index[ndiffs - pixel_sat_groups - 1]] = 0  #setting largest diff to be a CR
-            new_CR_found = True
-
-            # Loop and see if there is more than one CR, setting the mask as you go
-            while new_CR_found and ((ndiffs - number_CRs_found - pixel_sat_groups) > 1):
-                new_CR_found = False
-                # For this pixel get a new median difference excluding the number of CRs found and
-                # the number of saturated groups
-                pixel_med_diff = get_clipped_median(ndiffs, number_CRs_found + pixel_sat_groups,
-                                                       pixel_masked_diffs, pixel_sorted_index)
-                #recalculate the noise and ratio for this pixel now that we have rejected a CR
-                pixel_poisson_noise = np.sqrt(np.abs(pixel_med_diff))
-                pixel_sigma = np.sqrt(pixel_poisson_noise * pixel_poisson_noise + pixel_rn2 / nframes)
-                pixel_ratio = np.abs(pixel_masked_diffs - pixel_med_diff) / pixel_sigma
-
-                # Check if largest remaining difference is above threshold
-                if pixel_ratio[pixel_sorted_index[ndiffs - number_CRs_found - pixel_sat_groups - 1]] > rej_threshold:
-                    new_CR_found = True
-                    pixel_cr_mask[pixel_sorted_index[ndiffs - number_CRs_found - pixel_sat_groups - 1]] = 0
-                    number_CRs_found += 1
-
-            # Found all CRs for this pixel. Set CR flags in input DQ array for this pixel
-            gdq[integration, 1:, row1[j], col1[j]] = \
-                np.bitwise_or(gdq[integration, 1:, row1[j], col1[j]],
-                              dqflags.group['JUMP_DET'] * np.invert(pixel_cr_mask))
-
-            # Save the CR-cleaned median slope for this pixel
-            if not new_CR_found:  # the while loop ran at least one time
-                median_slopes[integration, row1[j], col1[j]] = pixel_med_diff
-
-        # Next pixel with an outlier (j loop)
-    # Next integration (integration loop)
-    if flag_4_neighbors: # We need to flag the neighbors of jumps
-
-        cr_int, cr_group, cr_row, cr_col = np.where(np.bitwise_and(gdq, dqflags.group['JUMP_DET']))
-        number_pixels_with_cr = len(cr_int)
-        #loop over all jumps
-        for j in range(number_pixels_with_cr):
-            #jumps must be within a certain range to have neighbors flagged
-            if all_ratios[cr_int[j], cr_row[j], cr_col[j], cr_group[j] - 1] < max_jump_to_flag_neighbors and \
-                    all_ratios[cr_int[j], cr_row[j], cr_col[j], cr_group[j] - 1] > min_jump_to_flag_neighbors:
-                # This section saves flagged neighbors that are above or below the current range of row. If this
-                # method is running in a single process, the row above and below are not used. If it is running in
-                # multiprocessing mode, then the rows above and below need to be returned to find_jumps to use when
-                # it reconstructs the full group dq array from the slices.
-                if cr_row[j] != 0:
-                    gdq[cr_int[j], cr_group[j], cr_row[j] - 1, cr_col[j]] = np.bitwise_or(
-                        gdq[cr_int[j], cr_group[j], cr_row[j] - 1, cr_col[j]],
-                        dqflags.group['JUMP_DET'])
-                else:
-                    row_below_gdq[cr_int[j], cr_group[j], cr_col[j]] =  dqflags.group['JUMP_DET']
-                if cr_row[j] != nrows - 1:
-                    gdq[cr_int[j], cr_group[j], cr_row[j] + 1, cr_col[j]] = np.bitwise_or(
-                        gdq[cr_int[j], cr_group[j], cr_row[j] + 1, cr_col[j]],
-                        dqflags.group['JUMP_DET'])
-                else:
-                    row_above_gdq[cr_int[j], cr_group[j], cr_col[j]] = dqflags.group['JUMP_DET']
-                # Here we are just checking that we don't flag neighbors of jumps that are off the detector.
-                if cr_col[j] != 0:
-                    gdq[cr_int[j], cr_group[j], cr_row[j], cr_col[j] - 1] = np.bitwise_or(
-                        gdq[cr_int[j], cr_group[j], cr_row[j], cr_col[j] - 1],
-                        dqflags.group['JUMP_DET'])
-                if cr_col[j] != ncols - 1:
-                    gdq[cr_int[j], cr_group[j], cr_row[j], cr_col[j] + 1] = np.bitwise_or(
-                        gdq[cr_int[j], cr_group[j], cr_row[j], cr_col[j] + 1],
-                        dqflags.group['JUMP_DET'])
+    ngroups : int
+        number of groups per integration
 
-    return gdq, row_below_gdq, row_above_gdq
+    ncols : int
+        number of columns
+
+    Returns
+    -------
+    nrows : int or None
+        number of rows per block, at least 1; None if there is no limit
+    """
+    if max_block_memory is None:
+        return None
+
+    bytes_per_row = ncols * max(ngroups - 1, 1) * BYTES_PER_DIFF
+    return max(1, int(max_block_memory * 1024 * 1024 / bytes_per_row))
 
 
 def get_clipped_median(num_differences, diffs_to_ignore, differences, sorted_index):
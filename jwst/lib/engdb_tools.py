@@ -4,8 +4,12 @@ Engineering Database
 """
 
 from astropy.time import Time
+from bisect import bisect_left, bisect_right
 from collections import namedtuple
+import hashlib
+import json
 import logging
+import os
 from os import getenv
 import re
 import requests
@@ -33,12 +37,38 @@ ENGDB_METADATA = 'MetaData/TlmMnemonics/'
 ENGDB_METADATA_XML = 'xml/MetaData/TlmMnemonics/'
 
 __all__ = [
-    'ENGDB_Service'
+    'ENGDB_Service',
+    'EngDB_Cache',
+    'enable_cache',
+    'disable_cache',
+    'get_cache',
 ]
 
+# Time, in seconds, after which the telemetry of a time range is assumed to
+# be complete: more recent time ranges may still get late telemetry and are
+# not cached.
+CACHE_SETTLE_TIME = 6 * 3600.
+
 # Define the returned value tuple.
 _EngDB_Value = namedtuple('EngDB_Value', ['obstime', 'value'])
 
+# HTTP session shared by all the queries, so that the connections to the
+# service are reused.
+_session = None
+
+# Caches of the records retrieved from each service, by base URL,
+# or None if caching is disabled.
+_caches = None
+_cache_dir = None
+_cache_settle_time = CACHE_SETTLE_TIME
+
+
+def _get_session():
+    global _session
+    if _session is None:
+        _session = requests.Session()
+    return _session
+
 
 class _Value_Collection():
     """Engineering Value Collection
@@ -98,6 +128,234 @@ class _Value_Collection():
             self.collection.append(value)
 
 
+class EngDB_Cache():
+    """Time-indexed cache of the records of the engineering database
+
+    For each mnemonic, the cache keeps the time ranges that have been
+    retrieved, with all their records and the bracketing records before
+    and after. A query within one of these ranges is answered from the
+    records the way the service answers it: the records in the requested
+    time range and the bracketing records on either side.
+
+    Parameters
+    ----------
+    cache_dir: str or None
+        If not None, the records of each mnemonic are also saved in a JSON
+        file in this directory, and read from it by later runs.
+
+    settle_time: float
+        Time, in seconds, that must have passed since the end of a time
+        range for it to be cached.
+
+    Notes
+    -----
+    Telemetry reaches the database with some delay, so time ranges which
+    ended less than ``settle_time`` ago may still get new records and are
+    not cached.
+    """
+    def __init__(self, cache_dir=None, settle_time=CACHE_SETTLE_TIME):
+        self.cache_dir = cache_dir
+        self.settle_time = settle_time
+        if cache_dir is not None:
+            os.makedirs(cache_dir, exist_ok=True)
+
+        # For each mnemonic, the response fields other than the data
+        # and the time ranges as [start, end, obstimes, records], sorted
+        # and disjoint.
+        self._mnemonics = {}
+
+    def _path(self, mnemonic):
+        return os.path.join(self.cache_dir, mnemonic.lower() + '.json')
+
+    def _ranges(self, mnemonic):
+        """Return the response fields and time ranges of a mnemonic"""
+        try:
+            return self._mnemonics[mnemonic]
+        except KeyError:
+            pass
+
+        entry = (None, [])
+        if self.cache_dir is not None and os.path.exists(self._path(mnemonic)):
+            try:
+                with open(self._path(mnemonic)) as cache_file:
+                    cached = json.load(cache_file)
+                entry = (cached['fields'], [
+                    [start, end, [extract_db_time(record['ObsTime'])
+                                  for record in records], records]
+                    for start, end, records in cached['ranges']
+                ])
+            except (OSError, ValueError, KeyError, TypeError) as exception:
+                logger.warning(
+                    'Ignoring cached records {}: {}'.format(
+                        self._path(mnemonic), exception
+                    )
+                )
+        self._mnemonics[mnemonic] = entry
+        return entry
+
+    def get(self, mnemonic, starttime, endtime):
+        """Return the cached records of a time range
+
+        Parameters
+        ----------
+        mnemonic: str
+            The engineering mnemonic
+
+        starttime, endtime: int
+            The, inclusive, time range in milliseconds, as the service
+            reports it in ``ReqSTime`` and ``ReqETime``.
+
+        Returns
+        -------
+        records: dict or None
+            The records as returned by the service, or None if the time
+            range has not been retrieved.
+        """
+        fields, ranges = self._ranges(mnemonic)
+        for start, end, obstimes, records in ranges:
+            if start <= starttime and endtime <= end:
+                break
+        else:
+            return None
+
+        first = max(bisect_left(obstimes, starttime) - 1, 0)
+        last = bisect_right(obstimes, endtime) + 1
+        data = records[first:last]
+
+        result = dict(fields)
+        result['ReqSTime'] = '/Date({:013d}+0000)/'.format(starttime)
+        result['ReqETime'] = '/Date({:013d}+0000)/'.format(endtime)
+        result['Count'] = len(data)
+        result['Data'] = data if data else None
+        return result
+
+    def put(self, mnemonic, records):
+        """Add the records returned by the service for a time range
+
+        Parameters
+        ----------
+        mnemonic: str
+            The engineering mnemonic
+
+        records: dict
+            The records returned by the service.
+        """
+        starttime = extract_db_time(records['ReqSTime'])
+        endtime = extract_db_time(records['ReqETime'])
+        if endtime > (Time.now().unix - self.settle_time) * 1000.:
+            return
+
+        _, ranges = self._ranges(mnemonic)
+        fields = {
+            key: value
+            for key, value in records.items()
+            if key not in ('ReqSTime', 'ReqETime', 'Count', 'Data')
+        }
+
+        # Merge the new range with the ranges it overlaps.
+        by_obstime = {}
+        for record in records['Data'] or []:
+            by_obstime[extract_db_time(record['ObsTime'])] = record
+        kept = []
+        for start, end, obstimes, cached in ranges:
+            if end < starttime or start > endtime:
+                kept.append([start, end, obstimes, cached])
+                continue
+            starttime = min(starttime, start)
+            endtime = max(endtime, end)
+            for obstime, record in zip(obstimes, cached):
+                by_obstime.setdefault(obstime, record)
+        obstimes = sorted(by_obstime)
+        kept.append([starttime, endtime, obstimes,
+                     [by_obstime[obstime] for obstime in obstimes]])
+        kept.sort(key=lambda entry: entry[0])
+
+        self._mnemonics[mnemonic] = (fields, kept)
+        if self.cache_dir is not None:
+            self._save(mnemonic)
+
+    def _save(self, mnemonic):
+        fields, ranges = self._mnemonics[mnemonic]
+        path = self._path(mnemonic)
+        tmp_path = '{}.{}.tmp'.format(path, os.getpid())
+        try:
+            with open(tmp_path, 'w') as cache_file:
+                json.dump({
+                    'fields': fields,
+                    'ranges': [[start, end, records]
+                               for start, end, _, records in ranges]
+                }, cache_file)
+            os.replace(tmp_path, path)
+        except OSError as exception:
+            logger.warning(
+                'Cannot save cached records {}: {}'.format(path, exception)
+            )
+
+
+def enable_cache(cache_dir=None, settle_time=CACHE_SETTLE_TIME):
+    """Cache the records retrieved from the engineering database
+
+    Once enabled, the `ENGDB_Service` objects answer the queries within
+    the time ranges already retrieved from the cache. If the
+    environment variable ``ENG_CACHE_DIR`` is set, the cache is enabled
+    with that directory when first needed.
+
+    Parameters
+    ----------
+    cache_dir: str or None
+        If not None, the records are also saved in this directory, one
+        subdirectory per service, and read from it by later runs.
+
+    settle_time: float
+        Time, in seconds, that must have passed since the end of a time
+        range for it to be cached. See `EngDB_Cache`.
+    """
+    global _caches, _cache_dir, _cache_settle_time
+    _caches = {}
+    _cache_dir = cache_dir
+    _cache_settle_time = settle_time
+
+
+def disable_cache():
+    """Stop caching the records of the engineering database"""
+    global _caches, _cache_dir, _cache_settle_time
+    _caches = None
+    _cache_dir = None
+    _cache_settle_time = CACHE_SETTLE_TIME
+
+
+def get_cache(base_url):
+    """Return the cache of a service, or None if caching is disabled
+
+    Parameters
+    ----------
+    base_url: str
+        The base url of the service.
+
+    Returns
+    -------
+    cache: `EngDB_Cache` or None
+    """
+    if _caches is None:
+        cache_dir = getenv('ENG_CACHE_DIR')
+        if not cache_dir:
+            return None
+        enable_cache(cache_dir)
+
+    try:
+        return _caches[base_url]
+    except KeyError:
+        pass
+    cache_dir = None
+    if _cache_dir is not None:
+        cache_dir = os.path.join(
+            _cache_dir, hashlib.sha1(base_url.encode()).hexdigest()[:16]
+        )
+    cache = EngDB_Cache(cache_dir, settle_time=_cache_settle_time)
+    _caches[base_url] = cache
+    return cache
+
+
 class ENGDB_Service():
     """
     Set of various utilities to access the JWST
@@ -112,10 +370,14 @@ class ENGDB_Service():
         The format the results of the data should be returned.
         If 'dict', the result will be in Python dict format.
 
+    cache: `EngDB_Cache` or None
+        The cache of the records retrieved from the service. If None,
+        the cache returned by `get_cache` is used, if caching is enabled.
+
     Attributes
     ----------
     response: `requests.response`
-        The results of the last query.
+        The results of the last query to the service.
 
     starttime: `astropy.time.Time`
         The start time of the last query.
@@ -130,16 +392,19 @@ class ENGDB_Service():
         This is not the format of the returned data.
     """
 
-    def __init__(self, base_url=None, default_format='dict'):
+    def __init__(self, base_url=None, default_format='dict', cache=None):
         if base_url is None:
             base_url = getenv('ENG_BASE_URL', ENGDB_BASE_URL)
         if base_url[-1] !='/':
             base_url += '/'
         self.base_url = base_url
         self.default_format = default_format
+        if cache is None:
+            cache = get_cache(base_url)
+        self.cache = cache
 
         # Check for aliveness
-        response = requests.get(''.join([
+        response = _get_session().get(''.join([
             self.base_url,
             self.default_format,
             ENGDB_METADATA
@@ -203,6 +468,9 @@ class ENGDB_Service():
         -----
         The engineering service always returns the bracketing entries
         before and after the requested time range.
+
+        If the service has a cache, the records of a time range that
+        has already been retrieved are returned from the cache.
         """
         if result_format is None:
             result_format = self.default_format
@@ -212,6 +480,20 @@ class ENGDB_Service():
         if not isinstance(endtime, Time):
             endtime = Time(endtime, format=time_format)
 
+        # Only the records in the default format are cached.
+        cache = self.cache if result_format == '' else None
+        if cache is not None:
+            records = cache.get(
+                mnemonic, _time_to_db(starttime), _time_to_db(endtime)
+            )
+            if records is not None:
+                logger.debug('Cached records of {} from {} to {}'.format(
+                    mnemonic, starttime.iso, endtime.iso
+                ))
+                self.starttime = starttime
+                self.endtime = endtime
+                return records
+
         # Build the URL
         query = ''.join([
             self.base_url,
@@ -226,7 +508,7 @@ class ENGDB_Service():
         logger.debug('Query URL="{}"'.format(query))
 
         # Make our request
-        response = requests.get(query)
+        response = _get_session().get(query)
         logger.debug('Response="{}"'.format(response))
         response.raise_for_status()
 
@@ -234,7 +516,65 @@ class ENGDB_Service():
         self.response = response
         self.starttime = starttime
         self.endtime = endtime
-        return response.json()
+        records = response.json()
+        if cache is not None:
+            cache.put(mnemonic, records)
+        return records
+
+    def prefetch(self, mnemonics, windows, time_format=None, max_gap=3600.):
+        """Retrieve mnemonics for several time ranges into the cache
+
+        The time ranges that overlap or are less than `max_gap` apart are
+        merged, and each mnemonic is retrieved once for each merged range,
+        so that the later queries for the individual time ranges are
+        answered from the cache.
+
+        Parameters
+        ----------
+        mnemonics: [str[,...]]
+            The engineering mnemonics to retrieve
+
+        windows: [(starttime, endtime)[,...]]
+            The time ranges, as str or `astropy.time.Time`.
+
+        time_format: str
+            The format of the input time used if the input times
+            are strings. If None, a guess is made.
+
+        max_gap: float
+            The largest gap, in seconds, between time ranges that are
+            retrieved together.
+
+        Raises
+        ------
+        requests.exceptions.HTTPError
+            Either a bad URL or non-existant mnemonic.
+        """
+        if self.cache is None:
+            logger.warning('Engineering DB cache is not enabled, nothing to prefetch')
+            return
+
+        ranges = []
+        for starttime, endtime in windows:
+            if not isinstance(starttime, Time):
+                starttime = Time(starttime, format=time_format)
+            if not isinstance(endtime, Time):
+                endtime = Time(endtime, format=time_format)
+            ranges.append((starttime.unix, endtime.unix))
+        ranges.sort()
+
+        merged = []
+        for start, end in ranges:
+            if merged and start - merged[-1][1] <= max_gap:
+                merged[-1][1] = max(merged[-1][1], end)
+            else:
+                merged.append([start, end])
+
+        for start, end in merged:
+            starttime = Time(start, format='unix')
+            endtime = Time(end, format='unix')
+            for mnemonic in mnemonics:
+                self.get_records(mnemonic, starttime, endtime)
 
     def get_values(
             self,
@@ -338,7 +678,7 @@ class ENGDB_Service():
         logger.debug('Query URL="{}"'.format(query))
 
         # Make our request
-        response = requests.get(query)
+        response = _get_session().get(query)
         logger.debug('Response="{}"'.format(response))
         response.raise_for_status()
 
@@ -350,6 +690,11 @@ class ENGDB_Service():
 # #########
 # Utilities
 # #########
+def _time_to_db(time):
+    """Time in milliseconds of a query time, as the service reads it"""
+    return int(round(Time(time.iso, format='iso').unix * 1000.))
+
+
 def extract_db_time(db_date):
     """Extract date from date string in the Database
 
@@ -0,0 +1,90 @@
+"""Utilities for the steps that use a pool of processes"""
+import logging
+import multiprocessing
+
+log = logging.getLogger(__name__)
+log.setLevel(logging.DEBUG)
+
+
+def num_processes(max_cores):
+    """
+    Number of processes to use for the fraction of the available cores
+    given by a step's ``maximum_cores`` option.
+
+    Parameters
+    ----------
+    max_cores : str or None
+        'quarter', 'half' or 'all' of the cores; None means no
+        multiprocessing
+
+    Returns
+    -------
+    num_processes : int
+        number of processes to use, at least 1
+    """
+    if max_cores is None:
+        return 1
+    num_cores = multiprocessing.cpu_count()
+    log.debug('Found {} possible cores'.format(num_cores))
+    if max_cores == 'quarter':
+        return num_cores // 4 or 1
+    elif max_cores == 'half':
+        return num_cores // 2 or 1
+    elif max_cores == 'all':
+        return num_cores
+    return 1
+
+
+def fork_processes(nproc):
+    """
+    Number of processes of a pool given by `fork_pool`.
+
+    Parameters
+    ----------
+    nproc : int
+        number of processes wanted
+
+    Returns
+    -------
+    nproc : int
+        `nproc`, or 1 where the 'fork' start method is not available
+    """
+    if nproc > 1 and 'fork' not in multiprocessing.get_all_start_methods():
+        log.warning("The 'fork' start method is not available; "
+                    "using a single process")
+        return 1
+    return nproc
+
+
+def fork_pool(processes, initializer, initargs):
+    """
+    Pool of processes started with the 'fork' method.
+
+    The steps give their workers the models they work on through the
+    initializer of the pool, so that the models are not sent with every
+    task. The workers inherit `initargs` from the parent when they are
+    forked: nothing is pickled but the tasks and their results. With the
+    'spawn' or 'forkserver' methods, the default on Windows and macOS,
+    `initargs` would instead be pickled for every worker, if the models can
+    be pickled at all; use `fork_processes` to fall back to a single
+    process where 'fork' is not available.
+
+    Parameters
+    ----------
+    processes : int
+        number of worker processes
+
+    initializer : callable
+        function called with `initargs` by each worker when it starts
+
+    initargs : tuple
+        arguments of `initializer`
+
+    Returns
+    -------
+    pool : multiprocessing.pool.Pool
+        the pool, to be terminated by the caller
+    """
+    context = multiprocessing.get_context('fork')
+    return context.Pool(processes=processes, initializer=initializer,
+                        initargs=initargs)
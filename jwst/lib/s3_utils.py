@@ -2,14 +2,42 @@
 Experimental support for reading reference files from S3.  Use of these functions
 requires installing the [aws] extras (but this module can be safely imported without
 them).
+
+`open_object` returns a seekable, read-only file object that fetches the
+object with range requests, one block at a time, so that only the parts of
+the object that are read are downloaded.  The blocks following the last one
+read are fetched in the background, and all the blocks are kept in a shared
+cache (`BlockCache`), in memory and optionally in a local directory, which is
+set by the ``JWST_S3_BLOCK_CACHE`` environment variable or `set_block_cache`.
 """
 import atexit
+from collections import OrderedDict
+from concurrent.futures import ThreadPoolExecutor
+import hashlib
+import io
+import os
+import tempfile
+import threading
+
+
+__all__ = ["object_exists", "get_object", "open_object", "prefetch", "get_client",
+           "get_range_client", "get_block_cache", "set_block_cache", "BlockCache",
+           "S3File", "is_s3_uri", "split_uri"]
+
 
+# Size of the blocks fetched by S3File
+BLOCK_SIZE = 4 * 2**20
 
-__all__ = ["object_exists", "get_object", "get_client", "is_s3_uri", "split_uri"]
+# Number of blocks S3File fetches ahead of a sequential read
+PREFETCH_BLOCKS = 2
+
+# Maximum size of the blocks kept in memory by the default cache
+CACHE_SIZE = 256 * 2**20
 
 
 _CLIENT = None
+_RANGE_CLIENT = None
+_BLOCK_CACHE = None
 
 
 def object_exists(uri):
@@ -48,6 +76,46 @@ def get_object(uri):
     return get_client().get_object(bucket_name, key)
 
 
+def open_object(uri, cache=None):
+    """
+    Open an object on S3 for reading, without downloading it.
+
+    Parameters
+    ----------
+    uri : str
+        S3 URI (s3://bucket-name/some/key)
+    cache : BlockCache, optional
+        Cache of the blocks read, the shared cache by default.
+
+    Returns
+    -------
+    S3File
+        Seekable binary file object reading the object with range requests.
+    """
+    return S3File(uri, cache=cache)
+
+
+def prefetch(uri, nblocks=1, cache=None):
+    """
+    Start fetching the first blocks of an object into the block cache.
+
+    For example, the headers of a file that is going to be opened with
+    `open_object` are then usually ready by the time they are read.
+
+    Parameters
+    ----------
+    uri : str
+        S3 URI (s3://bucket-name/some/key)
+    nblocks : int
+        The number of blocks to fetch.
+    cache : BlockCache, optional
+        The cache to fetch the blocks into, the shared cache by default.
+    """
+    with S3File(uri, cache=cache, prefetch_blocks=0) as s3file:
+        for index in range(min(nblocks, s3file.nblocks)):
+            s3file.prefetch(index)
+
+
 def get_client():
     """
     Get the shared instance of ConcurrentS3Client.
@@ -64,6 +132,316 @@ def get_client():
     return _CLIENT
 
 
+def get_range_client():
+    """
+    Get the shared client making the range requests of `S3File`.
+
+    The shared ConcurrentS3Client is used if it supports range requests,
+    otherwise a botocore S3 client.
+
+    Returns
+    -------
+    object
+        Client with ``object_info(bucket_name, key)``, returning the size
+        and the ETag of an object, and ``get_range(bucket_name, key, start,
+        stop)``, returning bytes `start` to `stop` of an object.
+    """
+    global _RANGE_CLIENT
+    client = get_client()
+    if hasattr(client, "get_range") and hasattr(client, "object_info"):
+        return client
+    if _RANGE_CLIENT is None:
+        _RANGE_CLIENT = _BotocoreRangeClient()
+    return _RANGE_CLIENT
+
+
+class _BotocoreRangeClient:
+    """Range requests through botocore, installed with the [aws] extras."""
+
+    def __init__(self):
+        import botocore.session
+        self._client = botocore.session.get_session().create_client("s3")
+
+    def object_info(self, bucket_name, key):
+        response = self._client.head_object(Bucket=bucket_name, Key=key)
+        return response["ContentLength"], response.get("ETag")
+
+    def get_range(self, bucket_name, key, start, stop):
+        response = self._client.get_object(
+            Bucket=bucket_name, Key=key,
+            Range="bytes={}-{}".format(start, stop - 1)
+        )
+        body = response["Body"]
+        try:
+            return body.read()
+        finally:
+            body.close()
+
+
+def get_block_cache():
+    """
+    Get the shared cache of the blocks read by `S3File`.
+
+    The cache is created on first use, keeping up to `CACHE_SIZE` bytes in
+    memory and, if the ``JWST_S3_BLOCK_CACHE`` environment variable is set,
+    all the blocks in that directory.
+
+    Returns
+    -------
+    BlockCache
+    """
+    global _BLOCK_CACHE
+    if _BLOCK_CACHE is None:
+        _BLOCK_CACHE = BlockCache(directory=os.environ.get("JWST_S3_BLOCK_CACHE"))
+    return _BLOCK_CACHE
+
+
+def set_block_cache(cache):
+    """
+    Replace the shared block cache.
+
+    Parameters
+    ----------
+    cache : BlockCache or None
+        The new cache, or None to create the default cache on next use.
+    """
+    global _BLOCK_CACHE
+    _BLOCK_CACHE = cache
+
+
+class BlockCache:
+    """
+    Cache of blocks of S3 objects, shared by the files reading them.
+
+    The blocks are identified by the URI and the ETag of their object, so
+    that the blocks of an object that has been replaced are not reused.
+    Blocks can be fetched in the background with `prefetch`; `get` then
+    waits for the block instead of fetching it again.  The ``hits`` and
+    ``misses`` counters count the blocks `get` did not or did have to fetch.
+
+    Parameters
+    ----------
+    max_bytes : int
+        The maximum size of the blocks kept in memory; the blocks used least
+        recently are dropped first.
+    directory : str, optional
+        Directory in which all the blocks are also stored, to be reused by
+        later runs.  Blocks are not removed from it.
+    max_workers : int
+        Number of threads fetching blocks in the background.
+    """
+
+    def __init__(self, max_bytes=CACHE_SIZE, directory=None, max_workers=4):
+        self.max_bytes = max_bytes
+        self.directory = directory
+        self.hits = 0
+        self.misses = 0
+        self._blocks = OrderedDict()
+        self._nbytes = 0
+        self._pending = {}
+        self._lock = threading.Lock()
+        self._max_workers = max_workers
+        self._executor = None
+        if directory is not None:
+            os.makedirs(directory, exist_ok=True)
+
+    def __contains__(self, key):
+        with self._lock:
+            return key in self._blocks or key in self._pending
+
+    def get(self, key, fetch):
+        """
+        Return the block `key`, calling ``fetch()`` to get it if it is not
+        in the cache nor being fetched.
+        """
+        with self._lock:
+            block = self._blocks.get(key)
+            if block is not None:
+                self._blocks.move_to_end(key)
+                self.hits += 1
+                return block
+            future = self._pending.get(key)
+            if future is not None:
+                self.hits += 1
+
+        if future is not None:
+            return future.result()
+        return self._fetch(key, fetch, count=True)
+
+    def prefetch(self, key, fetch):
+        """Start fetching the block `key` in the background, if needed."""
+        with self._lock:
+            if key in self._blocks or key in self._pending:
+                return
+            if self._executor is None:
+                self._executor = ThreadPoolExecutor(max_workers=self._max_workers)
+                atexit.register(self._executor.shutdown, wait=False)
+            self._pending[key] = self._executor.submit(self._fetch, key, fetch)
+
+    def clear(self):
+        """Drop the blocks kept in memory."""
+        with self._lock:
+            self._blocks.clear()
+            self._nbytes = 0
+
+    def _fetch(self, key, fetch, count=False):
+        try:
+            block = self._read(key)
+            fetched = block is None
+            if fetched:
+                block = fetch()
+                self._write(key, block)
+            self._add(key, block, fetched if count else None)
+            return block
+        finally:
+            with self._lock:
+                self._pending.pop(key, None)
+
+    def _add(self, key, block, fetched=None):
+        with self._lock:
+            if fetched is True:
+                self.misses += 1
+            elif fetched is False:
+                self.hits += 1
+            if key in self._blocks:
+                return
+            self._blocks[key] = block
+            self._nbytes += len(block)
+            while self._nbytes > self.max_bytes and len(self._blocks) > 1:
+                _, dropped = self._blocks.popitem(last=False)
+                self._nbytes -= len(dropped)
+
+    def _path(self, key):
+        name = hashlib.sha1(repr(key).encode("utf-8")).hexdigest()
+        return os.path.join(self.directory, name)
+
+    def _read(self, key):
+        if self.directory is None:
+            return None
+        try:
+            with open(self._path(key), "rb") as block_file:
+                return block_file.read()
+        except FileNotFoundError:
+            return None
+
+    def _write(self, key, block):
+        if self.directory is None:
+            return
+        fd, tmp_path = tempfile.mkstemp(dir=self.directory)
+        try:
+            with os.fdopen(fd, "wb") as block_file:
+                block_file.write(block)
+            os.replace(tmp_path, self._path(key))
+        except OSError:
+            if os.path.exists(tmp_path):
+                os.remove(tmp_path)
+
+
+class S3File(io.RawIOBase):
+    """
+    Read-only, seekable file object reading an S3 object with range requests.
+
+    The object is read in blocks of `block_size` bytes, which are kept in a
+    `BlockCache`.  When the blocks are read in order, the next
+    `prefetch_blocks` blocks are fetched in the background.
+
+    Parameters
+    ----------
+    uri : str
+        S3 URI (s3://bucket-name/some/key)
+    cache : BlockCache, optional
+        The cache of the blocks, the shared cache by default.
+    block_size : int, optional
+        The size of the blocks, `BLOCK_SIZE` by default.
+    prefetch_blocks : int, optional
+        The number of blocks to fetch ahead, `PREFETCH_BLOCKS` by default.
+    """
+
+    def __init__(self, uri, cache=None, block_size=None, prefetch_blocks=None):
+        super().__init__()
+        self.uri = uri
+        self._bucket_name, self._key = split_uri(uri)
+        self._client = get_range_client()
+        self.size, self._etag = self._client.object_info(self._bucket_name, self._key)
+        self._cache = get_block_cache() if cache is None else cache
+        self.block_size = BLOCK_SIZE if block_size is None else block_size
+        self.prefetch_blocks = (PREFETCH_BLOCKS if prefetch_blocks is None
+                                else prefetch_blocks)
+        self._position = 0
+        self._last_block = None
+
+    @property
+    def nblocks(self):
+        return -(-self.size // self.block_size)
+
+    def readable(self):
+        return True
+
+    def seekable(self):
+        return True
+
+    def tell(self):
+        return self._position
+
+    def seek(self, offset, whence=io.SEEK_SET):
+        if whence == io.SEEK_SET:
+            position = offset
+        elif whence == io.SEEK_CUR:
+            position = self._position + offset
+        elif whence == io.SEEK_END:
+            position = self.size + offset
+        else:
+            raise ValueError("Invalid whence ({}, should be 0, 1 or 2)".format(whence))
+        if position < 0:
+            raise ValueError("Negative seek position {}".format(position))
+        self._position = position
+        return position
+
+    def readinto(self, buffer):
+        if self.closed:
+            raise ValueError("I/O operation on closed file")
+        view = memoryview(buffer).cast("B")
+        size = max(0, min(len(view), self.size - self._position))
+        done = 0
+        while done < size:
+            index, offset = divmod(self._position, self.block_size)
+            block = self._block(index)
+            count = min(size - done, len(block) - offset)
+            if count <= 0:
+                break
+            view[done:done + count] = memoryview(block)[offset:offset + count]
+            done += count
+            self._position += count
+        return done
+
+    def readall(self):
+        return self.read(max(0, self.size - self._position))
+
+    def prefetch(self, index):
+        """Start fetching block `index` in the background."""
+        self._cache.prefetch(self._block_key(index), self._fetcher(index))
+
+    def _block(self, index):
+        block = self._cache.get(self._block_key(index), self._fetcher(index))
+        if self._last_block is not None and index == self._last_block + 1:
+            for ahead in range(index + 1, min(index + 1 + self.prefetch_blocks,
+                                              self.nblocks)):
+                self.prefetch(ahead)
+        self._last_block = index
+        return block
+
+    def _block_key(self, index):
+        return (self.uri, self._etag, self.block_size, index)
+
+    def _fetcher(self, index):
+        start = index * self.block_size
+        stop = min(start + self.block_size, self.size)
+
+        def fetch():
+            return self._client.get_range(self._bucket_name, self._key, start, stop)
+        return fetch
+
+
 def is_s3_uri(value):
     """
     Determine if a value represents an S3 URI.
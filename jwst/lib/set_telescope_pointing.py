@@ -87,6 +87,25 @@ Transforms.__new__.__defaults__ = (None, None, None, None, None,
 WCSRef = namedtuple('WCSRef', ['ra', 'dec', 'pa'])
 WCSRef.__new__.__defaults__ = (None, None, None)
 
+# Mnemonics of the pointing information in the engineering database
+POINTING_MNEMONICS = (
+    'SA_ZATTEST1',
+    'SA_ZATTEST2',
+    'SA_ZATTEST3',
+    'SA_ZATTEST4',
+    'SA_ZRFGS2J11',
+    'SA_ZRFGS2J12',
+    'SA_ZRFGS2J13',
+    'SA_ZRFGS2J21',
+    'SA_ZRFGS2J22',
+    'SA_ZRFGS2J23',
+    'SA_ZRFGS2J31',
+    'SA_ZRFGS2J32',
+    'SA_ZRFGS2J33',
+    'SA_ZADUCMDX',
+    'SA_ZADUCMDY',
+)
+
 
 def add_wcs(filename, default_pa_v3=0., siaf_path=None, engdb_url=None,
             tolerance=60, allow_default=False, reduce_func=None,
@@ -1283,23 +1302,7 @@ def get_mnemonics(obsstart, obsend, tolerance, engdb_url=None):
         'Querying engineering DB: {}'.format(engdb.base_url)
     )
 
-    mnemonics = {
-        'SA_ZATTEST1':  None,
-        'SA_ZATTEST2':  None,
-        'SA_ZATTEST3':  None,
-        'SA_ZATTEST4':  None,
-        'SA_ZRFGS2J11': None,
-        'SA_ZRFGS2J12': None,
-        'SA_ZRFGS2J13': None,
-        'SA_ZRFGS2J21': None,
-        'SA_ZRFGS2J22': None,
-        'SA_ZRFGS2J23': None,
-        'SA_ZRFGS2J31': None,
-        'SA_ZRFGS2J32': None,
-        'SA_ZRFGS2J33': None,
-        'SA_ZADUCMDX':  None,
-        'SA_ZADUCMDY':  None,
-    }
+    mnemonics = {mnemonic: None for mnemonic in POINTING_MNEMONICS}
 
     # Retrieve the mnemonics from the engineering database.
     # Check for whether the bracket values are used and
@@ -1356,6 +1359,43 @@ def get_mnemonics(obsstart, obsend, tolerance, engdb_url=None):
     return mnemonics
 
 
+def prefetch_mnemonics(windows, engdb_url=None, max_gap=3600.):
+    """Retrieve the pointing mnemonics of several exposures at once
+
+    The mnemonics are retrieved for the merged time ranges of the
+    exposures into the engineering database cache, from which
+    `get_mnemonics` then gets the values of each exposure. The cache
+    must be enabled, see `jwst.lib.engdb_tools.enable_cache`.
+
+    Parameters
+    ----------
+    windows: [(obsstart, obsend)[,...]]
+        MJD observation start/end times of the exposures
+
+    engdb_url: str or None
+        URL of the engineering telemetry database REST interface.
+
+    max_gap: float
+        The largest gap, in seconds, between exposures whose telemetry
+        is retrieved together.
+
+    Raises
+    ------
+    ValueError
+        Cannot retrieve engineering information
+    """
+    try:
+        engdb = ENGDB_Service(base_url=engdb_url)
+        engdb.prefetch(
+            POINTING_MNEMONICS, windows, time_format='mjd', max_gap=max_gap
+        )
+    except Exception as exception:
+        raise ValueError(
+            'Cannot retrieve pointing mnemonics from engineering.'
+            '\nFailure was {}'.format(exception)
+        )
+
+
 def all_pointings(mnemonics):
     """V1 of making pointings
 
@@ -9,6 +9,7 @@ S3_BUCKET_NAME = "test-s3-data"
 class MockS3Client:
     def __init__(self, s3_test_data_path):
         self.s3_test_data_path = s3_test_data_path
+        self.range_requests = []
 
     def get_object(self, bucket_name, key):
         assert self.object_exists(bucket_name, key)
@@ -16,6 +17,20 @@ class MockS3Client:
         with open(self._get_path(key), "rb") as f:
             return io.BytesIO(f.read())
 
+    def object_info(self, bucket_name, key):
+        assert self.object_exists(bucket_name, key)
+
+        stat = os.stat(self._get_path(key))
+        return stat.st_size, str(stat.st_mtime_ns)
+
+    def get_range(self, bucket_name, key, start, stop):
+        assert self.object_exists(bucket_name, key)
+
+        self.range_requests.append((key, start, stop))
+        with open(self._get_path(key), "rb") as f:
+            f.seek(start)
+            return f.read(stop - start)
+
     def object_exists(self, bucket_name, key):
         if bucket_name != S3_BUCKET_NAME:
             return False
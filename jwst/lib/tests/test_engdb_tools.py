@@ -170,3 +170,65 @@ def test_unzip(engdb):
     )
     assert isinstance(values, tuple)
     assert len(values.obstime) == len(values.value)
+
+
+@pytest.mark.parametrize(
+    'starttime, endtime',
+    [
+        (SHORT_STARTTIME, SHORT_STARTTIME),
+        (GOOD_STARTTIME, GOOD_ENDTIME),
+        ('2016-01-18 00:00:00', '2016-01-18 00:00:00'),
+        (NODATA_STARTIME, NODATA_ENDTIME),
+    ]
+)
+def test_cached_records(engdb, tmpdir, starttime, endtime):
+    """Test that the cache returns the records of the service"""
+    expected = engdb.get_records(GOOD_MNEMONIC, starttime, endtime)
+
+    cache_dir = str(tmpdir.join('engdb'))
+    engdb.cache = engdb_tools.EngDB_Cache(cache_dir)
+    engdb.prefetch(
+        [GOOD_MNEMONIC],
+        [('2013-12-31', NODATA_ENDTIME), (GOOD_STARTTIME, GOOD_ENDTIME)],
+        max_gap=0.
+    )
+
+    # Queries are answered from the cache, and from its files by a new cache.
+    for cache in (engdb.cache, engdb_tools.EngDB_Cache(cache_dir)):
+        engdb.cache = cache
+        engdb.response = None
+        records = engdb.get_records(GOOD_MNEMONIC, starttime, endtime)
+        assert engdb.response is None
+        assert records == expected
+
+
+def test_cache_misses(engdb):
+    """Test that time ranges not retrieved are queried from the service"""
+    engdb.cache = engdb_tools.EngDB_Cache()
+    engdb.get_records(GOOD_MNEMONIC, SHORT_STARTTIME, SHORT_STARTTIME)
+
+    engdb.response = None
+    engdb.get_records(GOOD_MNEMONIC, GOOD_STARTTIME, GOOD_ENDTIME)
+    assert engdb.response is not None
+
+    engdb.response = None
+    engdb.get_records(GOOD_MNEMONIC, SHORT_STARTTIME, '2016-01-18 16:00:00')
+    assert engdb.response is None
+
+
+def test_cache_settle_time(engdb):
+    """Test that time ranges which ended within the settle time are not cached"""
+    millennium = 3600. * 24 * 365 * 1000
+    engdb.cache = engdb_tools.EngDB_Cache(settle_time=millennium)
+    engdb.get_records(GOOD_MNEMONIC, GOOD_STARTTIME, GOOD_ENDTIME)
+
+    engdb.response = None
+    engdb.get_records(GOOD_MNEMONIC, GOOD_STARTTIME, GOOD_ENDTIME)
+    assert engdb.response is not None
+
+    engdb.cache = engdb_tools.EngDB_Cache(settle_time=0.)
+    engdb.get_records(GOOD_MNEMONIC, GOOD_STARTTIME, GOOD_ENDTIME)
+
+    engdb.response = None
+    engdb.get_records(GOOD_MNEMONIC, GOOD_STARTTIME, GOOD_ENDTIME)
+    assert engdb.response is None
@@ -0,0 +1,68 @@
+"""Test the multiprocessing utilities"""
+import pytest
+
+from .. import multiprocessing_utils
+
+
+def test_num_processes(monkeypatch):
+    """
+    Test the number of processes for each maximum_cores option
+    """
+    monkeypatch.setattr(multiprocessing_utils.multiprocessing, 'cpu_count',
+                        lambda: 6)
+    assert multiprocessing_utils.num_processes(None) == 1
+    assert multiprocessing_utils.num_processes('quarter') == 1
+    assert multiprocessing_utils.num_processes('half') == 3
+    assert multiprocessing_utils.num_processes('all') == 6
+
+
+def test_num_processes_single_core(monkeypatch):
+    """
+    Test that every option gives at least one process
+    """
+    monkeypatch.setattr(multiprocessing_utils.multiprocessing, 'cpu_count',
+                        lambda: 1)
+    for max_cores in (None, 'quarter', 'half', 'all'):
+        assert multiprocessing_utils.num_processes(max_cores) == 1
+
+
+def test_fork_processes(monkeypatch):
+    """
+    Test that a single process is used where 'fork' is not available
+    """
+    assert multiprocessing_utils.fork_processes(1) == 1
+    monkeypatch.setattr(multiprocessing_utils.multiprocessing,
+                        'get_all_start_methods', lambda: ['fork', 'spawn'])
+    assert multiprocessing_utils.fork_processes(4) == 4
+    monkeypatch.setattr(multiprocessing_utils.multiprocessing,
+                        'get_all_start_methods', lambda: ['spawn'])
+    assert multiprocessing_utils.fork_processes(4) == 1
+
+
+_inherited = None
+
+
+def _set_inherited(value):
+    global _inherited
+    _inherited = value
+
+
+def _get_inherited(i):
+    return (_inherited[0](i), _inherited[1])
+
+
+def test_fork_pool_inherits_initargs():
+    """
+    Test that the workers get initargs that cannot be pickled
+    """
+    if multiprocessing_utils.fork_processes(2) < 2:
+        pytest.skip("the 'fork' start method is not available")
+    square = lambda i: i * i    # noqa: E731, lambdas cannot be pickled
+    pool = multiprocessing_utils.fork_pool(2, _set_inherited,
+                                           ((square, 'state'),))
+    try:
+        results = pool.map(_get_inherited, range(4))
+    finally:
+        pool.terminate()
+        pool.close()
+    assert results == [(0, 'state'), (1, 'state'), (4, 'state'), (9, 'state')]
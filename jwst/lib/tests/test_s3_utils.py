@@ -23,6 +23,84 @@ def test_get_object(s3_text_file):
     assert s3_utils.get_object("s3://test-s3-data/test.txt").read() == b"foo\n"
 
 
+@pytest.fixture
+def s3_binary_file(s3_root_dir):
+    path = str(s3_root_dir.join("test.bin"))
+    with open(path, "wb") as binary_file:
+        binary_file.write(bytes(range(256)) * 40)
+
+    return path
+
+
+def test_open_object(s3_binary_file):
+    with open(s3_binary_file, "rb") as f:
+        content = f.read()
+
+    with s3_utils.S3File("s3://test-s3-data/test.bin", block_size=1000) as s3file:
+        assert s3file.size == len(content)
+        assert s3file.read(10) == content[:10]
+        assert s3file.seek(2995) == 2995
+        assert s3file.read(10) == content[2995:3005]
+        assert s3file.seek(-5, 2) == len(content) - 5
+        assert s3file.read() == content[-5:]
+        assert s3file.read(10) == b""
+        s3file.seek(0)
+        assert s3file.read() == content
+
+
+def test_open_object_reads_blocks_once(s3_binary_file):
+    client = s3_utils.get_client()
+    uri = "s3://test-s3-data/test.bin"
+
+    with s3_utils.S3File(uri, block_size=1000, prefetch_blocks=0) as s3file:
+        s3file.seek(5000)
+        s3file.read(100)
+    assert client.range_requests == [("test.bin", 5000, 6000)]
+
+    # Another file object reuses the cached block
+    with s3_utils.open_object(uri) as s3file:
+        s3file.seek(5000)
+        s3file.read(100)
+    assert len(client.range_requests) == 2
+    with s3_utils.S3File(uri, block_size=1000) as s3file:
+        s3file.seek(5500)
+        s3file.read(100)
+    assert len(client.range_requests) == 2
+
+
+def test_block_cache_directory(s3_binary_file, tmpdir):
+    client = s3_utils.get_client()
+    uri = "s3://test-s3-data/test.bin"
+    directory = str(tmpdir.join("blocks"))
+
+    cache = s3_utils.BlockCache(directory=directory)
+    with s3_utils.S3File(uri, cache=cache, block_size=1000) as s3file:
+        content = s3file.read()
+    assert len(client.range_requests) == 11
+
+    cache = s3_utils.BlockCache(directory=directory)
+    with s3_utils.S3File(uri, cache=cache, block_size=1000) as s3file:
+        assert s3file.read() == content
+    assert len(client.range_requests) == 11
+    assert (cache.hits, cache.misses) == (11, 0)
+
+
+def test_block_cache_max_bytes():
+    cache = s3_utils.BlockCache(max_bytes=10)
+    for key in range(3):
+        cache.get(key, lambda: b"12345")
+    assert 0 not in cache
+    assert 1 in cache and 2 in cache
+
+
+def test_prefetch(s3_binary_file):
+    cache = s3_utils.get_block_cache()
+    s3_utils.prefetch("s3://test-s3-data/test.bin")
+    with s3_utils.open_object("s3://test-s3-data/test.bin") as s3file:
+        assert s3file.read(10) == bytes(range(10))
+    assert (cache.hits, cache.misses) == (1, 0)
+
+
 def test_get_client(s3_text_file):
     assert isinstance(s3_utils.get_client(), helpers.MockS3Client)
 
@@ -1,6 +1,9 @@
 """Primary code for performing outlier detection on JWST observations."""
 
 from functools import partial
+import shutil
+import tempfile
+
 import numpy as np
 
 from stsci.image import median
@@ -9,8 +12,11 @@ from scipy import ndimage
 from drizzle.cdrizzle import tblot
 
 from .. import datamodels
+from ..lib.multiprocessing_utils import (fork_pool, fork_processes,
+                                         num_processes)
 from ..resample import resample
-from ..resample.resample_utils import build_driz_weight, calc_gwcs_pixmap
+from ..resample.resample_utils import (build_driz_weight, calc_gwcs_pixmap,
+                                       reproject)
 from ..stpipe.step import Step
 
 import logging
@@ -19,6 +25,15 @@ log.setLevel(logging.DEBUG)
 
 CRBIT = np.uint32(datamodels.dqflags.pixel['JUMP_DET'])
 
+# Approximate number of bytes used per pixel of each input image when
+# computing the median of a section
+BYTES_PER_MEDIAN_PIXEL = 16
+
+
+# Images blotted and flagged by the processes of the forked pool in
+# OutlierDetection.blot_and_flag
+_pool_state = None
+
 
 __all__ = ["OutlierDetection", "flag_cr", "abs_deriv"]
 
@@ -182,37 +197,57 @@ class OutlierDetection:
 
         pars = self.outlierpars
         save_intermediate_results = pars['save_intermediate_results']
-        if pars['resample_data']:
-            # Start by creating resampled/mosaic images for
-            # each group of exposures
-            sdriz = resample.ResampleData(self.input_models, single=True,
-                                          blendheaders=False, **pars)
-            sdriz.do_drizzle()
-            drizzled_models = sdriz.output_models
-            for model in drizzled_models:
-                if save_intermediate_results:
-                    log.info("Writing out resampled exposures...")
-                    self.save_model(
-                        model,
-                        output_file=model.meta.filename,
-                        suffix=self.resample_suffix
-                    )
-        else:
-            drizzled_models = self.input_models
-            for i in range(len(self.input_models)):
-                drizzled_models[i].wht = build_driz_weight(
-                    self.input_models[i],
-                    weight_type='exptime',
-                    good_bits=pars['good_bits'])
-
-        # Initialize intermediate products used in the outlier detection
-        median_model = datamodels.ImageModel(
-                                        init=drizzled_models[0].data.shape)
-        median_model.update(drizzled_models[0])
-        median_model.meta.wcs = drizzled_models[0].meta.wcs
-
-        # Perform median combination on set of drizzled mosaics
-        median_model.data = self.create_median(drizzled_models)
+        single_dir = None
+        if pars['resample_data'] and pars.get('buffer_size') is not None:
+            # Keep the resampled images on disk, they are read back
+            # section by section by create_median
+            single_dir = tempfile.mkdtemp(prefix='outlier_detection_')
+            log.info("Writing resampled exposures to {}".format(single_dir))
+
+        # The resampled images written to single_dir, to be closed and
+        # removed even if the drizzle or the median fails
+        single_models = []
+        try:
+            if pars['resample_data']:
+                # Start by creating resampled/mosaic images for
+                # each group of exposures
+                sdriz = resample.ResampleData(self.input_models, single=True,
+                                              blendheaders=False,
+                                              single_dir=single_dir, **pars)
+                if single_dir is not None:
+                    single_models = sdriz.output_models
+                sdriz.do_drizzle()
+                drizzled_models = sdriz.output_models
+                for model in drizzled_models:
+                    if save_intermediate_results:
+                        log.info("Writing out resampled exposures...")
+                        self.save_model(
+                            model,
+                            output_file=model.meta.filename,
+                            suffix=self.resample_suffix
+                        )
+            else:
+                drizzled_models = self.input_models
+                for i in range(len(self.input_models)):
+                    drizzled_models[i].wht = build_driz_weight(
+                        self.input_models[i],
+                        weight_type='exptime',
+                        good_bits=pars['good_bits'])
+
+            # Initialize intermediate products used in the outlier detection
+            median_model = datamodels.ImageModel(
+                                            init=drizzled_models[0].data.shape)
+            median_model.update(drizzled_models[0])
+            median_model.meta.wcs = drizzled_models[0].meta.wcs
+
+            # Perform median combination on set of drizzled mosaics
+            median_model.data = self.create_median(drizzled_models)
+        finally:
+            if single_dir is not None:
+                for model in single_models:
+                    model.close()
+                shutil.rmtree(single_dir, ignore_errors=True)
+        del drizzled_models, single_models
 
         if save_intermediate_results:
             median_output_path = self.make_output_path(
@@ -224,6 +259,13 @@ class OutlierDetection:
             ))
             median_model.save(median_output_path)
 
+        if self.use_tiles():
+            # Blot the median image and flag the outliers one tile of rows
+            # at a time, without making the full-frame blotted images
+            self.blot_and_flag(median_model)
+            del median_model
+            return
+
         if pars['resample_data']:
             # Blot the median image back to recreate each input image specified
             # in the original input list/ASN/ModelContainer
@@ -259,39 +301,42 @@ class OutlierDetection:
         following ways:
         - type of combination: fixed to 'median'
         - 'minmed' not implemented as an option
-        """
-        resampled_sci = [i.data for i in resampled_models]
-        resampled_weight = [i.wht for i in resampled_models]
 
+        If the `buffer_size` parameter (in MB) is set, the median is computed
+        in sections of rows, reading only one section of each resampled image
+        at a time, so memory does not grow with the number of images.
+        """
         nlow = self.outlierpars.get('nlow', 0)
         nhigh = self.outlierpars.get('nhigh', 0)
         maskpt = self.outlierpars.get('maskpt', 0.7)
-
-        # Create a mask for each input image, masking out areas where there is
-        # no data or the data has very low weight
-        badmasks = []
-        for weight in resampled_weight:
-            # Create boolean masks for weight being zero or NaN
-            mask_zero_weight = np.equal(weight, 0.)
-            mask_nans = np.isnan(weight)
-            # Combine the masks
-            weight_masked = np.ma.array(weight, mask=np.logical_or(
-                mask_zero_weight, mask_nans))
-            # Sigma-clip the unmasked data
-            weight_masked = sigma_clip(weight_masked, sigma=3, maxiters=5)
-            mean_weight = np.mean(weight_masked)
-            # Mask pixels where weight falls below maskpt percent
-            weight_threshold = mean_weight * maskpt
-            badmask = np.less(weight, weight_threshold)
-            log.debug("Percentage of pixels with low weight: {}".format(
-                np.sum(badmask) / len(weight.flat) * 100))
-            badmasks.append(badmask)
-
-        # Compute median of stack of images using `badmasks` to remove
-        # low-weight values.  In the future we should use a masked array
-        # and np.median
-        median_image = median(resampled_sci, nlow=nlow, nhigh=nhigh,
-                              badmasks=badmasks)
+        buffer_size = self.outlierpars.get('buffer_size')
+
+        # Find the weight below which the data of each input image is masked
+        # out, for areas where there is no data or the data has very low weight
+        weight_thresholds = [weight_threshold(model.wht, maskpt)
+                             for model in resampled_models]
+
+        shape = resampled_models[0].data.shape
+        nrows = rows_per_section(buffer_size, len(resampled_models), shape)
+        if nrows >= shape[0]:
+            resampled_sci = [i.data for i in resampled_models]
+            badmasks = [np.less(model.wht, threshold) for model, threshold
+                        in zip(resampled_models, weight_thresholds)]
+            # Compute median of stack of images using `badmasks` to remove
+            # low-weight values.  In the future we should use a masked array
+            # and np.median
+            return median(resampled_sci, nlow=nlow, nhigh=nhigh,
+                          badmasks=badmasks)
+
+        log.info("Computing median in sections of {} rows".format(nrows))
+        median_image = np.empty(shape, dtype=resampled_models[0].data.dtype)
+        for row_start in range(0, shape[0], nrows):
+            rows = slice(row_start, min(row_start + nrows, shape[0]))
+            resampled_sci = [model.data[rows] for model in resampled_models]
+            badmasks = [np.less(model.wht[rows], threshold) for model, threshold
+                        in zip(resampled_models, weight_thresholds)]
+            median_image[rows] = median(resampled_sci, nlow=nlow, nhigh=nhigh,
+                                        badmasks=badmasks)
 
         return median_image
 
@@ -348,12 +393,115 @@ class OutlierDetection:
         for image, blot in zip(self.input_models, blot_models):
             flag_cr(image, blot, **self.outlierpars)
 
+        self._update_inputs_dq()
+
+    def use_tiles(self):
+        """Whether the median is blotted and the outliers flagged in tiles.
+
+        The tiles are used if the ``tile_rows`` parameter is set and the
+        median is blotted, unless the blotted images have to be saved.
+        """
+        pars = self.outlierpars
+        return (pars.get('tile_rows') is not None and
+                pars['resample_data'] is True and
+                not pars['save_intermediate_results'])
+
+    def blot_and_flag(self, median_model):
+        """Blot the median image and flag outliers, one tile at a time.
+
+        This combines `blot_median` and `detect_outliers`: for each tile of
+        ``tile_rows`` rows of each input image, the pixel map of the tile is
+        computed, the median is blotted onto it and the outliers are flagged
+        in the DQ array of the image, so that no full-frame blotted image,
+        pixel map or derivative is made.  The DQ arrays are the same as with
+        `blot_median` and `detect_outliers`.
+
+        With more than one process (``maximum_cores``), the tiles of all the
+        images are processed at the same time.
+        """
+        pars = self.outlierpars
+        tile_rows = pars['tile_rows']
+        cr_pars = _flag_cr_pars(pars)
+
+        images = []
+        tiles = []
+        for index, model in enumerate(self.input_models):
+            images.append((
+                model.data, model.err, model.meta.wcs,
+                model.meta.exposure.exposure_time,
+                _subtracted_background(model, cr_pars['backg'])
+            ))
+            nrows = model.data.shape[0]
+            for row_start in range(0, nrows, tile_rows):
+                tiles.append((index, row_start,
+                              min(row_start + tile_rows, nrows)))
+
+        state = (median_model.data, median_model.meta.wcs, images, pars)
+        nproc = fork_processes(min(num_processes(pars.get('maximum_cores')),
+                                   len(tiles)))
+        log.info("Blotting median and flagging outliers in {} tiles of {} "
+                 "rows".format(len(tiles), tile_rows))
+
+        if nproc <= 1:
+            results = (_flag_tile(state, *tile) for tile in tiles)
+            self._apply_tiles(tiles, results)
+        else:
+            log.info("Processing tiles with {} processes".format(nproc))
+            pool = fork_pool(nproc, _set_pool_state, (state,))
+            try:
+                self._apply_tiles(tiles, pool.imap(_pool_flag_tile, tiles))
+            finally:
+                pool.terminate()
+                pool.close()
+
+        self._update_inputs_dq()
+
+    def _apply_tiles(self, tiles, results):
+        """Flag the outliers found in each tile in the DQ of its image."""
+        for (index, row_start, row_stop), crs in zip(tiles, results):
+            dq = self.input_models[index].dq[row_start:row_stop]
+            np.bitwise_or(dq, crs * CRBIT, dq)
+
+    def _update_inputs_dq(self):
         if self.converted:
             # Make sure actual input gets updated with new results
             for i in range(len(self.input_models)):
                 self.inputs.dq[i, :, :] = self.input_models[i].dq
 
 
+def weight_threshold(weight, maskpt):
+    """Find the weight below which a resampled image is masked out.
+
+    The threshold is `maskpt` times the sigma-clipped mean of the non-zero,
+    non-NaN weights.
+    """
+    # Create boolean masks for weight being zero or NaN
+    mask_zero_weight = np.equal(weight, 0.)
+    mask_nans = np.isnan(weight)
+    # Combine the masks
+    weight_masked = np.ma.array(weight, mask=np.logical_or(
+        mask_zero_weight, mask_nans))
+    # Sigma-clip the unmasked data
+    weight_masked = sigma_clip(weight_masked, sigma=3, maxiters=5)
+    mean_weight = np.mean(weight_masked)
+    # Mask pixels where weight falls below maskpt percent
+    threshold = mean_weight * maskpt
+    log.debug("Percentage of pixels with low weight: {}".format(
+        np.sum(np.less(weight, threshold)) / len(weight.flat) * 100))
+    return threshold
+
+
+def rows_per_section(buffer_size, nimages, shape):
+    """Number of rows of the stack of images that fit in `buffer_size` MB.
+
+    Returns all the rows if `buffer_size` is None, and at least one row.
+    """
+    if buffer_size is None:
+        return shape[0]
+    row_bytes = BYTES_PER_MEDIAN_PIXEL * nimages * int(np.prod(shape[1:]))
+    return max(1, int(buffer_size * 2**20 // row_bytes))
+
+
 def flag_cr(sci_image, blot_image, **pars):
     """Masks outliers in science image by updating DQ in-place
 
@@ -380,12 +528,38 @@ def flag_cr(sci_image, blot_image, **pars):
     backg    = 0               # Background value
 
     """
-    grow = pars.get('grow', 1)
-    ctegrow = pars.get('ctegrow', 0)  # not provided by outlierpars
-    backg = pars.get('backg', 0)
+    cr_pars = _flag_cr_pars(pars)
+    subtracted_background = _subtracted_background(sci_image, cr_pars['backg'])
+    exptime = sci_image.meta.exposure.exposure_time
+
+    cr_mask = _cr_mask(sci_image.data * exptime, blot_image.data * exptime,
+                       np.nan_to_num(sci_image.err), subtracted_background,
+                       **cr_pars)
+
+    count_sci = np.count_nonzero(sci_image.dq)
+    count_cr = np.count_nonzero(cr_mask)
+    log.debug("Pixels in input DQ: {}".format(count_sci))
+    log.debug("Pixels in cr_mask:  {}".format(count_cr))
+
+    # Update the DQ array in the input image in place
+    np.bitwise_or(sci_image.dq, np.invert(cr_mask) * CRBIT, sci_image.dq)
+
+
+def _flag_cr_pars(pars):
+    """Parameters of `_cr_mask` from the user parameters of `flag_cr`."""
     snr1, snr2 = [float(val) for val in pars.get('snr', '5.0 4.0').split()]
     scl1, scl2 = [float(val) for val in pars.get('scale', '1.2 0.7').split()]
+    return {
+        'grow': pars.get('grow', 1),
+        'ctegrow': pars.get('ctegrow', 0),  # not provided by outlierpars
+        'backg': pars.get('backg', 0),
+        'snr1': snr1, 'snr2': snr2,
+        'scl1': scl1, 'scl2': scl2,
+    }
 
+
+def _subtracted_background(sci_image, backg):
+    """Background level to add back to the blotted image."""
     # Get background level if it has been subtracted
     if (sci_image.meta.background.subtracted is True and
         sci_image.meta.background.level is not None):
@@ -395,17 +569,20 @@ def flag_cr(sci_image, blot_image, **pars):
     else:
         # No subtracted background.  Allow user-set value, which defaults to 0
         subtracted_background = backg
+    return subtracted_background
 
-    exptime = sci_image.meta.exposure.exposure_time
 
-    sci_data = sci_image.data * exptime
-    blot_data = blot_image.data * exptime
-    blot_deriv = abs_deriv(blot_data)
+def _cr_mask(sci_data, blot_data, err_data, subtracted_background,
+             grow=1, ctegrow=0, backg=0, snr1=5.0, snr2=4.0, scl1=1.2,
+             scl2=0.7):
+    """Mask of the good pixels of the science data, False for outliers.
 
-    err_data = np.nan_to_num(sci_image.err)
+    The science and blotted data are in counts, ``err_data`` has no NaN.
+    """
+    blot_deriv = abs_deriv(blot_data)
 
     # Define output cosmic ray mask to populate
-    cr_mask = np.zeros(sci_image.shape, dtype=np.uint8)
+    cr_mask = np.zeros(sci_data.shape, dtype=np.uint8)
 
     #
     #
@@ -488,15 +665,78 @@ def flag_cr(sci_image, blot_image, **pars):
     # combine masks and cast back to Bool
     np.logical_and(where_cr_ctegrow_kernel_conv,
                    where_cr_grow_kernel_conv, cr_mask)
-    cr_mask = cr_mask.astype(bool)
+    return cr_mask.astype(bool)
 
-    count_sci = np.count_nonzero(sci_image.dq)
-    count_cr = np.count_nonzero(cr_mask)
-    log.debug("Pixels in input DQ: {}".format(count_sci))
-    log.debug("Pixels in cr_mask:  {}".format(count_cr))
 
-    # Update the DQ array in the input image in place
-    np.bitwise_or(sci_image.dq, np.invert(cr_mask) * CRBIT, sci_image.dq)
+def _tile_halo(grow, ctegrow):
+    """Number of rows needed on each side of a tile by `_cr_mask`.
+
+    The mask of a pixel depends on the pixels up to 2 rows away through
+    the derivative and the 3x3 convolution, and on the pixels up to
+    ``grow`` or ``ctegrow`` rows away through the growth of the mask.
+    """
+    return 2 + max(grow, ctegrow)
+
+
+def _flag_tile(state, index, row_start, row_stop):
+    """Find the outliers in rows `row_start` to `row_stop` of an image.
+
+    The median is blotted onto the rows of the tile and some rows on each
+    side of it, so that the outliers are the same as when the whole image
+    is flagged.  Rows past the edges of the image are not added, so the
+    tiles on the edges are handled as the edges of the whole image.
+
+    Parameters
+    ----------
+    state : tuple
+        The median data and WCS, the ``(data, err, wcs, exptime,
+        subtracted_background)`` of each image and the user parameters.
+    index : int
+        Index of the image in the images of `state`.
+    row_start, row_stop : int
+        Rows of the tile.
+
+    Returns
+    -------
+    crs : ndarray
+        Boolean array of shape ``(row_stop - row_start, ncols)``, True for
+        the outliers.
+    """
+    median_data, median_wcs, images, pars = state
+    data, err, blot_wcs, exptime, subtracted_background = images[index]
+    cr_pars = _flag_cr_pars(pars)
+
+    halo = _tile_halo(cr_pars['grow'], cr_pars['ctegrow'])
+    nrows, ncols = data.shape
+    ext_start = max(0, row_start - halo)
+    ext_stop = min(nrows, row_stop + halo)
+
+    # Pixel map of the rows, as made by calc_gwcs_pixmap for the whole image
+    y, x = np.mgrid[ext_start:ext_stop, 0:ncols].astype(np.float64)
+    pixmap = np.dstack(reproject(blot_wcs, median_wcs)(x, y))
+    pixmap[np.isnan(pixmap)] = -1
+
+    blot_data = np.zeros((ext_stop - ext_start, ncols), dtype=np.float32)
+    tblot(median_data, pixmap, blot_data, scale=1, kscale=1.0,
+          interp=pars.get('interp', 'poly5'), exptime=1.0, misval=0.0,
+          sinscl=pars.get('sinscl', 1.0))
+
+    rows = slice(ext_start, ext_stop)
+    cr_mask = _cr_mask(data[rows] * exptime, blot_data * exptime,
+                       np.nan_to_num(err[rows]), subtracted_background,
+                       **cr_pars)
+
+    core = slice(row_start - ext_start, row_stop - ext_start)
+    return np.logical_not(cr_mask[core])
+
+
+def _set_pool_state(state):
+    global _pool_state
+    _pool_state = state
+
+
+def _pool_flag_tile(tile):
+    return _flag_tile(_pool_state, *tile)
 
 
 def abs_deriv(array):
@@ -108,6 +108,13 @@ class OutlierDetectionSpec(OutlierDetection):
                      median_model.meta.filename))
             median_model.save(median_model.meta.filename)
 
+        if self.use_tiles():
+            # Blot the median image and flag the outliers one tile of rows
+            # at a time, without making the full-frame blotted images
+            self.blot_and_flag(median_model)
+            del median_model
+            return
+
         if pars['resample_data'] is True:
             # Blot the median image back to recreate each input image specified
             # in the original input list/ASN/ModelContainer
@@ -62,6 +62,9 @@ class OutlierDetectionStep(Step):
         good_bits = integer(default=6)
         scale_detection = boolean(default=False)
         search_output_file = boolean(default=False)
+        buffer_size = float(default=None, min=0) # MB for computing the median in sections; resampled images are kept on disk
+        maximum_cores = option('quarter', 'half', 'all', default=None) # max number of processes computing pixel maps and tiles
+        tile_rows = integer(default=None, min=1) # number of rows of the tiles the median is blotted and the outliers flagged in
     """
 
     def process(self, input):
@@ -107,6 +110,9 @@ class OutlierDetectionStep(Step):
                 'save_intermediate_results': self.save_intermediate_results,
                 'resample_data': self.resample_data,
                 'good_bits': self.good_bits,
+                'buffer_size': self.buffer_size,
+                'maximum_cores': self.maximum_cores,
+                'tile_rows': self.tile_rows,
                 'make_output_path': self.make_output_path,
             }
 
@@ -1,8 +1,14 @@
+import os
+
 import pytest
 import numpy as np
+from astropy.modeling.models import Shift
+from gwcs.wcs import WCS
 from scipy.ndimage.filters import gaussian_filter
 
-from jwst.outlier_detection.outlier_detection import flag_cr
+from jwst.outlier_detection import outlier_detection
+from jwst.outlier_detection.outlier_detection import (flag_cr, OutlierDetection,
+                                                      rows_per_section)
 from jwst import datamodels
 
 
@@ -54,3 +60,124 @@ def test_flag_cr_with_subtracted_background(sci_blot_image_pair):
 
     flag_cr(sci, blot)
     assert sci.dq[5, 5] > 0
+
+
+@pytest.mark.parametrize("buffer_size", [None, 0.001, 1.0])
+def test_create_median_in_sections(buffer_size):
+    """The median computed in sections matches the median of whole images"""
+    shape = (21, 17)
+    rng = np.random.RandomState(0)
+    models = datamodels.ModelContainer()
+    for i in range(5):
+        model = datamodels.ImageModel(shape)
+        model.data = rng.normal(size=shape).astype(np.float32)
+        model.wht = rng.uniform(0.5, 1.5, size=shape).astype(np.float32)
+        model.wht[i, :] = 0.
+        models.append(model)
+
+    expected = OutlierDetection(models, reffiles={}).create_median(models)
+    step = OutlierDetection(models, reffiles={}, buffer_size=buffer_size)
+    result = step.create_median(models)
+
+    np.testing.assert_array_equal(result, expected)
+
+
+def test_rows_per_section():
+    assert rows_per_section(None, 10, (100, 50)) == 100
+    # 1 MB holds 2**20 / (16 * 4 * 1024) = 16 rows of 4 images
+    assert rows_per_section(1.0, 4, (2048, 1024)) == 16
+    # always at least one row
+    assert rows_per_section(1e-6, 4, (2048, 1024)) == 1
+
+
+@pytest.mark.parametrize("tile_rows, grow, maximum_cores", [
+    (1, 1, None), (4, 1, None), (7, 3, None), (50, 1, None), (5, 2, 'all')
+])
+def test_blot_and_flag_in_tiles(tile_rows, grow, maximum_cores):
+    """Outliers flagged in tiles are those flagged on the whole images"""
+    shape = (23, 19)
+    rng = np.random.RandomState(0)
+    median_model = datamodels.ImageModel(shape)
+    median_model.data = gaussian_filter(rng.normal(size=shape), sigma=2) * 5
+    median_model.meta.wcs = WCS(Shift(0.5) & Shift(-0.5), output_frame='world')
+
+    models = datamodels.ModelContainer()
+    for i in range(3):
+        model = datamodels.ImageModel(shape)
+        model.meta.filename = 'image{}_cal.fits'.format(i)
+        model.meta.exposure.exposure_time = 10.
+        model.data = median_model.data + rng.normal(scale=0.1, size=shape)
+        model.data[rng.randint(shape[0], size=5),
+                   rng.randint(shape[1], size=5)] += 50.
+        model.err = np.full(shape, 0.1, dtype=np.float32)
+        model.meta.wcs = WCS(Shift(0.3 * i) & Shift(-0.2 * i),
+                             output_frame='world')
+        models.append(model)
+    pars = {'grow': grow, 'snr': '4.0 3.0', 'scale': '0.5 0.4',
+            'resample_data': True, 'save_intermediate_results': False,
+            'good_bits': 4}
+
+    whole = OutlierDetection(models.copy(), reffiles={}, **pars)
+    whole._convert_inputs()
+    whole.detect_outliers(whole.blot_median(median_model))
+
+    tiled = OutlierDetection(models.copy(), reffiles={}, tile_rows=tile_rows,
+                             maximum_cores=maximum_cores, **pars)
+    tiled._convert_inputs()
+    assert tiled.use_tiles()
+    tiled.blot_and_flag(median_model)
+
+    for expected, result in zip(whole.input_models, tiled.input_models):
+        assert np.count_nonzero(expected.dq) > 0
+        np.testing.assert_array_equal(result.dq, expected.dq)
+
+
+@pytest.mark.parametrize("failing", ["drizzle", "median"])
+def test_single_dir_removed_on_error(monkeypatch, tmpdir, failing):
+    """The resampled images on disk are closed and removed when the
+    drizzle or the median fails"""
+    single_dir = str(tmpdir.mkdir('single'))
+    closed = []
+
+    class ClosingModel(datamodels.ImageModel):
+        def close(self):
+            closed.append(self.meta.filename)
+            super().close()
+
+    class FakeResampleData:
+        def __init__(self, input_models, single_dir=None, **pars):
+            self.input_models = input_models
+            self.single_dir = single_dir
+            self.output_models = datamodels.ModelContainer()
+
+        def do_drizzle(self):
+            for i, model in enumerate(self.input_models):
+                path = os.path.join(self.single_dir, 'single_{:04d}.fits'.format(i))
+                model.save(path)
+                self.output_models.append(ClosingModel(path))
+                if failing == "drizzle" and i == 1:
+                    raise RuntimeError("drizzle failed")
+
+    def failing_median(self, resampled_models):
+        raise RuntimeError("median failed")
+
+    monkeypatch.setattr(outlier_detection.tempfile, 'mkdtemp',
+                        lambda prefix: single_dir)
+    monkeypatch.setattr(outlier_detection.resample, 'ResampleData',
+                        FakeResampleData)
+    monkeypatch.setattr(OutlierDetection, 'create_median', failing_median)
+
+    models = datamodels.ModelContainer()
+    for i in range(3):
+        model = datamodels.ImageModel((5, 6))
+        model.meta.filename = 'image{}_cal.fits'.format(i)
+        models.append(model)
+    step = OutlierDetection(models, reffiles={}, resample_data=True,
+                            buffer_size=1.0, save_intermediate_results=False,
+                            good_bits=4)
+
+    with pytest.raises(RuntimeError, match=failing):
+        step.do_detection()
+
+    assert not os.path.exists(single_dir)
+    assert len(set(closed)) == (2 if failing == "drizzle" else 3)
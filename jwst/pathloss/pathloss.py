@@ -3,8 +3,7 @@
 import math
 import numpy as np
 import logging
-from jwst.assign_wcs import nirspec, util
-from gwcs import wcstools
+from jwst.assign_wcs import util, wcs_cache
 
 log = logging.getLogger(__name__)
 log.setLevel(logging.DEBUG)
@@ -331,13 +330,11 @@ def do_correction(input_model, pathloss_model):
         wavelength_array = np.zeros(input_model.shape, dtype=np.float32)
         wavelength_array.fill(np.nan)
         for slice in NIRSPEC_IFU_SLICES:
-            slice_wcs = nirspec.nrs_wcs_set_input(input_model, slice)
-            x, y = wcstools.grid_from_bounding_box(slice_wcs.bounding_box)
+            x, y, ra, dec, wavelength = wcs_cache.slit_coordinates(input_model, slice)
             xmin = int(x.min())
             xmax = int(x.max())
             ymin = int(y.min())
             ymax = int(y.max())
-            ra, dec, wavelength = slice_wcs(x, y)
             wavelength_array[ymin:ymax+1, xmin:xmax+1] = wavelength
 
         # Compute the pathloss 2D correction
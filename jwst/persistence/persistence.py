@@ -15,6 +15,49 @@ SCALEFACTOR = 2.
 from traps, compared with photon-generated charges.
 """
 
+BYTES_PER_GROUP = 24
+"""Approximate number of bytes of the temporary arrays used for each group
+of each pixel while computing the slope and the charge capture.
+"""
+
+
+def rows_per_chunk(max_chunk_memory, ngroups, nfamilies, ncols, itemsize):
+    """Compute the number of rows per chunk for which the work arrays fit
+    within the given memory budget.
+
+    Parameters
+    ----------
+    max_chunk_memory : float or None
+        Memory budget in MB for the work arrays of a chunk; None means no
+        limit.
+
+    ngroups : int
+        The number of groups per integration.
+
+    nfamilies : int
+        The number of trap families.
+
+    ncols : int
+        The number of columns of the detector.
+
+    itemsize : int
+        The number of bytes of each element of the working arrays.
+
+    Returns
+    -------
+    int or None
+        The number of rows in each chunk, at least 1; None if there is no
+        limit.
+    """
+
+    if max_chunk_memory is None:
+        return None
+
+    bytes_per_row = ncols * (ngroups * BYTES_PER_GROUP
+                             + (nfamilies + 4) * itemsize)
+    return max(1, int(max_chunk_memory * 1024 * 1024 / bytes_per_row))
+
+
 def no_NaN(input_model, fill_value,
            zap_nan=False, zap_zero=False):
     """Replace NaNs and/or zeros with a fill value.
@@ -111,12 +154,20 @@ class DataSet():
 
     nresets : int
         The number of resets (frames) at the beginning of each integration.
+
+    max_chunk_memory : float or None
+        If not None, the detector is processed in chunks of rows whose
+        work arrays take about `max_chunk_memory` MB.
+
+    working_dtype : numpy dtype
+        Type of the arrays in which decays and persistence are accumulated.
     """
 
     def __init__(self, output_obj, input_traps_filled,
                  flag_pers_cutoff, save_persistence,
                  trap_density_model, trappars_model,
-                 persat_model):
+                 persat_model, max_chunk_memory=None,
+                 working_dtype=np.float64):
 
         """Assign values to attributes.
 
@@ -149,6 +200,15 @@ class DataSet():
 
         persat_model : persistence saturation model
             Persistence saturation limit (full well) reference file.
+
+        max_chunk_memory : float or None
+            If not None, the memory budget in MB for the work arrays of a
+            chunk of rows.  The default is to process the whole detector
+            at once.
+
+        working_dtype : numpy dtype
+            Type of the arrays in which decays and persistence are
+            accumulated, np.float64 (the default) or np.float32.
         """
 
         log.debug("input_traps_filled = %s", str(input_traps_filled))
@@ -164,6 +224,8 @@ class DataSet():
         self.trap_density = trap_density_model
         self.trappars_model = trappars_model
         self.persistencesat = persat_model
+        self.max_chunk_memory = max_chunk_memory
+        self.working_dtype = np.dtype(working_dtype)
 
         # These will be populated from metadata.
         self.tframe = 0.
@@ -212,10 +274,7 @@ class DataSet():
         if nfamilies <= 0:
             log.error("The trappars reference table is empty!")
 
-        # Note that this might be a subarray.
-        persistence = np.zeros((shape[-2], shape[-1]), dtype=np.float64)
         (nints, ngroups, ny, nx) = shape
-        t_group = self.output_obj.meta.exposure.group_time
 
         # The trap density image is full-frame, so use it to get the shape of
         # a full-frame array.  traps_filled is also full-frame, but we can't
@@ -245,9 +304,9 @@ class DataSet():
         self.persistencesat = no_NaN(self.persistencesat, 1.e7, zap_nan=True)
 
         if have_traps_filled:   # was there an actual traps_filled file?
-            # Decrease traps_filled by the number of traps that decayed
-            # in the time (to_start) from the end of the traps_filled file
-            # to the start of the current exposure.
+            # traps_filled will be decreased by the number of traps that
+            # decayed in the time (to_start) from the end of the
+            # traps_filled file to the start of the current exposure.
             # Note that to_start includes the reset (if any) at the
             # beginning of the exposure, because meta.exposure.start_time
             # is the time when the actual exposure started, not the time
@@ -259,20 +318,16 @@ class DataSet():
                         - self.traps_filled.meta.exposure.end_time) * 86400.
             log.debug("Decay time for previous traps-filled file = %g s",
                       to_start)
-            for k in range(nfamilies):
-                decay_param_k = self.get_decay_param(par, k)
-                decay = self.compute_decay(self.traps_filled.data[k],
-                                           decay_param_k, to_start)
-                self.traps_filled.data[k, :, :] -= decay
-                del decay
+        else:
+            to_start = None
 
         """
         These will be full-frame:
             self.traps_filled           (nfamilies, det_ny, det_nx)
             self.trap_density (before extracting subarray)
             self.persistencesat (before extracting subarray)
-            decayed                     (nfamilies, det_ny, det_nx)
-            decayed_in_group            (det_ny, det_nx)
+            decayed                     (nfamilies, chunk_rows, det_nx)
+            decayed_in_group            (chunk_rows, det_nx)
 
         These will be subarrays if the input object is a subarray:
             self.output_obj             (nints, ngroups, ny, nx)
@@ -321,20 +376,122 @@ class DataSet():
         else:
             self.output_pers = None
 
-        # Buffer for accumulating the number of decayed traps from the
-        # start of an integration to the current group (in the loop below).
-        decayed = np.zeros((nfamilies, det_ny, det_nx), dtype=np.float64)
+        # The pixels are independent of each other, so the detector can be
+        # processed in chunks of rows, each through all the integrations.
+        chunk_rows = rows_per_chunk(self.max_chunk_memory, ngroups,
+                                    nfamilies, det_nx,
+                                    self.working_dtype.itemsize)
+        if chunk_rows is None or chunk_rows >= det_ny:
+            chunk_rows = det_ny
+        else:
+            log.info("Processing chunks of %d rows", chunk_rows)
+
+        # Buffers, reused for every chunk.
+        # decayed accumulates the number of decayed traps from the start
+        # of an integration to the current group; decayed_in_group is for
+        # the current trap family and group.  persistence is the sum of
+        # decayed over trap families, for the science pixels of the chunk.
+        # filled and cr_filled are the traps that captured a charge during
+        # an integration, in total and due to cosmic-ray jumps.
+        buffers = {'decayed': np.zeros((nfamilies, chunk_rows, det_nx),
+                                       dtype=self.working_dtype),
+                   'decayed_in_group':
+                       np.zeros((chunk_rows, det_nx),
+                                dtype=self.traps_filled.data.dtype),
+                   'persistence': np.zeros((chunk_rows, nx),
+                                           dtype=self.working_dtype),
+                   'filled': np.zeros((chunk_rows, nx),
+                                      dtype=self.working_dtype),
+                   'cr_filled': np.zeros((chunk_rows, nx),
+                                         dtype=self.trap_density.data.dtype)}
+
+        for row0 in range(0, det_ny, chunk_rows):
+            det_rows = slice(row0, min(row0 + chunk_rows, det_ny))
+            self.correct_chunk(par, det_rows, save_slice, to_start, buffers)
+
+        # Update the start and end times (and other stuff) in the
+        # traps_filled image to the times for the current exposure.
+        self.traps_filled.update(self.output_obj, only="PRIMARY")
+
+        # meta.filename of traps_filled is now the name of the science file
+        # that was passed as input to this step.  This is good, since we're
+        # going to write traps_filled out, and the output name should be
+        # related to the output science file name.
+
+        if self.save_persistence:
+            self.output_pers.update(self.output_obj, only="PRIMARY")
+
+        return (self.output_obj, self.traps_filled, self.output_pers, skipped)
 
-        # self.traps_filled will be updated with each integration, to
-        # account for charge capture and decay of traps.
-        filled = -1                             # just to ensure that it exists
+
+    def correct_chunk(self, par, det_rows, save_slice, to_start, buffers):
+        """Apply the persistence correction to a chunk of detector rows.
+
+        Parameters
+        ----------
+        par : tuple of ndarray
+            The columns of the trap parameters reference table.
+
+        det_rows : slice
+            The rows of the detector (i.e. of `self.traps_filled`) in the
+            chunk.
+
+        save_slice : tuple of two slice objects
+            The Y and X slices of the science data in `self.traps_filled`.
+
+        to_start : float or None
+            The time (seconds) from the end of the input traps_filled file
+            to the start of the current exposure, or None if there was no
+            input traps_filled file.
+
+        buffers : dict
+            Preallocated work arrays, with at least as many rows as the
+            chunk:  "decayed", "decayed_in_group", "persistence", "filled"
+            and "cr_filled".
+        """
+
+        (nints, ngroups, ny, nx) = self.output_obj.data.shape
+        nfamilies = len(par[0])
+        t_group = self.output_obj.meta.exposure.group_time
+
+        # The rows of the science data in the chunk, as rows of the science
+        # data and as rows of the chunk.
+        first = max(det_rows.start, save_slice[0].start)
+        last = min(det_rows.stop, save_slice[0].stop)
+        have_science = (first < last)
+        sci_rows = slice(first - save_slice[0].start,
+                         last - save_slice[0].start)
+        chunk_sci = (slice(first - det_rows.start, last - det_rows.start),
+                     save_slice[1])
+
+        nrows = det_rows.stop - det_rows.start
+        traps_filled = self.traps_filled.data[:, det_rows, :]
+        decayed = buffers['decayed'][:, :nrows, :]
+        decayed_in_group = buffers['decayed_in_group'][:nrows, :]
+        persistence = buffers['persistence'][:max(last - first, 0), :]
+        filled = buffers['filled'][:max(last - first, 0), :]
+        cr_filled = buffers['cr_filled'][:max(last - first, 0), :]
+        trap_density = self.trap_density.data[sci_rows, :]
+
+        if to_start is not None:
+            # Decrease traps_filled by the number of traps that decayed
+            # before the start of the current exposure.
+            for k in range(nfamilies):
+                decay_param_k = self.get_decay_param(par, k)
+                self.compute_decay(traps_filled[k], decay_param_k, to_start,
+                                   out=decayed_in_group)
+                traps_filled[k, :, :] -= decayed_in_group
+
+        # traps_filled will be updated with each integration, to account
+        # for charge capture and decay of traps.
         for integ in range(nints):
             self.get_group_info(integ)          # self.tgroup, etc.
             decayed[:, :, :] = 0.               # initialize
             # slope has to be computed early in the loop over integrations,
             # before the data are modified by subtracting persistence.
             # The slope is needed for computing charge captures.
-            (grp_slope, slope) = self.compute_slope(integ)
+            if have_science:
+                (grp_slope, slope) = self.compute_slope(integ, sci_rows)
             for group in range(ngroups):
                 persistence[:, :] = 0.          # initialize
                 for k in range(nfamilies):
@@ -344,61 +501,42 @@ class DataSet():
                     # first integration have already been accounted for.
                     if integ > 0 and group == 0 and self.nresets > 0:
                         reset_time = self.tframe * self.nresets
-                        decay_during_reset = \
-                            self.compute_decay(self.traps_filled.data[k],
-                                               decay_param_k, reset_time)
-                        self.traps_filled.data[k, :, :] -= decay_during_reset
+                        self.compute_decay(traps_filled[k], decay_param_k,
+                                           reset_time, out=decayed_in_group)
+                        traps_filled[k, :, :] -= decayed_in_group
                     # Decays during current group, for current trap family.
-                    decayed_in_group = \
-                        self.compute_decay(self.traps_filled.data[k],
-                                           decay_param_k, t_group)
+                    self.compute_decay(traps_filled[k], decay_param_k,
+                                       t_group, out=decayed_in_group)
                     # Cumulative decay to the end of the current group.
                     decayed[k, :, :] += decayed_in_group
-                    self.traps_filled.data[k, :, :] -= decayed_in_group
-                    if is_subarray:
-                        persistence += decayed[k, save_slice[0], save_slice[1]]
-                    else:
-                        persistence += decayed[k, :, :]
-                    del decayed_in_group
+                    traps_filled[k, :, :] -= decayed_in_group
+                    if have_science:
+                        persistence += decayed[k][chunk_sci]
 
+                if not have_science:
+                    continue
                 # Persistence was computed in DN.
-                self.output_obj.data[integ, group, :, :] -= persistence
+                self.output_obj.data[integ, group, sci_rows, :] -= persistence
                 if self.save_persistence:
-                    self.output_pers.data[integ, group, :, :] = \
-                        persistence.copy()
+                    self.output_pers.data[integ, group, sci_rows, :] = \
+                        persistence
                 if persistence.max() >= self.flag_pers_cutoff:
                     mask = (persistence >= self.flag_pers_cutoff)
-                    self.output_obj.pixeldq[mask] |= dqflags.pixel['DO_NOT_USE']
+                    pixeldq = self.output_obj.pixeldq[sci_rows, :]
+                    pixeldq[mask] |= dqflags.pixel['DO_NOT_USE']
 
+            if not have_science:
+                continue
             # Update traps_filled with the number of traps that captured
             # a charge during the current integration.
             for k in range(nfamilies):
                 capture_param_k = self.get_capture_param(par, k)
                 # This may be a subarray.
-                filled = self.predict_capture(capture_param_k,
-                                              self.trap_density.data,
-                                              integ, grp_slope, slope)
-                if is_subarray:
-                    self.traps_filled.data[k, save_slice[0],
-                                              save_slice[1]] += filled
-                else:
-                    self.traps_filled.data[k, :, :] += filled
-
-        del filled
-
-        # Update the start and end times (and other stuff) in the
-        # traps_filled image to the times for the current exposure.
-        self.traps_filled.update(self.output_obj, only="PRIMARY")
-
-        # meta.filename of traps_filled is now the name of the science file
-        # that was passed as input to this step.  This is good, since we're
-        # going to write traps_filled out, and the output name should be
-        # related to the output science file name.
-
-        if self.save_persistence:
-            self.output_pers.update(self.output_obj, only="PRIMARY")
-
-        return (self.output_obj, self.traps_filled, self.output_pers, skipped)
+                self.predict_capture(capture_param_k, trap_density,
+                                     integ, grp_slope, slope,
+                                     rows=sci_rows, out=filled,
+                                     cr_out=cr_filled)
+                traps_filled[k][chunk_sci] += filled
 
 
     def get_slice(self, ref, sci):
@@ -535,7 +673,7 @@ class DataSet():
         return (par0, par1, par2, par3)
 
 
-    def compute_slope(self, integ):
+    def compute_slope(self, integ, rows=slice(None)):
         """Compute an estimate of the slope of the ramp for each pixel.
 
         Extended Summary
@@ -563,6 +701,10 @@ class DataSet():
         integ : int
             The number (index) of the current integration.
 
+        rows : slice
+            The rows of the science data for which to compute the slope.
+            The default is all rows.
+
         Returns
         -------
         grp_slope : ndarray, 2-D
@@ -573,30 +715,34 @@ class DataSet():
             saturation limit per second.
         """
 
-        (_, ngroups, ny, nx) = self.output_obj.shape
+        ngroups = self.output_obj.shape[1]
+        persat_data = self.persistencesat.data[rows, :]
+        if hasattr(self.persistencesat, "dq"):
+            persat_dq = self.persistencesat.dq[rows, :]
         if ngroups == 1:
             # This won't be accurate, because there's only one group.
-            grp_slope = self.output_obj.data[integ, 0, :, :]
+            grp_slope = self.output_obj.data[integ, 0, rows, :]
             if hasattr(self.persistencesat, "dq"):
-                mask = (np.bitwise_and(self.persistencesat.dq,
+                mask = (np.bitwise_and(persat_dq,
                                        dqflags.pixel["DO_NOT_USE"]) > 0)
                 if mask.sum() == 0:
                     mask = None
             else:
                 mask = None
             if mask is None:
-                slope = grp_slope / (self.persistencesat.data * self.tgroup)
+                slope = grp_slope / (persat_data * self.tgroup)
             else:
                 # Set to 1 so we don't divide by 0.
-                persat = np.where(mask, 1., self.persistencesat.data)
+                persat = np.where(mask, 1., persat_data)
                 slope = np.where(mask, 0.,
                                  grp_slope / (persat * self.tgroup))
             return (grp_slope, slope)
 
         gdqflags = dqflags.group
 
-        data = self.output_obj.data[integ, :, :, :]
-        gdq = self.output_obj.groupdq[integ, :, :, :]
+        data = self.output_obj.data[integ, :, rows, :]
+        gdq = self.output_obj.groupdq[integ, :, rows, :]
+        (_, ny, nx) = data.shape
 
         # This assumes that the jump step has already been run, so that
         # CR jumps will have been flagged in the groupdq extension.
@@ -644,17 +790,17 @@ class DataSet():
         # slope will have units (DN / persistence_saturation_limit) / second,
         # where persistence_saturation_limit is in units of DN.
         if hasattr(self.persistencesat, "dq"):
-            mask = (np.bitwise_and(self.persistencesat.dq,
+            mask = (np.bitwise_and(persat_dq,
                                    dqflags.pixel["DO_NOT_USE"]) > 0)
             if mask.sum() == 0:
                 mask = None
         else:
             mask = None
         if mask is None:
-            slope = grp_slope / (self.persistencesat.data * self.tgroup)
+            slope = grp_slope / (persat_data * self.tgroup)
         else:
             # Set to 1 so we don't divide by 0.
-            persat = np.where(mask, 1., self.persistencesat.data)
+            persat = np.where(mask, 1., persat_data)
             slope = np.where(mask, 0.,
                              grp_slope / (persat * self.tgroup))
 
@@ -755,7 +901,8 @@ class DataSet():
 
 
     def predict_capture(self, capture_param_k, trap_density, integ,
-                        grp_slope, slope):
+                        grp_slope, slope, rows=slice(None), out=None,
+                        cr_out=None):
         """Compute the number of traps that will be filled in time dt.
 
         This is based on Michael Regan's trapcapturemodel.pro.
@@ -786,13 +933,25 @@ class DataSet():
             fraction of the persistence saturation limit per second.
             This is the same as `grp_slope` except for units.
 
+        rows : slice
+            The rows of the science data that `trap_density`, `grp_slope`
+            and `slope` are for.  The default is all rows.
+
+        out : ndarray, 2-D, optional
+            If given, the result is written to this array instead of a
+            new one.
+
+        cr_out : ndarray, 2-D, optional
+            Work array for the traps filled due to cosmic-ray jumps; it is
+            passed to `delta_fcn_capture` as `out`.
+
         Returns
         -------
         ndarray, 2-D
             The computed traps_filled at the end of the integration.
         """
 
-        data = self.output_obj.data[integ, :, :, :]
+        data = self.output_obj.data[integ, :, rows, :]
 
         t_frame = self.tframe
         t_group = self.tgroup
@@ -805,9 +964,9 @@ class DataSet():
         totaltime = ngroups * t_group + nresets * t_frame
 
         # Find pixels exceeding the persistence saturation limit (full well).
-        pflag = (data > self.persistencesat.data)
+        pflag = (data > self.persistencesat.data[rows, :])
         if hasattr(self.persistencesat, "dq"):
-            mask = (np.bitwise_and(self.persistencesat.dq,
+            mask = (np.bitwise_and(self.persistencesat.dq[rows, :],
                                    dqflags.pixel["DO_NOT_USE"]) > 0)
             mshape = mask.shape
             mask = mask.reshape((1,) + mshape)
@@ -826,7 +985,11 @@ class DataSet():
                                 capture_param_k,
                                 trap_density, slope, dt)
 
-        filled = ramp_traps_filled.copy()
+        if out is None:
+            filled = ramp_traps_filled.copy()
+        else:
+            filled = out
+            filled[...] = ramp_traps_filled
         mask = (sat_count > 0)
         any_saturated = np.any(mask)
         if any_saturated:
@@ -842,7 +1005,8 @@ class DataSet():
         cr_filled = self.delta_fcn_capture(
                                 capture_param_k,
                                 trap_density, integ,
-                                grp_slope, ngroups, t_group)
+                                grp_slope, ngroups, t_group, rows=rows,
+                                out=cr_out)
         filled += cr_filled
 
         return filled
@@ -973,7 +1137,8 @@ class DataSet():
 
 
     def delta_fcn_capture(self, capture_param_k, trap_density, integ,
-                          grp_slope, ngroups, t_group):
+                          grp_slope, ngroups, t_group, rows=slice(None),
+                          out=None):
         """Compute number of traps filled due to cosmic-ray jumps.
 
         Extended Summary
@@ -1014,6 +1179,14 @@ class DataSet():
             The time (seconds) from the start of one group to the start
             of the next group.
 
+        rows : slice
+            The rows of the science data that `trap_density` and
+            `grp_slope` are for.  The default is all rows.
+
+        out : ndarray, 2-D, optional
+            If given, the result is written to this array instead of a
+            new one.
+
         Returns
         -------
         ndarray, 2-D
@@ -1023,9 +1196,13 @@ class DataSet():
         (par0, par1, par2) = capture_param_k
         # cr_filled will be incremented group-by-group, depending on
         # where cosmic rays were found in each group.
-        cr_filled = np.zeros_like(trap_density)
-        data = self.output_obj.data[integ, :, :, :]
-        gdq = self.output_obj.groupdq[integ, :, :, :]
+        if out is None:
+            cr_filled = np.zeros_like(trap_density)
+        else:
+            cr_filled = out
+            cr_filled[...] = 0.
+        data = self.output_obj.data[integ, :, rows, :]
+        gdq = self.output_obj.groupdq[integ, :, rows, :]
         gdqflags = dqflags.group
 
         # If there's a CR hit in the first group, we can't determine its
@@ -1053,7 +1230,7 @@ class DataSet():
         return cr_filled
 
 
-    def compute_decay(self, traps_filled, decay_param, delta_t):
+    def compute_decay(self, traps_filled, decay_param, delta_t, out=None):
         """Compute the number of trap decays.
 
         This is based on Michael Regan's trapdecay.pro.
@@ -1073,6 +1250,10 @@ class DataSet():
             The time interval (unit = second) over which the trap decay
             is to be computed.
 
+        out : ndarray, 2-D, optional
+            If given, the result is written to this array instead of a
+            new one.
+
         Returns
         -------
         decayed : ndarray, 2-D
@@ -1081,9 +1262,10 @@ class DataSet():
         """
 
         if decay_param == 0.:
-            decayed = traps_filled * 0.
+            decayed = np.multiply(traps_filled, 0., out=out)
         else:
             tau = 1. / abs(decay_param)
-            decayed = traps_filled * (1. - math.exp(-delta_t / tau))
+            decayed = np.multiply(traps_filled, (1. - math.exp(-delta_t / tau)),
+                                  out=out)
 
         return decayed
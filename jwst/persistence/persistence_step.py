@@ -27,6 +27,11 @@ class PersistenceStep(Step):
         # If `save_trapsfilled` is True, the updated trapsfilled file will
         # be written to an output file with suffix "_trapsfilled".
         save_trapsfilled = boolean(default=True)
+        # If `max_chunk_memory` (MB) is given, the detector is processed in
+        # chunks of rows whose work arrays fit within that budget.
+        max_chunk_memory = float(default=None, min=0)
+        # Precision of the arrays in which persistence is accumulated.
+        working_precision = option('float64', 'float32', default='float64')
     """
 
     reference_file_types = ["trapdensity", "trappars", "persat"]
@@ -83,7 +88,9 @@ class PersistenceStep(Step):
                                      self.flag_pers_cutoff,
                                      self.save_persistence,
                                      trap_density_model, trappars_model,
-                                     persat_model)
+                                     persat_model,
+                                     max_chunk_memory=self.max_chunk_memory,
+                                     working_dtype=self.working_precision)
         (output_obj, traps_filled, output_pers, skipped) = pers_a.do_all()
         if skipped:
             output_obj.meta.cal_step.persistence = 'SKIPPED'
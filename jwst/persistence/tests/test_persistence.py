@@ -0,0 +1,155 @@
+import numpy as np
+import pytest
+
+from jwst import datamodels
+from jwst.datamodels import dqflags
+from jwst.persistence import persistence
+
+NINTS = 2
+NGROUPS = 6
+DET_SHAPE = (37, 20)
+NFAMILIES = 3
+
+
+def make_dataset(subarray, traps_filled, max_chunk_memory=None,
+                 working_dtype=np.float64):
+    """Persistence DataSet of ramps with saturated pixels and jumps."""
+    rng = np.random.RandomState(7)
+    (det_ny, det_nx) = DET_SHAPE
+    if subarray:
+        (ystart, xstart, ny, nx) = (6, 3, 25, 14)
+    else:
+        (ystart, xstart, ny, nx) = (1, 1, det_ny, det_nx)
+    shape = (NINTS, NGROUPS, ny, nx)
+
+    rate = rng.uniform(10., 400., size=(ny, nx))
+    data = (rate * np.arange(1, NGROUPS + 1)[:, np.newaxis, np.newaxis]
+            + rng.normal(scale=5., size=(NINTS, NGROUPS, ny, nx)))
+    groupdq = np.zeros(shape, dtype=np.uint8)
+    jumps = rng.random_sample(shape) < 0.02
+    jumps[:, 0] = False
+    groupdq[jumps] = dqflags.group['JUMP_DET']
+    data += np.cumsum(jumps * 300., axis=1)
+
+    model = datamodels.RampModel(data=data.astype(np.float32),
+                                 groupdq=groupdq,
+                                 pixeldq=np.zeros((ny, nx), dtype=np.uint32))
+    model.meta.instrument.name = 'NIRCAM'
+    model.meta.instrument.detector = 'NRCA1'
+    model.meta.subarray.xstart = xstart
+    model.meta.subarray.ystart = ystart
+    model.meta.subarray.xsize = nx
+    model.meta.subarray.ysize = ny
+    model.meta.exposure.frame_time = 10.7
+    model.meta.exposure.group_time = 10.7
+    model.meta.exposure.ngroups = NGROUPS
+    model.meta.exposure.nframes = 1
+    model.meta.exposure.groupgap = 0
+    model.meta.exposure.nresets_at_start = 1
+    model.meta.exposure.nresets_between_ints = 1
+    model.meta.exposure.start_time = 58000.1
+
+    trap_density = datamodels.TrapDensityModel(
+        data=rng.uniform(0.5, 2., size=DET_SHAPE).astype(np.float32))
+    persat = datamodels.PersistenceSatModel(
+        data=np.full(DET_SHAPE, 1500., dtype=np.float32))
+    for ref in (trap_density, persat):
+        ref.meta.subarray.xstart = 1
+        ref.meta.subarray.ystart = 1
+    trap_density.dq[0, 2] = dqflags.pixel['DO_NOT_USE']
+    persat.dq[3, 4] = dqflags.pixel['DO_NOT_USE']
+
+    trappars = datamodels.TrapParsModel()
+    trappars.trappars_table = np.array(
+        [(1.5, -0.001, 0.02, -0.0003),
+         (0.8, -0.0002, 0.01, -0.00003),
+         (0.3, -0.05, 0.0, 0.)],
+        dtype=[('capture0', '<f8'), ('capture1', '<f8'),
+               ('capture2', '<f8'), ('decay_param', '<f8')])
+
+    if traps_filled:
+        input_traps = datamodels.TrapsFilledModel(
+            data=rng.uniform(0., 50., size=(NFAMILIES,) + DET_SHAPE)
+            .astype(np.float32))
+        input_traps.meta.subarray.xstart = 1
+        input_traps.meta.subarray.ystart = 1
+        input_traps.meta.exposure.end_time = 58000.09
+    else:
+        input_traps = None
+
+    return persistence.DataSet(model, input_traps, 40., True, trap_density,
+                               trappars, persat,
+                               max_chunk_memory=max_chunk_memory,
+                               working_dtype=working_dtype)
+
+
+@pytest.mark.parametrize('working_dtype', [np.float64, np.float32])
+@pytest.mark.parametrize('traps_filled', [False, True])
+@pytest.mark.parametrize('subarray', [False, True])
+def test_chunked_matches_unchunked(subarray, traps_filled, working_dtype):
+    """Processing the detector in chunks of rows gives the same result as
+    processing it at once, including a last chunk shorter than the others.
+    """
+    # A budget of 4.5 rows of work arrays, which doesn't divide the rows.
+    itemsize = np.dtype(working_dtype).itemsize
+    row_budget = (DET_SHAPE[1] * (NGROUPS * persistence.BYTES_PER_GROUP
+                                  + (NFAMILIES + 4) * itemsize)
+                  / (1024. * 1024.))
+    max_chunk_memory = 4.5 * row_budget
+    chunk_rows = persistence.rows_per_chunk(max_chunk_memory, NGROUPS,
+                                            NFAMILIES, DET_SHAPE[1],
+                                            itemsize)
+    assert 1 < chunk_rows < DET_SHAPE[0]
+    assert DET_SHAPE[0] % chunk_rows != 0
+
+    whole = make_dataset(subarray, traps_filled,
+                         working_dtype=working_dtype).do_all()
+    chunked = make_dataset(subarray, traps_filled,
+                           max_chunk_memory=max_chunk_memory,
+                           working_dtype=working_dtype).do_all()
+
+    (output, traps, pers, skipped) = chunked
+    (output_ref, traps_ref, pers_ref, skipped_ref) = whole
+    assert not skipped and not skipped_ref
+    assert pers.data.max() > 0.
+    np.testing.assert_array_equal(output.data, output_ref.data)
+    np.testing.assert_array_equal(output.pixeldq, output_ref.pixeldq)
+    np.testing.assert_array_equal(traps.data, traps_ref.data)
+    np.testing.assert_array_equal(pers.data, pers_ref.data)
+
+
+def test_float32_close_to_float64():
+    """float32 accumulation buffers change the result only by rounding."""
+    output64 = make_dataset(True, True).do_all()
+    output32 = make_dataset(True, True, max_chunk_memory=0.01,
+                            working_dtype=np.float32).do_all()
+
+    np.testing.assert_allclose(output32[0].data, output64[0].data,
+                               rtol=1e-5, atol=1e-3)
+    np.testing.assert_allclose(output32[1].data, output64[1].data,
+                               rtol=1e-5, atol=1e-3)
+
+
+def test_out_buffers_match_new_arrays():
+    """predict_capture and delta_fcn_capture give the same result when
+    writing to preallocated buffers, whatever the buffers held before.
+    """
+    dataset = make_dataset(False, False)
+    dataset.get_group_info(0)
+    trap_density = dataset.trap_density.data
+    par = dataset.get_parameters()
+    rows = slice(3, 17)
+    (grp_slope, slope) = dataset.compute_slope(0, rows)
+    out = np.full(grp_slope.shape, np.nan)
+    cr_out = np.full(grp_slope.shape, np.nan, dtype=trap_density.dtype)
+    for k in range(NFAMILIES):
+        capture_param_k = dataset.get_capture_param(par, k)
+        expected = dataset.predict_capture(capture_param_k,
+                                           trap_density[rows], 0,
+                                           grp_slope, slope, rows=rows)
+        filled = dataset.predict_capture(capture_param_k,
+                                         trap_density[rows], 0,
+                                         grp_slope, slope, rows=rows,
+                                         out=out, cr_out=cr_out)
+        assert filled is out
+        np.testing.assert_array_equal(filled, expected)
@@ -4,6 +4,7 @@ import traceback
 
 from .. import datamodels
 from ..assign_wcs.util import NoDataOnDetectorError
+from ..assign_wcs import wcs_cache
 from ..lib.pipe_utils import is_tso
 from ..stpipe import Pipeline
 
@@ -42,6 +43,8 @@ class Spec2Pipeline(Pipeline):
     spec = """
         save_bsub = boolean(default=False)        # Save background-subracted science
         fail_on_exception = boolean(default=True) # Fail if any product fails.
+        cache_wcs = boolean(default=False)        # Reuse WCS coordinates evaluated by earlier steps
+        wcs_cache_dir = string(default=None)      # Directory to load and save the WCS caches in
     """
 
     # Define aliases to steps
@@ -194,6 +197,18 @@ class Spec2Pipeline(Pipeline):
                 else:
                     raise RuntimeError('Cannot determine WCS.')
 
+        # Keep the WCS evaluations of the later steps with the model
+        wcs_cache_file = None
+        wcs_cache_model = None
+        if self.cache_wcs:
+            if self.wcs_cache_dir is not None:
+                wcs_cache_file = op.join(
+                    self.wcs_cache_dir,
+                    op.splitext(op.basename(science))[0] + '_wcscache.npz'
+                )
+            wcs_cache.enable(input, sidecar=wcs_cache_file)
+            wcs_cache_model = input
+
         # Do background processing, if necessary
         if exp_type in WFSS_TYPES or len(members_by_type['background']) > 0:
 
@@ -308,6 +323,12 @@ class Spec2Pipeline(Pipeline):
             self.extract_1d.suffix = 'x1d'
         x1d_result = self.extract_1d(result_extra)
 
+        if wcs_cache_file is not None:
+            # Saved from the assign_wcs output the cache was enabled on,
+            # with its fingerprint; the copies made by the later steps
+            # share its entries
+            wcs_cache.save(wcs_cache_model, wcs_cache_file)
+
         result_extra.close()
         x1d_result.close()
 
@@ -637,44 +637,31 @@ def gls_fit(ramp_data,
                  frame_time * (M + 1.) / 2.
 
     if num_cr > 0:
-        sum_crs = cr_flagged_2d.cumsum(axis=0)
-        for k in range(ngroups):
-            s = slice(k, ngroups)
-            for n in range(1, num_cr + 1):
-                temp = np.where(np.logical_and(cr_flagged_2d[k] == 1,
-                                               sum_crs[k] == n))
-                if len(temp[0]) > 0:
-                    index = (temp[0], s, n + 1)
-                    x[index] = 1
-        del temp, index
+        # The column of the n-th cosmic ray is 1 from the group in which
+        # it was flagged onwards, i.e. where at least n have been flagged.
+        sum_crs = cr_flagged_2d.cumsum(axis=0).T
+        for n in range(1, num_cr + 1):
+            x[:, :, n + 1] = (sum_crs >= n)
+        del sum_crs
 
     y = np.transpose(ramp_data, (1, 0)).reshape((nz, ngroups, 1))
 
     # ramp_cov is an array of nz matrices, each ngroups x ngroups.
     # each matrix gives the covariance of that pixel's ramp data
-    ramp_cov = np.ones((nz, ngroups, ngroups), dtype=np.float64)
-
+    #
     # Use the previous fit to the data to populate the covariance matrix,
     # for each of the nz pixels.  prev_fit_data has shape (ngroups, nz),
     # similar to the ramp data, but we want the nz axis to be the first
     # (we're constructing an array of nz matrix equations), so transpose
-    # prev_fit_data.
+    # prev_fit_data.  Element (k, j) of a matrix is the previous fit at
+    # group min(k, j).
     prev_fit_T = np.transpose(prev_fit_data, (1, 0))
-    for k in range(ngroups):
-        # Populate the upper right, row by row.
-        ramp_cov[:, k, k:ngroups] = prev_fit_T[:, k:k + 1]
-        # Populate the lower left, column by column.
-        ramp_cov[:, k:ngroups, k] = prev_fit_T[:, k:k + 1]
-        # Give saturated pixels a very high high variance (hence a low weight)
-        ramp_cov[:, k, k] += saturated_data[k, :]
+    groups = np.arange(ngroups)
+    ramp_cov = prev_fit_T[:, np.minimum.outer(groups, groups)].astype(np.float64)
     del prev_fit_T
-
-    # I is 2-D, but it can broadcast to 4-D.  This is used to add terms to
-    # the diagonal of the covariance matrix.
-    I = np.identity(ngroups)
-
-    rn3d = readnoise.reshape((nz, 1, 1))
-    ramp_cov += (I * rn3d**2)
+    # Give saturated pixels a very high high variance (hence a low weight)
+    ramp_cov[:, groups, groups] += saturated_data.T
+    ramp_cov[:, groups, groups] += readnoise.reshape((nz, 1))**2
 
     # prev_slope_data must be non-negative.
     flags = prev_slope_data < 0.
@@ -684,24 +671,38 @@ def gls_fit(ramp_data,
     #  (xT @ ramp_cov^-1 @ x)^-1 @ [xT @ ramp_cov^-1 @ y]
     #  = [y-intercept, slope, cr_amplitude_1, cr_amplitude_2, ...]
     # where @ means matrix multiplication.
-
-    # shape of xT is (nz, 2 + num_cr, ngroups)
-    xT = np.transpose(x, (0, 2, 1))
-
-    # shape of `ramp_invcov` is (nz, ngroups, ngroups)
-    I = I.reshape((1, ngroups, ngroups))
-    ramp_invcov = la.solve(ramp_cov, I)
-
-    del I
-
-    # temp1 = xT @ ramp_invcov
-    # np.einsum use is equivalent to matrix multiplication
-    # shape of temp1 is (nz, 2 + num_cr, ngroups)
-    temp1 = np.einsum('...ij,...jk->...ik', xT, ramp_invcov)
-
-    # temp_var = xT @ ramp_invcov @ x
-    # shape of temp_var is (nz, 2 + num_cr, 2 + num_cr)
-    temp_var = np.einsum('...ij,...jk->...ik', temp1, x)
+    #
+    # With the Cholesky factorization ramp_cov = L @ LT, these are computed
+    # from wx = L^-1 @ x and wy = L^-1 @ y, as (wxT @ wx)^-1 @ [wxT @ wy],
+    # without inverting ramp_cov.  L^-1 @ x and L^-1 @ y are found together,
+    # as the columns of L^-1 @ [x y].
+    xy = np.concatenate((x, y), axis=2)
+    try:
+        chol = la.cholesky(ramp_cov)
+    except la.LinAlgError:
+        chol = None
+
+    if chol is not None:
+        wxy = solve_lower(chol, xy)
+        del chol
+        wx = wxy[:, :, :-1]
+        wxT = np.transpose(wx, (0, 2, 1))
+        # shape of temp_var is (nz, 2 + num_cr, 2 + num_cr)
+        temp_var = np.matmul(wxT, wx)
+        # [xT @ ramp_invcov @ y]
+        # shape of temp2 is (nz, 2 + num_cr, 1)
+        temp2 = np.matmul(wxT, wxy[:, :, -1:])
+        del wxy, wx, wxT
+    else:
+        # Some covariance matrices are not positive definite, solve the
+        # equations with the LU decomposition instead.
+        invcov_xy = la.solve(ramp_cov, xy)
+        # shape of xT is (nz, 2 + num_cr, ngroups)
+        xT = np.transpose(x, (0, 2, 1))
+        temp_var = np.matmul(xT, invcov_xy[:, :, :-1])
+        temp2 = np.matmul(xT, invcov_xy[:, :, -1:])
+        del invcov_xy, xT
+    del ramp_cov, xy
 
     # `fitparam_cov` is an array of nz covariance matrices.
     # fitparam_cov = (xT @ ramp_invcov @ x)^-1
@@ -720,12 +721,8 @@ def gls_fit(ramp_data,
                 raise la.LinAlgError(msg2)
     del I_2
 
-    # [xT @ ramp_invcov @ y]
-    # shape of temp2 is (nz, 2 + num_cr, 1)
-    temp2 = np.einsum('...ij,...jk->...ik', temp1, y)
-
     # shape of fitparam is (nz, 2 + num_cr, 1)
-    fitparam = np.einsum('...ij,...jk->...ik', fitparam_cov, temp2)
+    fitparam = np.matmul(fitparam_cov, temp2)
     r_shape = fitparam.shape
     fitparam2d = fitparam.reshape((r_shape[0], r_shape[1]))
     del fitparam
@@ -734,3 +731,27 @@ def gls_fit(ramp_data,
     fitparam_uncs = fitparam_cov.diagonal(axis1=1, axis2=2).copy()
 
     return (fitparam2d, fitparam_uncs)
+
+
+def solve_lower(chol, b):
+    """Solve stacked lower-triangular systems by forward substitution.
+
+    Parameters
+    ----------
+    chol: 3-D ndarray, shape (nz, n, n)
+        Lower-triangular matrices, e.g. Cholesky factors.
+
+    b: 3-D ndarray, shape (nz, n, m)
+        The right-hand sides.
+
+    Returns
+    -------
+    z: 3-D ndarray, shape (nz, n, m)
+        The solution of chol[i] @ z[i] = b[i] for each i.  The loop is over
+        the n rows, each row is computed for all the nz systems at once.
+    """
+    z = np.empty(b.shape, dtype=np.float64)
+    for k in range(chol.shape[1]):
+        known = np.matmul(chol[:, k:k + 1, :k], z[:, :k, :])[:, 0, :]
+        z[:, k, :] = (b[:, k, :] - known) / chol[:, k, k, np.newaxis]
+    return z
@@ -15,6 +15,7 @@
 
 import time
 import logging
+import multiprocessing
 import numpy as np
 import warnings
 
@@ -33,7 +34,7 @@ BUFSIZE = 1024 * 30000  # 30Mb cache size for data section
 
 
 def ramp_fit(model, buffsize, save_opt, readnoise_model, gain_model,
-             algorithm, weighting):
+             algorithm, weighting, max_cores=None):
     """
     Calculate the count rate for each pixel in all data cube sections and all
     integrations, equal to the slope for all sections (intervals between
@@ -67,6 +68,12 @@ def ramp_fit(model, buffsize, save_opt, readnoise_model, gain_model,
         'optimal' specifies that optimal weighting should be used;
          currently the only weighting supported.
 
+    max_cores : string or None
+        Number of cores to use for multiprocessing of the OLS fit. If set to
+        None (the default), no multiprocessing will be done. The other
+        allowable values are 'quarter', 'half', and 'all'. This is the
+        fraction of cores to use for multi-proc. Not used for 'GLS'.
+
     Returns
     -------
     new_model : Data Model object
@@ -87,12 +94,12 @@ def ramp_fit(model, buffsize, save_opt, readnoise_model, gain_model,
     if algorithm == "GLS":
         new_model, int_model, gls_opt_model = gls_ramp_fit(model,
                                 buffsize, save_opt,
-                                readnoise_model, gain_model)
+                                readnoise_model, gain_model, max_cores)
         opt_model = None
     else:
         new_model, int_model, opt_model = \
                ols_ramp_fit(model, buffsize, save_opt, readnoise_model, \
-               gain_model, weighting)
+               gain_model, weighting, max_cores)
         gls_opt_model = None
 
     # Update data units in output models
@@ -108,7 +115,7 @@ def ramp_fit(model, buffsize, save_opt, readnoise_model, gain_model,
 
 
 def ols_ramp_fit(model, buffsize, save_opt, readnoise_model, gain_model,
-                 weighting):
+                 weighting, max_cores=None):
     """
     Fit a ramp using ordinary least squares. Calculate the count rate for each
     pixel in all data cube sections and all integrations, equal to the weighted
@@ -136,6 +143,13 @@ def ols_ramp_fit(model, buffsize, save_opt, readnoise_model, gain_model,
         'optimal' specifies that optimal weighting should be used; currently
         the only weighting supported.
 
+    max_cores : string or None
+        Number of cores to use for multiprocessing. If set to None (the
+        default), no multiprocessing will be done. The other allowable values
+        are 'quarter', 'half', and 'all'. This is the fraction of cores to use
+        for multi-proc. The total number of cores includes the SMT cores
+        (Hyper Threading for Intel).
+
     Returns
     -------
     new_model : Data Model object
@@ -265,13 +279,6 @@ def ols_ramp_fit(model, buffsize, save_opt, readnoise_model, gain_model,
     max_seg = calc_num_seg(gdq_cube, n_int)
     del gdq_cube
 
-    f_max_seg = 0  # final number to use, usually overwritten by actual value
-
-    (dq_int, median_diffs_2d, num_seg_per_int, sat_0th_group_int) =\
-        utils.alloc_arrays_1(n_int, imshape)
-
-    opt_res = utils.OptRes(n_int, imshape, max_seg, nreads, save_opt)
-
     # Calculate number of (contiguous) rows per data section
     nrows = calc_nrows(model, buffsize, cubeshape, nreads)
 
@@ -289,6 +296,395 @@ def ols_ramp_fit(model, buffsize, save_opt, readnoise_model, gain_model,
     pixeldq = model.pixeldq.copy()
     pixeldq = utils.reset_bad_gain( pixeldq, gain_2d ) # Flag bad pixels in gain
 
+    # Every quantity computed below depends only on the ramp of a single
+    #   pixel, so the rows of the dataset can be fit independently, and the
+    #   results will be identical however the rows are divided up.
+    number_slices = utils.compute_slices(max_cores, cubeshape[1])
+
+    if number_slices == 1:
+        (slope_dataset2, slope_int, dq_int, var_p3, var_r3, var_both3,
+         s_inv_var_p3, s_inv_var_r3, opt_res, var_p4, var_r4, inv_var_both4,
+         f_max_seg) = \
+            ols_ramp_fit_sliced(model.data, model.groupdq, pixeldq,
+                                readnoise_2d, gain_2d, frame_time, group_time,
+                                ngroups, max_seg, nrows, save_opt, weighting)
+    else:
+        (slope_dataset2, slope_int, dq_int, var_p3, var_r3, var_both3,
+         s_inv_var_p3, s_inv_var_r3, opt_res, var_p4, var_r4, inv_var_both4,
+         f_max_seg) = \
+            ols_ramp_fit_multi(model.data, model.groupdq, pixeldq,
+                               readnoise_2d, gain_2d, frame_time, group_time,
+                               ngroups, max_seg, nrows, save_opt, weighting,
+                               number_slices)
+
+    del readnoise_2d, gain_2d
+
+    # Loop over data integrations to calculate integration-specific pedestal
+    if save_opt:
+        dq_slice = np.zeros((gdq_cube_shape[2],gdq_cube_shape[3]),
+                            dtype=np.uint32)
+
+        for num_int in range(0, n_int):
+            dq_slice =  model.get_section('groupdq')[num_int, 0, :, :]
+            opt_res.ped_int[ num_int, :, : ] = \
+                utils.calc_pedestal(num_int, slope_int, opt_res.firstf_int,
+                    dq_slice, nframes, groupgap, dropframes1)
+
+        del dq_slice
+
+    # Collect optional results for output
+    if save_opt:
+        gdq_cube = model.groupdq
+        opt_res.shrink_crmag(n_int, gdq_cube, imshape, nreads)
+        del gdq_cube
+
+        # Some contributions to these vars may be NaN as they are from ramps
+        # having PIXELDQ=DO_NOT_USE
+        var_p4[ np.isnan( var_p4 )] = 0.
+        var_r4[ np.isnan( var_r4 )] = 0.
+
+        # Truncate results at the maximum number of segments found
+        opt_res.slope_seg = opt_res.slope_seg[:,:f_max_seg,:,:]
+        opt_res.sigslope_seg = opt_res.sigslope_seg[:,:f_max_seg,:,:]
+        opt_res.yint_seg = opt_res.yint_seg[:,:f_max_seg,:,:]
+        opt_res.sigyint_seg = opt_res.sigyint_seg[:,:f_max_seg,:,:]
+        opt_res.weights = (inv_var_both4[:,:f_max_seg,:,:])**2.
+        opt_res.var_p_seg = var_p4[:,:f_max_seg,:,:]
+        opt_res.var_r_seg = var_r4[:,:f_max_seg,:,:]
+
+        opt_model = opt_res.output_optional(model, effintim)
+    else:
+        opt_model = None
+
+    if inv_var_both4 is not None:
+        del inv_var_both4
+
+    if var_p4 is not None:
+        del var_p4
+
+    if var_r4 is not None:
+        del var_r4
+
+    if pixeldq is not None:
+        del pixeldq
+
+    # For multiple-integration datasets, will output integration-specific
+    #    results to separate file named <basename> + '_integ.fits'
+    int_times = None
+    if n_int > 1:
+        if pipe_utils.is_tso(model) and hasattr(model, 'int_times'):
+            int_times = model.int_times
+        else:
+            int_times = None
+        int_model = utils.output_integ(model, slope_int, dq_int, effintim,
+                                       var_p3, var_r3, var_both3, int_times)
+    else:
+        int_model = None
+
+    if opt_res is not None:
+        del opt_res
+
+    if slope_int is not None:
+        del slope_int
+    del var_p3
+    del var_r3
+    del var_both3
+    if int_times is not None:
+        del int_times
+
+    # Divide slopes by total (summed over all integrations) effective
+    #   integration time to give count rates.
+    c_rates = slope_dataset2 / effintim
+
+    # Compress all integration's dq arrays to create 2D PIXELDDQ array for
+    #   primary output
+    final_pixeldq = dq_compress_final(dq_int, n_int)
+
+    if dq_int is not None:
+        del dq_int
+
+    tstop = time.time()
+
+    log_stats(c_rates)
+
+    log.debug('Instrument: %s', instrume)
+    log.debug('Number of pixels in 2D array: %d', npix)
+    log.debug('Shape of 2D image: (%d, %d)' %(imshape))
+    log.debug('Shape of data cube: (%d, %d, %d)' %(orig_cubeshape))
+    log.debug('Buffer size (bytes): %d', buffsize)
+    log.debug('Number of rows per buffer: %d', nrows)
+    log.debug('Number of slices fit in parallel: %d', number_slices)
+    log.info('Number of groups per integration: %d', orig_nreads)
+    log.info('Number of integrations: %d', n_int)
+    log.debug('The execution time in seconds: %f', tstop - tstart)
+
+    # Compute the 2D variances due to Poisson and read noise
+    var_p2 = 1/(s_inv_var_p3.sum(axis=0))
+    var_r2 = 1/(s_inv_var_r3.sum(axis=0))
+
+    # Huge variances correspond to non-existing segments, so are reset to 0
+    #  to nullify their contribution.
+    with warnings.catch_warnings():
+        warnings.filterwarnings("ignore", "invalid value.*", RuntimeWarning)
+        var_p2[var_p2 > 0.1 * utils.LARGE_VARIANCE] = 0.
+        var_r2[var_r2 > 0.1 * utils.LARGE_VARIANCE] = 0.
+
+    # Some contributions to these vars may be NaN as they are from ramps
+    # having PIXELDQ=DO_NOT_USE
+    var_p2[ np.isnan( var_p2 )] = 0.
+    var_r2[ np.isnan( var_r2 )] = 0.
+
+    # Suppress, then re-enable, harmless arithmetic warning
+    warnings.filterwarnings("ignore", ".*invalid value.*", RuntimeWarning)
+    err_tot = np.sqrt(var_p2 + var_r2)
+    warnings.resetwarnings()
+
+    del s_inv_var_p3
+    del s_inv_var_r3
+
+    # Create new model for the primary output.
+    new_model = datamodels.ImageModel(data=c_rates.astype(np.float32),
+            dq=final_pixeldq.astype(np.uint32),
+            var_poisson=var_p2.astype(np.float32),
+            var_rnoise=var_r2.astype(np.float32),
+            err=err_tot.astype(np.float32))
+
+    new_model.update(model)  # ... and add all keys from input
+
+    return new_model, int_model, opt_model
+
+
+def ols_ramp_fit_multi(data, groupdq, pixeldq, readnoise_2d, gain_2d,
+                       frame_time, group_time, ngroups, max_seg, nrows,
+                       save_opt, weighting, number_slices):
+    """
+    Divide the rows of the dataset into slices, fit each slice in a separate
+    process with ols_ramp_fit_sliced(), and reassemble the slice results into
+    arrays covering the full 2D image.
+
+    Parameters
+    ----------
+    data : float, 4D array
+        science data, [integration, group, y, x]
+
+    groupdq : int, 4D array
+        GROUPDQ array, [integration, group, y, x]
+
+    pixeldq : int, 2D array
+        PIXELDQ array, with bad gain values already flagged
+
+    readnoise_2d : float, 2D array
+        readnoise for all pixels, as returned by get_ref_subs()
+
+    gain_2d : float, 2D array
+        gain for all pixels
+
+    frame_time : float
+        integration time
+
+    group_time : float
+        time increment between groups
+
+    ngroups : int
+        number of groups per integration
+
+    max_seg : int
+        maximum number of segments fit, over all pixels and integrations
+
+    nrows : int
+        number of rows per data section
+
+    save_opt : boolean
+        calculate optional fitting results
+
+    weighting : string
+        'optimal' specifies that optimal weighting should be used; currently
+        the only weighting supported.
+
+    number_slices : int
+        number of slices (and processes) to divide the rows into
+
+    Returns
+    -------
+    The same tuple as ols_ramp_fit_sliced(), for the full 2D image.
+    """
+    n_int, nreads, total_rows, total_cols = data.shape
+    imshape = (total_rows, total_cols)
+
+    # Each element of slices is a tuple of the arguments to
+    # ols_ramp_fit_sliced() for the corresponding range of rows
+    rows_per_slice = total_rows // number_slices
+    row_ranges = []
+    slices = []
+    for i in range(number_slices):
+        rlo = i * rows_per_slice
+        if i == number_slices - 1:
+            rhi = total_rows  # last slice gets the rest
+        else:
+            rhi = rlo + rows_per_slice
+        row_ranges.append((rlo, rhi))
+        slices.append((data[:, :, rlo:rhi, :], groupdq[:, :, rlo:rhi, :],
+                       pixeldq[rlo:rhi, :], readnoise_2d[rlo:rhi, :],
+                       gain_2d[rlo:rhi, :], frame_time, group_time, ngroups,
+                       max_seg, nrows, save_opt, weighting))
+
+    log.info("Creating %d processes for ramp fitting " % number_slices)
+    pool = multiprocessing.Pool(processes=number_slices)
+    real_results = pool.starmap(ols_ramp_fit_sliced, slices)
+    pool.terminate()
+    pool.close()
+
+    # Allocate the full-size output arrays
+    slope_dataset2 = np.zeros(imshape, dtype=np.float64)
+    slope_int = np.zeros((n_int,) + imshape, dtype=np.float64)
+    dq_int = np.zeros((n_int,) + imshape, dtype=np.uint32)
+    # Every row is covered by a slice, so the arrays are filled completely;
+    #   the segment-specific variances are only needed for the optional
+    #   output product
+    var_p3 = np.zeros((n_int,) + imshape, dtype=np.float32)
+    var_r3 = np.zeros_like(var_p3)
+    var_both3 = np.zeros_like(var_p3)
+    s_inv_var_p3 = np.zeros_like(var_p3)
+    s_inv_var_r3 = np.zeros_like(var_p3)
+    if save_opt:
+        var_p4 = np.zeros((n_int, max_seg) + imshape, dtype=np.float32)
+        var_r4 = np.zeros_like(var_p4)
+        inv_var_both4 = np.zeros_like(var_p4)
+    else:
+        var_p4, var_r4, inv_var_both4 = None, None, None
+
+    opt_res = utils.OptRes(n_int, imshape, max_seg, nreads, save_opt)
+    f_max_seg = 0
+
+    # Copy the results for each slice into the full-size arrays
+    for (rlo, rhi), result in zip(row_ranges, real_results):
+        (s_slope_dataset2, s_slope_int, s_dq_int, s_var_p3, s_var_r3,
+         s_var_both3, s_s_inv_var_p3, s_s_inv_var_r3, s_opt_res, s_var_p4,
+         s_var_r4, s_inv_var_both4, s_f_max_seg) = result
+
+        slope_dataset2 = slope_dataset2.astype(s_slope_dataset2.dtype,
+                                               copy=False)
+        slope_int = slope_int.astype(s_slope_int.dtype, copy=False)
+
+        slope_dataset2[rlo:rhi, :] = s_slope_dataset2
+        slope_int[:, rlo:rhi, :] = s_slope_int
+        dq_int[:, rlo:rhi, :] = s_dq_int
+        var_p3[:, rlo:rhi, :] = s_var_p3
+        var_r3[:, rlo:rhi, :] = s_var_r3
+        var_both3[:, rlo:rhi, :] = s_var_both3
+        s_inv_var_p3[:, rlo:rhi, :] = s_s_inv_var_p3
+        s_inv_var_r3[:, rlo:rhi, :] = s_s_inv_var_r3
+        opt_res.slope_seg[:, :, rlo:rhi, :] = s_opt_res.slope_seg
+
+        if save_opt:
+            opt_res.yint_seg[:, :, rlo:rhi, :] = s_opt_res.yint_seg
+            opt_res.sigyint_seg[:, :, rlo:rhi, :] = s_opt_res.sigyint_seg
+            opt_res.sigslope_seg[:, :, rlo:rhi, :] = s_opt_res.sigslope_seg
+            opt_res.inv_var_seg[:, :, rlo:rhi, :] = s_opt_res.inv_var_seg
+            opt_res.firstf_int[:, rlo:rhi, :] = s_opt_res.firstf_int
+            opt_res.cr_mag_seg[:, :, rlo:rhi, :] = s_opt_res.cr_mag_seg
+            var_p4[:, :, rlo:rhi, :] = s_var_p4
+            var_r4[:, :, rlo:rhi, :] = s_var_r4
+            inv_var_both4[:, :, rlo:rhi, :] = s_inv_var_both4
+
+        f_max_seg = max(f_max_seg, s_f_max_seg)
+
+    return (slope_dataset2, slope_int, dq_int, var_p3, var_r3, var_both3,
+            s_inv_var_p3, s_inv_var_r3, opt_res, var_p4, var_r4,
+            inv_var_both4, f_max_seg)
+
+
+def ols_ramp_fit_sliced(data, groupdq, pixeldq, readnoise_2d, gain_2d,
+                        frame_time, group_time, ngroups, max_seg, nrows,
+                        save_opt, weighting):
+    """
+    Fit the ramps of all pixels in the given rows of the dataset, for all
+    integrations. The rows may be the entire 2D image, or a slice of it
+    processed by one of the multiprocessing workers; since the fit of every
+    pixel is independent of every other pixel, the results do not depend on
+    how the image is sliced.
+
+    Parameters
+    ----------
+    data : float, 4D array
+        science data, [integration, group, y, x]; saturated groups are
+        reset to NaN in place
+
+    groupdq : int, 4D array
+        GROUPDQ array, [integration, group, y, x]
+
+    pixeldq : int, 2D array
+        PIXELDQ array, with bad gain values already flagged
+
+    readnoise_2d : float, 2D array
+        readnoise for all pixels, as returned by get_ref_subs()
+
+    gain_2d : float, 2D array
+        gain for all pixels
+
+    frame_time : float
+        integration time
+
+    group_time : float
+        time increment between groups
+
+    ngroups : int
+        number of groups per integration
+
+    max_seg : int
+        maximum number of segments fit, over all pixels and integrations of
+        the full dataset
+
+    nrows : int
+        number of rows per data section
+
+    save_opt : boolean
+        calculate optional fitting results
+
+    weighting : string
+        'optimal' specifies that optimal weighting should be used; currently
+        the only weighting supported.
+
+    Returns
+    -------
+    slope_dataset2 : float, 2D array
+        weighted slope averaged over all segments and integrations
+
+    slope_int : float, 3D array
+        integration-specific weighted slopes
+
+    dq_int : int, 3D array
+        integration-specific DQ arrays
+
+    var_p3, var_r3, var_both3 : float, 3D arrays
+        integration-specific variances due to Poisson noise, read noise, and
+        both
+
+    s_inv_var_p3, s_inv_var_r3 : float, 3D arrays
+        integration-specific sums over segments of the inverse variances due
+        to Poisson noise and read noise
+
+    opt_res : OptRes object
+        segment-specific fitting results, not yet truncated to f_max_seg
+
+    var_p4, var_r4, inv_var_both4 : float, 4D arrays or None
+        segment-specific variances due to Poisson noise and read noise, and
+        the inverse of the combined variance; None if save_opt is False
+
+    f_max_seg : int
+        actual maximum number of segments fit within a ramp in these rows
+    """
+    n_int, nreads = data.shape[:2]
+    imshape = data.shape[-2:]
+    cubeshape = (nreads,) + imshape
+
+    f_max_seg = 0  # final number to use, usually overwritten by actual value
+
+    (dq_int, median_diffs_2d, num_seg_per_int, sat_0th_group_int) =\
+        utils.alloc_arrays_1(n_int, imshape)
+
+    opt_res = utils.OptRes(n_int, imshape, max_seg, nreads, save_opt)
+
     # In this 'First Pass' over the data, loop over integrations and data
     #   sections to calculate the estimated median slopes, which will be used
     #   to calculate the variances. This is the same method to estimate slopes
@@ -305,7 +701,7 @@ def ols_ramp_fit(model, buffsize, save_opt, readnoise_model, gain_model,
             if rhi > cubeshape[1]:
                 rhi = cubeshape[1]
 
-            data_sect = model.get_section('data')[num_int, :, rlo:rhi, :]
+            data_sect = data[num_int, :, rlo:rhi, :]
 
             # Skip data section if it is all NaNs
             if  np.all(np.isnan( data_sect)):
@@ -313,11 +709,10 @@ def ols_ramp_fit(model, buffsize, save_opt, readnoise_model, gain_model,
                 continue
 
             # first frame section for 1st group of current integration
-            ff_sect = model.get_section('data')[ num_int, 0, rlo:rhi, :].\
-                astype(np.float32)
+            ff_sect = data[ num_int, 0, rlo:rhi, :].astype(np.float32)
 
             # Get appropriate sections
-            gdq_sect = model.get_section('groupdq')[num_int, :, rlo:rhi, :]
+            gdq_sect = groupdq[num_int, :, rlo:rhi, :]
             rn_sect = readnoise_2d[rlo:rhi, :]
             gain_sect = gain_2d[rlo:rhi, :]
 
@@ -376,6 +771,8 @@ def ols_ramp_fit(model, buffsize, save_opt, readnoise_model, gain_model,
             nan_med[np.isnan(nan_med)] = 0. # if all first_diffs_sect are nans
             median_diffs_2d[ rlo:rhi, : ] += nan_med
 
+            del first_diffs_sect
+
             # Calculate the slope of each segment
             t_dq_cube, inv_var, opt_res, f_max_seg, num_seg = \
                  calc_slope(data_sect, gdq_sect, frame_time, opt_res, save_opt,
@@ -383,6 +780,7 @@ def ols_ramp_fit(model, buffsize, save_opt, readnoise_model, gain_model,
                             f_max_seg)
 
             del gain_sect
+            del inv_var
 
             # Populate 3D num_seg { integ, y, x } with 2D num_seg for this data
             #  section (y,x) and integration (num_int)
@@ -402,6 +800,7 @@ def ols_ramp_fit(model, buffsize, save_opt, readnoise_model, gain_model,
                   dq_compress_sect(t_dq_cube, pixeldq_sect).copy()
 
             del t_dq_cube
+            del pixeldq_sect
 
             # Loop over the segments and copy the reshaped 2D segment-specific
             #   results for the current data section to the 4D output arrays.
@@ -423,15 +822,11 @@ def ols_ramp_fit(model, buffsize, save_opt, readnoise_model, gain_model,
             del ff_sect
             del gdq_sect
 
-    if pixeldq_sect is not None:
-        del pixeldq_sect
-
     # Compute the final 2D array of differences; create rate array
     median_diffs_2d /= n_int
     med_rates = median_diffs_2d/group_time
 
     del median_diffs_2d
-    del first_diffs_sect
 
     (var_p3, var_r3, var_p4, var_r4, var_both4, var_both3,
      inv_var_both4, s_inv_var_p3, s_inv_var_r3, s_inv_var_both3,
@@ -463,7 +858,7 @@ def ols_ramp_fit(model, buffsize, save_opt, readnoise_model, gain_model,
                 rhi = cubeshape[1]
 
             # gdq_sect is: [ groups, y, x ]
-            gdq_sect = model.get_section('groupdq')[num_int, :, rlo:rhi, :]
+            gdq_sect = groupdq[num_int, :, rlo:rhi, :]
 
             rn_sect = readnoise_2d[rlo:rhi, :]
             gain_sect = gain_2d[rlo:rhi, :]
@@ -489,6 +884,7 @@ def ols_ramp_fit(model, buffsize, save_opt, readnoise_model, gain_model,
             warnings.resetwarnings()
 
             del den_r3, den_p3, num_r3, segs_beg_3
+            del rn_sect
             del gain_sect
             del gdq_sect
 
@@ -534,10 +930,6 @@ def ols_ramp_fit(model, buffsize, save_opt, readnoise_model, gain_model,
         var_p4_int *= ( segs_4[num_int,:,:,:] > 0)
         inv_var_both4_int *= ( segs_4[num_int,:,:,:] > 0)
 
-        # reshape these arrays to simplify masking [ segment, 1D pixel ]
-        var_p4_int2 = var_p4_int.reshape(( var_p4_int.shape[0],
-                            var_p4_int.shape[1]*var_p4_int.shape[2]))
-
         s_inv_var_both3[num_int,:,:] = (inv_var_both4[num_int,:,:,:]).sum(axis=0)
 
         # Suppress, then re-enable harmless arithmetic warnings
@@ -547,31 +939,15 @@ def ols_ramp_fit(model, buffsize, save_opt, readnoise_model, gain_model,
         warnings.resetwarnings()
 
         del var_p4_int
-        del var_p4_int2
-
-    del gain_2d
+        del inv_var_both4_int
 
     var_p4 *= ( segs_4[:,:,:,:] > 0) # Zero out non-existing segments
     var_r4 *= ( segs_4[:,:,:,:] > 0)
 
     # Delete lots of arrays no longer needed
-    if inv_var_both4_int is not None:
-        del inv_var_both4_int
-
-    if med_rates is not None:
-        del med_rates
-
-    if num_seg_per_int is not None:
-        del num_seg_per_int
-
-    if readnoise_2d is not None:
-        del readnoise_2d
-
-    if rn_sect is not None:
-        del rn_sect
-
-    if segs_4 is not None:
-        del segs_4
+    del med_rates
+    del num_seg_per_int
+    del segs_4
 
     # Now that the segment-specific and integration-specific variances have
     #   been calculated, the segment-specific, integration-specific, and
@@ -621,149 +997,24 @@ def ols_ramp_fit(model, buffsize, save_opt, readnoise_model, gain_model,
     var_p3, var_both3, slope_int = utils.fix_sat_ramps( sat_0th_group_int,
                                            var_p3, var_both3, slope_int)
 
-    if sat_0th_group_int is not None:
-        del sat_0th_group_int
-
-    # Loop over data integrations to calculate integration-specific pedestal
-    if save_opt:
-        dq_slice = np.zeros((gdq_cube_shape[2],gdq_cube_shape[3]),
-                            dtype=np.uint32)
-
-        for num_int in range(0, n_int):
-            dq_slice =  model.get_section('groupdq')[num_int, 0, :, :]
-            opt_res.ped_int[ num_int, :, : ] = \
-                utils.calc_pedestal(num_int, slope_int, opt_res.firstf_int,
-                    dq_slice, nframes, groupgap, dropframes1)
-
-        del dq_slice
+    del sat_0th_group_int
 
-    # Collect optional results for output
-    if save_opt:
-        gdq_cube = model.groupdq
-        opt_res.shrink_crmag(n_int, gdq_cube, imshape, nreads)
-        del gdq_cube
+    # The 2D work arrays for the last data section are no longer needed, and
+    #   would otherwise be pickled along with the results by a worker process.
+    opt_res.init_2d(0, 0, save_opt)
 
-        # Some contributions to these vars may be NaN as they are from ramps
-        # having PIXELDQ=DO_NOT_USE
-        var_p4[ np.isnan( var_p4 )] = 0.
-        var_r4[ np.isnan( var_r4 )] = 0.
+    # The segment-specific variances are only needed for the optional output
+    if not save_opt:
+        var_p4, var_r4, inv_var_both4 = None, None, None
 
-        # Truncate results at the maximum number of segments found
-        opt_res.slope_seg = opt_res.slope_seg[:,:f_max_seg,:,:]
-        opt_res.sigslope_seg = opt_res.sigslope_seg[:,:f_max_seg,:,:]
-        opt_res.yint_seg = opt_res.yint_seg[:,:f_max_seg,:,:]
-        opt_res.sigyint_seg = opt_res.sigyint_seg[:,:f_max_seg,:,:]
-        opt_res.weights = (inv_var_both4[:,:f_max_seg,:,:])**2.
-        opt_res.var_p_seg = var_p4[:,:f_max_seg,:,:]
-        opt_res.var_r_seg = var_r4[:,:f_max_seg,:,:]
-
-        opt_model = opt_res.output_optional(model, effintim)
-    else:
-        opt_model = None
-
-    if inv_var_both4 is not None:
-        del inv_var_both4
-
-    if var_p4 is not None:
-        del var_p4
-
-    if var_r4 is not None:
-        del var_r4
-
-    if inv_var is not None:
-        del inv_var
-
-    if pixeldq is not None:
-        del pixeldq
-
-    # For multiple-integration datasets, will output integration-specific
-    #    results to separate file named <basename> + '_integ.fits'
-    int_times = None
-    if n_int > 1:
-        if pipe_utils.is_tso(model) and hasattr(model, 'int_times'):
-            int_times = model.int_times
-        else:
-            int_times = None
-        int_model = utils.output_integ(model, slope_int, dq_int, effintim,
-                                       var_p3, var_r3, var_both3, int_times)
-    else:
-        int_model = None
-
-    if opt_res is not None:
-        del opt_res
-
-    if slope_int is not None:
-        del slope_int
-    del var_p3
-    del var_r3
-    del var_both3
-    if int_times is not None:
-        del int_times
-
-    # Divide slopes by total (summed over all integrations) effective
-    #   integration time to give count rates.
-    c_rates = slope_dataset2 / effintim
-
-    # Compress all integration's dq arrays to create 2D PIXELDDQ array for
-    #   primary output
-    final_pixeldq = dq_compress_final(dq_int, n_int)
-
-    if dq_int is not None:
-        del dq_int
-
-    tstop = time.time()
-
-    log_stats(c_rates)
-
-    log.debug('Instrument: %s', instrume)
-    log.debug('Number of pixels in 2D array: %d', npix)
-    log.debug('Shape of 2D image: (%d, %d)' %(imshape))
-    log.debug('Shape of data cube: (%d, %d, %d)' %(orig_cubeshape))
-    log.debug('Buffer size (bytes): %d', buffsize)
-    log.debug('Number of rows per buffer: %d', nrows)
-    log.info('Number of groups per integration: %d', orig_nreads)
-    log.info('Number of integrations: %d', n_int)
-    log.debug('The execution time in seconds: %f', tstop - tstart)
-
-    # Compute the 2D variances due to Poisson and read noise
-    var_p2 = 1/(s_inv_var_p3.sum(axis=0))
-    var_r2 = 1/(s_inv_var_r3.sum(axis=0))
-
-    # Huge variances correspond to non-existing segments, so are reset to 0
-    #  to nullify their contribution.
-    with warnings.catch_warnings():
-        warnings.filterwarnings("ignore", "invalid value.*", RuntimeWarning)
-        var_p2[var_p2 > 0.1 * utils.LARGE_VARIANCE] = 0.
-        var_r2[var_r2 > 0.1 * utils.LARGE_VARIANCE] = 0.
-
-    # Some contributions to these vars may be NaN as they are from ramps
-    # having PIXELDQ=DO_NOT_USE
-    var_p2[ np.isnan( var_p2 )] = 0.
-    var_r2[ np.isnan( var_r2 )] = 0.
-
-    # Suppress, then re-enable, harmless arithmetic warning
-    warnings.filterwarnings("ignore", ".*invalid value.*", RuntimeWarning)
-    err_tot = np.sqrt(var_p2 + var_r2)
-    warnings.resetwarnings()
-
-    del s_inv_var_p3
-    del s_inv_var_r3
-
-    # Create new model for the primary output.
-    new_model = datamodels.ImageModel(data=c_rates.astype(np.float32),
-            dq=final_pixeldq.astype(np.uint32),
-            var_poisson=var_p2.astype(np.float32),
-            var_rnoise=var_r2.astype(np.float32),
-            err=err_tot.astype(np.float32))
-
-    new_model.update(model)  # ... and add all keys from input
-
-    return new_model, int_model, opt_model
+    return (slope_dataset2, slope_int, dq_int, var_p3, var_r3, var_both3,
+            s_inv_var_p3, s_inv_var_r3, opt_res, var_p4, var_r4,
+            inv_var_both4, f_max_seg)
 
 
 def gls_ramp_fit(model,
                  buffsize, save_opt,
-                 readnoise_model, gain_model):
+                 readnoise_model, gain_model, max_cores=None):
     """Fit a ramp using generalized least squares.
 
     Extended Summary
@@ -794,6 +1045,12 @@ def gls_ramp_fit(model,
     gain_model : instance of gain model
         Gain for all pixels.
 
+    max_cores : string or None
+        Number of cores to use for multiprocessing. If set to None (the
+        default), no multiprocessing is done; otherwise 'quarter', 'half',
+        or 'all' of the cores are used, each process fitting one data
+        section at a time.
+
     Returns
     -------
     new_model : Data Model object
@@ -887,92 +1144,88 @@ def gls_ramp_fit(model,
     # Flag any bad pixels in the gain
     pixeldq = utils.reset_bad_gain( pixeldq, gain_2d )
 
-    # loop over data integrations
-    for num_int in range(n_int):
-        if save_opt:
-            first_group[:, :] = 0.      # re-use this for each integration
-
-        # loop over data sections
-        for rlo in range(0, cubeshape[1], nrows):
-            rhi = rlo + nrows
-
-            if rhi > cubeshape[1]:
-                rhi = cubeshape[1]
-
-            data_sect = model.get_section('data')[num_int, :, rlo:rhi, :]
-
-            # We'll propagate error estimates from previous steps to the
-            # current step by using the variance.
-            input_var_sect = model.get_section('err')[num_int, :, rlo:rhi, :]
-            input_var_sect = input_var_sect**2
-
-            gdq_sect = gdq_cube[num_int, :, rlo:rhi, :]
-            rn_sect = readnoise_2d[rlo:rhi, :]
-            gain_sect = gain_2d[rlo:rhi, :]
-
-            # Convert the data section from DN to electrons.
-            data_sect *= gain_sect
+    # With multiprocessing, `number_slices` data sections are fitted at a
+    # time, the sections being made smaller if needed so that each process
+    # has one.
+    number_slices = utils.compute_slices(max_cores, cubeshape[1])
+    pool = None
+    if number_slices > 1:
+        nrows = min(nrows, -(-cubeshape[1] // number_slices))
+        log.info("Creating %d processes for GLS ramp fitting" % number_slices)
+        pool = multiprocessing.Pool(processes=number_slices)
+
+    try:
+        # loop over data integrations
+        for num_int in range(n_int):
             if save_opt:
-                first_group[rlo:rhi, :] = data_sect[0, :, :].copy()
-
-            (intercept_sect, intercept_var_sect,
-             slope_sect, slope_var_sect,
-             cr_sect, cr_var_sect) = \
-                        gls_fit.determine_slope(data_sect, input_var_sect,
-                                                gdq_sect, rn_sect, gain_sect,
-                                                frame_time, group_time,
-                                                nframes_used, max_num_cr,
-                                                saturated_flag, jump_flag)
-
-            slope_int[num_int, rlo:rhi, :] = slope_sect.copy()
-            v_mask = (slope_var_sect <= 0.)
-            if v_mask.any():
-                # Replace negative or zero variances with a large value.
-                slope_var_sect[v_mask] = utils.LARGE_VARIANCE
-                # Also set a flag in the pixel dq array.
-                temp_dq[rlo:rhi, :][v_mask] = dqflags.pixel['UNRELIABLE_SLOPE']
-            del v_mask
-            # If a pixel was flagged (by an earlier step) as saturated in
-            # the first group, flag the pixel as bad.
-            # Note:  save s_mask until after the call to utils.gls_pedestal.
-            s_mask = (gdq_sect[0] == saturated_flag)
-            if s_mask.any():
-                temp_dq[rlo:rhi, :][s_mask] = dqflags.pixel['UNRELIABLE_SLOPE']
-            slope_err_int[num_int, rlo:rhi, :] = np.sqrt(slope_var_sect)
-
-            # We need to take a weighted average if (and only if) n_int > 1.
-            # Accumulate sum of slopes and sum of weights.
-            if n_int > 1:
-                weight = 1. / slope_var_sect
-                slopes[rlo:rhi, :] += (slope_sect * weight)
-                sum_weight[rlo:rhi, :] += weight
-
-            if save_opt:
-                # Save the intercepts and cosmic-ray amplitudes for the
-                # current integration.
-                intercept_int[num_int, rlo:rhi, :] = intercept_sect.copy()
-                intercept_err_int[num_int, rlo:rhi, :] = \
-                        np.sqrt(np.abs(intercept_var_sect))
-                pedestal_int[num_int, rlo:rhi, :] = \
-                        utils.gls_pedestal(first_group[rlo:rhi, :],
-                                           slope_int[num_int, rlo:rhi, :],
-                                           s_mask,
-                                           frame_time, nframes_used)
-                ampl_int[num_int, rlo:rhi, :, :] = cr_sect.copy()
-                ampl_err_int[num_int, rlo:rhi, :, :] = \
-                        np.sqrt(np.abs(cr_var_sect))
-            del s_mask
-
-            # Compress 4D->2D dq arrays for saturated and jump-detected
-            #   pixels
-            pixeldq_sect = pixeldq[rlo:rhi, :].copy()
-            dq_int[num_int, rlo:rhi, :] = \
-                  dq_compress_sect(gdq_sect, pixeldq_sect).copy()
-
-        # temp_dq |= dq_int[num_int, :, :]
-        # dq_int[num_int, :, :] = temp_dq.copy()
-        dq_int[num_int, :, :] |= temp_dq
-        temp_dq[:, :] = 0               # initialize for next integration
+                first_group[:, :] = 0.      # re-use this for each integration
+
+            # loop over data sections
+            sections = gls_data_sections(model, gdq_cube, num_int, nrows,
+                                         readnoise_2d, gain_2d)
+            for rlo, rhi, section, fit in gls_fit_sections(
+                    sections, frame_time, group_time, nframes_used, max_num_cr,
+                    saturated_flag, jump_flag, pool, number_slices):
+                data_sect, input_var_sect, gdq_sect, rn_sect, gain_sect = section
+                (intercept_sect, intercept_var_sect,
+                 slope_sect, slope_var_sect,
+                 cr_sect, cr_var_sect) = fit
+                if save_opt:
+                    first_group[rlo:rhi, :] = data_sect[0, :, :].copy()
+
+                slope_int[num_int, rlo:rhi, :] = slope_sect.copy()
+                v_mask = (slope_var_sect <= 0.)
+                if v_mask.any():
+                    # Replace negative or zero variances with a large value.
+                    slope_var_sect[v_mask] = utils.LARGE_VARIANCE
+                    # Also set a flag in the pixel dq array.
+                    temp_dq[rlo:rhi, :][v_mask] = dqflags.pixel['UNRELIABLE_SLOPE']
+                del v_mask
+                # If a pixel was flagged (by an earlier step) as saturated in
+                # the first group, flag the pixel as bad.
+                # Note:  save s_mask until after the call to utils.gls_pedestal.
+                s_mask = (gdq_sect[0] == saturated_flag)
+                if s_mask.any():
+                    temp_dq[rlo:rhi, :][s_mask] = dqflags.pixel['UNRELIABLE_SLOPE']
+                slope_err_int[num_int, rlo:rhi, :] = np.sqrt(slope_var_sect)
+
+                # We need to take a weighted average if (and only if) n_int > 1.
+                # Accumulate sum of slopes and sum of weights.
+                if n_int > 1:
+                    weight = 1. / slope_var_sect
+                    slopes[rlo:rhi, :] += (slope_sect * weight)
+                    sum_weight[rlo:rhi, :] += weight
+
+                if save_opt:
+                    # Save the intercepts and cosmic-ray amplitudes for the
+                    # current integration.
+                    intercept_int[num_int, rlo:rhi, :] = intercept_sect.copy()
+                    intercept_err_int[num_int, rlo:rhi, :] = \
+                            np.sqrt(np.abs(intercept_var_sect))
+                    pedestal_int[num_int, rlo:rhi, :] = \
+                            utils.gls_pedestal(first_group[rlo:rhi, :],
+                                               slope_int[num_int, rlo:rhi, :],
+                                               s_mask,
+                                               frame_time, nframes_used)
+                    ampl_int[num_int, rlo:rhi, :, :] = cr_sect.copy()
+                    ampl_err_int[num_int, rlo:rhi, :, :] = \
+                            np.sqrt(np.abs(cr_var_sect))
+                del s_mask
+
+                # Compress 4D->2D dq arrays for saturated and jump-detected
+                #   pixels
+                pixeldq_sect = pixeldq[rlo:rhi, :].copy()
+                dq_int[num_int, rlo:rhi, :] = \
+                      dq_compress_sect(gdq_sect, pixeldq_sect).copy()
+
+            # temp_dq |= dq_int[num_int, :, :]
+            # dq_int[num_int, :, :] = temp_dq.copy()
+            dq_int[num_int, :, :] |= temp_dq
+            temp_dq[:, :] = 0               # initialize for next integration
+    finally:
+        if pool is not None:
+            pool.terminate()
+            pool.close()
 
     # Average the slope over all integrations.
     if n_int > 1:
@@ -1049,6 +1302,80 @@ def gls_ramp_fit(model,
     return new_model, int_model, gls_opt_model
 
 
+def gls_data_sections(model, gdq_cube, num_int, nrows, readnoise_2d,
+                      gain_2d):
+    """Yield the sections of `nrows` rows of an integration to fit with GLS.
+
+    Yields
+    ------
+    rlo, rhi, section : int, int, tuple
+        The first and last (excluded) rows of the section, and its data in
+        electrons, input variance, group DQ, read noise and gain, the first
+        arguments of gls_fit.determine_slope.
+    """
+    cubeshape = gdq_cube.shape[1:]
+    for rlo in range(0, cubeshape[1], nrows):
+        rhi = rlo + nrows
+
+        if rhi > cubeshape[1]:
+            rhi = cubeshape[1]
+
+        data_sect = model.get_section('data')[num_int, :, rlo:rhi, :]
+
+        # We'll propagate error estimates from previous steps to the
+        # current step by using the variance.
+        input_var_sect = model.get_section('err')[num_int, :, rlo:rhi, :]
+        input_var_sect = input_var_sect**2
+
+        gdq_sect = gdq_cube[num_int, :, rlo:rhi, :]
+        rn_sect = readnoise_2d[rlo:rhi, :]
+        gain_sect = gain_2d[rlo:rhi, :]
+
+        # Convert the data section from DN to electrons.
+        data_sect *= gain_sect
+
+        yield rlo, rhi, (data_sect, input_var_sect, gdq_sect, rn_sect,
+                         gain_sect)
+
+
+def gls_fit_sections(sections, frame_time, group_time, nframes_used,
+                     max_num_cr, saturated_flag, jump_flag,
+                     pool=None, number_slices=1):
+    """Fit the sections yielded by `gls_data_sections`, in order.
+
+    With a multiprocessing pool, `number_slices` sections are read and
+    fitted at a time, one by each process.
+
+    Yields
+    ------
+    rlo, rhi, section, fit : int, int, tuple, tuple
+        The rows and data of each section, and the result of
+        gls_fit.determine_slope for it.
+    """
+    fit_args = (frame_time, group_time, nframes_used, max_num_cr,
+                saturated_flag, jump_flag)
+    if pool is None:
+        for rlo, rhi, section in sections:
+            yield rlo, rhi, section, gls_fit.determine_slope(*section, *fit_args)
+        return
+
+    batch = []
+    for item in sections:
+        batch.append(item)
+        if len(batch) == number_slices:
+            yield from _gls_fit_batch(batch, fit_args, pool)
+            batch = []
+    if batch:
+        yield from _gls_fit_batch(batch, fit_args, pool)
+
+
+def _gls_fit_batch(batch, fit_args, pool):
+    fits = pool.starmap(gls_fit.determine_slope,
+                        [section + fit_args for _, _, section in batch])
+    for (rlo, rhi, section), fit in zip(batch, fits):
+        yield rlo, rhi, section, fit
+
+
 def calc_power(snr):
     """
     Using the given SNR, calculate the weighting exponent, which is from
@@ -1436,9 +1763,17 @@ def fit_next_segment(start, end_st, end_heads, pixel_done, data_sect, mask_2d,
 
     ramp_mask_sum = mask_2d_init.sum(axis=0)
 
-    # Each returned array below is 1D, for all npix pixels for current segment
-    slope, intercept, variance, sig_intercept, sig_slope = fit_lines(data_sect,
-              mask_2d, rn_sect, gain_sect, ngroups, weighting)
+    # Each returned array below is 1D, for all npix pixels for current segment.
+    #   Pixels whose ramps have been completely fit are not used again, so
+    #   once any pixel is done, only the remaining pixels are fit.
+    if pixel_done.any():
+        slope, intercept, variance, sig_intercept, sig_slope = \
+            fit_lines_active(data_sect, mask_2d, rn_sect, gain_sect, ngroups,
+                             weighting, ~pixel_done)
+    else:
+        slope, intercept, variance, sig_intercept, sig_slope = \
+            fit_lines(data_sect, mask_2d, rn_sect, gain_sect, ngroups,
+                      weighting)
 
     end_locs = end_st[end_heads[all_pix] - 1, all_pix]
 
@@ -1948,6 +2283,75 @@ def fit_lines(data, mask_2d, rn_sect, gain_sect, ngroups, weighting):
     return slope_s, intercept_s, variance_s, sig_intercept_s, sig_slope_s
 
 
+def fit_lines_active(data, mask_2d, rn_sect, gain_sect, ngroups, weighting,
+                     active):
+    """
+    Do the linear least squares fit of fit_lines() for only the pixels in the
+    data section that are flagged as active. The active pixels are gathered
+    into compact arrays, so that the masked copies of the data made while
+    fitting the segment scale with the number of pixels still being fit
+    rather than with the size of the data section. The fit of each pixel is
+    independent of all other pixels, so the results for the active pixels are
+    identical to those of fit_lines() for the whole section.
+
+    Parameters
+    ----------
+    data : float, 3D array
+       array of values for current data section
+
+    mask_2d : boolean, 2D array
+       delineates which channels to fit for each pixel
+
+    rn_sect : float, 2D array
+        read noise values for all pixels in data section
+
+    gain_sect : float, 2D array
+        gain values for all pixels in data section
+
+    ngroups : int
+        number of groups per integration
+
+    weighting : string
+        'optimal' specifies that optimal weighting should be used; currently
+        the only weighting supported.
+
+    active : boolean, 1D array
+        pixels of the data section to fit
+
+    Returns
+    -------
+    The same arrays as fit_lines(), for all pixels in the data section; the
+    values for pixels that are not active are 0.
+    """
+    nreads = data.shape[0]
+    npix = mask_2d.shape[1]
+    act_pix = np.where(active)[0]
+    n_act = len(act_pix)
+
+    # Gather the active pixels into a data 'section' of a single row. The
+    #   data section is usually a strided view of the cube, so the pixels
+    #   are picked by row and column rather than from a flattened copy.
+    rows, cols = np.divmod(act_pix, data.shape[2])
+    data_act = data[:, rows, cols].reshape((nreads, 1, n_act))
+    mask_act = mask_2d[:, act_pix]
+    rn_act = rn_sect[rows, cols].reshape((1, n_act))
+    gain_act = gain_sect[rows, cols].reshape((1, n_act))
+
+    results_act = fit_lines(data_act, mask_act, rn_act, gain_act, ngroups,
+                            weighting)
+
+    # Scatter the results back to all pixels of the data section
+    results = []
+    for res_act in results_act:
+        res = np.zeros(npix, dtype=res_act.dtype)
+        res[act_pix] = res_act
+        results.append(res)
+
+    slope_s, intercept_s, variance_s, sig_intercept_s, sig_slope_s = results
+
+    return slope_s, intercept_s, variance_s, sig_intercept_s, sig_slope_s
+
+
 def fit_single_read(slope_s, intercept_s, variance_s, sig_intercept_s,
                     sig_slope_s, npix, data, wh_pix_1r):
     """
@@ -23,6 +23,7 @@ class RampFitStep (Step):
         int_name = string(default='')
         save_opt = boolean(default=False) # Save optional output
         opt_name = string(default='')
+        maximum_cores = option('quarter', 'half', 'all', default=None) # max number of processes to create
     """
 
     # Prior to 04/26/17, the following were also in the spec above:
@@ -59,6 +60,8 @@ class RampFitStep (Step):
 
             log.info('Using algorithm = %s' % self.algorithm)
             log.info('Using weighting = %s' % self.weighting)
+            if self.maximum_cores is not None:
+                log.info('Maximum cores to use = %s', self.maximum_cores)
 
             buffsize = ramp_fit.BUFSIZE
             if self.algorithm == "GLS":
@@ -67,7 +70,7 @@ class RampFitStep (Step):
             out_model, int_model, opt_model, gls_opt_model = ramp_fit.ramp_fit(
                 input_model, buffsize,
                 self.save_opt, readnoise_model, gain_model, self.algorithm,
-                self.weighting
+                self.weighting, self.maximum_cores
             )
 
             readnoise_model.close()
@@ -2,6 +2,9 @@ import pytest
 import numpy as np
 
 from jwst.ramp_fitting.ramp_fit import ramp_fit
+from jwst.ramp_fitting.ramp_fit import fit_lines, fit_lines_active
+from jwst.ramp_fitting import gls_fit
+from jwst.lib import multiprocessing_utils
 from jwst.datamodels import dqflags
 from jwst.datamodels import RampModel
 from jwst.datamodels import GainModel, ReadnoiseModel
@@ -570,6 +573,143 @@ def setup_small_cube(ngroups=10, nints=1, nrows=2, ncols=2, deltatime=10.,
 
 
 #Need test for multi-ints near zero with positive and negative slopes
+def test_multiprocessing_matches_serial(monkeypatch):
+    # Fit the same ramps with and without multiprocessing; since the rows are
+    # fit independently, the results must be identical.
+    monkeypatch.setattr(multiprocessing_utils.multiprocessing, 'cpu_count', lambda: 4)
+    results = []
+    for max_cores in [None, 'all']:
+        model1, gdq, rnModel, pixdq, err, gain = setup_inputs(ngroups=10,
+                                 readnoise=7, nints=2, gain=5, deltatime=3)
+        model1.data[:, :, :, :] = np.arange(10)[np.newaxis, :, np.newaxis,
+                                                np.newaxis] * 20.
+        model1.data[:, :, 50, 50] += np.arange(10) * 5.
+        model1.data[0, 5:, 25, 25] += 500.
+        model1.groupdq[0, 5, 25, 25] = dqflags.group['JUMP_DET']
+        model1.data[1, 7:, 80, 10] += 300.
+        model1.groupdq[1, 7, 80, 10] = dqflags.group['JUMP_DET']
+        model1.groupdq[:, 8:, 60, 60] = dqflags.group['SATURATED']
+        results.append(ramp_fit(model1, 64000, True, rnModel, gain, 'OLS',
+                                'optimal', max_cores))
+
+    serial, multi = results
+    for attr in ['data', 'dq', 'var_poisson', 'var_rnoise', 'err']:
+        np.testing.assert_array_equal(getattr(serial[0], attr),
+                                      getattr(multi[0], attr))
+        np.testing.assert_array_equal(getattr(serial[1], attr),
+                                      getattr(multi[1], attr))
+    for attr in ['slope', 'sigslope', 'var_poisson', 'var_rnoise', 'yint',
+                 'sigyint', 'pedestal', 'weights', 'crmag']:
+        np.testing.assert_array_equal(getattr(serial[2], attr),
+                                      getattr(multi[2], attr))
+
+
+def test_gls_multiprocessing_matches_serial(monkeypatch):
+    # The data sections are fit independently, so fitting them in separate
+    # processes must give the same results.
+    monkeypatch.setattr(multiprocessing_utils.multiprocessing, 'cpu_count', lambda: 4)
+    results = []
+    for max_cores in [None, 'all']:
+        model1, gdq, rnModel, pixdq, err, gain = setup_inputs(ngroups=6,
+                                 readnoise=7, nints=2, nrows=20, ncols=15,
+                                 gain=5, deltatime=3)
+        model1.data[:, :, :, :] = np.arange(6)[np.newaxis, :, np.newaxis,
+                                               np.newaxis] * 20.
+        model1.data[0, 3:, 5, 5] += 500.
+        model1.groupdq[0, 3, 5, 5] = dqflags.group['JUMP_DET']
+        model1.groupdq[:, 4:, 16, 10] = dqflags.group['SATURATED']
+        results.append(ramp_fit(model1, 64000, True, rnModel, gain, 'GLS',
+                                'optimal', max_cores))
+
+    serial, multi = results
+    for attr in ['data', 'dq', 'err']:
+        np.testing.assert_allclose(getattr(multi[0], attr),
+                                   getattr(serial[0], attr), rtol=1e-10)
+        np.testing.assert_allclose(getattr(multi[1], attr),
+                                   getattr(serial[1], attr), rtol=1e-10)
+
+
+@pytest.mark.parametrize("num_cr", [0, 1, 2])
+def test_gls_fit_matches_explicit_inverse(num_cr):
+    # The batched Cholesky solution must match the generalized least squares
+    # solution computed with the inverse of each covariance matrix.
+    ngroups, nz = 7, 12
+    frame_time, group_time, nframes = 10.6, 10.6, 1
+    rng = np.random.RandomState(1)
+    cr_flagged = np.zeros((ngroups, nz), dtype=np.uint8)
+    for z in range(nz):
+        groups = rng.choice(np.arange(1, ngroups), num_cr, replace=False)
+        cr_flagged[groups, z] = 1
+    saturated = np.zeros((ngroups, nz))
+    ramp = (np.arange(ngroups)[:, np.newaxis] * 50. + 100. +
+            cr_flagged.cumsum(axis=0) * 300. +
+            rng.normal(0., 5., (ngroups, nz)))
+    prev_fit = np.abs(ramp)
+    readnoise = np.full(nz, 8.)
+
+    result, variances = gls_fit.gls_fit(ramp, prev_fit, np.ones(nz), readnoise,
+                                        None, frame_time, group_time, nframes,
+                                        num_cr, cr_flagged, saturated)
+
+    times = np.arange(ngroups) * group_time + frame_time
+    for z in range(nz):
+        x = np.ones((ngroups, 2 + num_cr))
+        x[:, 1] = times
+        sum_crs = cr_flagged[:, z].cumsum()
+        for n in range(1, num_cr + 1):
+            x[:, n + 1] = sum_crs >= n
+        groups = np.arange(ngroups)
+        cov = prev_fit[np.minimum.outer(groups, groups), z]
+        cov += np.diag(saturated[:, z] + readnoise[z]**2)
+        invcov = np.linalg.inv(cov)
+        param_cov = np.linalg.inv(x.T @ invcov @ x)
+        param = param_cov @ x.T @ invcov @ ramp[:, z]
+        np.testing.assert_allclose(result[z], param, rtol=1e-7)
+        np.testing.assert_allclose(variances[z], np.diag(param_cov), rtol=1e-7)
+
+
+def test_solve_lower():
+    rng = np.random.RandomState(2)
+    a = rng.normal(size=(5, 6, 6))
+    cov = np.matmul(a, np.transpose(a, (0, 2, 1))) + 6 * np.eye(6)
+    chol = np.linalg.cholesky(cov)
+    b = rng.normal(size=(5, 6, 3))
+    np.testing.assert_allclose(gls_fit.solve_lower(chol, b),
+                               np.linalg.solve(chol, b), rtol=1e-10)
+
+
+@pytest.mark.parametrize("strided", [False, True])
+def test_fit_lines_active_matches_fit_lines(strided):
+    # Fitting only the active pixels must give the same results for those
+    # pixels as fitting the whole section, also when the section is a
+    # strided view of the data.
+    nreads, nrows, ncols = 8, 4, 5
+    npix = nrows * ncols
+    rng = np.random.RandomState(42)
+    data = (np.arange(nreads)[:, np.newaxis, np.newaxis] * 15. +
+            rng.normal(0., 2., (nreads, 2 * nrows, 2 * ncols))).astype(np.float32)
+    if strided:
+        data = data[:, 1::2, ::2]
+    else:
+        data = data[:, :nrows, :ncols].copy()
+    mask_2d = np.ones((nreads, npix), dtype=bool)
+    mask_2d[5:, 3] = False
+    mask_2d[:2, 7] = False
+    mask_2d[2:, 11] = False
+    rn_sect = np.full((nrows, ncols), 10., dtype=np.float32)
+    gain_sect = np.full((nrows, ncols), 5., dtype=np.float32)
+    active = np.ones(npix, dtype=bool)
+    active[::3] = False
+
+    full = fit_lines(data, mask_2d, rn_sect, gain_sect, nreads, 'optimal')
+    part = fit_lines_active(data, mask_2d, rn_sect, gain_sect, nreads,
+                            'optimal', active)
+
+    for full_res, part_res in zip(full, part):
+        np.testing.assert_array_equal(part_res[active], full_res[active])
+        assert np.all(part_res[~active] == 0.)
+
+
 def setup_inputs(ngroups=10, readnoise=10, nints=1,
                  nrows=103, ncols=102, nframes=1, grouptime=1.0,gain=1, deltatime=1):
 
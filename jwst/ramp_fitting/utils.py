@@ -8,6 +8,7 @@ import numpy as np
 from .. import datamodels
 from ..datamodels import dqflags
 from ..lib import reffile_utils
+from ..lib.multiprocessing_utils import num_processes
 
 log = logging.getLogger(__name__)
 log.setLevel(logging.DEBUG)
@@ -1341,3 +1342,25 @@ def do_all_sat( model, imshape, n_int, save_opt):
     log.info('All groups of all integrations are saturated.')
 
     return new_model, int_model, opt_model
+
+
+def compute_slices(max_cores, nrows):
+    """
+    Compute the number of slices (and processes) into which the rows of the
+    dataset will be divided for multiprocessing.
+
+    Parameters
+    ----------
+    max_cores : string or None
+        fraction of the available cores to use: None, 'quarter', 'half', or
+        'all'; None means no multiprocessing
+
+    nrows : int
+        number of rows in the 2D image
+
+    Returns
+    -------
+    number_slices : int
+        number of slices to use, at least 1 and at most nrows
+    """
+    return max(1, min(num_processes(max_cores), nrows))
@@ -35,9 +35,19 @@
 #  subarray, omit the refpix step.
 #
 #  For MIRI subarray exposures, omit the refpix step.
+#
+#  Batched processing added 10/2026
+#
+#  For NIR full frame exposures, the groups can optionally be corrected in
+#  place, working on a view of the data in detector coordinates, with the
+#  side reference pixels of all the groups of an integration median
+#  filtered together.
 
 
+import warnings
+
 import numpy as np
+from numpy.lib.stride_tricks import as_strided
 from scipy import stats
 import logging
 from ..datamodels import dqflags
@@ -131,6 +141,12 @@ class Dataset():
         flag that controls whether odd and even-numbered rows are handled
         separately (MIR only)
 
+    batched: boolean
+        flag that controls whether the groups are corrected in place, with
+        the side reference pixels of all the groups of an integration median
+        filtered together (NIR full frame only).  Set after the dataset is
+        created; False by default.
+
 """
     def __init__(self, input_model,
                  odd_even_columns,
@@ -172,6 +188,7 @@ class Dataset():
         self.side_gain = side_gain
         self.odd_even_rows = odd_even_rows
         self.bad_reference_pixels = False
+        self.batched = False
 
         # Define temp array for processing every group
         self.pixeldq = self.get_pixeldq()
@@ -674,6 +691,105 @@ class NIRDataset(Dataset):
             result[i] = np.median(window)
         return result
 
+    def median_filter_planes(self, data, dq, smoothing_length):
+        """Median filter each plane of a stack of side reference pixels,
+        in the same way as median_filter.  As in median_filter, the pixels
+        flagged DO_NOT_USE are left out of each window, and a window with
+        a NaN among its other pixels has a NaN median.
+
+        Parameters:
+        -----------
+
+        data: NDArray
+            input 3-d science array (plane, row, column)
+
+        dq: NDArray
+            input 2-d dq array, common to all planes
+
+        smoothing_length: integer (should be odd)
+            height of box within which the median value is calculated
+
+        Returns:
+        --------
+
+        result: NDArray
+            2-d array, one median filtered vector per plane of the input data
+        """
+        if smoothing_length % 2 == 0:
+            log.info("Smoothing length must be odd, adding 1")
+            smoothing_length = smoothing_length + 1
+        bufsize = smoothing_length // 2
+        nplanes, nrows, ncols = data.shape
+
+        def windows(a):
+            # Every window of smoothing_length rows of a reflected at the
+            # top and bottom, as a view, with the pixels of a window last
+            reflected = np.concatenate((a[:, bufsize:0:-1],
+                                        a,
+                                        a[:, -2:-(bufsize + 2):-1]), axis=1)
+            s0, s1, s2 = reflected.strides
+            view = as_strided(reflected,
+                              shape=(nplanes, nrows, smoothing_length, ncols),
+                              strides=(s0, s1, s1, s2), writeable=False)
+            return view.reshape((nplanes, nrows, smoothing_length * ncols))
+
+        badpixels = np.bitwise_and(dq, dqflags.pixel['DO_NOT_USE']) != 0
+        # The pixels flagged DO_NOT_USE are made NaN, so that nanmedian
+        # leaves them out, then the windows of median_filter that hold a
+        # NaN good pixel are set back to NaN
+        masked = np.where(badpixels, np.nan, data)
+        with warnings.catch_warnings():
+            # Windows with no good pixels give NaN, as in median_filter
+            warnings.simplefilter('ignore', RuntimeWarning)
+            result = np.nanmedian(windows(masked), axis=2)
+        nan_good = np.isnan(data) & ~badpixels
+        if np.any(nan_good):
+            result[windows(nan_good).any(axis=2)] = np.nan
+        return result.astype(np.float64)
+
+    def detector_transform(self):
+        """Find the transformation from DMS to detector coordinates that
+        DMS_to_detector_dq applies to the pixeldq array, as a function
+        returning views.
+
+        Returns:
+        --------
+
+        to_detector: function or None
+            function of an array with full frame rows and columns as the
+            last two axes, returning a view of it in detector coordinates,
+            writing to which updates the array; or None if the
+            transformation is not a combination of flips and transposes
+
+        """
+        #
+        # Find the DMS pixel of each detector pixel by transforming an
+        # array of pixel indices
+        pixeldq = self.pixeldq
+        self.pixeldq = np.arange(self.nrows * self.ncols).reshape(self.full_shape)
+        self.DMS_to_detector_dq()
+        index = self.pixeldq
+        self.pixeldq = pixeldq
+        rows, cols = np.unravel_index(index, self.full_shape)
+
+        transposed = (rows[0, 0] == rows[1, 0])
+        flip_rows = (cols if transposed else rows)[0, 0] != 0
+        flip_cols = (rows if transposed else cols)[0, 0] != 0
+
+        def to_detector(a):
+            if transposed:
+                a = np.swapaxes(a, -2, -1)
+            if flip_rows:
+                a = a[..., ::-1, :]
+            if flip_cols:
+                a = a[..., :, ::-1]
+            return a
+
+        if not np.array_equal(to_detector(np.arange(index.size).reshape(index.shape)),
+                              index):
+            return None
+        return to_detector
+
     def calculate_side_ref_signal(self, group, colstart, colstop):
         """Calculate the reference pixel signal from the side reference pixels
         by running a box up the side reference pixels and calculating the running
@@ -781,7 +897,88 @@ class NIRDataset(Dataset):
         if self.is_subarray:
             self.do_subarray_corrections()
         else:
-            self.do_fullframe_corrections()
+            to_detector = self.detector_transform() if self.batched else None
+            if to_detector is not None:
+                self.do_fullframe_corrections_batched(to_detector)
+            else:
+                self.do_fullframe_corrections()
+
+    def do_fullframe_corrections_batched(self, to_detector):
+        """Do the same corrections as do_fullframe_corrections, in place
+        through a view of the data in detector coordinates instead of to a
+        copy of each group.  The top and bottom reference pixels are still
+        used group by group, but the side reference pixels of all the groups
+        of an integration are median filtered together.  The results are the
+        same as those of do_fullframe_corrections.
+
+        Parameters:
+        -----------
+
+        to_detector: function
+            the transformation returned by detector_transform
+        """
+        if self.odd_even_columns:
+            offsets = (0, 1)
+            step = 2
+        else:
+            offsets = (0,)
+            step = 1
+        #
+        #  First get the view of the data in detector coordinates, then
+        #  transform pixeldq array to detector coordinates
+        cubes = to_detector(self.input_model.data)
+        self.DMS_to_detector_dq()
+        #
+        #  Whether each section has good reference pixels only depends on
+        #  pixeldq.  If one doesn't, do_fullframe_corrections stops at the
+        #  first group of every integration, before correcting it, so
+        #  nothing is corrected.
+        refslices = {}
+        for amplifier in 'ABCD':
+            for offset in offsets:
+                for top_bottom in ('top', 'bottom'):
+                    rowstart, rowstop, colstart, colstop = \
+                        NIR_reference_sections[amplifier][top_bottom]
+                    refslice = (slice(rowstart, rowstop, 1),
+                                slice(colstart + offset, colstop, step))
+                    if np.all(np.bitwise_and(self.pixeldq[refslice],
+                                             dqflags.pixel['DO_NOT_USE'])):
+                        self.bad_reference_pixels = True
+                        return
+                    refslices[amplifier, offset, top_bottom] = refslice
+
+        for cube in cubes:
+            for plane in cube:
+                #
+                # Get the reference values from the top and bottom reference
+                # pixels, then apply them as do_top_bottom_correction does
+                refvalues = {}
+                for key, refslice in refslices.items():
+                    refvalues[key] = self.sigma_clip(plane[refslice],
+                                                     self.pixeldq[refslice])
+                for amplifier in 'ABCD':
+                    datarowstart, datarowstop, datacolstart, datacolstop = \
+                        NIR_reference_sections[amplifier]['data']
+                    for offset in offsets:
+                        #
+                        # For now, just average the top and bottom corrections
+                        refsignal = 0.5 * (refvalues[amplifier, offset, 'top'] +
+                                           refvalues[amplifier, offset, 'bottom'])
+                        dataslice = (slice(datarowstart, datarowstop, 1),
+                                     slice(datacolstart + offset, datacolstop, step))
+                        plane[dataslice] = plane[dataslice] - refsignal
+            if self.use_side_ref_pixels:
+                smoothing_length = self.side_smoothing_length
+                left = self.median_filter_planes(cube[:, :, 0:4],
+                                                 self.pixeldq[:, 0:4],
+                                                 smoothing_length)
+                right = self.median_filter_planes(cube[:, :, 2044:2048],
+                                                  self.pixeldq[:, 2044:2048],
+                                                  smoothing_length)
+                combined = 0.5 * (left + right)
+                cube -= self.side_gain * combined[:, :, np.newaxis]
+        log.setLevel(logging.INFO)
+        return
 
     def do_fullframe_corrections(self):
         """Do Reference Pixels Corrections for all amplifiers, NIR detectors
@@ -1674,7 +1871,7 @@ def create_dataset(input_model,
 def correct_model(input_model, odd_even_columns,
                    use_side_ref_pixels,
                    side_smoothing_length, side_gain,
-                   odd_even_rows):
+                   odd_even_rows, batched=False):
     """Wrapper to do Reference Pixel Correction on a JWST Model.
     Performs the correction on the datamodel
 
@@ -1704,6 +1901,11 @@ def correct_model(input_model, odd_even_columns,
         flag that controls whether odd and even-numbered rows are handled
         separately (MIR only)
 
+    batched: boolean
+        flag that controls whether the groups are corrected in place, with
+        the side reference pixels of all the groups of an integration median
+        filtered together (NIR full frame only)
+
     """
     if input_model.meta.instrument.name == 'MIRI':
         if reffile_utils.is_subarray(input_model):
@@ -1720,6 +1922,7 @@ def correct_model(input_model, odd_even_columns,
     if input_dataset is None:
         status = SUBARRAY_DOESNTFIT
         return status
+    input_dataset.batched = batched
     result_dataset = reference_pixel_correction(input_dataset)
 
     if result_dataset.bad_reference_pixels:
@@ -23,6 +23,7 @@ class RefPixStep(Step):
         side_smoothing_length = integer(default=11)
         side_gain = float(default=1.0)
         odd_even_rows = boolean(default=True)
+        batched = boolean(default=False) # correct in place, filtering side pixels of all groups together
     """
 
     reference_file_types = ['refpix']
@@ -61,13 +62,15 @@ class RefPixStep(Step):
                               (self.side_smoothing_length,))
                 self.log.info('side_gain = %f' % (self.side_gain,))
                 self.log.info('odd_even_rows = %s' % (self.odd_even_rows,))
+                self.log.info('batched = %s' % (self.batched,))
                 datamodel = input_model.copy()
                 status = reference_pixels.correct_model(datamodel,
                                                         self.odd_even_columns,
                                                         self.use_side_ref_pixels,
                                                         self.side_smoothing_length,
                                                         self.side_gain,
-                                                        self.odd_even_rows)
+                                                        self.odd_even_rows,
+                                                        self.batched)
                 if status == reference_pixels.REFPIX_OK:
                     datamodel.meta.cal_step.refpix = 'COMPLETE'
                 elif status == reference_pixels.SUBARRAY_DOESNTFIT:
@@ -3,7 +3,9 @@ import pytest
 
 from jwst.datamodels import RampModel, dqflags
 from jwst.refpix import RefPixStep
-from jwst.refpix.reference_pixels import Dataset, NIRDataset, correct_model, create_dataset
+from jwst.refpix.reference_pixels import (Dataset, NIRDataset, correct_model,
+                                          create_dataset, REFPIX_OK,
+                                          BAD_REFERENCE_PIXELS)
 
 
 def test_refpix_subarray():
@@ -696,3 +698,63 @@ def test_do_corrections_all_detectors(setup_cube, instr, det_list, ngroups, nrow
 
         np.testing.assert_almost_equal(np.mean(input_model.data[0, 0, :4, 4:-4]), rpix - rpix, decimal=0)
         np.testing.assert_almost_equal(np.mean(input_model.data[0, 0, 4:-4, 4:-4]), dataval - rpix, decimal=0)
+
+
+@pytest.mark.parametrize('use_side_ref_pixels', [True, False])
+@pytest.mark.parametrize('odd_even_columns', [True, False])
+@pytest.mark.parametrize('det', ['NRCA1', 'NRCB4', 'NRS1', 'NRS2', 'NIS'])
+def test_batched_corrections(setup_cube, det, odd_even_columns,
+                             use_side_ref_pixels):
+    '''Test that correcting all groups at once is the same as correcting
+    each group, including for NaN pixels.'''
+
+    instr = {'NRC': 'NIRCAM', 'NRS': 'NIRSPEC', 'NIS': 'NIRISS'}[det[:3]]
+    ngroups = 3
+    nrows = ncols = 2048
+
+    rng = np.random.RandomState(42)
+    input_model = setup_cube(instr, det, ngroups, nrows, ncols)
+    input_model.data[:] = rng.normal(100., 5., input_model.data.shape)
+    input_model.data[0, :, 10:20, 0] += np.arange(ngroups)[:, np.newaxis] * 50.
+    input_model.pixeldq[500, 2] = dqflags.pixel['DO_NOT_USE']
+    input_model.pixeldq[2046, 100] = dqflags.pixel['DO_NOT_USE']
+    # NaN reference pixels along each edge of one group, and in the data
+    input_model.data[0, 1, 700:705, 1] = np.nan
+    input_model.data[0, 1, 1, 300:305] = np.nan
+    input_model.data[0, 1, 1200:1205, 2046] = np.nan
+    input_model.data[0, 1, 2046, 1500:1505] = np.nan
+    input_model.data[0, 2, 1000, 1000] = np.nan
+    batched_model = input_model.copy()
+
+    status = correct_model(input_model, odd_even_columns, use_side_ref_pixels,
+                           11, 1.0, False)
+    batched_status = correct_model(batched_model, odd_even_columns,
+                                   use_side_ref_pixels, 11, 1.0, False,
+                                   batched=True)
+
+    assert status == batched_status == REFPIX_OK
+    np.testing.assert_array_equal(batched_model.data, input_model.data)
+
+
+@pytest.mark.parametrize('det', ['NRCA1', 'NRS2'])
+def test_batched_bad_reference_pixels(setup_cube, det):
+    '''Test that neither correction changes the data when the top and
+    bottom reference pixels are all flagged DO_NOT_USE.'''
+
+    instr = {'NRC': 'NIRCAM', 'NRS': 'NIRSPEC'}[det[:3]]
+    ngroups = 2
+    rng = np.random.RandomState(0)
+    input_model = setup_cube(instr, det, ngroups, 2048, 2048)
+    input_model.data[:] = rng.normal(100., 5., input_model.data.shape)
+    for edge in (np.s_[:4, :], np.s_[-4:, :], np.s_[:, :4], np.s_[:, -4:]):
+        input_model.pixeldq[edge] = dqflags.pixel['DO_NOT_USE']
+    expected = input_model.data.copy()
+    batched_model = input_model.copy()
+
+    status = correct_model(input_model, True, True, 11, 1.0, False)
+    batched_status = correct_model(batched_model, True, True, 11, 1.0, False,
+                                   batched=True)
+
+    assert status == batched_status == BAD_REFERENCE_PIXELS
+    np.testing.assert_array_equal(input_model.data, expected)
+    np.testing.assert_array_equal(batched_model.data, expected)
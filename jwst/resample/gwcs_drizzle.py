@@ -115,7 +115,7 @@ class GWCSDrizzle:
 
     def add_image(self, insci, inwcs, inwht=None,
                   xmin=0, xmax=0, ymin=0, ymax=0, pscale_ratio=1.0,
-                  expin=1.0, in_units="cps", wt_scl=1.0):
+                  expin=1.0, in_units="cps", wt_scl=1.0, pixmap=None):
         """
         Combine an input image with the output drizzled image.
 
@@ -180,6 +180,11 @@ class GWCSDrizzle:
             initialized with wt_scl set to "exptime" or "expsq", the exposure time
             will be used to set the weight scaling and the value of this parameter
             will be ignored.
+
+        pixmap : array, optional
+            The mapping of the input pixels to the output image, as returned by
+            `~jwst.resample.resample_utils.calc_gwcs_pixmap`. It is computed
+            from `inwcs` if not given.
         """
         insci = insci.astype(np.float32)
 
@@ -202,7 +207,7 @@ class GWCSDrizzle:
                             pscale_ratio=pscale_ratio, uniqid=self.uniqid,
                             xmin=xmin, xmax=xmax, ymin=ymin, ymax=ymax,
                             pixfrac=self.pixfrac, kernel=self.kernel,
-                            fillval=self.fillval)
+                            fillval=self.fillval, pixmap=pixmap)
 
     def blot_image(self, blotwcs, interp='poly5', sinscl=1.0):
         """
@@ -263,7 +268,7 @@ def dodrizzle(insci, input_wcs, inwht,
               expin, in_units, wt_scl,
               pscale_ratio=1.0, uniqid=1,
               xmin=0, xmax=0, ymin=0, ymax=0,
-              pixfrac=1.0, kernel='square', fillval="INDEF"):
+              pixfrac=1.0, kernel='square', fillval="INDEF", pixmap=None):
     """
     Low level routine for performing 'drizzle' operation on one image.
 
@@ -368,6 +373,10 @@ def dodrizzle(insci, input_wcs, inwht,
         The value a pixel is set to in the output if the input image does
         not overlap it. The default value of INDEF does not set a value.
 
+    pixmap : 3d array, optional
+        The mapping between the input and output pixel coordinates. If None
+        it is computed from `input_wcs` and `output_wcs`.
+
     Returns
     -------
     A tuple with three values: a version string, the number of pixels
@@ -422,7 +431,8 @@ def dodrizzle(insci, input_wcs, inwht,
 
     # Compute the mapping between the input and output pixel coordinates
     # for use in drizzle.cdrizzle.tdriz
-    pixmap = resample_utils.calc_gwcs_pixmap(input_wcs, output_wcs, insci.shape)
+    if pixmap is None:
+        pixmap = resample_utils.calc_gwcs_pixmap(input_wcs, output_wcs, insci.shape)
     # pixmap[np.isnan(pixmap)] = -10
     # print("Number of NaNs: ", len(np.isnan(pixmap)) / 2)
     # inwht[np.isnan(pixmap[:,:,0])] = 0.
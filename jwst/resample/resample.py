@@ -1,10 +1,12 @@
 import logging
+import os
 from collections import OrderedDict
 import numpy as np
 
 from .. import datamodels
 
 from . import gwcs_drizzle
+from ..lib.multiprocessing_utils import num_processes
 from . import resample_utils
 from ..model_blender import blendmeta
 
@@ -62,6 +64,13 @@ class ResampleData:
 
         self.output_models = datamodels.ModelContainer()
 
+        # In single-drizzle mode, the outputs can be written to this directory
+        # and memory-mapped back, instead of being kept in memory
+        self.single_dir = pars.get('single_dir')
+
+        # Number of processes computing the pixel maps of the inputs
+        self.num_processes = num_processes(pars.get('maximum_cores'))
+
     def update_driz_outputs(self):
         """ Define output arrays for use with drizzle operations.
         """
@@ -108,55 +117,98 @@ class ResampleData:
             group_exptime = [total_exposure_time]
         pointings = len(self.input_models.group_names)
 
-        for obs_product, exposure, texptime in zip(driz_outputs, exposures,
-                                                   group_exptime):
-            output_model = self.blank_output.copy()
-            output_model.meta.filename = obs_product
-            saved_model_type = output_model.meta.model_type
-
-            if self.drizpars['blendheaders']:
-                self.blend_output_metadata(output_model)
-                output_model.meta.model_type = saved_model_type
-
-            exposure_times = {'start': [], 'end': []}
-
-            # Initialize the output with the wcs
-            driz = gwcs_drizzle.GWCSDrizzle(output_model,
-                                            single=self.drizpars['single'],
-                                            pixfrac=self.drizpars['pixfrac'],
-                                            kernel=self.drizpars['kernel'],
-                                            fillval=self.drizpars['fillval'])
-
-            for n, img in enumerate(exposure):
-                exposure_times['start'].append(img.meta.exposure.start_time)
-                exposure_times['end'].append(img.meta.exposure.end_time)
-
-                # apply sky subtraction
-                blevel = img.meta.background.level
-                if not img.meta.background.subtracted and blevel is not None:
-                    img.data -= blevel
-
-                outwcs_pscale = output_model.meta.wcsinfo.cdelt1
-                wcslin_pscale = img.meta.wcsinfo.cdelt1
-
-                inwht = resample_utils.build_driz_weight(img,
-                    weight_type=self.drizpars['weight_type'],
-                    good_bits=self.drizpars['good_bits'])
-                driz.add_image(img.data, img.meta.wcs, inwht=inwht,
-                        expin=img.meta.exposure.exposure_time,
-                        pscale_ratio=outwcs_pscale / wcslin_pscale)
-
-            # Update some basic exposure time values based on all the inputs
-            output_model.meta.exposure.exposure_time = texptime
-            output_model.meta.exposure.start_time = min(exposure_times['start'])
-            output_model.meta.exposure.end_time = max(exposure_times['end'])
-            output_model.meta.resample.product_exposure_time = texptime
-            output_model.meta.resample.weight_type = self.drizpars['weight_type']
-            output_model.meta.resample.pointings = pointings
-
-            self.update_fits_wcs(output_model)
-
-            self.output_models.append(output_model)
+        # The pixel maps of the inputs, in the order they are drizzled
+        pixmaps = self.iter_pixmaps(exposures)
+
+        try:
+            for obs_product, exposure, texptime in zip(driz_outputs, exposures,
+                                                       group_exptime):
+                output_model = self.blank_output.copy()
+                output_model.meta.filename = obs_product
+                saved_model_type = output_model.meta.model_type
+
+                if self.drizpars['blendheaders']:
+                    self.blend_output_metadata(output_model)
+                    output_model.meta.model_type = saved_model_type
+
+                exposure_times = {'start': [], 'end': []}
+
+                # Initialize the output with the wcs
+                driz = gwcs_drizzle.GWCSDrizzle(output_model,
+                                                single=self.drizpars['single'],
+                                                pixfrac=self.drizpars['pixfrac'],
+                                                kernel=self.drizpars['kernel'],
+                                                fillval=self.drizpars['fillval'])
+
+                for n, img in enumerate(exposure):
+                    exposure_times['start'].append(img.meta.exposure.start_time)
+                    exposure_times['end'].append(img.meta.exposure.end_time)
+
+                    # apply sky subtraction
+                    blevel = img.meta.background.level
+                    if not img.meta.background.subtracted and blevel is not None:
+                        img.data -= blevel
+
+                    outwcs_pscale = output_model.meta.wcsinfo.cdelt1
+                    wcslin_pscale = img.meta.wcsinfo.cdelt1
+
+                    inwht = resample_utils.build_driz_weight(img,
+                        weight_type=self.drizpars['weight_type'],
+                        good_bits=self.drizpars['good_bits'])
+                    driz.add_image(img.data, img.meta.wcs, inwht=inwht,
+                            expin=img.meta.exposure.exposure_time,
+                            pscale_ratio=outwcs_pscale / wcslin_pscale,
+                            pixmap=next(pixmaps))
+
+                # Update some basic exposure time values based on all the inputs
+                output_model.meta.exposure.exposure_time = texptime
+                output_model.meta.exposure.start_time = min(exposure_times['start'])
+                output_model.meta.exposure.end_time = max(exposure_times['end'])
+                output_model.meta.resample.product_exposure_time = texptime
+                output_model.meta.resample.weight_type = self.drizpars['weight_type']
+                output_model.meta.resample.pointings = pointings
+
+                self.update_fits_wcs(output_model)
+
+                if self.drizpars['single'] and self.single_dir is not None:
+                    output_model = self.move_to_disk(output_model,
+                                                     len(self.output_models))
+
+                self.output_models.append(output_model)
+        finally:
+            pixmaps.close()
+
+    def iter_pixmaps(self, exposures):
+        """
+        Yield the pixel map of each image of `exposures` on the output WCS.
+
+        With more than one process, the pixel maps of up to `num_processes`
+        images are computed at the same time, so that only that many are held
+        in memory. Otherwise None is yielded and each pixel map is computed
+        when its image is drizzled. The generator is to be closed by the
+        caller, which terminates the processes.
+        """
+        if self.num_processes <= 1:
+            return (None for exposure in exposures for img in exposure)
+        jobs = [(img.meta.wcs, self.output_wcs, img.data.shape)
+                for exposure in exposures for img in exposure]
+        return resample_utils.iter_pixmaps(jobs, self.num_processes)
+
+    def move_to_disk(self, output_model, index):
+        """
+        Write a single-drizzled output to `single_dir` and return it opened
+        with its arrays memory-mapped from the file.
+        """
+        obs_product = output_model.meta.filename
+        output_path = os.path.join(self.single_dir,
+                                   'single_{:04d}.fits'.format(index))
+        log.debug('Writing {} to {}'.format(obs_product, output_path))
+        output_model.save(output_path)
+        output_model.close()
+
+        output_model = datamodels.DrizProductModel(output_path, memmap=True)
+        output_model.meta.filename = obs_product
+        return output_model
 
     def update_fits_wcs(self, model):
         """
@@ -1,5 +1,6 @@
 import logging
-from collections import OrderedDict
+from collections import OrderedDict, deque
+import itertools
 import warnings
 
 import numpy as np
@@ -14,6 +15,7 @@ from gwcs import coordinate_frames as cf
 
 from .. import datamodels
 from . import gwcs_drizzle
+from ..lib.multiprocessing_utils import num_processes
 from . import resample_utils
 
 
@@ -60,6 +62,7 @@ class ResampleSpecData:
             output = input_models.meta.resample.output
 
         self.drizpars = pars
+        self.num_processes = num_processes(pars.get('maximum_cores'))
 
         self.pscale_ratio = 1.
         self.blank_output = None
@@ -67,10 +70,6 @@ class ResampleSpecData:
         # Define output WCS based on all inputs, including a reference WCS
         # wcslist = [m.meta.wcs for m in self.input_models]
         self.output_wcs = self.build_interpolated_output_wcs()
-        self.blank_output = datamodels.DrizProductModel(self.data_size)
-
-        self.blank_output.update(datamodels.ImageModel(self.input_models[0]._instance))
-        self.blank_output.meta.wcs = self.output_wcs
         self.output_models = datamodels.ModelContainer()
 
     def build_interpolated_output_wcs(self, refmodel=None):
@@ -194,9 +193,51 @@ class ResampleSpecData:
 
         return output_wcs
 
-    def do_drizzle(self, **pars):
+    def model_groups(self):
+        """
+        Groups of input models drizzled to each output, in order.
+        """
+        if self.drizpars['single']:
+            return self.input_models.models_grouped
+        return [self.input_models]
+
+    def pixmap_jobs(self):
+        """
+        Arguments of `~jwst.resample.resample_utils.calc_gwcs_pixmap` for
+        each slit, in the order they are drizzled by `do_drizzle`.
+        """
+        return [(img.meta.wcs, self.output_wcs, img.data.shape)
+                for group in self.model_groups() for img in group]
+
+    def do_drizzle(self, pixmaps=None, **pars):
         """ Perform drizzling operation on input images's to create a new output
+
+        Parameters
+        ----------
+        pixmaps : iterator, optional
+            The pixel map of each slit, in the order of `pixmap_jobs`, or None
+            for a slit whose pixel map is to be computed when it is drizzled.
+            If not given, the pixel maps are computed with `num_processes`
+            processes.
         """
+        if pixmaps is None:
+            if self.num_processes > 1:
+                pixmaps = resample_utils.iter_pixmaps(self.pixmap_jobs(),
+                                                      self.num_processes)
+                try:
+                    return self.do_drizzle(pixmaps=pixmaps, **pars)
+                finally:
+                    pixmaps.close()
+            pixmaps = itertools.repeat(None)
+
+        # The blank output is only created when drizzling, so that the
+        # outputs of the sources still waiting in drizzle_sources are not
+        # held in memory.
+        if self.blank_output is None:
+            self.blank_output = datamodels.DrizProductModel(self.data_size)
+            self.blank_output.update(datamodels.ImageModel(self.input_models[0]._instance))
+            self.blank_output.meta.wcs = self.output_wcs
+
         # Set up information about what outputs we need to create: single or final
         # Key: value from metadata for output/observation name
         # Value: full filename for output file
@@ -204,16 +245,15 @@ class ResampleSpecData:
 
         # Look for input configuration parameter telling the code to run
         # in single-drizzle mode (mosaic all detectors in a single observation?)
+        model_groups = self.model_groups()
         if self.drizpars['single']:
             driz_outputs = ['{0}_resamp.fits'.format(g) for g in self.input_models.group_names]
-            model_groups = self.input_models.models_grouped
             group_exptime = []
             for group in model_groups:
                 group_exptime.append(group[0].meta.exposure.exposure_time)
         else:
             final_output = self.input_models.meta.resample.output
             driz_outputs = [final_output]
-            model_groups = [self.input_models]
 
             total_exposure_time = 0.0
             for group in self.input_models.models_grouped:
@@ -257,7 +297,8 @@ class ResampleSpecData:
                 in_wcs = img.meta.wcs
                 driz.add_image(img.data, in_wcs, inwht=inwht,
                         expin=img.meta.exposure.exposure_time,
-                        pscale_ratio=self.pscale_ratio)
+                        pscale_ratio=self.pscale_ratio,
+                        pixmap=next(pixmaps))
 
             # Update some basic exposure time values based on all the inputs
             output_model.meta.exposure.exposure_time = texptime
@@ -284,6 +325,48 @@ class ResampleSpecData:
         return self.output_models
 
 
+def drizzle_sources(containers, **pars):
+    """
+    Resample the slits of each source of `containers`.
+
+    The output WCS of all the sources are built first, so that the pixel
+    maps of the slits of several sources are computed at the same time when
+    ``maximum_cores`` allows more than one process. At most that many pixel
+    maps are held in memory while the slits are drizzled, one source after
+    the other, and the outputs of a source are only created when its slits
+    are drizzled.
+
+    Parameters
+    ----------
+    containers : iterable of `~jwst.datamodels.ModelContainer`
+        The slits of each source.
+
+    pars : dict
+        Drizzle parameters, as for `ResampleSpecData`.
+
+    Yields
+    ------
+    container, drizzled_models : `~jwst.datamodels.ModelContainer`
+        Each container of `containers` and its resampled slits.
+    """
+    resamplers = deque((container, ResampleSpecData(container, **pars))
+                       for container in containers)
+    nproc = num_processes(pars.get('maximum_cores'))
+    pixmaps = None
+    if nproc > 1:
+        jobs = [job for _, resamp in resamplers
+                for job in resamp.pixmap_jobs()]
+        pixmaps = resample_utils.iter_pixmaps(jobs, nproc)
+    try:
+        # drop each resampler once drizzled, with its blank output
+        while resamplers:
+            container, resamp = resamplers.popleft()
+            yield container, resamp.do_drizzle(pixmaps=pixmaps)
+    finally:
+        if pixmaps is not None:
+            pixmaps.close()
+
+
 def find_dispersion_axis(refmodel):
     """
     Find the dispersion axis (0-indexed) of the given 2D wavelength array
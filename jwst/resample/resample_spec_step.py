@@ -43,6 +43,7 @@ class ResampleSpecStep(ResampleStep):
             # Deal with NIRSpec which currently has no default drizpars reffile
             self.log.info("No NIRSpec DIRZPARS reffile")
             kwargs = self._set_spec_defaults()
+            kwargs['maximum_cores'] = self.maximum_cores
 
         self.drizpars = kwargs
 
@@ -74,9 +75,8 @@ class ResampleSpecStep(ResampleStep):
         containers = multislit_to_container(input_models)
         result = datamodels.MultiProductModel()
         result.update(input_models[0])
-        for container in containers.values():
-            resamp = resample_spec.ResampleSpecData(container, **self.drizpars)
-            drizzled_models = resamp.do_drizzle()
+        for container, drizzled_models in resample_spec.drizzle_sources(
+                containers.values(), **self.drizpars):
 
             for model in drizzled_models:
                 model.meta.cal_step.resample = "COMPLETE"
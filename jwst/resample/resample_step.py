@@ -6,6 +6,7 @@ from ..stpipe import Step
 from ..extern.configobj.validate import Validator
 from ..extern.configobj.configobj import ConfigObj
 from .. import datamodels
+from ..datamodels import filetype
 from . import resample
 from ..assign_wcs import util
 
@@ -33,13 +34,21 @@ class ResampleStep(Step):
         good_bits = integer(min=0, default=6)
         single = boolean(default=False)
         blendheaders = boolean(default=True)
+        maximum_cores = option('quarter', 'half', 'all', default=None) # max number of processes computing pixel maps
+        max_open = integer(min=1, default=None) # max number of members of an association file kept open
     """
 
     reference_file_types = ['drizpars']
 
     def process(self, input):
 
-        input = datamodels.open(input)
+        if self.max_open is not None and isinstance(input, str) and \
+                filetype.check(input) == 'asn':
+            # Open each member when it is resampled, memory-mapped, and
+            # close the least recently used ones beyond max_open
+            input = datamodels.open(input, lazy=True, max_open=self.max_open)
+        else:
+            input = datamodels.open(input)
 
         # If single input, wrap in a ModelContainer
         if not isinstance(input, datamodels.ModelContainer):
@@ -65,6 +74,7 @@ class ResampleStep(Step):
             # Deal with NIRSpec which currently has no default drizpars reffile
             self.log.info("No NIRSpec DIRZPARS reffile")
             kwargs = self._set_spec_defaults()
+            kwargs['maximum_cores'] = self.maximum_cores
 
         # Call the resampling routine
         resamp = resample.ResampleData(input_models, **kwargs)
@@ -163,7 +173,8 @@ class ResampleStep(Step):
         kwargs = dict(
             good_bits=self.good_bits,
             single=self.single,
-            blendheaders=self.blendheaders
+            blendheaders=self.blendheaders,
+            maximum_cores=self.maximum_cores
             )
 
         kwargs.update(all_drizpars)
@@ -1,4 +1,5 @@
 import logging
+import multiprocessing
 import warnings
 
 import numpy as np
@@ -112,6 +113,35 @@ def calc_gwcs_pixmap(in_wcs, out_wcs, shape=None):
     return pixmap
 
 
+def iter_pixmaps(jobs, num_processes=1):
+    """
+    Yield the pixel map of each ``(in_wcs, out_wcs, shape)`` of `jobs`, in
+    order, as computed by `calc_gwcs_pixmap`.
+
+    With more than one process, the pixel maps of up to `num_processes`
+    jobs are computed at the same time, so that only that many are held in
+    memory. Otherwise None is yielded and each pixel map is computed when
+    its image is drizzled.
+    """
+    jobs = list(jobs)
+    num_processes = min(num_processes, len(jobs))
+    if num_processes <= 1:
+        for job in jobs:
+            yield None
+        return
+
+    log.info('Computing pixel maps with {} processes'.format(num_processes))
+    pool = multiprocessing.Pool(processes=num_processes)
+    try:
+        for start in range(0, len(jobs), num_processes):
+            batch = jobs[start:start + num_processes]
+            for pixmap in pool.starmap(calc_gwcs_pixmap, batch):
+                yield pixmap
+    finally:
+        pool.terminate()
+        pool.close()
+
+
 def reproject(wcs1, wcs2):
     """
     Given two WCSs or transforms return a function which takes pixel
@@ -0,0 +1,111 @@
+"""
+Test that the images drizzled with pixel maps computed by a pool of
+processes match the ones drizzled with their pixel maps computed serially
+"""
+import numpy as np
+from numpy.testing import assert_array_equal
+import pytest
+
+from astropy import coordinates as coord
+from astropy import units as u
+from astropy.modeling.models import (Shift, Scale, Pix2Sky_TAN,
+                                     RotateNative2Celestial)
+from gwcs import WCS
+from gwcs import coordinate_frames as cf
+
+from jwst import datamodels
+from jwst.lib import multiprocessing_utils
+from jwst.resample import resample
+
+
+def imaging_wcs(shape, ra, dec, cdelt):
+    nrows, ncols = shape
+    transform = ((Shift(-(ncols - 1) / 2) & Shift(-(nrows - 1) / 2)) |
+                 (Scale(cdelt) & Scale(cdelt)) | Pix2Sky_TAN() |
+                 RotateNative2Celestial(ra, dec, 180.))
+    detector = cf.Frame2D(name='detector', axes_order=(0, 1),
+                          unit=(u.pix, u.pix))
+    world = cf.CelestialFrame(reference_frame=coord.ICRS(), name='world')
+    return WCS([(detector, transform), (world, None)])
+
+
+def dithered_models(nexposures=4, shape=(30, 40), ra=5.3, dec=-72.1,
+                    pscale=0.031):
+    """ Container of dithered images, each its own exposure """
+    rng = np.random.RandomState(42)
+    cdelt = pscale / 3600.
+
+    models = datamodels.ModelContainer()
+    for i in range(nexposures):
+        offset = rng.uniform(-5., 5., size=2) * cdelt
+        model = datamodels.ImageModel(shape)
+        model.data[...] = rng.normal(loc=1., scale=0.1, size=shape)
+        model.err[...] = 0.1
+        model.meta.wcs = imaging_wcs(shape, ra + offset[0], dec + offset[1],
+                                     cdelt)
+        model.meta.wcsinfo.wcsaxes = 2
+        model.meta.wcsinfo.ctype1 = 'RA---TAN'
+        model.meta.wcsinfo.ctype2 = 'DEC--TAN'
+        model.meta.wcsinfo.cdelt1 = cdelt
+        model.meta.wcsinfo.cdelt2 = cdelt
+        model.meta.wcsinfo.pc1_1 = 1.
+        model.meta.wcsinfo.pc1_2 = 0.
+        model.meta.wcsinfo.pc2_1 = 0.
+        model.meta.wcsinfo.pc2_2 = 1.
+        model.meta.coordinates.reference_frame = 'ICRS'
+        model.meta.instrument.name = 'NIRCAM'
+        model.meta.exposure.exposure_time = 100.
+        model.meta.exposure.start_time = 58000. + i
+        model.meta.exposure.end_time = 58000. + i + 0.01
+        model.meta.observation.program_number = '00001'
+        model.meta.observation.observation_number = '001'
+        model.meta.observation.visit_number = '001'
+        model.meta.observation.visit_group = '01'
+        model.meta.observation.sequence_id = '1'
+        model.meta.observation.activity_id = '01'
+        model.meta.observation.exposure_number = str(i + 1)
+        model.meta.filename = 'test_{:04d}_cal.fits'.format(i)
+        models.append(model)
+    models.meta.resample.output = 'test_i2d.fits'
+    return models
+
+
+def drizzle(maximum_cores, single):
+    resamp = resample.ResampleData(
+        dithered_models(), pixfrac=1.0, kernel='square', fillval='INDEF',
+        weight_type='exptime', good_bits=6, single=single,
+        blendheaders=False, maximum_cores=maximum_cores)
+    resamp.do_drizzle()
+    return resamp
+
+
+@pytest.mark.parametrize('single', [True, False])
+def test_pool_pixmaps_match_serial(monkeypatch, single):
+    monkeypatch.setattr(multiprocessing_utils.multiprocessing, 'cpu_count', lambda: 3)
+
+    serial = drizzle(None, single)
+    parallel = drizzle('all', single)
+    assert serial.num_processes == 1
+    assert parallel.num_processes == 3
+
+    assert len(serial.output_models) == (4 if single else 1)
+    assert len(parallel.output_models) == len(serial.output_models)
+    for par, ser in zip(parallel.output_models, serial.output_models):
+        assert par.meta.filename == ser.meta.filename
+        assert np.any(ser.wht > 0)
+        assert_array_equal(par.data, ser.data)
+        assert_array_equal(par.wht, ser.wht)
+        assert_array_equal(par.con, ser.con)
+
+
+def test_serial_pixmaps_skip_jobs():
+    """
+    Test that no pixel map jobs are made for the inputs without a pool
+    """
+    resamp = resample.ResampleData(dithered_models(), single=False,
+                                   blendheaders=False, maximum_cores=None)
+    # placeholders that have no WCS nor data to make the jobs from
+    exposures = [[object(), object()], [object()]]
+    pixmaps = resamp.iter_pixmaps(exposures)
+    assert list(pixmaps) == [None, None, None]
+    pixmaps.close()
@@ -1,5 +1,5 @@
 import numpy as np
-from numpy.testing import assert_allclose
+from numpy.testing import assert_allclose, assert_array_equal
 
 from ...datamodels import ImageModel
 from jwst.assign_wcs import AssignWcsStep
@@ -9,7 +9,8 @@ from jwst.resample import ResampleSpecStep
 from gwcs.wcstools import grid_from_bounding_box
 
 
-def test_spatial_transform_nirspec():
+def nirspec_fs_model(subarray_name='SUBS200A1'):
+    """ Fixed slit exposure of NRS1 with its WCS assigned """
     wcsinfo = {
         'dec_ref': -0.00601415671349804,
         'ra_ref': -0.02073605215697509,
@@ -28,14 +29,24 @@ def test_spatial_transform_nirspec():
         'gwa_xtilt': 0.0001,
         'gwa_ytilt': 0.0001}
 
-    subarray = {
-        'fastaxis': 1,
-        'name': 'SUBS200A1',
-        'slowaxis': 2,
-        'xsize': 72,
-        'xstart': 1,
-        'ysize': 416,
-        'ystart': 529}
+    if subarray_name == 'FULL':
+        subarray = {
+            'fastaxis': 1,
+            'name': 'FULL',
+            'slowaxis': 2,
+            'xsize': 2048,
+            'xstart': 1,
+            'ysize': 2048,
+            'ystart': 1}
+    else:
+        subarray = {
+            'fastaxis': 1,
+            'name': subarray_name,
+            'slowaxis': 2,
+            'xsize': 72,
+            'xstart': 1,
+            'ysize': 416,
+            'ystart': 529}
 
     observation = {
         'date': '2016-09-05',
@@ -70,7 +81,11 @@ def test_spatial_transform_nirspec():
     im.meta.observation._instance.update(observation)
     im.meta.exposure._instance.update(exposure)
     im.meta.subarray._instance.update(subarray)
-    im = AssignWcsStep.call(im)
+    return AssignWcsStep.call(im)
+
+
+def test_spatial_transform_nirspec():
+    im = nirspec_fs_model()
 
     im = Extract2dStep.call(im)
 
@@ -84,6 +99,23 @@ def test_spatial_transform_nirspec():
         assert_allclose(slit.meta.wcs.invert(ra, dec, lam), slit.meta.wcs.invert(ra1, dec, lam))
 
 
+def test_multislit_processes():
+    """ The slits resampled with pixel maps computed by a pool of processes
+    match the ones resampled serially """
+    slits = Extract2dStep.call(nirspec_fs_model('FULL'))
+    assert len(slits.slits) > 1
+
+    serial = ResampleSpecStep.call(slits.copy())
+    parallel = ResampleSpecStep.call(slits.copy(), maximum_cores='all')
+
+    assert len(parallel.products) == len(serial.products)
+    for par, ser in zip(parallel.products, serial.products):
+        assert par.name == ser.name
+        assert_array_equal(par.data, ser.data)
+        assert_array_equal(par.wht, ser.wht)
+        assert_array_equal(par.con, ser.con)
+
+
 def test_spatial_transform_miri():
     wcsinfo = {
         'dec_ref': -0.00601415671349804,
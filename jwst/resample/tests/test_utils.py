@@ -1,5 +1,10 @@
+from numpy.testing import assert_allclose
+from astropy.modeling.models import Shift
+from gwcs import WCS
+
 from jwst.datamodels import SlitModel
 
+from jwst.resample import resample_utils
 from jwst.resample.resample_spec import find_dispersion_axis
 
 
@@ -14,3 +19,22 @@ def test_find_dispersion_axis():
 
     dm.meta.wcsinfo.dispersion_direction = 2    # vertical
     assert find_dispersion_axis(dm) == 1        # Y axis for wcs functions
+
+
+def test_iter_pixmaps():
+    """
+    Test that the pixel maps computed in parallel are those of
+    calc_gwcs_pixmap, in the order of the jobs
+    """
+    out_wcs = WCS(Shift(0.5) & Shift(-0.5), output_frame='world')
+    jobs = [(WCS(Shift(0.3 * i) & Shift(-0.2 * i), output_frame='world'),
+             out_wcs, (5, 7 + i)) for i in range(5)]
+
+    assert list(resample_utils.iter_pixmaps(jobs)) == [None] * len(jobs)
+
+    pixmaps = list(resample_utils.iter_pixmaps(jobs, num_processes=2))
+    assert len(pixmaps) == len(jobs)
+    for job, pixmap in zip(jobs, pixmaps):
+        expected = resample_utils.calc_gwcs_pixmap(*job)
+        assert pixmap.shape == expected.shape
+        assert_allclose(pixmap, expected)
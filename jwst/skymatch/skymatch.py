@@ -10,6 +10,7 @@ import numpy as np
 
 # LOCAL
 from . skyimage import SkyImage, SkyGroup
+from ..lib.multiprocessing_utils import fork_pool, fork_processes
 
 
 __all__ = ['match']
@@ -25,7 +26,8 @@ log = logging.getLogger(__name__)
 log.setLevel(logging.DEBUG)
 
 
-def match(images, skymethod='global+match', match_down=True, subtract=False):
+def match(images, skymethod='global+match', match_down=True, subtract=False,
+          nproc=1):
     """
     A function to compute and/or "equalize" sky background in input images.
 
@@ -93,6 +95,10 @@ stsci_python_sphinxdocs_2.13/drizzlepac/astrodrizzle.html>`_ because it
     subtract : bool (Default = False)
         Subtract computed sky value from image data.
 
+    nproc : int (Default = 1)
+        Number of processes used to compute sky values in the overlap
+        regions of pairs of images.
+
 
     Raises
     ------
@@ -309,7 +315,8 @@ stsci_python_sphinxdocs_2.13/drizzlepac/astrodrizzle.html>`_\ .
                  "overlapping regions.")
 
         # find "optimum" sky changes:
-        sky_deltas = _find_optimum_sky_deltas(images, apply_sky=not subtract)
+        sky_deltas = _find_optimum_sky_deltas(images, apply_sky=not subtract,
+                                              nproc=nproc)
         sky_good = np.isfinite(sky_deltas)
 
         if np.any(sky_good):
@@ -478,37 +485,137 @@ def _apply_sky(images, sky_deltas, do_global, do_skysub, show_old):
     #return A, W
 
 # bug workaround version:
-def _overlap_matrix(images, apply_sky=True):
-    #TODO: to improve performance, the nested loops could be parallelized
-    # since _calc_sky() here can be called independently from previous steps.
+def _overlap_matrix(images, apply_sky=True, nproc=1):
     ns = len(images)
     A = np.zeros((ns, ns), dtype=float)
     W = np.zeros((ns, ns), dtype=float)
 
-    for i in range(ns):
-        for j in range(i + 1, ns):
-            s1, w1, area1 = images[i].calc_sky(
-                overlap=images[j], delta=apply_sky
+    # Only pairs whose bounding caps intersect can overlap; the sky values
+    # of the other pairs would be discarded as their overlap area is 0.
+    pairs = _candidate_pairs(images)
+    log.debug("{:d} out of {:d} pairs of images may overlap"
+              .format(len(pairs), ns * (ns - 1) // 2))
+
+    nproc = fork_processes(min(nproc, len(pairs)))
+    if nproc > 1:
+        log.info("Computing sky in overlap regions using {:d} processes"
+                 .format(nproc))
+        # The forked workers inherit the images when they start, instead
+        # of being sent them with each pair.
+        pool = fork_pool(nproc, _set_pool_images, (images,))
+        try:
+            skies = pool.starmap(
+                _pool_pair_sky, [(i, j, apply_sky) for i, j in pairs]
             )
+        finally:
+            pool.terminate()
+            pool.close()
+    else:
+        skies = [_pair_sky(images[i], images[j], apply_sky)
+                 for i, j in pairs]
+
+    for (i, j), (s1, w1, area1, s2, w2, area2) in zip(pairs, skies):
+        if area1 == 0.0 or area2 == 0.0 or s1 is None or s2 is None:
+            continue
+
+        A[j, i] = s1
+        W[j, i] = w1
+        A[i, j] = s2
+        W[i, j] = w2
 
-            s2, w2, area2 = images[j].calc_sky(
-                overlap=images[i], delta=apply_sky
-            )
+    return A, W
 
-            if area1 == 0.0 or area2 == 0.0 or s1 is None or s2 is None:
-                continue
 
-            A[j, i] = s1
-            W[j, i] = w1
-            A[i, j] = s2
-            W[i, j] = w2
+def _pair_sky(image1, image2, apply_sky):
+    """ Sky values of two images in their region of overlap. """
+    s1, w1, area1 = image1.calc_sky(overlap=image2, delta=apply_sky)
+    s2, w2, area2 = image2.calc_sky(overlap=image1, delta=apply_sky)
+    return s1, w1, area1, s2, w2, area2
 
-    return A, W
+
+# Images that the pairs computed by a pool worker refer to:
+_pool_images = None
+
+
+def _set_pool_images(images):
+    global _pool_images
+    _pool_images = images
+
+
+def _pool_pair_sky(i, j, apply_sky):
+    return _pair_sky(_pool_images[i], _pool_images[j], apply_sky)
+
+
+def _bounding_cap(image):
+    """
+    Spherical cap that contains the bounding polygon of a `SkyImage` or
+    `SkyGroup`.
+
+    Returns
+    -------
+    center : numpy.ndarray, None
+        Unit vector of the center of the cap, or `None` if the polygon is
+        empty.
+
+    radius : float
+        Angular radius of the cap, in radians. It is taken to be pi
+        (the cap is the whole sphere) when the polygon cannot be bounded by
+        a cap smaller than a hemisphere.
+
+    """
+    points = [p for p in image.polygon.points if len(p) > 0]
+    if not points:
+        return None, 0.0
+
+    xyz = np.vstack(points)
+    center = xyz.sum(axis=0)
+    norm = np.linalg.norm(center)
+    if norm == 0.0:
+        return np.array([0.0, 0.0, 1.0]), np.pi
+    center /= norm
+
+    radius = np.arccos(np.clip(np.dot(xyz, center), -1.0, 1.0)).max()
+    if radius >= 0.5 * np.pi:
+        # Only caps smaller than a hemisphere contain the arcs between
+        # their points.
+        radius = np.pi
+
+    return center, radius
+
+
+def _candidate_pairs(images, tol=1.0e-6):
+    """
+    Pairs of indices ``(i, j)``, ``i < j``, of the images whose bounding
+    caps intersect, i.e., of all the images that may overlap.
+
+    Parameters
+    ----------
+    images : list of SkyImage or SkyGroup
+        Images to be paired.
+
+    tol : float, optional
+        Margin (in radians) added to the sum of the radii of two caps in
+        order to account for rounding errors.
+
+    """
+    ns = len(images)
+    caps = [_bounding_cap(im) for im in images]
+    valid = np.array([c is not None for c, _ in caps], dtype=bool)
+    centers = np.array([np.zeros(3) if c is None else c for c, _ in caps])
+    radii = np.array([r for _, r in caps])
+    centers = centers.reshape((ns, 3))
+
+    sep = np.arccos(np.clip(np.dot(centers, centers.T), -1.0, 1.0))
+    close = sep <= radii[:, np.newaxis] + radii[np.newaxis, :] + tol
+    close &= valid[:, np.newaxis] & valid[np.newaxis, :]
+
+    i, j = np.nonzero(np.triu(close, k=1))
+    return list(zip(i.tolist(), j.tolist()))
 
 
-def _find_optimum_sky_deltas(images, apply_sky=True):
+def _find_optimum_sky_deltas(images, apply_sky=True, nproc=1):
     ns = len(images)
-    A, W = _overlap_matrix(images, apply_sky=apply_sky)
+    A, W = _overlap_matrix(images, apply_sky=apply_sky, nproc=nproc)
 
     def is_valid(i, j):
         return (W[i, j] > 0 and W[j, i] > 0)
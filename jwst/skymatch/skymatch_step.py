@@ -13,6 +13,7 @@ import logging
 
 from ..stpipe import Step
 from .. import datamodels
+from ..lib.multiprocessing_utils import num_processes
 
 from astropy.nddata.bitmask import (
     bitfield_to_boolean_mask,
@@ -37,6 +38,7 @@ class SkyMatchStep(Step):
         skymethod = option('local', 'global', 'match', 'global+match', default='global+match') # sky computation method
         match_down = boolean(default=True) # adjust sky to lowest measured value?
         subtract = boolean(default=False) # subtract computed sky from image data?
+        maximum_cores = option('quarter', 'half', 'all', default=None) # max number of processes to use for matching
 
         # Image's bounding polygon parameters:
         stepsize = integer(default=None) # Max vertex separation
@@ -94,7 +96,7 @@ class SkyMatchStep(Step):
 
         # match/compute sky values:
         match(images, skymethod=self.skymethod, match_down=self.match_down,
-              subtract=self.subtract)
+              subtract=self.subtract, nproc=num_processes(self.maximum_cores))
 
         # set sky background value in each image's meta:
         for im in images:
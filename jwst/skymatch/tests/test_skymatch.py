@@ -0,0 +1,86 @@
+"""
+Test the sky matching of overlapping images, serially and with a pool of
+processes.
+"""
+import numpy as np
+import pytest
+from astropy import coordinates as coord
+from astropy import units as u
+from astropy.modeling.models import (Shift, Scale, Pix2Sky_TAN,
+                                     RotateNative2Celestial)
+from gwcs import WCS
+from gwcs import coordinate_frames as cf
+
+from jwst.skymatch import skymatch
+from jwst.skymatch.skyimage import SkyImage
+
+shape = (60, 80)
+pscale = 0.1 / 3600.
+# Offsets (in pixels) of the images from the center of the mosaic; the
+# last image is far from all the others.
+offsets = [(0, 0), (30, 5), (-25, 10), (10, -30), (-5, 35), (5000, 5000)]
+levels = [10., 12.5, 9., 11., 14., 20.]
+
+
+def make_wcs(ra, dec):
+    transform = ((Shift(-(shape[1] - 1) / 2) & Shift(-(shape[0] - 1) / 2)) |
+                 (Scale(pscale) & Scale(pscale)) | Pix2Sky_TAN() |
+                 RotateNative2Celestial(ra, dec, 180.))
+    detector = cf.Frame2D(name='detector', axes_order=(0, 1),
+                          unit=(u.pix, u.pix))
+    world = cf.CelestialFrame(reference_frame=coord.ICRS(), name='world')
+    return WCS([(detector, transform), (world, None)])
+
+
+def make_images():
+    rng = np.random.RandomState(3)
+    ra0, dec0 = 5.3, -72.1
+    images = []
+    for k, ((dx, dy), level) in enumerate(zip(offsets, levels)):
+        ra = ra0 + dx * pscale / np.cos(np.deg2rad(dec0))
+        dec = dec0 + dy * pscale
+        wcs = make_wcs(ra, dec)
+        data = level + rng.normal(scale=0.1, size=shape)
+        images.append(SkyImage(data, wcs_fwd=wcs.__call__,
+                               wcs_inv=wcs.invert, id=k))
+    return images
+
+
+def test_candidate_pairs():
+    """The far image doesn't pair with any other; all the others pair."""
+    pairs = skymatch._candidate_pairs(make_images())
+    n = len(offsets) - 1
+    assert sorted(pairs) == [(i, j) for i in range(n)
+                             for j in range(i + 1, n)]
+
+
+@pytest.mark.parametrize('skymethod', ['match', 'global+match'])
+@pytest.mark.parametrize('nproc', [2, 4])
+def test_match_parallel(skymethod, nproc):
+    """Sky values with a pool are the same as serially computed ones."""
+    expected = make_images()
+    skymatch.match(expected, skymethod=skymethod, nproc=1)
+    images = make_images()
+    skymatch.match(images, skymethod=skymethod, nproc=nproc)
+
+    for im, truth in zip(images, expected):
+        assert im.is_sky_valid == truth.is_sky_valid
+        assert im.sky == truth.sky
+
+    # The overlapping images are matched to the lowest of their levels.
+    if skymethod == 'match':
+        skies = [im.sky for im in expected[:-1]]
+        np.testing.assert_allclose(
+            skies, np.subtract(levels[:-1], min(levels[:-1])), atol=0.1)
+
+
+def test_overlap_matrix_parallel():
+    """The overlap matrix doesn't depend on the number of processes."""
+    images = make_images()
+    A1, W1 = skymatch._overlap_matrix(images, nproc=1)
+    A3, W3 = skymatch._overlap_matrix(images, nproc=3)
+
+    np.testing.assert_array_equal(A3, A1)
+    np.testing.assert_array_equal(W3, W1)
+    # The far image has no overlap with the others.
+    assert not W1[-1].any() and not W1[:, -1].any()
@@ -0,0 +1,95 @@
+"""
+Background saving of the output files of a pipeline.
+
+A `BackgroundWriter` saves data models in a separate thread, so that the
+steps of a pipeline can go on computing while the output files of the
+previous steps are being written.  Each model is copied before it is
+queued, as the next steps may modify their input in place.
+"""
+from concurrent.futures import FIRST_COMPLETED, ThreadPoolExecutor, wait
+
+from . import log
+from . import profiling
+
+__all__ = ['BackgroundWriter']
+
+
+class BackgroundWriter:
+    """Save data models in a background thread, in the order queued.
+
+    Parameters
+    ----------
+    max_pending : int or None
+        If not None, `save` waits until fewer than this number of files
+        are waiting to be written, which limits the memory used by the
+        copies of the queued models.  Each queued model holds a full copy
+        of its arrays until it is written, and the copy is made by `save`
+        on the caller's thread, so it costs the step the time of copying
+        the model even though the file is written later.
+    """
+
+    def __init__(self, max_pending=None):
+        self._executor = ThreadPoolExecutor(max_workers=1)
+        self._futures = []
+        self._max_pending = max_pending
+
+    def save(self, model, path):
+        """Queue a copy of `model` to be saved to `path`.
+
+        The model is prepared for saving (`DataModel.on_save`) right away,
+        so its ``meta.filename`` is the name of the output file, as after
+        a synchronous save.  The size of the file is counted, once it is
+        written, in the performance records of the steps running now.
+
+        Returns
+        -------
+        output_path : str
+            The path the model will be saved in.
+        """
+        model.on_save(path)
+        snapshot = model.copy()
+        if self._max_pending is not None:
+            pending = self._pending()
+            while len(pending) >= self._max_pending:
+                wait(pending, return_when=FIRST_COMPLETED)
+                pending = self._pending()
+        log.log.debug('Queued {0} for saving'.format(path))
+        self._futures.append(self._executor.submit(
+            _save, snapshot, path, profiling.running_records()))
+        return path
+
+    def _pending(self):
+        return [future for future in self._futures if not future.done()]
+
+    def wait(self):
+        """Wait until all the queued models are saved.
+
+        Raises
+        ------
+        Exception
+            The first exception raised while saving a model.
+        """
+        futures, self._futures = self._futures, []
+        error = None
+        for future in futures:
+            exc = future.exception()
+            if exc is not None and error is None:
+                error = exc
+        if error is not None:
+            raise error
+
+    def close(self):
+        """Wait for the queued models to be saved and stop the thread."""
+        try:
+            self.wait()
+        finally:
+            self._executor.shutdown(wait=True)
+
+
+def _save(model, path, records):
+    try:
+        path = model.save(path)
+    finally:
+        model.close()
+    profiling.add_bytes_written(path, records)
+    log.log.info('Saved model in {0}'.format(path))
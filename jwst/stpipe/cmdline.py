@@ -8,6 +8,7 @@ import textwrap
 
 from . import config_parser
 from . import log
+from . import profiling
 from . import Step
 from . import utilities
 from .step import get_disable_crds_steppars
@@ -188,6 +189,11 @@ def just_the_step_from_cmdline(args, cls=None):
         '--disable-crds-steppars', action='store_true',
         help='Disable retrieval of step parameter references files from CRDS'
     )
+    parser1.add_argument(
+        '--profile', type=str,
+        help='Write the time, memory and I/O of each step to the specified '
+             'JSON file, and log a summary at the end.'
+    )
     known, _ = parser1.parse_known_args(args)
 
     try:
@@ -252,6 +258,7 @@ def just_the_step_from_cmdline(args, cls=None):
     del args.debug
     del args.save_parameters
     del args.disable_crds_steppars
+    del args.profile
     positional = args.args
     del args.args
 
@@ -307,6 +314,9 @@ def just_the_step_from_cmdline(args, cls=None):
         step.get_pars_model().save(known.save_parameters)
         log.log.info(f"Step/Pipeline parameters saved to '{known.save_parameters}'")
 
+    if known.profile:
+        profiling.enable(known.profile)
+
     return step, step_class, positional, debug_on_exception
 
 
@@ -356,6 +366,8 @@ def step_from_cmdline(args, cls=None):
             pdb.post_mortem()
         else:
             raise
+    finally:
+        profiling.finish()
 
     return step
 
@@ -36,6 +36,9 @@ directly in modules other than this crds_client so that dependency order and
 general integration can be managed here.
 """
 
+import datetime
+import json
+import os
 import re
 
 import crds
@@ -79,17 +82,222 @@ def get_multiple_reference_paths(dataset_model, reference_file_types, observator
 
     If both of the above fail,  observatory defaults to 'jwst'.
 
+    The results are cached for the rest of the process, keyed by the CRDS
+    context and the values of the selection parameters of the dataset, so
+    datasets with the same selection parameters are looked up only once.
+    See `_ReferenceCache`.
+
     Returns best references dict { filetype : filepath or "N/A", ... }
     """
     log.set_log_time(True)
-    data_dict = _get_data_dict(dataset_model)
     if observatory is None:
         observatory = dataset_model.meta.telescope or 'jwst'
     observatory = observatory.lower()
-    refpaths = _get_refpaths(data_dict, tuple(reference_file_types), observatory)
+    reference_file_types = tuple(reference_file_types)
+    if not reference_file_types:   # [] interpreted as *all types*.
+        return {}
+
+    context = get_context_used(observatory)
+    selector = _get_selector(dataset_model, context)
+    if selector is None:
+        data_dict = _get_data_dict(dataset_model)
+        selector = _format_selector(sorted(data_dict.items()))
+    else:
+        data_dict = None
+
+    cache = _get_reference_cache()
+    refpaths = {}
+    missing = []
+    for filetype in reference_file_types:
+        refpath = cache.get(observatory, context, filetype, selector)
+        if refpath is None:
+            missing.append(filetype)
+        else:
+            refpaths[filetype] = refpath
+
+    if missing:
+        if data_dict is None:
+            data_dict = _get_data_dict(dataset_model)
+        found = _get_refpaths(data_dict, tuple(missing), observatory)
+        for filetype, refpath in found.items():
+            cache.put(observatory, context, filetype, selector, refpath)
+        cache.save()
+        refpaths.update(found)
+    return refpaths
+
+
+def get_multiple_reference_paths_bulk(dataset_models, reference_file_types,
+                                      observatory=None):
+    """Determine the best references of several datasets, e.g. the members
+    of an association.
+
+    The datasets are grouped by their selection parameters, and the best
+    references of each group are determined once, from its first dataset.
+    Datasets whose selection parameters are not known are looked up on
+    their own.
+
+    Returns a list of best references dicts, one per dataset in order, as
+    returned by get_multiple_reference_paths().
+    """
+    reference_file_types = tuple(reference_file_types)
+    if not reference_file_types:   # [] interpreted as *all types*.
+        return [{} for model in dataset_models]
+
+    groups = {}
+    refpaths = []
+    for model in dataset_models:
+        model_observatory = (observatory or model.meta.telescope or 'jwst').lower()
+        context = get_context_used(model_observatory)
+        selector = _get_selector(model, context)
+        if selector is None:
+            refpaths.append(get_multiple_reference_paths(
+                model, reference_file_types, observatory))
+            continue
+        key = (model_observatory, context, selector)
+        if key not in groups:
+            groups[key] = get_multiple_reference_paths(
+                model, reference_file_types, observatory)
+        refpaths.append(dict(groups[key]))
     return refpaths
 
 
+def clear_reference_cache():
+    """Forget the best references resolved in this process, and reload the
+    cache file named by CRDS_REFERENCE_CACHE, if any, on next use.
+    """
+    global _reference_cache
+    _reference_cache = None
+
+
+class _ReferenceCache:
+    """Best references resolved in this process, keyed by observatory, CRDS
+    context, reference type and selection parameters.
+
+    If the environment variable CRDS_REFERENCE_CACHE names a file, the cache
+    is loaded from and saved to that JSON file, so later runs start warm and
+    can resolve known datasets without contacting the CRDS server.  An entry
+    read from the file is only used if its reference file is still in the
+    CRDS cache.  Processes sharing the file may overwrite each other's new
+    entries, which are then looked up again.
+    """
+
+    def __init__(self, filename=None):
+        self.filename = filename
+        self._entries = {}
+        self._unchecked = {}
+        self._modified = False
+        if filename is not None and os.path.exists(filename):
+            try:
+                with open(filename) as cache_file:
+                    entries = json.load(cache_file)['entries']
+                self._unchecked = {tuple(key): refpath for (*key, refpath) in entries}
+            except (OSError, ValueError, KeyError, TypeError) as exc:
+                log.warning("Ignoring reference cache", repr(filename), ":", str(exc))
+
+    def get(self, observatory, context, filetype, selector):
+        """Return the cached reference path, or None if it is not known."""
+        key = (observatory, context, filetype, selector)
+        try:
+            return self._entries[key]
+        except KeyError:
+            pass
+
+        refpath = self._unchecked.pop(key, None)
+        if refpath is not None and (refpath == "N/A" or s3_utils.is_s3_uri(refpath) or
+                                    os.path.exists(refpath)):
+            self._entries[key] = refpath
+            return refpath
+        return None
+
+    def put(self, observatory, context, filetype, selector, refpath):
+        self._entries[(observatory, context, filetype, selector)] = refpath
+        self._modified = True
+
+    def save(self):
+        """Write the cache to its file, if it has one and has new entries."""
+        if self.filename is None or not self._modified:
+            return
+        entries = dict(self._unchecked)
+        entries.update(self._entries)
+        tmp_name = "{0}.{1}.tmp".format(self.filename, os.getpid())
+        try:
+            with open(tmp_name, "w") as cache_file:
+                json.dump({"entries": [list(key) + [refpath]
+                                       for (key, refpath) in entries.items()]},
+                          cache_file)
+            os.replace(tmp_name, self.filename)
+            self._modified = False
+        except OSError as exc:
+            log.warning("Cannot save reference cache", repr(self.filename), ":", str(exc))
+
+
+_reference_cache = None
+
+# Selection parameters of each instrument in each context, or None if CRDS
+# cannot tell them.
+_required_parkeys = {}
+
+
+def _get_reference_cache():
+    global _reference_cache
+    if _reference_cache is None:
+        _reference_cache = _ReferenceCache(os.environ.get("CRDS_REFERENCE_CACHE") or None)
+    return _reference_cache
+
+
+def _get_required_parkeys(context, instrument):
+    """Return the names of the dataset parameters which can select the
+    references of `instrument` under `context`, e.g. META.INSTRUMENT.DETECTOR,
+    or None if they cannot be determined.
+    """
+    key = (context, instrument)
+    if key not in _required_parkeys:
+        try:
+            imap = crds.get_cached_mapping(context).get_imap(instrument)
+            parkeys = tuple(sorted(set(parkey.upper()
+                                      for parkey in imap.get_required_parkeys())))
+        except Exception:
+            parkeys = None
+        _required_parkeys[key] = parkeys
+    return _required_parkeys[key]
+
+
+def _get_selector(dataset_model, context):
+    """Return the values of the selection parameters of `dataset_model`,
+    formatted for use as a cache key, or None if the selection parameters
+    are not known.
+
+    Only these values are read from the model, which is much cheaper than
+    _get_data_dict().
+    """
+    try:
+        instrument = dataset_model.meta.instrument.name
+    except AttributeError:
+        return None
+    if not isinstance(instrument, str):
+        return None
+    parkeys = _get_required_parkeys(context, instrument.lower())
+    if parkeys is None:
+        return None
+
+    values = []
+    for parkey in parkeys:
+        try:
+            value = dataset_model[parkey.lower()]
+        except KeyError:
+            value = None
+        if isinstance(value, datetime.datetime):
+            value = value.isoformat()
+        elif not isinstance(value, (str, int, float, bool, type(None))):
+            value = str(value)
+        values.append((parkey, value))
+    return _format_selector(values)
+
+
+def _format_selector(items):
+    return json.dumps(items, default=str)
+
+
 def _get_data_dict(dataset_model):
     """Return the data models header dictionary based on open data
     `dataset_model`.
@@ -125,11 +333,16 @@ def check_reference_open(refpath):
     """Verify that `refpath` exists and is readable for the current user.
 
     Ignore reference path values of "N/A" or "" for checking.
+
+    The first block of S3 references is fetched in the background into the
+    shared S3 block cache, so that the headers are ready when the reference
+    is opened.
     """
     if refpath != "N/A" and refpath.strip() != "":
         if s3_utils.is_s3_uri(refpath):
             if not s3_utils.object_exists(refpath):
                 raise RuntimeError("S3 object does not exist: " + refpath)
+            s3_utils.prefetch(refpath)
         else:
             opened = open(refpath, "rb")
             opened.close()
@@ -32,6 +32,7 @@ LinearPipeline
 """
 import gc
 
+from . import profiling
 from .pipeline import Pipeline
 
 
@@ -116,7 +117,7 @@ class LinearPipeline(Pipeline, metaclass=_LinearPipelineMetaclass):
             if pipeline_steps == []:
                 if (hasattr(self, 'output_file') and
                     self.output_file is not None):
-                    input_file.save(self.output_file)
+                    self._save_now_or_later(input_file, self.output_file)
                 return input_file
 
             name, cls = pipeline_steps[0]
@@ -140,7 +141,7 @@ class LinearPipeline(Pipeline, metaclass=_LinearPipelineMetaclass):
             elif mode == 'RUN':
                 dm = step(input_file)
                 if do_caching:
-                    dm.save(filename)
+                    self._save_now_or_later(dm, filename)
                 if name == self.end_step:
                     return None
                 return recurse(mode, dm, pipeline_steps[1:])
@@ -149,6 +150,17 @@ class LinearPipeline(Pipeline, metaclass=_LinearPipelineMetaclass):
         gc.collect()
         return result
 
+    def _save_now_or_later(self, model, path):
+        """
+        Save `model`, in the background if the pipeline saves in the
+        background.
+        """
+        writer = self.search_attr('_background_writer')
+        if writer is not None:
+            writer.save(model, path)
+        else:
+            profiling.add_bytes_written(model.save(path))
+
     def set_input_filename(self, path):
         for name, cls in self.pipeline_steps:
             getattr(self, name).set_input_filename(path)
@@ -37,6 +37,8 @@ from . import config_parser
 from . import Step
 from . import crds_client
 from . import log
+from . import profiling
+from .background_writer import BackgroundWriter
 from .step import get_disable_crds_steppars
 from ..datamodels import open as dm_open
 from ..lib.class_property import ClassInstanceMethod
@@ -49,6 +51,7 @@ class Pipeline(Step):
 
     # Configuration
     spec = """
+    save_in_background = boolean(default=False)  # Write output files in a background thread
     """
     # A set of steps used in the Pipeline.  Should be overridden by
     # the subclass.
@@ -74,6 +77,36 @@ class Pipeline(Step):
 
             setattr(self, key, new_step)
 
+        self._background_writer = None
+
+    def run(self, *args):
+        """
+        Run the pipeline.  OVERRIDES Step.
+
+        If `save_in_background` is set, the output files of the pipeline
+        and its steps are written in a background thread while the
+        pipeline runs, and this method returns once they are all written.
+        """
+        if (not self.save_in_background or
+                self.search_attr('_background_writer') is not None):
+            return super().run(*args)
+
+        self._background_writer = BackgroundWriter(max_pending=2)
+        try:
+            result = super().run(*args)
+        except Exception:
+            try:
+                self._background_writer.close()
+            except Exception as e:
+                self.log.error('Saving in the background failed: {0}'.format(e))
+            raise
+        else:
+            self._background_writer.close()
+        finally:
+            self._background_writer = None
+
+        return result
+
     @property
     def reference_file_types(self):
         """Collect the list of all reftypes for child Steps that are not skipped.
@@ -284,14 +317,27 @@ class Pipeline(Step):
         No garbage collection.
         """
         if self._is_container(model_or_container):
-            # recurse on each contained model
+            # Resolve the references of all the contained models at once,
+            # so models with the same selection parameters share a lookup
+            models = [model for model in model_or_container
+                      if not self._is_container(model)]
+            with profiling.reference_timer():
+                model_refs = iter(crds_client.get_multiple_reference_paths_bulk(
+                    models, self._get_fetch_types()))
+
+            # recurse on the contained containers, and check the references
+            # of the contained models
             for contained_model in model_or_container:
-                self._precache_references_opened(contained_model)
+                if self._is_container(contained_model):
+                    self._precache_references_opened(contained_model)
+                else:
+                    self._precache_references_impl(contained_model,
+                                                   next(model_refs))
         else:
             # precache a single model object
             self._precache_references_impl(model_or_container)
 
-    def _precache_references_impl(self, model):
+    def _precache_references_impl(self, model, crds_refs=None):
         """Given open data `model`,  determine and cache reference files for
         any reference types which are not overridden on the command line.
 
@@ -302,25 +348,40 @@ class Pipeline(Step):
         model :  `DataModel`
             Only a `DataModel` instnace is allowed.
             Cannot be a filename, ModelContainer, etc.
-        """
-        ovr_refs = {
-            reftype: self.get_ref_override(reftype)
-            for reftype in self.reference_file_types
-            if self.get_ref_override(reftype) is not None
-            }
 
-        fetch_types = sorted(set(self.reference_file_types) - set(ovr_refs.keys()))
+        crds_refs : dict or None
+            The best references of `model` already determined by
+            `crds_client.get_multiple_reference_paths_bulk`; if None, they
+            are determined here.
+        """
+        ovr_refs = self._get_ref_overrides()
+        fetch_types = self._get_fetch_types()
 
         self.log.info("Prefetching reference files for dataset: " + repr(model.meta.filename) +
                       " reftypes = " + repr(fetch_types))
-        crds_refs = crds_client.get_multiple_reference_paths(model, fetch_types)
+        with profiling.reference_timer():
+            if crds_refs is None:
+                crds_refs = crds_client.get_multiple_reference_paths(model, fetch_types)
+
+            ref_path_map = dict(list(crds_refs.items()) + list(ovr_refs.items()))
 
-        ref_path_map = dict(list(crds_refs.items()) + list(ovr_refs.items()))
+            for (reftype, refpath) in sorted(ref_path_map.items()):
+                how = "Override" if reftype in ovr_refs else "Prefetch"
+                self.log.info("{0} for {1} reference file is '{2}'.".format(how, reftype.upper(), refpath))
+                crds_client.check_reference_open(refpath)
+
+    def _get_ref_overrides(self):
+        """Return the reference files overridden on the command line, by type."""
+        return {
+            reftype: self.get_ref_override(reftype)
+            for reftype in self.reference_file_types
+            if self.get_ref_override(reftype) is not None
+            }
 
-        for (reftype, refpath) in sorted(ref_path_map.items()):
-            how = "Override" if reftype in ovr_refs else "Prefetch"
-            self.log.info("{0} for {1} reference file is '{2}'.".format(how, reftype.upper(), refpath))
-            crds_client.check_reference_open(refpath)
+    def _get_fetch_types(self):
+        """Return the sorted reference types to get from CRDS."""
+        return sorted(set(self.reference_file_types) -
+                      set(self._get_ref_overrides().keys()))
 
     @classmethod
     def _is_container(cls, input_file):
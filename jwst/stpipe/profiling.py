@@ -0,0 +1,265 @@
+"""
+Performance records of steps and pipelines.
+
+When profiling is enabled (``strun --profile=report.json``), every run of
+a `Step` records its wall-clock and CPU times, the change of the resident
+set size and of the peak resident set size of the process, the number of
+bytes of the files opened by `Step.open_model` and saved by
+`Step.save_model`, and the time spent getting reference files.  The runs of
+the steps of a pipeline are nested in the record of the pipeline, and the
+byte counts and reference file times of a record include those of the
+records nested in it.
+
+At the end of the run, the records are written as JSON and a summary is
+logged.
+"""
+import json
+import os
+import sys
+import threading
+import time
+
+try:
+    import resource
+except ImportError:
+    resource = None
+
+from . import log
+
+__all__ = ['enable', 'disable', 'is_enabled', 'start_step', 'end_step',
+           'add_bytes_read', 'add_bytes_written', 'running_records',
+           'reference_timer',
+           'get_records', 'write_report', 'summary', 'finish']
+
+# Top-level records, or None if profiling is disabled.
+_records = None
+
+# Records of the steps currently running, innermost last.
+_stack = []
+
+# File to write the report to at the end of the run.
+_report_file = None
+
+# Held while adding to the counts, which the thread of a
+# `~jwst.stpipe.background_writer.BackgroundWriter` also updates.
+_lock = threading.Lock()
+
+
+def enable(report_file=None):
+    """Start collecting performance records.
+
+    Parameters
+    ----------
+    report_file : str or None
+        The name of the JSON file written by `finish`.
+    """
+    global _records, _report_file
+    _records = []
+    _stack.clear()
+    _report_file = report_file
+
+
+def disable():
+    """Stop collecting performance records and discard them."""
+    global _records, _report_file
+    _records = None
+    _stack.clear()
+    _report_file = None
+
+
+def is_enabled():
+    """Return True if performance records are being collected."""
+    return _records is not None
+
+
+def _memory():
+    """Return the resident set size and its peak, in bytes.
+
+    Either value is None if it cannot be determined on this platform.
+    """
+    rss = None
+    try:
+        with open('/proc/self/statm') as statm:
+            rss = int(statm.read().split()[1]) * os.sysconf('SC_PAGE_SIZE')
+    except (OSError, ValueError, IndexError, AttributeError):
+        pass
+
+    peak = None
+    if resource is not None:
+        peak = resource.getrusage(resource.RUSAGE_SELF).ru_maxrss
+        # ru_maxrss is in bytes on macOS and in kilobytes elsewhere.
+        if sys.platform != 'darwin':
+            peak *= 1024
+    return rss, peak
+
+
+def _delta(end, start):
+    if end is None or start is None:
+        return None
+    return end - start
+
+
+def start_step(step):
+    """Start the record of a run of `step`.
+
+    Returns
+    -------
+    record : dict or None
+        The record to pass to `end_step`, or None if profiling is disabled.
+    """
+    if _records is None:
+        return None
+
+    rss, peak = _memory()
+    record = {
+        'name': step.name,
+        'class': step.__class__.__name__,
+        'wall_time': 0.,
+        'cpu_time': 0.,
+        'rss_delta': None,
+        'peak_rss_delta': None,
+        'peak_rss': None,
+        'bytes_read': 0,
+        'bytes_written': 0,
+        'reference_time': 0.,
+        'steps': [],
+        '_start': (time.perf_counter(), time.process_time(), rss, peak),
+    }
+    _stack.append(record)
+    return record
+
+
+def _close(record, end):
+    """Set the times and memory of `record` from the values `end` of
+    ``(wall, cpu, rss, peak)`` at its end."""
+    wall, cpu, rss, peak = record.pop('_start')
+    end_wall, end_cpu, end_rss, end_peak = end
+    record['wall_time'] = end_wall - wall
+    record['cpu_time'] = end_cpu - cpu
+    record['rss_delta'] = _delta(end_rss, rss)
+    record['peak_rss_delta'] = _delta(end_peak, peak)
+    record['peak_rss'] = end_peak
+
+
+def end_step(record):
+    """Complete a record returned by `start_step`."""
+    if record is None or not any(open_record is record for open_record in _stack):
+        return
+
+    end = (time.perf_counter(), time.process_time()) + _memory()
+
+    # Records left open by an exception are closed with their parent,
+    # and nested in the record below them.
+    while True:
+        closed = _stack.pop()
+        _close(closed, end)
+        if _stack:
+            _stack[-1]['steps'].append(closed)
+        elif _records is not None:
+            _records.append(closed)
+        if closed is record:
+            break
+
+
+def _add(key, value, records=None):
+    with _lock:
+        for record in (_stack if records is None else records):
+            record[key] += value
+
+
+def _file_size(path):
+    try:
+        return os.path.getsize(path)
+    except (OSError, TypeError, ValueError):
+        return 0
+
+
+def add_bytes_read(path):
+    """Count the size of the file `path` as read by the running steps."""
+    if _stack:
+        _add('bytes_read', _file_size(path))
+
+
+def running_records():
+    """Return the records of the steps currently running.
+
+    These are the records to pass to `add_bytes_written` for a file that
+    is written after the steps that saved it have ended.
+    """
+    return list(_stack)
+
+
+def add_bytes_written(path, records=None):
+    """Count the size of the file `path` as written by the running steps,
+    or by the steps of `records`, as returned by `running_records`."""
+    if records is None:
+        records = _stack
+    if records:
+        _add('bytes_written', _file_size(path), records)
+
+
+class reference_timer:
+    """Context manager that counts the time spent in its block as time
+    spent getting reference files by the running steps.
+    """
+
+    def __enter__(self):
+        self._start = time.perf_counter()
+        return self
+
+    def __exit__(self, *exc):
+        if _stack:
+            _add('reference_time', time.perf_counter() - self._start)
+        return False
+
+
+def get_records():
+    """Return the list of completed top-level records."""
+    return [] if _records is None else list(_records)
+
+
+def write_report(path):
+    """Write the completed records to the JSON file `path`."""
+    with open(path, 'w') as report:
+        json.dump({'steps': get_records()}, report, indent=2)
+
+
+def _format_bytes(nbytes):
+    if nbytes is None:
+        return 'n/a'
+    return '{:.1f}'.format(nbytes / 2.**20)
+
+
+def summary():
+    """Return a table of the completed records, as a list of lines."""
+    lines = ['{:<40} {:>10} {:>10} {:>10} {:>10} {:>10} {:>10}'.format(
+        'Step', 'Wall [s]', 'CPU [s]', 'RSS [MB]', 'Read [MB]',
+        'Write [MB]', 'Refs [s]')]
+
+    def add_lines(record, depth):
+        lines.append(
+            '{:<40} {:>10.2f} {:>10.2f} {:>10} {:>10} {:>10} {:>10.2f}'.format(
+                '  ' * depth + record['name'], record['wall_time'],
+                record['cpu_time'], _format_bytes(record['rss_delta']),
+                _format_bytes(record['bytes_read']),
+                _format_bytes(record['bytes_written']),
+                record['reference_time']))
+        for child in record['steps']:
+            add_lines(child, depth + 1)
+
+    for record in get_records():
+        add_lines(record, 0)
+    return lines
+
+
+def finish():
+    """Write the report, log the summary and stop collecting records."""
+    if _records is None:
+        return
+
+    if _report_file:
+        write_report(_report_file)
+        log.log.info('Profile written to {0}'.format(_report_file))
+    for line in summary():
+        log.log.info(line)
+    disable()
@@ -27,6 +27,7 @@ except ImportError:
 from . import config_parser
 from . import crds_client
 from . import log
+from . import profiling
 from . import utilities
 from .. import __version_commit__, __version__
 from ..associations.load_as_asn import (LoadAsAssociation, LoadAsLevel2Asn)
@@ -360,6 +361,7 @@ class Step():
         if len(args):
             self.set_primary_input(args[0])
 
+        profile = profiling.start_step(self)
         try:
             # Default output file configuration
             if self.output_file is not None:
@@ -466,6 +468,7 @@ class Step():
             self.log.info(
                 'Step {0} done'.format(self.name))
         finally:
+            profiling.end_step(profile)
             log.delegator.log = orig_log
 
         return step_result
@@ -660,6 +663,10 @@ class Step():
         -------
         reference_file : path of reference file,  a string
         """
+        with profiling.reference_timer():
+            return self._get_reference_file(input_file, reference_file_type)
+
+    def _get_reference_file(self, input_file, reference_file_type):
         override = self.get_ref_override(reference_file_type)
         if override is not None:
             if isinstance(override, DataModel):
@@ -869,15 +876,21 @@ class Step():
             ):
                 output_file = model.meta.filename
                 idx = None
-            output_path = model.save(
-                self.make_output_path(
-                    basepath=output_file,
-                    suffix=suffix,
-                    idx=idx,
-                    name_format=format,
-                    **components
-                )
+            output_path = self.make_output_path(
+                basepath=output_file,
+                suffix=suffix,
+                idx=idx,
+                name_format=format,
+                **components
             )
+
+            # A pipeline saving in the background writes the file later.
+            writer = self.search_attr('_background_writer')
+            if writer is not None:
+                return writer.save(model, output_path)
+
+            output_path = model.save(output_path)
+            profiling.add_bytes_written(output_path)
             self.log.info('Saved model in {}'.format(output_path))
 
         return output_path
@@ -1061,7 +1074,10 @@ class Step():
         datamodel : DataModel
             Object opened as a datamodel
         """
-        return dm_open(self.make_input_path(obj))
+        input_path = self.make_input_path(obj)
+        if isinstance(input_path, str):
+            profiling.add_bytes_read(input_path)
+        return dm_open(input_path)
 
     def make_input_path(self, file_path):
         """Create an input path for a given file path
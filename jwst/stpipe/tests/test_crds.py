@@ -143,3 +143,86 @@ def test_check_reference_open_s3(s3_root_dir):
 
     with pytest.raises(RuntimeError):
         assert crds_client.check_reference_open("s3://test-s3-data/missing.fits")
+
+
+def test_reference_cache(monkeypatch, tmpdir):
+    """Datasets with the same selection parameters share a CRDS lookup,
+    and the results are reused from the cache file by later runs."""
+    from ... import datamodels
+
+    flat = str(tmpdir.join('flat.fits'))
+    fits.HDUList(fits.PrimaryHDU()).writeto(flat)
+
+    lookups = []
+
+    def mock_get_refpaths(data_dict, reference_file_types, observatory):
+        lookups.append(reference_file_types)
+        return {reftype: flat for reftype in reference_file_types}
+
+    monkeypatch.setattr(crds_client, '_get_refpaths', mock_get_refpaths)
+    monkeypatch.setattr(crds_client, 'get_context_used',
+                        lambda observatory=None: 'jwst_0001.pmap')
+    monkeypatch.setattr(crds_client, '_required_parkeys', {
+        ('jwst_0001.pmap', 'nircam'): ('META.INSTRUMENT.DETECTOR',
+                                       'META.INSTRUMENT.NAME')})
+    monkeypatch.setenv('CRDS_REFERENCE_CACHE', str(tmpdir.join('refs.json')))
+    crds_client.clear_reference_cache()
+
+    models = []
+    for detector in ('NRCA1', 'NRCA1', 'NRCB1'):
+        model = datamodels.ImageModel()
+        model.meta.instrument.name = 'NIRCAM'
+        model.meta.instrument.detector = detector
+        model.meta.filename = detector + '.fits'
+        models.append(model)
+
+    try:
+        refs = crds_client.get_multiple_reference_paths_bulk(models, ['flat'])
+        assert refs == [{'flat': flat}] * 3
+        assert lookups == [('flat',), ('flat',)]
+
+        assert crds_client.get_multiple_reference_paths(models[0], ['flat']) == {'flat': flat}
+        assert len(lookups) == 2
+
+        # A new process starts from the cache file
+        crds_client.clear_reference_cache()
+        assert crds_client.get_reference_file(models[2], 'flat') == flat
+        assert len(lookups) == 2
+    finally:
+        crds_client.clear_reference_cache()
+
+
+def test_bulk_references_grouped(monkeypatch):
+    """The best references are determined once per set of selection
+    parameters, and in the order of the datasets."""
+    from ... import datamodels
+
+    monkeypatch.setattr(crds_client, 'get_context_used',
+                        lambda observatory=None: 'jwst_0001.pmap')
+    monkeypatch.setattr(crds_client, '_required_parkeys', {
+        ('jwst_0001.pmap', 'nircam'): ('META.INSTRUMENT.DETECTOR',
+                                       'META.INSTRUMENT.NAME')})
+
+    looked_up = []
+
+    def mock_get_paths(model, reference_file_types, observatory=None):
+        looked_up.append(model.meta.filename)
+        return {reftype: model.meta.instrument.detector
+                for reftype in reference_file_types}
+
+    monkeypatch.setattr(crds_client, 'get_multiple_reference_paths',
+                        mock_get_paths)
+
+    models = []
+    for i, detector in enumerate(('NRCA1', 'NRCB1', 'NRCA1', 'NRCB1')):
+        model = datamodels.ImageModel()
+        model.meta.instrument.name = 'NIRCAM'
+        model.meta.instrument.detector = detector
+        model.meta.filename = '{0}_{1}.fits'.format(detector, i)
+        models.append(model)
+
+    refs = crds_client.get_multiple_reference_paths_bulk(models, ['flat'])
+    assert refs == [{'flat': model.meta.instrument.detector}
+                    for model in models]
+    assert looked_up == ['NRCA1_0.fits', 'NRCB1_1.fits']
+    assert crds_client.get_multiple_reference_paths_bulk(models, []) == [{}] * 4
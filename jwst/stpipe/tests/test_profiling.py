@@ -0,0 +1,98 @@
+"""Test the performance records of steps and pipelines"""
+import json
+from os import path
+
+from ..step import Step
+from .. import profiling
+from .steps import AnotherDummyStep
+
+data_fn = 'flat.fits'
+data_fn_path = path.join(path.dirname(__file__), 'data', data_fn)
+
+
+def test_profile_disabled():
+    """No records are made unless profiling is enabled"""
+    step = AnotherDummyStep()
+    assert profiling.start_step(step) is None
+
+    step.run(1, 2)
+    assert profiling.get_records() == []
+
+
+def test_profile_pipeline(mk_tmp_dirs):
+    """The records of the steps are nested in the record of the pipeline"""
+    args = [
+        'jwst.stpipe.tests.steps.SavePipeline',
+        data_fn_path,
+        '--profile=profile.json',
+    ]
+
+    Step.from_cmdline(args)
+
+    assert not profiling.is_enabled()
+    with open('profile.json') as report_file:
+        report = json.load(report_file)
+
+    (pipeline,) = report['steps']
+    assert pipeline['class'] == 'SavePipeline'
+    assert [step['class'] for step in pipeline['steps']] == [
+        'StepWithModel', 'SaveStep'
+    ]
+
+    savestep = pipeline['steps'][1]
+    assert savestep['bytes_written'] > 0
+    assert pipeline['bytes_written'] > savestep['bytes_written']
+    assert pipeline['wall_time'] >= savestep['wall_time']
+    assert pipeline['cpu_time'] >= 0.
+
+
+def test_profile_records_left_open():
+    """Records left open are closed and nested when their parent ends"""
+    pipeline, step, substep = [AnotherDummyStep(name=name)
+                               for name in ('pipeline', 'step', 'substep')]
+    profiling.enable()
+    try:
+        pipeline_record = profiling.start_step(pipeline)
+        profiling.start_step(step)
+        profiling.start_step(substep)
+        # An equal record that is not open is ignored
+        profiling.end_step(dict(pipeline_record))
+        assert len(profiling._stack) == 3
+
+        profiling.end_step(pipeline_record)
+        assert profiling._stack == []
+        (record,) = profiling.get_records()
+    finally:
+        profiling.disable()
+
+    assert record is pipeline_record
+    (step_record,) = record['steps']
+    assert step_record['name'] == 'step'
+    (substep_record,) = step_record['steps']
+    assert substep_record['name'] == 'substep'
+    for closed in (record, step_record, substep_record):
+        assert '_start' not in closed
+        assert closed['wall_time'] >= 0.
+    assert record['wall_time'] >= step_record['wall_time'] >= substep_record['wall_time']
+
+
+def test_profile_save_in_background(mk_tmp_dirs):
+    """The files saved in the background are counted in the records of
+    the steps that saved them"""
+    args = [
+        'jwst.stpipe.tests.steps.SavePipeline',
+        data_fn_path,
+        '--profile=profile.json',
+        '--save_in_background=true',
+        '--steps.savestep.save_results=true',
+    ]
+
+    Step.from_cmdline(args)
+
+    with open('profile.json') as report_file:
+        report = json.load(report_file)
+
+    (pipeline,) = report['steps']
+    savestep = pipeline['steps'][1]
+    assert savestep['bytes_written'] > 0
+    assert pipeline['bytes_written'] > savestep['bytes_written']
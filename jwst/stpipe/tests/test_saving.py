@@ -5,6 +5,7 @@ from os import path
 import shutil
 
 from ..step import Step
+from ...datamodels import ImageModel
 
 data_fn = 'flat.fits'
 data_fn_path = path.join(path.dirname(__file__), 'data', data_fn)
@@ -228,6 +229,27 @@ def test_save_pipeline_default(mk_tmp_dirs):
     assert path.isfile(desired)
 
 
+def test_save_pipeline_in_background(mk_tmp_dirs):
+    """Files saved in the background are all written when the run ends"""
+    tmp_current_path, tmp_data_path, tmp_config_path = mk_tmp_dirs
+
+    args = [
+        'jwst.stpipe.tests.steps.SavePipeline',
+        data_fn_path,
+        '--save_in_background=true',
+        '--steps.savestep.save_results=true',
+    ]
+
+    step = Step.from_cmdline(args)
+    assert step._background_writer is None
+
+    for suffix in ('_processed', '_savestep', '_savepipeline'):
+        desired = data_name + suffix + data_ext
+        assert path.isfile(desired)
+        with ImageModel(desired) as model:
+            assert model.meta.filename == desired
+
+
 def test_save_pipeline_withdir(mk_tmp_dirs):
     """Save to specified folder"""
     tmp_current_path, tmp_data_path, tmp_config_path = mk_tmp_dirs
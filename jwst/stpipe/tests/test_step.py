@@ -253,6 +253,7 @@ def test_getpars_model(step_obj, full_spec, expected):
             'suffix': None,
             'search_output_file': True,
             'input_dir': None,
+            'save_in_background': False,
             'par1': 'Name the atomizer',
             'steps': {
                 'make_list': {'pre_hooks': [],
@@ -291,6 +292,7 @@ def test_getpars_model(step_obj, full_spec, expected):
             'suffix': None,
             'search_output_file': True,
             'input_dir': '',
+            'save_in_background': False,
             'par1': 'Instantiated',
             'steps': {
                 'make_list': {
@@ -328,6 +330,7 @@ def test_getpars_model(step_obj, full_spec, expected):
             'suffix': None,
             'search_output_file': True,
             'input_dir': None,
+            'save_in_background': False,
             'par1': 'Name the atomizer',
             'steps': {}
         }),
@@ -347,6 +350,7 @@ def test_getpars_model(step_obj, full_spec, expected):
             'suffix': None,
             'search_output_file': True,
             'input_dir': '',
+            'save_in_background': False,
             'par1': 'Instantiated',
             'steps': {}
         }),
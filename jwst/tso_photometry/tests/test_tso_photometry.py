@@ -233,3 +233,32 @@ def test_tso_phot_4():
                           58704.65968, 58704.6686, 58704.677512,
                           58704.686428])
     assert np.allclose(catalog['MJD'], int_times, rtol=1.e-8)
+
+
+def test_weighted_sums():
+    """Compare the batched sums with photutils, integration by integration"""
+    from photutils import CircularAperture, CircularAnnulus
+    from jwst.tso_photometry.tso_photometry import (aperture_weights,
+                                                     weighted_sums)
+
+    rng = np.random.RandomState(42)
+    data = rng.normal(10., 1., size=(5, 40, 30)).astype(np.float32)
+    err = rng.uniform(0.5, 1., size=data.shape).astype(np.float32)
+
+    # The annulus extends beyond the edge of the image.
+    apertures = [CircularAperture((12.3, 20.6), r=4.5),
+                 CircularAnnulus((12.3, 20.6), r_in=8., r_out=14.)]
+    for aperture in apertures:
+        sums, sums_err = weighted_sums(data, err,
+                                       aperture_weights(aperture, data.shape[-2:]))
+        for i in range(data.shape[0]):
+            expected, expected_err = aperture.do_photometry(data[i],
+                                                            error=err[i])
+            assert np.isclose(sums[i], expected[0], rtol=1.e-10)
+            assert np.isclose(sums_err[i], expected_err[0], rtol=1.e-10)
+
+    # No overlap with the image
+    sums, sums_err = weighted_sums(
+        data, err, aperture_weights(CircularAperture((-50., -50.), r=3.),
+                                    data.shape[-2:]))
+    assert np.all(np.isnan(sums)) and np.all(np.isnan(sums_err))
@@ -59,42 +59,29 @@ def tso_aperture_photometry(datamodel, xcenter, ycenter, radius, radius_inner,
         bkg_aper = CircularAnnulus((xcenter, ycenter), r_in=radius_inner,
                                    r_out=radius_outer)
 
-    aperture_sum = []
-    aperture_sum_err = []
-    annulus_sum = []
-    annulus_sum_err = []
-
     nimg = datamodel.data.shape[0]
 
     if sub64p_wlp8:
         info = ('Photometry measured as the sum of all values in the '
                 'subarray.  No background subtraction was performed.')
 
-        for i in np.arange(nimg):
-            aperture_sum.append(np.sum(datamodel.data[i, :, :]))
-            aperture_sum_err.append(
-                np.sqrt(np.sum(datamodel.err[i, :, :]**2)))
+        aperture_sum = np.sum(datamodel.data, axis=(1, 2))
+        aperture_sum_err = np.sqrt(np.sum(datamodel.err**2, axis=(1, 2)))
     else:
         info = ('Photometry measured in a circular aperture of r={0} '
                 'pixels.  Background calculated as the mean in a '
                 'circular annulus with r_inner={1} pixels and '
                 'r_outer={2} pixels.'.format(radius, radius_inner,
                                                 radius_outer))
-        for i in np.arange(nimg):
-            aper_sum, aper_sum_err = phot_aper.do_photometry(
-                datamodel.data[i, :, :], error=datamodel.err[i, :, :])
-            ann_sum, ann_sum_err = bkg_aper.do_photometry(
-                datamodel.data[i, :, :], error=datamodel.err[i, :, :])
-
-            aperture_sum.append(aper_sum[0])
-            aperture_sum_err.append(aper_sum_err[0])
-            annulus_sum.append(ann_sum[0])
-            annulus_sum_err.append(ann_sum_err[0])
-
-    aperture_sum = np.array(aperture_sum)
-    aperture_sum_err = np.array(aperture_sum_err)
-    annulus_sum = np.array(annulus_sum)
-    annulus_sum_err = np.array(annulus_sum_err)
+        # The apertures are the same for all integrations, so their
+        # weights are computed once and applied to the whole cube.
+        image_shape = datamodel.data.shape[-2:]
+        aperture_sum, aperture_sum_err = weighted_sums(
+            datamodel.data, datamodel.err,
+            aperture_weights(phot_aper, image_shape))
+        annulus_sum, annulus_sum_err = weighted_sums(
+            datamodel.data, datamodel.err,
+            aperture_weights(bkg_aper, image_shape))
 
     # construct metadata for output table
     meta = OrderedDict()
@@ -204,3 +191,85 @@ def tso_aperture_photometry(datamodel, xcenter, ycenter, radius, radius_inner,
         tbl['net_aperture_sum_err'] = aperture_sum_err
 
     return tbl
+
+
+def aperture_weights(aperture, shape):
+    """
+    Compute the exact-overlap weights of an aperture in an image.
+
+    Parameters
+    ----------
+    aperture : `photutils.PixelAperture`
+        An aperture at a single position.
+
+    shape : tuple of int
+        The shape of the image.
+
+    Returns
+    -------
+    weights : tuple or None
+        The tuple ``(yslice, xslice, weights)``, where ``weights`` is the
+        array of the fractions of the pixels of
+        ``image[yslice, xslice]`` within the aperture, or None if the
+        aperture does not overlap the image.
+    """
+    mask = aperture.to_mask(method='exact')
+    if isinstance(mask, list):
+        mask = mask[0]
+
+    image = mask.to_image(shape)
+    if image is None:
+        return None
+
+    rows = np.flatnonzero(image.any(axis=1))
+    cols = np.flatnonzero(image.any(axis=0))
+    if rows.size == 0:
+        return None
+    yslice = slice(rows[0], rows[-1] + 1)
+    xslice = slice(cols[0], cols[-1] + 1)
+    return yslice, xslice, image[yslice, xslice]
+
+
+# Maximum number of values of the integrations reduced at once
+# by weighted_sums, to limit the size of the temporary arrays.
+_MAX_CHUNK_SIZE = 2**22
+
+
+def weighted_sums(data, err, weights):
+    """
+    Sum the data of each integration within an aperture.
+
+    This gives the same sums and errors as calling
+    ``aperture.do_photometry(data[i], error=err[i])`` for each
+    integration, but reduces all the integrations at once.
+
+    Parameters
+    ----------
+    data, err : ndarray
+        The (nints, ny, nx) science and error arrays.
+
+    weights : tuple or None
+        The weights of the aperture, from `aperture_weights`.
+
+    Returns
+    -------
+    sums, sums_err : ndarray
+        The weighted sum of the data of each integration and its error.
+        Both are NaN if the aperture does not overlap the image.
+    """
+    nints = data.shape[0]
+    sums = np.full(nints, np.nan)
+    sums_err = np.full(nints, np.nan)
+    if weights is None:
+        return sums, sums_err
+
+    yslice, xslice, weights = weights
+    weights = weights.ravel()
+    step = max(1, _MAX_CHUNK_SIZE // weights.size)
+    for start in range(0, nints, step):
+        stop = min(start + step, nints)
+        values = data[start:stop, yslice, xslice].reshape(stop - start, -1)
+        sums[start:stop] = np.dot(values, weights)
+        variance = err[start:stop, yslice, xslice].reshape(stop - start, -1)**2
+        sums_err[start:stop] = np.sqrt(np.dot(variance, weights))
+    return sums, sums_err
@@ -0,0 +1,113 @@
+"""
+Test the source catalogs of tweakreg: the cache of catalogs and building
+them in a pool of processes.
+"""
+import numpy as np
+from numpy.testing import assert_allclose, assert_array_equal
+import pytest
+
+from jwst import datamodels
+from jwst.tweakreg import tweakreg_step
+from jwst.tweakreg.tweakreg_catalog import (
+    CatalogCache, catalog_key, make_tweakreg_catalog
+)
+
+DETECTION_PARS = {'kernel_fwhm': 2.5, 'snr_threshold': 5.0,
+                  'brightest': 100, 'peakmax': None}
+
+
+def make_image(seed, shape=(120, 100), nstars=15):
+    """ImageModel of Gaussian stars on a noisy background."""
+    rng = np.random.RandomState(seed)
+    yy, xx = np.mgrid[:shape[0], :shape[1]]
+    data = rng.normal(scale=1.0, size=shape)
+    for x, y, flux in zip(rng.uniform(10, shape[1] - 10, nstars),
+                          rng.uniform(10, shape[0] - 10, nstars),
+                          rng.uniform(200., 2000., nstars)):
+        data += flux / (2 * np.pi * 1.2**2) * np.exp(
+            -0.5 * ((xx - x)**2 + (yy - y)**2) / 1.2**2)
+    model = datamodels.ImageModel(data=data.astype(np.float32),
+                                  dq=np.zeros(shape, dtype=np.uint32))
+    model.meta.filename = 'image{}_cal.fits'.format(seed)
+    return model
+
+
+def make_step(**pars):
+    step = tweakreg_step.TweakRegStep()
+    for name, value in dict(DETECTION_PARS, **pars).items():
+        setattr(step, name, value)
+    return step
+
+
+def assert_same_catalog(catalog, expected):
+    assert catalog.colnames == expected.colnames
+    assert len(catalog) == len(expected)
+    assert_array_equal(catalog['id'], expected['id'])
+    for name in ('xcentroid', 'ycentroid', 'flux'):
+        assert_allclose(catalog[name], expected[name], rtol=1e-14)
+
+
+def test_cache_hit_matches_detection(tmpdir, monkeypatch):
+    """A cached catalog is the catalog detected from the image."""
+    images = [make_image(seed) for seed in range(3)]
+    expected = [make_tweakreg_catalog(im, **DETECTION_PARS) for im in images]
+    assert all(len(catalog) > 0 for catalog in expected)
+
+    step = make_step(catalog_cache_dir=str(tmpdir))
+    fresh = [catalog for _, catalog in step._source_catalogs(images)]
+    assert len(tmpdir.listdir()) == len(images)
+
+    # Detection must not run any more: every catalog comes from the cache.
+    def no_detection(*args, **kwargs):
+        raise AssertionError('sources detected instead of read from cache')
+    monkeypatch.setattr(tweakreg_step, 'make_tweakreg_catalog', no_detection)
+    cached = [catalog for _, catalog in step._source_catalogs(images)]
+
+    for catalog, catalog_fresh, truth in zip(cached, fresh, expected):
+        assert_same_catalog(catalog_fresh, truth)
+        assert_same_catalog(catalog, truth)
+
+    cache = CatalogCache(str(tmpdir))
+    assert cache.get('0' * 40) is None
+
+
+def test_catalog_key():
+    """The key depends on the pixels, DQ flags and every detection
+    parameter, and only on them."""
+    image = make_image(0)
+    key = catalog_key(image, **DETECTION_PARS)
+
+    copy = image.copy()
+    copy.meta.filename = 'other_cal.fits'
+    assert catalog_key(copy, **DETECTION_PARS) == key
+
+    changed_pars = {'kernel_fwhm': 3.0, 'snr_threshold': 4.0,
+                    'brightest': 50, 'peakmax': 1000.}
+    for name, value in changed_pars.items():
+        pars = dict(DETECTION_PARS, **{name: value})
+        assert catalog_key(image, **pars) != key, name
+
+    changed = image.copy()
+    changed.data[5, 7] += 1.
+    assert catalog_key(changed, **DETECTION_PARS) != key
+
+    changed = image.copy()
+    changed.dq[5, 7] = datamodels.dqflags.pixel['NON_SCIENCE']
+    assert catalog_key(changed, **DETECTION_PARS) != key
+
+
+@pytest.mark.parametrize('nimages', [2, 5])
+def test_parallel_matches_serial(nimages, monkeypatch):
+    """Catalogs built by a pool are those built one image at a time, in
+    the order of the images."""
+    images = [make_image(seed) for seed in range(nimages)]
+    serial = list(make_step()._source_catalogs(images))
+
+    monkeypatch.setattr(tweakreg_step, 'num_processes', lambda max_cores: 3)
+    parallel = list(make_step(maximum_cores='all')._source_catalogs(images))
+
+    assert len(parallel) == len(serial) == nimages
+    for (image, catalog), (image_serial, catalog_serial) in zip(parallel,
+                                                                serial):
+        assert image is image_serial
+        assert_same_catalog(catalog, catalog_serial)
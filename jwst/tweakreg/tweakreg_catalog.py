@@ -1,3 +1,8 @@
+import hashlib
+import logging
+import os
+import tempfile
+
 from astropy.table import Table
 import numpy as np
 from photutils import detect_threshold, DAOStarFinder
@@ -5,6 +10,13 @@ from photutils import detect_threshold, DAOStarFinder
 from ..datamodels import dqflags, ImageModel
 
 
+log = logging.getLogger(__name__)
+log.setLevel(logging.DEBUG)
+
+__all__ = ['make_tweakreg_catalog', 'find_sources', 'catalog_key',
+           'CatalogCache']
+
+
 def make_tweakreg_catalog(model, kernel_fwhm, snr_threshold, sharplo=0.2,
                           sharphi=1.0, roundlo=-1.0, roundhi=1.0,
                           brightest=None, peakmax=None):
@@ -63,7 +75,37 @@ def make_tweakreg_catalog(model, kernel_fwhm, snr_threshold, sharplo=0.2,
     if not isinstance(model, ImageModel):
         raise TypeError('The input model must be an ImageModel.')
 
-    threshold_img = detect_threshold(model.data, nsigma=snr_threshold)
+    return find_sources(model.data, model.dq, kernel_fwhm, snr_threshold,
+                        sharplo=sharplo, sharphi=sharphi, roundlo=roundlo,
+                        roundhi=roundhi, brightest=brightest, peakmax=peakmax)
+
+
+def find_sources(data, dq, kernel_fwhm, snr_threshold, sharplo=0.2,
+                 sharphi=1.0, roundlo=-1.0, roundhi=1.0, brightest=None,
+                 peakmax=None):
+    """
+    Create a catalog of point-line sources from the data and DQ arrays of
+    an image.
+
+    This is the detection done by `make_tweakreg_catalog`, on arrays
+    instead of a model, so that it can be run in another process.
+
+    Parameters
+    ----------
+    data : 2D ndarray
+        The background subtracted science array of the image.
+
+    dq : 2D ndarray
+        The data quality array of the image.
+
+    The other parameters are those of `make_tweakreg_catalog`.
+
+    Returns
+    -------
+    catalog : `~astropy.Table`
+        An astropy Table containing the source catalog.
+    """
+    threshold_img = detect_threshold(data, nsigma=snr_threshold)
     # TODO:  use threshold image based on error array
     threshold = threshold_img[0, 0]     # constant image
 
@@ -73,9 +115,9 @@ def make_tweakreg_catalog(model, kernel_fwhm, snr_threshold, sharplo=0.2,
                             peakmax=peakmax)
 
     # Mask the non-imaging area (e.g. MIRI)
-    mask = (dqflags.pixel['NON_SCIENCE'] & model.dq).astype(np.bool)
+    mask = (dqflags.pixel['NON_SCIENCE'] & dq).astype(np.bool)
 
-    sources = daofind(model.data, mask=mask)
+    sources = daofind(data, mask=mask)
 
     columns = ['id', 'xcentroid', 'ycentroid', 'flux']
     if sources:
@@ -85,3 +127,82 @@ def make_tweakreg_catalog(model, kernel_fwhm, snr_threshold, sharplo=0.2,
                                               np.float_))
 
     return catalog
+
+
+def catalog_key(model, **detection_pars):
+    """
+    Key of the source catalog of an image in a `CatalogCache`.
+
+    Parameters
+    ----------
+    model : `ImageModel`
+        The image the catalog is made from.
+
+    detection_pars : dict
+        The parameters passed to `make_tweakreg_catalog`.
+
+    Returns
+    -------
+    key : str
+        The checksum of the data and DQ arrays of the image and of the
+        detection parameters.
+    """
+    digest = hashlib.sha1()
+    for array in (model.data, model.dq):
+        array = np.ascontiguousarray(array)
+        digest.update(repr((array.shape, array.dtype.str)).encode())
+        digest.update(array.view(np.uint8))
+    digest.update(repr(sorted(detection_pars.items())).encode())
+    return digest.hexdigest()
+
+
+class CatalogCache:
+    """
+    Source catalogs saved in a directory, by `catalog_key`.
+
+    The catalogs only depend on the pixels of the images and the detection
+    parameters, so rerunning tweakreg with different alignment parameters
+    reads the catalogs from the cache instead of detecting the sources
+    again.
+
+    Parameters
+    ----------
+    directory : str
+        The directory of the catalog files. It is created if it does not
+        exist.
+    """
+
+    def __init__(self, directory):
+        self.directory = directory
+        os.makedirs(directory, exist_ok=True)
+
+    def _path(self, key):
+        return os.path.join(self.directory, '{}.ecsv'.format(key))
+
+    def get(self, key):
+        """
+        Return the catalog saved for ``key``, or None if there is none.
+        """
+        path = self._path(key)
+        if not os.path.exists(path):
+            return None
+        try:
+            return Table.read(path, format='ascii.ecsv')
+        except Exception as e:
+            log.warning('Cannot read cached catalog {}: {}'.format(path, e))
+            return None
+
+    def put(self, key, catalog):
+        """
+        Save ``catalog`` for ``key``.
+        """
+        # Write to a temporary file first, so that concurrent runs sharing
+        # the cache never read a partly written catalog.
+        fd, tmp_path = tempfile.mkstemp(suffix='.ecsv', dir=self.directory)
+        os.close(fd)
+        try:
+            catalog.write(tmp_path, format='ascii.ecsv', overwrite=True)
+            os.replace(tmp_path, self._path(key))
+        except Exception:
+            os.remove(tmp_path)
+            raise
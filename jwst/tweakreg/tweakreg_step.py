@@ -4,6 +4,7 @@ JWST pipeline step for image alignment.
 :Authors: Mihai Cara
 
 """
+import multiprocessing
 from os import path
 
 from astropy.table import Table
@@ -14,8 +15,11 @@ from tweakwcs.matchutils import TPMatch
 # LOCAL
 from ..stpipe import Step
 from .. import datamodels
+from ..lib.multiprocessing_utils import num_processes
 
-from .tweakreg_catalog import make_tweakreg_catalog
+from .tweakreg_catalog import (
+    make_tweakreg_catalog, find_sources, catalog_key, CatalogCache
+)
 
 
 __all__ = ['TweakRegStep']
@@ -35,6 +39,8 @@ class TweakRegStep(Step):
         snr_threshold = float(default=10.0) # SNR threshold above the bkg
         brightest = integer(default=100) # Keep top ``brightest`` objects
         peakmax = float(default=None) # Filter out objects with pixel values >= ``peakmax``
+        maximum_cores = option('quarter', 'half', 'all', default=None) # max number of processes building catalogs
+        catalog_cache_dir = string(default=None) # Directory of cached source catalogs
 
         # Optimize alignment order:
         enforce_user_order = boolean(default=False) # Align images in user specified order?
@@ -69,53 +75,53 @@ class TweakRegStep(Step):
                       "containing one or more DataModels.", ) + e.args[1:]
             raise e
 
-        # Build the catalogs for input images
-        for image_model in images:
-            catalog = make_tweakreg_catalog(
-                image_model, self.kernel_fwhm, self.snr_threshold,
-                brightest=self.brightest, peakmax=self.peakmax
-            )
-
-            # filter out sources outside the image array if WCS validity
-            # region is provided:
-            wcs_bounds = image_model.meta.wcs.pixel_bounds
-            if wcs_bounds is not None:
-                ((xmin, xmax), (ymin, ymax)) = wcs_bounds
-                xname = 'xcentroid' if 'xcentroid' in catalog.colnames else 'x'
-                yname = 'ycentroid' if 'ycentroid' in catalog.colnames else 'y'
-                x = catalog[xname]
-                y = catalog[yname]
-                mask = (x > xmin) & (x < xmax) & (y > ymin) & (y < ymax)
-                catalog = catalog[mask]
-
-            filename = image_model.meta.filename
-            nsources = len(catalog)
-            if nsources == 0:
-                self.log.warning('No sources found in {}.'.format(filename))
-            else:
-                self.log.info('Detected {} sources in {}.'
-                              .format(len(catalog), filename))
-
-            if self.save_catalogs:
-                catalog_filename = filename.replace(
-                    '.fits', '_cat.{}'.format(self.catalog_format)
-                )
-                if self.catalog_format == 'ecsv':
-                    fmt = 'ascii.ecsv'
-                elif self.catalog_format == 'fits':
-                    # NOTE: The catalog must not contain any 'None' values.
-                    #       FITS will also not clobber existing files.
-                    fmt = 'fits'
+        # Build the catalogs for input images; closing the generator
+        # terminates its processes if a catalog cannot be used
+        source_catalogs = self._source_catalogs(images)
+        try:
+            for image_model, catalog in source_catalogs:
+                # filter out sources outside the image array if WCS validity
+                # region is provided:
+                wcs_bounds = image_model.meta.wcs.pixel_bounds
+                if wcs_bounds is not None:
+                    ((xmin, xmax), (ymin, ymax)) = wcs_bounds
+                    xname = 'xcentroid' if 'xcentroid' in catalog.colnames else 'x'
+                    yname = 'ycentroid' if 'ycentroid' in catalog.colnames else 'y'
+                    x = catalog[xname]
+                    y = catalog[yname]
+                    mask = (x > xmin) & (x < xmax) & (y > ymin) & (y < ymax)
+                    catalog = catalog[mask]
+
+                filename = image_model.meta.filename
+                nsources = len(catalog)
+                if nsources == 0:
+                    self.log.warning('No sources found in {}.'.format(filename))
                 else:
-                    raise ValueError(
-                        '\'catalog_format\' must be "ecsv" or "fits".'
-                    )
-                catalog.write(catalog_filename, format=fmt, overwrite=True)
-                self.log.info('Wrote source catalog: {}'
-                              .format(catalog_filename))
-                image_model.meta.tweakreg_catalog = catalog_filename
+                    self.log.info('Detected {} sources in {}.'
+                                  .format(len(catalog), filename))
 
-            image_model.catalog = catalog
+                if self.save_catalogs:
+                    catalog_filename = filename.replace(
+                        '.fits', '_cat.{}'.format(self.catalog_format)
+                    )
+                    if self.catalog_format == 'ecsv':
+                        fmt = 'ascii.ecsv'
+                    elif self.catalog_format == 'fits':
+                        # NOTE: The catalog must not contain any 'None' values.
+                        #       FITS will also not clobber existing files.
+                        fmt = 'fits'
+                    else:
+                        raise ValueError(
+                            '\'catalog_format\' must be "ecsv" or "fits".'
+                        )
+                    catalog.write(catalog_filename, format=fmt, overwrite=True)
+                    self.log.info('Wrote source catalog: {}'
+                                  .format(catalog_filename))
+                    image_model.meta.tweakreg_catalog = catalog_filename
+
+                image_model.catalog = catalog
+        finally:
+            source_catalogs.close()
 
         # Now use the catalogs for tweakreg
         if len(images) == 0:
@@ -209,6 +215,72 @@ class TweakRegStep(Step):
 
         return images
 
+    def _source_catalogs(self, images):
+        """
+        Yield each image of ``images`` with the catalog of its sources.
+
+        Catalogs found in ``catalog_cache_dir`` are read from there, and
+        the catalogs that are built are saved in it. With more than one
+        process, the catalogs of up to ``maximum_cores`` images are built
+        at the same time, one image per process, so that only that many
+        images are held in memory.
+        """
+        detection_pars = {'kernel_fwhm': self.kernel_fwhm,
+                          'snr_threshold': self.snr_threshold,
+                          'brightest': self.brightest,
+                          'peakmax': self.peakmax}
+        cache = None
+        if self.catalog_cache_dir:
+            cache = CatalogCache(self.catalog_cache_dir)
+
+        nproc = max(1, min(num_processes(self.maximum_cores), len(images)))
+        pool = None
+        if nproc > 1:
+            self.log.info('Building catalogs with {} processes'.format(nproc))
+            pool = multiprocessing.Pool(processes=nproc)
+
+        try:
+            for start in range(0, len(images), nproc):
+                batch = images[start:start + nproc]
+                catalogs = [None] * len(batch)
+                keys = [None] * len(batch)
+                if cache is not None:
+                    for i, image_model in enumerate(batch):
+                        keys[i] = catalog_key(image_model, **detection_pars)
+                        catalogs[i] = cache.get(keys[i])
+                        if catalogs[i] is not None:
+                            self.log.info('Using cached catalog of {}'.format(
+                                image_model.meta.filename))
+
+                missing = [i for i, catalog in enumerate(catalogs)
+                           if catalog is None]
+                if pool is not None and len(missing) > 1:
+                    if not all(isinstance(batch[i], datamodels.ImageModel)
+                               for i in missing):
+                        raise TypeError('The input model must be an ImageModel.')
+                    args = [(batch[i].data, batch[i].dq, detection_pars)
+                            for i in missing]
+                    for i, catalog in zip(missing,
+                                          pool.starmap(_find_sources, args)):
+                        catalogs[i] = catalog
+                else:
+                    for i in missing:
+                        catalogs[i] = make_tweakreg_catalog(
+                            batch[i], self.kernel_fwhm, self.snr_threshold,
+                            brightest=self.brightest, peakmax=self.peakmax
+                        )
+
+                if cache is not None:
+                    for i in missing:
+                        cache.put(keys[i], catalogs[i])
+
+                for image_model, catalog in zip(batch, catalogs):
+                    yield image_model, catalog
+        finally:
+            if pool is not None:
+                pool.terminate()
+                pool.close()
+
     def _imodel2wcsim(self, image_model):
         # make sure that we have a catalog:
         if hasattr(image_model, 'catalog'):
@@ -248,6 +320,11 @@ class TweakRegStep(Step):
         return im
 
 
+def _find_sources(data, dq, detection_pars):
+    """ Source catalog of an image, built by a pool worker. """
+    return find_sources(data, dq, **detection_pars)
+
+
 def _common_name(group):
     file_names = [path.splitext(im.meta.filename)[0].strip('_- ')
                   for im in group]
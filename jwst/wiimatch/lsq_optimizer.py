@@ -15,7 +15,7 @@ __all__ = ['build_lsq_eqs', 'pinv_solve', 'rlu_solve']
 
 
 def build_lsq_eqs(images, masks, sigmas, degree, center=None,
-                  image2world=None, center_cs='image'):
+                  image2world=None, center_cs='image', sparse=False):
     """
     Build system of linear equations whose solution would provide image
     intensity matching in the least squares sense.
@@ -64,11 +64,16 @@ def build_lsq_eqs(images, masks, sigmas, degree, center=None,
         `None`: it is assumed to be `False`. ``center_cs`` *cannot be*
         ``'world'`` when ``image2world`` is `None` unless ``center`` is `None`.
 
+    sparse : bool, optional
+        When `True`, the coefficients of the system are returned as a
+        `scipy.sparse.csr_matrix`. Only image pairs that overlap contribute
+        non-zero blocks to the system.
+
     Returns
     -------
-    a : numpy.ndarray
-        A 2D `numpy.ndarray` that holds the coefficients of the linear system
-        of equations.
+    a : numpy.ndarray, scipy.sparse.csr_matrix
+        A 2D `numpy.ndarray` (or a sparse matrix when ``sparse`` is `True`)
+        that holds the coefficients of the linear system of equations.
 
     b : numpy.ndarray
         A 1D `numpy.ndarray` that holds the free terms of the linear system of
@@ -121,6 +126,11 @@ def build_lsq_eqs(images, masks, sigmas, degree, center=None,
         (c_{0,0,\\ldots}^1,c_{1,0,\\ldots}^1,\\ldots,c_{0,0,\\ldots}^2,\
         c_{1,0,\\ldots}^2,\\ldots).
 
+    The system is assembled one pair of images at a time: only pairs whose
+    masks have valid pixels in common contribute to the system, and the sums
+    for all the polynomial terms of a pair are computed in a single pass
+    over the common pixels of the pair.
+
     Examples
     --------
     >>> import numpy as np
@@ -192,7 +202,8 @@ def build_lsq_eqs(images, masks, sigmas, degree, center=None,
         npolycoeff *= d
     sys_eq_array_size = nimages * npolycoeff
 
-    gshape = (nimages,) + degree1
+    # exponents of the polynomial terms, in the order of the coefficients:
+    exponents = list(np.ndindex(degree1))
 
     # pre-compute coordinate arrays:
     coord_arrays, eff_center, coord_system = create_coordinate_arrays(
@@ -202,69 +213,65 @@ def build_lsq_eqs(images, masks, sigmas, degree, center=None,
         center_cs=center_cs
     )
 
-    # allocate array for the coefficients of the system of equations (a*x=b):
-    a = np.zeros((sys_eq_array_size, sys_eq_array_size), dtype=np.float)
-    b = np.zeros(sys_eq_array_size, dtype=np.float)
+    # bounding boxes of valid data, used to skip pairs of images that
+    # do not overlap and to limit the sums to the common box of a pair:
+    bboxes = [_mask_bounding_box(m) for m in masks]
 
-    for i in range(sys_eq_array_size):
-        # decompose first (row, or eq) flat index into "original" indices:
-        lp = np.unravel_index(i, gshape)
-        l = lp[0]
-        p = lp[1:]
+    # blocks of the system of equations (a*x=b), keyed by image indices:
+    blocks = {}
+    b = np.zeros(sys_eq_array_size, dtype=np.float)
+    diag = np.zeros((nimages, npolycoeff, npolycoeff), dtype=np.float)
 
-        # compute known terms:
-        for m in range(nimages):
-            if m == l:
+    for l in range(nimages):
+        for m in range(l + 1, nimages):
+            box = _intersect_boxes(bboxes[l], bboxes[m])
+            if box is None:
                 continue
 
-            # compute array elements for m!=l:
-            b[i] += _image_pixel_sum(
-                image_l = images[l],
-                image_m = images[m],
-                mask_l = masks[l],
-                mask_m = masks[m],
-                sigma2_l = sigmas2[l],
-                sigma2_m = sigmas2[m],
-                coord_arrays=coord_arrays,
-                p=p
+            sums = _pair_sums(
+                image_l=images[l][box],
+                image_m=images[m][box],
+                mask_l=masks[l][box],
+                mask_m=masks[m][box],
+                sigma2_l=sigmas2[l][box],
+                sigma2_m=sigmas2[m][box],
+                coord_arrays=[c[box] for c in coord_arrays],
+                exponents=exponents
             )
-
-        for j in range(sys_eq_array_size):
-
-            # decompose second (col, or cf) flat index into "original" indices:
-            mp = np.unravel_index(j, gshape)
-            m = mp[0]
-            pp = mp[1:]
-
-            if l == m:  # we will deal with this case in the next iteration
+            if sums is None:
                 continue
 
-            a[i, j] = -_sigma_pixel_sum(
-                mask_l = masks[l],
-                mask_m = masks[m],
-                sigma2_l = sigmas2[l],
-                sigma2_m = sigmas2[m],
-                coord_arrays=coord_arrays,
-                p=p,
-                pp=pp
-            )
-
-    # now compute coefficients of array 'a' for l==m:
-    for i in range(sys_eq_array_size):
-        # decompose first (row, or eq) flat index into "original" indices:
-        lp = np.unravel_index(i, gshape)
-        l = lp[0]
-        p = lp[1:]
-
-        for ppi in range(npolycoeff):
-            pp = np.unravel_index(ppi, degree1)
-            j = np.ravel_multi_index((l,) + pp, gshape)
-
-            for m in range(nimages):
-                if m == l:
-                    continue
-                k = np.ravel_multi_index((m,) + pp, gshape)
-                a[i, j] -= a[i, k]
+            sigma_sum, image_sum = sums
+            blocks[(l, m)] = -sigma_sum
+            blocks[(m, l)] = -sigma_sum
+            diag[l] += sigma_sum
+            diag[m] += sigma_sum
+            b[l * npolycoeff:(l + 1) * npolycoeff] += image_sum
+            b[m * npolycoeff:(m + 1) * npolycoeff] -= image_sum
+
+    for l in range(nimages):
+        blocks[(l, l)] = diag[l]
+
+    if sparse:
+        from scipy import sparse as sp
+        rows = []
+        cols = []
+        vals = []
+        offsets = np.arange(npolycoeff)
+        for (l, m), block in blocks.items():
+            rows.append(np.repeat(l * npolycoeff + offsets, npolycoeff))
+            cols.append(np.tile(m * npolycoeff + offsets, npolycoeff))
+            vals.append(block.ravel())
+        a = sp.csr_matrix(
+            (np.concatenate(vals), (np.concatenate(rows),
+                                    np.concatenate(cols))),
+            shape=(sys_eq_array_size, sys_eq_array_size)
+        )
+    else:
+        a = np.zeros((sys_eq_array_size, sys_eq_array_size), dtype=np.float)
+        for (l, m), block in blocks.items():
+            a[l * npolycoeff:(l + 1) * npolycoeff,
+              m * npolycoeff:(m + 1) * npolycoeff] = block
 
     return a, b, coord_arrays, eff_center, coord_system
 
@@ -280,8 +287,9 @@ def pinv_solve(matrix, free_term, nimages, tol=None):
 
     Parameters
     ----------
-    matrix : numpy.ndarray
-        A 2D array containing coefficients of the system.
+    matrix : numpy.ndarray, scipy.sparse.spmatrix
+        A 2D array containing coefficients of the system. A sparse matrix
+        is converted to a dense array.
 
     free_term : numpy.ndarray
         A 1D array containing free terms of the system of the equations.
@@ -323,6 +331,8 @@ def pinv_solve(matrix, free_term, nimages, tol=None):
             -9.32587341e-15,  2.99760217e-15]])
 
     """
+    if hasattr(matrix, 'toarray'):
+        matrix = matrix.toarray()
     if tol is None:
         tol = np.finfo(matrix.dtype).eps**(2.0/3.0)
     v = np.dot(np.linalg.pinv(matrix, rcond=tol), free_term)
@@ -344,11 +354,12 @@ def rlu_solve(matrix, free_term, nimages):
     Upon solving the reduced system, these unknowns are recomputed so that
     mean corection coefficients for all images are 0.
     This function uses `~scipy.linalg.lu_solve` and
-    `~scipy.linalg.lu_factor` functions.
+    `~scipy.linalg.lu_factor` functions, or `~scipy.sparse.linalg.splu`
+    when ``matrix`` is a sparse matrix.
 
     Parameters
     ----------
-    matrix : numpy.ndarray
+    matrix : numpy.ndarray, scipy.sparse.spmatrix
         A 2D array containing coefficients of the system.
 
     free_term : numpy.ndarray
@@ -387,10 +398,20 @@ def rlu_solve(matrix, free_term, nimages):
     drop =  free_term.size // nimages
     if nimages <= 1:
         return np.zeros((1, drop), dtype=np.float)
-    from scipy import linalg
     rmat = matrix[drop:, drop:]
-    v = linalg.lu_solve(linalg.lu_factor(rmat),
-                        free_term[drop:])
+    v = None
+    if hasattr(rmat, 'tocsc'):
+        from scipy.sparse import linalg as splinalg
+        try:
+            v = splinalg.splu(rmat.tocsc()).solve(free_term[drop:])
+        except RuntimeError:
+            # splu fails on singular systems, e.g. when some images do not
+            # overlap any other: solve these as the dense system was.
+            rmat = rmat.toarray()
+    if v is None:
+        from scipy import linalg
+        v = linalg.lu_solve(linalg.lu_factor(rmat),
+                            free_term[drop:])
     reduced_bkg_poly_coeff = v.reshape((nimages - 1, v.size // (nimages - 1)))
     delta1 = - reduced_bkg_poly_coeff.sum(axis=0) / nimages
     reduced_bkg_poly_coeff += delta1
@@ -398,79 +419,58 @@ def rlu_solve(matrix, free_term, nimages):
     return bkg_poly_coeff
 
 
-def _image_pixel_sum(image_l, image_m, mask_l, mask_m,
-                     sigma2_l, sigma2_m, coord_arrays=None, p=None):
-    # Compute sum of:
+def _mask_bounding_box(mask):
+    # Return a tuple of slices of the smallest box that contains all
+    # non-zero elements of the mask, or None if there are none.
+    box = []
+    for axis in range(mask.ndim):
+        other = tuple(k for k in range(mask.ndim) if k != axis)
+        idx = np.flatnonzero(np.any(mask, axis=other))
+        if idx.size == 0:
+            return None
+        box.append(slice(idx[0], idx[-1] + 1))
+    return tuple(box)
+
+
+def _intersect_boxes(box1, box2):
+    # Return the intersection of two boxes returned by _mask_bounding_box(),
+    # or None if they do not overlap.
+    if box1 is None or box2 is None:
+        return None
+    box = []
+    for s1, s2 in zip(box1, box2):
+        start = max(s1.start, s2.start)
+        stop = min(s1.stop, s2.stop)
+        if start >= stop:
+            return None
+        box.append(slice(start, stop))
+    return tuple(box)
+
+
+def _pair_sums(image_l, image_m, mask_l, mask_m, sigma2_l, sigma2_m,
+               coord_arrays, exponents):
+    # Compute, in a single pass over the pixels valid in both images, the
+    # sums of coord_arrays^(p+pp) / (sigma_l**2 + sigma_m**2) for all pairs
+    # of polynomial terms (a 2D array) and the sums of
     # coord_arrays^(p) * (image_l - image_m) / (sigma_l**2 + sigma_m**2)
-    #
-    # If coord_arrays is None, replace it with 1 (this allows code
-    # optimization) for the case of constant background (polynomials of zero
-    # degree).
-    #
-    # NOTE: this function does not check that sigma2 arrays have same shapes
-    #       as the coord_arrays arrays (for efficiency purpose).
-
+    # for all polynomial terms (a 1D array). Return None if the images have
+    # no valid pixels in common.
     cmask = np.logical_and(mask_l, mask_m)
-
-    if coord_arrays is None:
-        if p is not None:
-            raise ValueError("When pixel indices are None then exponent list "
-                             "must be None as well.")
-
-        return np.sum((image_l[cmask] - image_m[cmask]) /
-                      (sigma2_l[cmask] + sigma2_m[cmask]),
-                      dtype=np.float)
-
-    if len(coord_arrays) != len(p):
-        raise ValueError("Lengths of the list of pixel index arrays and "
-                         "list of the exponents 'p' must be equal.")
-
-    if len(coord_arrays) == 0:
-        raise ValueError("There has to be at least one pixel index.")
-
-    i = coord_arrays[0]**p[0]
-
-    for c, ip in zip(coord_arrays[1:], p[1:]):
-        i *= c**ip
-
-    return np.sum(i[cmask] * (image_l[cmask] - image_m[cmask]) /
-                  (sigma2_l[cmask] + sigma2_m[cmask]),
-                  dtype=np.float)
-
-
-def _sigma_pixel_sum(mask_l, mask_m, sigma2_l, sigma2_m,
-                     coord_arrays=None, p=None, pp=None):
-    # Compute sum of coord_arrays^(p+pp) ()/ (sigma_l**2 + sigma_m**2)
-    #
-    # If coord_arrays is None, replace it with 1 (this allows code
-    # optimization) for the case of constant background (polynomials of zero
-    # degree).
-    #
-    # NOTE: this function does not check that sigma2 arrays have same shapes
-    #       as the coord_arrays arrays (for efficiency purpose).
-
-    cmask = np.logical_and(mask_l, mask_m)
-
-    if coord_arrays is None:
-        if p is not None or pp is not None:
-            raise ValueError("When pixel indices are None then exponent lists "
-                             "must be None as well.")
-
-        return np.sum(1.0 / (sigma2_l[cmask] + sigma2_m[cmask]),
-                      dtype=np.float)
-
-    if len(coord_arrays) != len(p) or len(p) != len(pp):
-        raise ValueError("Lengths of the list of pixel index arrays and "
-                         "lists of the exponents 'p' and 'pp' must be "
-                         "equal.")
-
-    if len(coord_arrays) == 0:
-        raise ValueError("There has to be at least one pixel index.")
-
-    i = coord_arrays[0]**(p[0] + pp[0])
-
-    for c, ip, ipp in zip(coord_arrays[1:], p[1:], pp[1:]):
-        i *= c**(ip + ipp)
-
-    return np.sum(i[cmask] / (sigma2_l[cmask] + sigma2_m[cmask]),
-                  dtype=np.float)
+    if not np.any(cmask):
+        return None
+
+    weight = 1.0 / (sigma2_l[cmask] + sigma2_m[cmask])
+    coords = [c[cmask] for c in coord_arrays]
+
+    # values of the polynomial terms at each pixel:
+    terms = np.empty((weight.size, len(exponents)), dtype=np.float)
+    for k, p in enumerate(exponents):
+        t = coords[0]**p[0]
+        for c, ip in zip(coords[1:], p[1:]):
+            t = t * c**ip
+        terms[:, k] = t
+
+    wterms = terms * weight[:, np.newaxis]
+    sigma_sum = np.dot(wterms.T, terms)
+    image_sum = np.dot(wterms.T, image_l[cmask] - image_m[cmask])
+    return sigma_sum, image_sum
@@ -17,10 +17,14 @@ __all__ = ['match_lsq']
 
 SUPPORTED_SOLVERS = ['RLU', 'PINV']
 
+# Number of images from which the system of equations is built as a sparse
+# matrix when ``sparse`` is None and the solver is 'RLU'.
+SPARSE_MIN_IMAGES = 16
+
 
 def match_lsq(images, masks=None, sigmas=None, degree=0,
               center=None, image2world=None, center_cs='image',
-              ext_return=False, solver='RLU'):
+              ext_return=False, solver='RLU', sparse=None):
     """
     Compute coefficients of (multivariate) polynomials that once subtracted
     from input images would provide image intensity matching in the least
@@ -83,6 +87,13 @@ def match_lsq(images, masks=None, sigmas=None, degree=0,
     solver : {'RLU', 'PINV'}, optional
         Specifies method for solving the system of equations.
 
+    sparse : bool, None, optional
+        Indicates whether the system of equations should be built as a
+        sparse matrix and, with the ``'RLU'`` solver, solved with a sparse
+        LU decomposition. This is useful for many images of which only
+        some pairs overlap. When `None` (default), a sparse matrix is used
+        with the ``'RLU'`` solver for ``SPARSE_MIN_IMAGES`` images or more.
+
     Returns
     -------
     bkg_poly_coeff : numpy.ndarray
@@ -93,10 +104,10 @@ def match_lsq(images, masks=None, sigmas=None, degree=0,
         `numpy.ndarray` that holds the solution (polynomial coefficients)
         to the system. The solution is grouped by image.
 
-    a : numpy.ndarray
-        A 2D `numpy.ndarray` that holds the coefficients of the linear system
-        of equations. This value is returned only when ``ext_return``
-        is `True`.
+    a : numpy.ndarray, scipy.sparse.csr_matrix
+        A 2D `numpy.ndarray` (a sparse matrix when ``sparse`` is `True`)
+        that holds the coefficients of the linear system of equations.
+        This value is returned only when ``ext_return`` is `True`.
 
     b : numpy.ndarray
         A 1D `numpy.ndarray` that holds the free terms of the linear system of
@@ -247,6 +258,9 @@ c_{1,0,\\ldots}^2,\\ldots).
     elif center is not None:
         center = tuple([center for i in range(ndim)])
 
+    if sparse is None:
+        sparse = solver == 'RLU' and nimages >= SPARSE_MIN_IMAGES
+
     # build the system of equations:
     a, b, coord_arrays, eff_center, coord_system = build_lsq_eqs(
         images,
@@ -255,7 +269,8 @@ c_{1,0,\\ldots}^2,\\ldots).
         degree,
         center=center,
         image2world=image2world,
-        center_cs=center_cs
+        center_cs=center_cs,
+        sparse=sparse
     )
 
     # solve the system:
@@ -0,0 +1,182 @@
+"""
+Test the LSQ matching of image intensities against the element-by-element
+construction of the system of equations.
+"""
+import warnings
+
+import numpy as np
+import pytest
+from numpy.testing import assert_allclose, assert_array_equal
+from scipy import linalg
+
+from jwst.wiimatch import lsq_optimizer
+from jwst.wiimatch.match import match_lsq
+from jwst.wiimatch.utils import create_coordinate_arrays
+
+
+def reference_lsq_eqs(images, masks, sigmas, degree, center):
+    # Build the system one element at a time, from its definition
+    masks = [m & (s > 0) for m, s in zip(masks, sigmas)]
+    sigmas2 = [s**2 for s in sigmas]
+    exponents = list(np.ndindex(tuple(d + 1 for d in degree)))
+    npoly = len(exponents)
+    nimages = len(images)
+    coords, _, _ = create_coordinate_arrays(images[0].shape, center=center)
+
+    def term(p):
+        t = np.ones(images[0].shape)
+        for c, ip in zip(coords, p):
+            t = t * c**ip
+        return t
+
+    a = np.zeros((nimages * npoly, nimages * npoly))
+    b = np.zeros(nimages * npoly)
+    for l in range(nimages):
+        for m in range(nimages):
+            if m == l:
+                continue
+            cmask = masks[l] & masks[m]
+            weight = 1.0 / (sigmas2[l][cmask] + sigmas2[m][cmask])
+            for i, p in enumerate(exponents):
+                b[l * npoly + i] += np.sum(
+                    term(p)[cmask] * (images[l][cmask] - images[m][cmask]) * weight)
+                for j, pp in enumerate(exponents):
+                    value = np.sum(term(p)[cmask] * term(pp)[cmask] * weight)
+                    a[l * npoly + i, m * npoly + j] = -value
+                    a[l * npoly + i, l * npoly + j] += value
+    return a, b
+
+
+def reference_rlu_solve(a, b, nimages):
+    drop = b.size // nimages
+    v = linalg.lu_solve(linalg.lu_factor(a[drop:, drop:]), b[drop:])
+    coef = v.reshape((nimages - 1, drop))
+    delta = -coef.sum(axis=0) / nimages
+    coef += delta
+    return np.insert(coef, 0, delta, axis=0)
+
+
+def make_images(nimages=5, shape=(12, 15)):
+    rng = np.random.RandomState(7)
+    y, x = np.indices(shape, dtype=float)
+    images = []
+    masks = []
+    sigmas = []
+    for n in range(nimages):
+        images.append(1.0 + 0.3 * n + 0.02 * n * x - 0.01 * y +
+                      rng.normal(scale=0.01, size=shape))
+        mask = np.zeros(shape, dtype=bool)
+        # overlapping strips, so that not all pairs overlap
+        mask[:, 2 * n:2 * n + 7] = True
+        mask[rng.random_sample(shape) < 0.1] = False
+        masks.append(mask)
+        sigma = rng.uniform(0.5, 2.0, size=shape)
+        sigma[0, 2 * n] = 0.0
+        sigmas.append(sigma)
+    return images, masks, sigmas
+
+
+@pytest.mark.parametrize('degree', [(0, 0), (1, 1), (2, 1)])
+def test_build_lsq_eqs_matches_reference(degree):
+    images, masks, sigmas = make_images()
+    ref_a, ref_b = reference_lsq_eqs(images, masks, sigmas, degree, (0, 0))
+
+    for sparse in (False, True):
+        a, b, _, _, _ = lsq_optimizer.build_lsq_eqs(
+            images, [m.copy() for m in masks], sigmas, degree,
+            center=(0, 0), sparse=sparse)
+        if sparse:
+            a = a.toarray()
+        assert_allclose(a, ref_a, rtol=1e-10, atol=1e-10)
+        assert_allclose(b, ref_b, rtol=1e-10, atol=1e-10)
+
+
+@pytest.mark.parametrize('degree', [0, 1])
+def test_match_lsq_dense_and_sparse(degree):
+    images, masks, sigmas = make_images()
+    deg = (degree, degree)
+    ref_a, ref_b = reference_lsq_eqs(images, masks, sigmas, deg, (0, 0))
+    expected = reference_rlu_solve(ref_a, ref_b, len(images))
+
+    dense = match_lsq(images, masks, sigmas, degree=deg, center=(0, 0),
+                      sparse=False)
+    sparse = match_lsq(images, masks, sigmas, degree=deg, center=(0, 0),
+                       sparse=True)
+    assert_allclose(dense, expected, rtol=1e-8, atol=1e-10)
+    assert_allclose(sparse, expected, rtol=1e-8, atol=1e-10)
+
+
+def test_match_lsq_sparse_by_default_for_many_images(monkeypatch):
+    from jwst.wiimatch import match
+
+    images, masks, sigmas = make_images()
+    used = []
+    build = match.build_lsq_eqs
+
+    def build_lsq_eqs(*args, **kwargs):
+        used.append(kwargs['sparse'])
+        return build(*args, **kwargs)
+
+    monkeypatch.setattr(match, 'build_lsq_eqs', build_lsq_eqs)
+    monkeypatch.setattr(match, 'SPARSE_MIN_IMAGES', len(images))
+    match_lsq(images, masks, sigmas, degree=0)
+    match_lsq(images[:-1], masks[:-1], sigmas[:-1], degree=0)
+    match_lsq(images, masks, sigmas, degree=0, solver='PINV')
+    assert used == [True, False, False]
+
+
+def test_sparse_solve_singular_system():
+    # an image that overlaps no other makes the reduced system singular
+    images, masks, sigmas = make_images(nimages=3)
+    masks[2][...] = False
+    masks[2][-1, -1] = True
+    masks[0][-1, -1] = False
+    masks[1][-1, -1] = False
+    a, b, _, _, _ = lsq_optimizer.build_lsq_eqs(
+        images, [m.copy() for m in masks], sigmas, (0, 0), center=(0, 0))
+    with np.errstate(all='ignore'), warnings.catch_warnings():
+        warnings.simplefilter('ignore')
+        dense = lsq_optimizer.rlu_solve(a, b, 3)
+        sparse = lsq_optimizer.rlu_solve(
+            lsq_optimizer.build_lsq_eqs(
+                images, [m.copy() for m in masks], sigmas, (0, 0),
+                center=(0, 0), sparse=True)[0], b, 3)
+    assert_array_equal(np.isfinite(dense), np.isfinite(sparse))
+
+
+def test_mask_bounding_box():
+    mask = np.zeros((6, 7), dtype=bool)
+    assert lsq_optimizer._mask_bounding_box(mask) is None
+
+    mask[2, 3] = True
+    mask[4, 1] = True
+    assert lsq_optimizer._mask_bounding_box(mask) == (slice(2, 5), slice(1, 4))
+
+    box1 = (slice(0, 3), slice(0, 3))
+    box2 = (slice(2, 5), slice(1, 4))
+    assert lsq_optimizer._intersect_boxes(box1, box2) == (slice(2, 3), slice(1, 3))
+    assert lsq_optimizer._intersect_boxes(box1, (slice(3, 5), slice(0, 1))) is None
+    assert lsq_optimizer._intersect_boxes(box1, None) is None
+
+
+def test_pair_sums():
+    images, masks, sigmas = make_images(nimages=2)
+    coords, _, _ = create_coordinate_arrays(images[0].shape, center=(0, 0))
+    exponents = list(np.ndindex((2, 2)))
+    sigma_sum, image_sum = lsq_optimizer._pair_sums(
+        images[0], images[1], masks[0], masks[1], sigmas[0]**2, sigmas[1]**2,
+        coords, exponents)
+
+    cmask = masks[0] & masks[1]
+    weight = 1.0 / (sigmas[0][cmask]**2 + sigmas[1][cmask]**2)
+    terms = [coords[0][cmask]**p[0] * coords[1][cmask]**p[1] for p in exponents]
+    diff = images[0][cmask] - images[1][cmask]
+    for i in range(len(exponents)):
+        assert_allclose(image_sum[i], np.sum(terms[i] * diff * weight))
+        for j in range(len(exponents)):
+            assert_allclose(sigma_sum[i, j], np.sum(terms[i] * terms[j] * weight))
+
+    no_overlap = np.zeros_like(masks[0])
+    assert lsq_optimizer._pair_sums(
+        images[0], images[1], masks[0], no_overlap, sigmas[0]**2,
+        sigmas[1]**2, coords, exponents) is None
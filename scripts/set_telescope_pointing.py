@@ -41,7 +41,10 @@ DAMAGE.
 import argparse
 import logging
 
-from jwst.lib.set_telescope_pointing import add_wcs
+from astropy.io import fits
+
+from jwst.lib import engdb_tools
+from jwst.lib.set_telescope_pointing import add_wcs, prefetch_mnemonics
 
 logger = logging.getLogger('jwst')
 handler = logging.StreamHandler()
@@ -81,6 +84,16 @@ if __name__ == '__main__':
               ' If not specified, the environmental variable "ENG_BASE_URL" is used.'
               ' Otherwise, a hardwired default is used.')
     )
+    parser.add_argument(
+        '--engdb_cache', type=str, default=None,
+        help=('Directory where the telemetry retrieved from the engineering database is cached'
+              ' for later runs. If not specified, it is only cached while the exposures are updated.')
+    )
+    parser.add_argument(
+        '--engdb_cache_settle', type=float, default=engdb_tools.CACHE_SETTLE_TIME / 3600.,
+        help=('Hours after which the telemetry of a time range is cached, as more recent'
+              ' telemetry may still be arriving in the engineering database.')
+    )
     parser.add_argument(
         '--transpose_j2fgs', action='store_false',
         help='Transpose the J2FGS matrix'
@@ -88,6 +101,22 @@ if __name__ == '__main__':
 
     args = parser.parse_args()
 
+    # Retrieve the telemetry of all the exposures at once.
+    engdb_tools.enable_cache(args.engdb_cache,
+                             settle_time=args.engdb_cache_settle * 3600.)
+    windows = []
+    for filename in args.exposure:
+        try:
+            header = fits.getheader(filename)
+            windows.append((header['EXPSTART'], header['EXPEND']))
+        except (OSError, KeyError) as exception:
+            logger.debug('No observation times for {}: {}'.format(filename, exception))
+    if windows:
+        try:
+            prefetch_mnemonics(windows, engdb_url=args.engdb_url)
+        except ValueError as exception:
+            logger.info('Cannot prefetch pointing information: ' + str(exception))
+
     for filename in args.exposure:
         logger.info(
             '\n------'
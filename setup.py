@@ -83,7 +83,7 @@ setup(
     ],
     python_requires='>=3.6',
     scripts=SCRIPTS,
-    packages=find_packages(),
+    packages=find_packages(exclude=['benchmarks']),
     package_data=PACKAGE_DATA,
     setup_requires=[
         'setuptools_scm',